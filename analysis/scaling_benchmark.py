@@ -0,0 +1,349 @@
+#!/usr/bin/env python3
+
+# Name: scaling_benchmark.py
+# Description: script that generates synthetic document collections and
+#              simulated reads from a fixed seed, and runs the build and
+#              run sub-commands of Cliffy across a grid of parameters
+#              (number of documents, document length, similarity) while
+#              recording the time, peak memory and index size of each step.
+
+import argparse
+import sys
+import os
+import json
+import random
+import subprocess
+import time
+
+NUCS = "ACGT"
+COMPLEMENT = {"A": "T", "C": "G", "G": "C", "T": "A"}
+
+# flags used for each mode of the build and run sub-commands, the build
+# only supports the two-pass algorithm so every build mode passes -a
+BUILD_MODES = {"two-pass": ["-a", "{prefix}.tmp"],
+               "taxcomp": ["-a", "{prefix}.tmp", "-t", "-k", "{num_col}"]}
+RUN_MODES = {"plain": [],
+             "optimized": ["-z"],
+             "ftab": ["-f"]}
+
+########################################################
+# generate sub-command: writes a synthetic collection
+# of documents and a set of simulated reads.
+########################################################
+
+def generate_main(args):
+    check_if_dir_exists(args.output_dir)
+    params = generation_params(args)
+    generate_dataset(params, args.output_dir)
+
+def generation_params(args):
+    return {"num_docs": args.num_docs,
+            "doc_length": args.doc_length,
+            "similarity": args.similarity,
+            "indel_fraction": args.indel_fraction,
+            "repeat_fraction": args.repeat_fraction,
+            "repeat_length": args.repeat_length,
+            "num_repeat_families": args.num_repeat_families,
+            "num_reads": args.num_reads,
+            "read_length": args.read_length,
+            "mutation_rate": args.mutation_rate,
+            "error_rate": args.error_rate,
+            "revcomp_reads": args.revcomp_reads,
+            "seed": args.seed}
+
+def generate_dataset(params, output_dir):
+    """ writes doc_<i>_seq.fa files, a file-list and reads.fa, the same params and seed give the same files """
+    rng = random.Random(params["seed"])
+    if output_dir[-1] != '/':
+        output_dir += '/'
+
+    # the documents share a root genome with repeat families, and each
+    # one diverges from it independently (star phylogeny)
+    root = generate_root_genome(rng, params)
+    doc_paths = []
+    docs = []
+    for i in range(1, params["num_docs"]+1):
+        doc = mutate_sequence(rng, root, 1.0 - params["similarity"], params["indel_fraction"])
+        doc_path = output_dir + f"doc_{i}_seq.fa"
+        write_fasta(doc_path, [(f"doc_{i}", doc)])
+        doc_paths.append(doc_path)
+        docs.append(doc)
+    log_message(f"wrote {params['num_docs']} documents of ~{params['doc_length']} bp to {output_dir}")
+
+    filelist_path = output_dir + "input_filelist.txt"
+    with open(filelist_path, "w") as out_fd:
+        for i, doc_path in enumerate(doc_paths):
+            out_fd.write(f"{os.path.abspath(doc_path)} {i+1}\n")
+
+    # reads come from a strain of their document (mutation model), and
+    # are then subject to sequencing errors (error model)
+    reads = []
+    for i in range(params["num_reads"]):
+        doc_num = rng.randrange(params["num_docs"])
+        doc = docs[doc_num]
+        pos = rng.randrange(max(1, len(doc) - params["read_length"] + 1))
+        read = doc[pos:pos+params["read_length"]]
+        read = mutate_sequence(rng, read, params["mutation_rate"], 0.0)
+        read = mutate_sequence(rng, read, params["error_rate"], params["indel_fraction"])
+        strand = "+"
+        if params["revcomp_reads"] and rng.random() < 0.5:
+            read = reverse_complement(read)
+            strand = "-"
+        reads.append((f"read_{i} doc={doc_num+1} pos={pos} strand={strand}", read))
+
+    reads_path = output_dir + "reads.fa"
+    write_fasta(reads_path, reads)
+    log_message(f"wrote {params['num_reads']} reads of {params['read_length']} bp to {reads_path}")
+
+    with open(output_dir + "generate.json", "w") as out_fd:
+        json.dump(params, out_fd, indent=2)
+    return filelist_path, reads_path, sum(len(doc) for doc in docs)
+
+def generate_root_genome(rng, params):
+    """ random genome where repeat_fraction of the bases are copies of a few repeat families """
+    length = params["doc_length"]
+    root = list(random_dna(rng, length))
+
+    repeat_length = min(params["repeat_length"], length)
+    families = [random_dna(rng, repeat_length) for _ in range(params["num_repeat_families"])]
+    num_copies = int(params["repeat_fraction"] * length / max(repeat_length, 1))
+    for _ in range(num_copies if families else 0):
+        copy = mutate_sequence(rng, rng.choice(families), 0.02, 0.0)
+        pos = rng.randrange(length - repeat_length + 1)
+        root[pos:pos+repeat_length] = copy
+    return "".join(root)
+
+def random_dna(rng, length):
+    return "".join(rng.choices(NUCS, k=length))
+
+def mutate_sequence(rng, seq, rate, indel_fraction):
+    """ applies substitutions and short indels (1-3 bp) at the given per-base rate """
+    if rate <= 0.0 or len(seq) == 0:
+        return seq
+    num_events = sum(1 for _ in range(len(seq)) if rng.random() < rate) if len(seq) < 1000 \
+                 else int(round(rng.gauss(rate * len(seq), (rate * (1 - rate) * len(seq)) ** 0.5)))
+    num_events = max(0, min(len(seq), num_events))
+    positions = sorted(rng.sample(range(len(seq)), num_events))
+
+    pieces = []
+    prev_end = 0
+    for pos in positions:
+        if pos < prev_end:
+            continue
+        pieces.append(seq[prev_end:pos])
+        if rng.random() >= indel_fraction:
+            pieces.append(rng.choice([ch for ch in NUCS if ch != seq[pos]]))
+            prev_end = pos + 1
+        elif rng.random() < 0.5:
+            pieces.append(seq[pos] + random_dna(rng, rng.randint(1, 3)))
+            prev_end = pos + 1
+        else:
+            prev_end = pos + rng.randint(1, 3)
+    pieces.append(seq[prev_end:])
+    return "".join(pieces)
+
+def reverse_complement(seq):
+    return "".join(COMPLEMENT.get(ch, "N") for ch in reversed(seq))
+
+def write_fasta(path, records, line_width=80):
+    with open(path, "w") as out_fd:
+        for name, seq in records:
+            out_fd.write(f">{name}\n")
+            for i in range(0, len(seq), line_width):
+                out_fd.write(seq[i:i+line_width] + "\n")
+
+########################################################
+# grid sub-command: runs the build and run modes over
+# a grid of collections, and records time/memory/size.
+########################################################
+
+def grid_main(args):
+    check_if_dir_exists(args.output_dir)
+    if args.output_dir[-1] != '/':
+        args.output_dir += '/'
+
+    build_modes = parse_list(args.build_modes, str)
+    run_modes = parse_list(args.run_modes, str)
+    for mode in build_modes:
+        if mode == "one-pass":
+            error_message("the one-pass build is not supported by cliffy build yet, use two-pass")
+        if mode not in BUILD_MODES:
+            error_message(f"unknown build mode: {mode}")
+    for mode in run_modes:
+        if mode not in RUN_MODES:
+            error_message(f"unknown run mode: {mode}")
+
+    results_path = args.output_dir + "results.tsv"
+    results_fd = open(results_path, "w")
+    results_fd.write("num_docs\tdoc_length\tsimilarity\ttotal_length\tstep\tmode\tstatus\t"
+                     "wall_sec\tcpu_sec\tpeak_rss_mb\tindex_bytes\treads_per_sec\n")
+
+    for num_docs in parse_list(args.num_docs, int):
+        for doc_length in parse_list(args.doc_lengths, int):
+            for similarity in parse_list(args.similarities, float):
+                args.num_docs_value, args.doc_length_value, args.similarity_value = num_docs, doc_length, similarity
+                run_grid_point(args, build_modes, run_modes, results_fd)
+    results_fd.close()
+    log_message(f"finished the grid, results are in {results_path}")
+
+def run_grid_point(args, build_modes, run_modes, results_fd):
+    """ generates one collection, then builds and queries it with every mode """
+    tag = f"d{args.num_docs_value}_n{args.doc_length_value}_s{args.similarity_value}"
+    data_dir = args.output_dir + tag + "/data/"
+    os.makedirs(data_dir, exist_ok=True)
+
+    params = {"num_docs": args.num_docs_value, "doc_length": args.doc_length_value,
+              "similarity": args.similarity_value, "indel_fraction": args.indel_fraction,
+              "repeat_fraction": args.repeat_fraction, "repeat_length": args.repeat_length,
+              "num_repeat_families": args.num_repeat_families, "num_reads": args.num_reads,
+              "read_length": args.read_length, "mutation_rate": args.mutation_rate,
+              "error_rate": args.error_rate, "revcomp_reads": False, "seed": args.seed}
+    print(); log_message(f"grid point: {tag}")
+    filelist_path, reads_path, total_length = generate_dataset(params, data_dir)
+    row_start = f"{args.num_docs_value}\t{args.doc_length_value}\t{args.similarity_value}\t{total_length}"
+
+    for build_mode in build_modes:
+        index_dir = args.output_dir + tag + f"/{build_mode}/"
+        os.makedirs(index_dir, exist_ok=True)
+        prefix = index_dir + "index"
+
+        flags = [flag.format(prefix=prefix, num_col=args.num_col) for flag in BUILD_MODES[build_mode]]
+        cmd = [args.cliffy, "build", "-f", filelist_path, "-o", prefix,
+               "-T", str(args.threads), "-J", prefix + ".report.json"] + flags
+        usage = run_and_measure(cmd, index_dir + "build.log")
+        index_bytes = index_size(index_dir, "index.")
+        results_fd.write(f"{row_start}\tbuild\t{build_mode}\t{usage['status']}\t{usage['wall_sec']:.3f}\t"
+                         f"{usage['cpu_sec']:.3f}\t{usage['peak_rss_mb']:.1f}\t{index_bytes}\tNA\n")
+        results_fd.flush()
+        log_message(f"build ({build_mode}): {usage['wall_sec']:.2f} sec, {usage['peak_rss_mb']:.1f} MB, {index_bytes} bytes")
+        if usage["status"] != 0:
+            continue
+
+        for run_mode in run_modes:
+            out_prefix = index_dir + run_mode
+            cmd = [args.cliffy, "run", "-r", prefix, "-p", reads_path, "-o", out_prefix, "-S"] + RUN_MODES[run_mode]
+            if build_mode == "taxcomp":
+                cmd += ["-t", "-c", str(args.num_col)]
+            usage = run_and_measure(cmd, out_prefix + ".log")
+
+            reads_per_sec = "NA"
+            if usage["status"] == 0 and os.path.exists(out_prefix + ".stats.json"):
+                with open(out_prefix + ".stats.json", "r") as stats_fd:
+                    reads_per_sec = f"{json.load(stats_fd)['reads_per_sec']:.1f}"
+            results_fd.write(f"{row_start}\trun\t{build_mode}+{run_mode}\t{usage['status']}\t{usage['wall_sec']:.3f}\t"
+                             f"{usage['cpu_sec']:.3f}\t{usage['peak_rss_mb']:.1f}\tNA\t{reads_per_sec}\n")
+            results_fd.flush()
+            log_message(f"run ({build_mode}+{run_mode}): {usage['wall_sec']:.2f} sec, {reads_per_sec} reads/sec")
+
+        if not args.keep_indexes:
+            for name in os.listdir(index_dir):
+                if name.startswith("index.") and not name.endswith(".report.json"):
+                    os.remove(index_dir + name)
+
+def run_and_measure(cmd, log_path):
+    """ runs a command, and returns its exit status, wall time, CPU time and peak RSS """
+    with open(log_path, "w") as log_fd:
+        log_fd.write(" ".join(cmd) + "\n")
+        log_fd.flush()
+        start = time.time()
+        try:
+            proc = subprocess.Popen(cmd, stdout=log_fd, stderr=subprocess.STDOUT)
+        except OSError as err:
+            error_message(f"could not start {cmd[0]}: {err}")
+        _, status, rusage = os.wait4(proc.pid, 0)
+        wall_sec = time.time() - start
+    return {"status": os.waitstatus_to_exitcode(status),
+            "wall_sec": wall_sec,
+            "cpu_sec": rusage.ru_utime + rusage.ru_stime,
+            "peak_rss_mb": rusage.ru_maxrss / 1024.0}
+
+def index_size(index_dir, name_prefix):
+    total = 0
+    for name in os.listdir(index_dir):
+        if name.startswith(name_prefix) and not name.endswith(".report.json") and ".tmp" not in name:
+            total += os.path.getsize(index_dir + name)
+    return total
+
+def parse_list(values, value_type):
+    try:
+        return [value_type(value) for value in values.split(",") if value != ""]
+    except ValueError:
+        error_message(f"could not parse the list of values: {values}")
+
+########################################################
+# helper method: argument parsing, file checking, etc.
+########################################################
+
+def add_generation_arguments(parser, grid=False):
+    if not grid:
+        parser.add_argument("--num-docs", dest="num_docs", type=int, default=8, help="number of documents (default: 8)")
+        parser.add_argument("--doc-length", dest="doc_length", type=int, default=1000000, help="length of each document (default: 1000000)")
+        parser.add_argument("--similarity", dest="similarity", type=float, default=0.99, help="identity between each document and the root genome (default: 0.99)")
+        parser.add_argument("--revcomp-reads", dest="revcomp_reads", action="store_true", default=False, help="reverse-complement half of the reads")
+    parser.add_argument("--indel-fraction", dest="indel_fraction", type=float, default=0.1, help="fraction of the mutations/errors that are indels (default: 0.1)")
+    parser.add_argument("--repeat-fraction", dest="repeat_fraction", type=float, default=0.05, help="fraction of the root genome covered by repeats (default: 0.05)")
+    parser.add_argument("--repeat-length", dest="repeat_length", type=int, default=300, help="length of each repeat family (default: 300)")
+    parser.add_argument("--repeat-families", dest="num_repeat_families", type=int, default=4, help="number of repeat families (default: 4)")
+    parser.add_argument("--num-reads", dest="num_reads", type=int, default=10000, help="number of simulated reads (default: 10000)")
+    parser.add_argument("--read-length", dest="read_length", type=int, default=150, help="length of the simulated reads (default: 150)")
+    parser.add_argument("--mutation-rate", dest="mutation_rate", type=float, default=0.0, help="divergence between a read's strain and its document (default: 0.0)")
+    parser.add_argument("--error-rate", dest="error_rate", type=float, default=0.01, help="sequencing error rate of the reads (default: 0.01)")
+    parser.add_argument("--seed", dest="seed", type=int, default=0, help="seed of the generator (default: 0)")
+
+def parse_arguments():
+    main_parser = argparse.ArgumentParser(description="generate synthetic collections and measure how Cliffy scales on them.")
+    sub_parser = main_parser.add_subparsers(dest="command",
+                                            help="available sub-commands",
+                                            required=True)
+
+    # sub-command 1: generate a collection and reads
+    generate_parser = sub_parser.add_parser("generate", help="generate a synthetic collection and simulated reads.")
+    generate_parser.add_argument("--output-dir",
+                                 dest="output_dir",
+                                 help="path to output directory for FASTA files",
+                                 type=str,
+                                 required=True)
+    add_generation_arguments(generate_parser)
+
+    # sub-command 2: run the build/run modes over a grid
+    grid_parser = sub_parser.add_parser("grid", help="build and query a grid of synthetic collections.")
+    grid_parser.add_argument("--cliffy", dest="cliffy", type=str, default="cliffy", help="path to the cliffy executable (default: cliffy)")
+    grid_parser.add_argument("--output-dir", dest="output_dir", type=str, help="path to output directory for data, indexes and results", required=True)
+    grid_parser.add_argument("--num-docs", dest="num_docs", type=str, default="4,16,64", help="comma-separated numbers of documents (default: 4,16,64)")
+    grid_parser.add_argument("--doc-lengths", dest="doc_lengths", type=str, default="100000,1000000", help="comma-separated document lengths (default: 100000,1000000)")
+    grid_parser.add_argument("--similarities", dest="similarities", type=str, default="0.99", help="comma-separated similarities (default: 0.99)")
+    grid_parser.add_argument("--build-modes", dest="build_modes", type=str, default="two-pass,taxcomp", help="comma-separated build modes (default: two-pass,taxcomp)")
+    grid_parser.add_argument("--run-modes", dest="run_modes", type=str, default="plain,optimized,ftab", help="comma-separated run modes (default: plain,optimized,ftab)")
+    grid_parser.add_argument("--threads", dest="threads", type=int, default=1, help="number of threads used to build (default: 1)")
+    grid_parser.add_argument("--num-col", dest="num_col", type=int, default=7, help="number of columns for taxcomp (default: 7)")
+    grid_parser.add_argument("--keep-indexes", dest="keep_indexes", action="store_true", default=False, help="keep the index files after querying")
+    add_generation_arguments(grid_parser, grid=True)
+
+    args = main_parser.parse_args()
+    return args
+
+def check_if_file_exists(path):
+    if not os.path.exists(path):
+        error_message(f"file {path} doesn't exist.")
+
+def check_if_dir_exists(dir_path):
+    if not os.path.exists(dir_path):
+        error_message(f"directory {dir_path} does not exist, please make it.")
+
+def error_message(msg):
+    red_start = "\033[91m"; red_end = "\033[0m"
+    print(f"\n{red_start}[Error]{red_end} {msg}\n")
+    exit(1)
+
+def log_message(msg):
+    print(f"\033[92m[cliffy::log]\033[0m {msg}")
+
+if __name__ == "__main__":
+    args = parse_arguments()
+
+    if args == None or args.command not in ["generate", "grid"]:
+        error_message("need to specify a sub-command.")
+    elif args.command == "generate":
+        print(); generate_main(args)
+    elif args.command == "grid":
+        print(); grid_main(args)
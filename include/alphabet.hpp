@@ -0,0 +1,100 @@
+/*
+ * File: alphabet.hpp
+ * Description: Definition of the alphabet_map struct that maps the
+ *              characters that occur in the BWT onto a dense range
+ *              [0, sigma). All of the per-character tables used during
+ *              construction and querying are indexed by this rank so
+ *              they are sized by the alphabet instead of 256.
+ * Date: October 19th, 2026
+ */
+
+#ifndef _ALPHABET_H
+#define _ALPHABET_H
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <pfp_doc.hpp>
+
+#define ALPHABET_ABSENT 0xFF
+
+struct alphabet_map {
+    size_t sigma = 0;
+    uint8_t ranks[256]; // character -> dense rank (ALPHABET_ABSENT if not present)
+    uint8_t chars[256]; // dense rank -> character
+    bool usual[256]; // indexed by rank, symbols that are expected to dominate the text
+
+    alphabet_map() {
+        std::fill(ranks, ranks + 256, ALPHABET_ABSENT);
+        std::fill(chars, chars + 256, 0);
+        std::fill(usual, usual + 256, false);
+    }
+
+    inline uint8_t operator[](uint8_t ch) const {return ranks[ch];}
+    inline size_t size() const {return sigma;}
+    inline bool contains(uint8_t ch) const {return ranks[ch] != ALPHABET_ABSENT;}
+    inline bool is_usual(uint8_t rank) const {return usual[rank];}
+
+    void build(const std::vector<bool>& present, ref_type seq_type) {
+        /* assigns ranks in lexicographic order to every character marked present */
+        sigma = 0;
+        for (size_t ch = 0; ch < 256; ch++) {
+            if (!present[ch]) continue;
+            ASSERT((sigma < ALPHABET_ABSENT), "alphabet is too large to be compacted.");
+
+            ranks[ch] = sigma; chars[sigma] = ch;
+
+            // for nucleotide texts, anything besides A, C, G, T, U (e.g. N or IUPAC codes)
+            // is treated as noise by the queue trimming heuristics, while for the minimizer
+            // alphabet every symbol is meaningful. The sentinel (0) is never usual.
+            if (seq_type == MINIMIZER)
+                usual[sigma] = (ch != 0);
+            else
+                usual[sigma] = (ch == 'A' || ch == 'C' || ch == 'G' || ch == 'T' || ch == 'U');
+            sigma++;
+        }
+    }
+
+    static alphabet_map from_dictionary(const std::vector<uint8_t>& dict, ref_type seq_type) {
+        /*
+         * builds the alphabet from the PFP dictionary, every BWT character is either
+         * a character preceding a proper phrase suffix or the 0 used for the suffix
+         * at the start of the text. The parsing delimiters (1, 2) are never BWT chars.
+         */
+        std::vector<bool> present(256, false);
+        for (auto ch: dict) present[ch] = true;
+        present[0] = true; present[1] = false; present[2] = false;
+
+        alphabet_map alphabet;
+        alphabet.build(present, seq_type);
+        return alphabet;
+    }
+
+    static alphabet_map from_counts(const std::vector<uint64_t>& counts, ref_type seq_type = DNA) {
+        /* builds the alphabet from a per-character count vector (e.g. F column or *.runcnt) */
+        ASSERT((counts.size() == 256), "count vector for the alphabet must have 256 entries.");
+        std::vector<bool> present(256, false);
+        for (size_t ch = 0; ch < 256; ch++)
+            present[ch] = (counts[ch] > 0);
+
+        alphabet_map alphabet;
+        alphabet.build(present, seq_type);
+        return alphabet;
+    }
+
+    static alphabet_map from_runcnt_file(std::string runcnt_file, ref_type seq_type = DNA) {
+        /* builds the alphabet from the *.runcnt file written during construction */
+        std::vector<uint64_t> run_counts(256, 0);
+        std::ifstream fin_runcnt(runcnt_file, std::ios::binary | std::ios::in);
+        if (!fin_runcnt.is_open())
+            FATAL_ERROR("unable to open the *.runcnt file: %s", runcnt_file.data());
+
+        fin_runcnt.read(reinterpret_cast<char*>(run_counts.data()), 256 * sizeof(uint64_t));
+        fin_runcnt.close();
+        return from_counts(run_counts, seq_type);
+    }
+};
+
+#endif /* end of include guard: _ALPHABET_H */
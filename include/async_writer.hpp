@@ -0,0 +1,182 @@
+/*
+ * File: async_writer.hpp
+ * Description: Definition of the async_writer class, which is used for
+ *              every output file of the construction. Writes are copied
+ *              into large aligned buffers, and a full buffer is handed to
+ *              a background thread that writes it out while the builder
+ *              fills the other one. The files can optionally be opened
+ *              with O_DIRECT to bypass the page cache.
+ * Date: October 19th, 2026
+ */
+
+#ifndef _ASYNC_WRITER_H
+#define _ASYNC_WRITER_H
+
+#include <string>
+#include <thread>
+#include <algorithm>
+#include <mutex>
+#include <cstdlib>
+#include <cstring>
+#include <condition_variable>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <pfp_doc.hpp>
+
+/* size of each of the two buffers, and their alignment (needed for O_DIRECT) */
+#define WRITER_BUFFER_SIZE (4ULL << 20)
+#define WRITER_ALIGNMENT 4096
+
+class async_writer {
+    public:
+        static inline bool direct_io = false;
+
+        async_writer(const async_writer&) = delete;
+        async_writer& operator=(const async_writer&) = delete;
+
+        static async_writer* open(std::string path) {
+            /* opens the file for writing, returns nullptr if it cannot be created */
+            async_writer* writer = new async_writer();
+            if (!writer->open_file(path)) {
+                delete writer;
+                return nullptr;
+            }
+            return writer;
+        }
+
+        static void close(async_writer*& writer) {
+            /* writes out the remaining data, and releases the writer */
+            if (writer == nullptr) return;
+            writer->finish();
+            delete writer;
+            writer = nullptr;
+        }
+
+        ~async_writer() {
+            std::free(buffers[0]);
+            std::free(buffers[1]);
+        }
+
+        size_t write(const void* ptr, size_t size, size_t count) {
+            /* same contract as fwrite, the number of items written is returned */
+            const char* src = (const char*) ptr;
+            size_t num_bytes = size * count;
+            while (num_bytes > 0) {
+                size_t len = std::min(num_bytes, (size_t) WRITER_BUFFER_SIZE - fill);
+                std::memcpy(buffers[active] + fill, src, len);
+                fill += len; src += len; num_bytes -= len;
+                if (fill == WRITER_BUFFER_SIZE)
+                    submit_buffer();
+            }
+            return count;
+        }
+
+        inline int put(int c) {
+            /* same contract as fputc */
+            unsigned char ch = c;
+            write(&ch, 1, 1);
+            return ch;
+        }
+
+    private:
+        int fd = -1;
+        std::string path = "";
+        bool is_direct = false;
+
+        char* buffers[2] = {nullptr, nullptr};
+        size_t active = 0;
+        size_t fill = 0;
+
+        // state shared with the flush thread
+        std::thread flusher;
+        std::mutex lock;
+        std::condition_variable cond;
+        char* pending = nullptr;
+        size_t pending_len = 0;
+        bool done = false;
+
+        async_writer() {}
+
+        bool open_file(std::string file_path) {
+            path = file_path;
+            mode_t mode = S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH;
+            if (direct_io) {
+                fd = ::open(path.data(), O_WRONLY | O_CREAT | O_TRUNC | O_DIRECT, mode);
+                is_direct = (fd != -1);
+            }
+            // fall back to buffered I/O if the filesystem does not support O_DIRECT
+            if (fd == -1) fd = ::open(path.data(), O_WRONLY | O_CREAT | O_TRUNC, mode);
+            if (fd == -1) return false;
+
+            for (size_t i = 0; i < 2; i++) {
+                if (posix_memalign((void**) &buffers[i], WRITER_ALIGNMENT, WRITER_BUFFER_SIZE) != 0)
+                    FATAL_ERROR("issue occurred allocating the output buffer for %s", path.data());
+            }
+            flusher = std::thread(&async_writer::run_flusher, this);
+            return true;
+        }
+
+        void submit_buffer() {
+            /* hands the active buffer to the flush thread, and waits for the other one to be free */
+            std::unique_lock<std::mutex> guard(lock);
+            cond.wait(guard, [&] {return pending == nullptr;});
+            pending = buffers[active];
+            pending_len = fill;
+            cond.notify_all();
+
+            active = 1 - active;
+            fill = 0;
+        }
+
+        void run_flusher() {
+            /* flush thread: writes each submitted buffer to the file */
+            std::unique_lock<std::mutex> guard(lock);
+            while (true) {
+                cond.wait(guard, [&] {return pending != nullptr || done;});
+                if (pending == nullptr) return;
+
+                char* data = pending;
+                size_t len = pending_len;
+                guard.unlock();
+                write_fully(data, len);
+                guard.lock();
+
+                pending = nullptr;
+                cond.notify_all();
+            }
+        }
+
+        void write_fully(const char* data, size_t len) {
+            if (is_direct && len % WRITER_ALIGNMENT != 0) {
+                // O_DIRECT needs whole blocks, so the unaligned tail is written without it
+                size_t aligned_len = len - (len % WRITER_ALIGNMENT);
+                write_fully(data, aligned_len);
+                if (fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_DIRECT) == -1)
+                    FATAL_ERROR("issue occurred when turning off O_DIRECT for %s", path.data());
+                is_direct = false;
+                data += aligned_len; len -= aligned_len;
+            }
+            while (len > 0) {
+                ssize_t num_written = ::write(fd, data, len);
+                if (num_written < 0)
+                    FATAL_ERROR("issue occurred while writing to %s", path.data());
+                data += num_written; len -= num_written;
+            }
+        }
+
+        void finish() {
+            if (fill > 0) submit_buffer();
+            {
+                std::unique_lock<std::mutex> guard(lock);
+                cond.wait(guard, [&] {return pending == nullptr;});
+                done = true;
+                cond.notify_all();
+            }
+            flusher.join();
+            if (::close(fd) != 0)
+                FATAL_ERROR("issue occurred when closing %s", path.data());
+        }
+};
+
+#endif /* end of include guard: _ASYNC_WRITER_H */
@@ -0,0 +1,245 @@
+/*
+ * File: build_checkpoint.hpp
+ * Description: Definition of the build_checkpoint class, which keeps the
+ *              manifest of a build (*.ckpt) up to date. The manifest
+ *              records the parameters, the size and mtime of each input
+ *              file, the stages that have been completed so far, and the
+ *              temp stores (with their segments) that hold the 1st-pass
+ *              checkpoint. When a build is resumed, the manifest must match
+ *              the current parameters and inputs, and the completed stages
+ *              are skipped. The inputs are only hashed if asked for, since
+ *              it means reading all of them again.
+ * Date: October 19th, 2026
+ */
+
+#ifndef _BUILD_CHECKPOINT_H
+#define _BUILD_CHECKPOINT_H
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <sys/stat.h>
+#include <pfp_doc.hpp>
+#include <hash_func.hpp>
+#include <temp_store.hpp>
+
+/* stages of the build, in the order they are completed */
+#define CKPT_REFERENCE "reference"
+#define CKPT_PARSE "parse"
+#define CKPT_FIRST_PASS "first-pass"
+#define CKPT_PROFILES "profiles"
+#define CKPT_BWT "bwt"
+#define CKPT_FTAB "ftab"
+
+#define CKPT_HASH_BUFFER_SIZE (4ULL << 20)
+
+typedef struct
+{
+    std::string path = "";
+    uint64_t size = 0;
+    uint64_t mtime = 0;     // in nanoseconds
+    std::string hash = "-"; // only computed with --verify-inputs
+} checkpoint_input_t;
+
+typedef struct
+{
+    std::string name = "";
+    std::string path = "";
+    uint64_t num_bytes = 0;
+    std::vector<bool> from_memory; // which segments were written out at the checkpoint
+} checkpoint_store_t;
+
+class build_checkpoint {
+    public:
+        build_checkpoint(std::string manifest_path, std::string params, std::string input_list, bool hash_inputs = false):
+                        path(manifest_path), params(params), hash_inputs(hash_inputs)
+        {
+            /* reads the size and mtime of the file-list and every file listed in it */
+            std::vector<std::string> input_paths = {input_list};
+            std::ifstream input_fd(input_list.data());
+            std::string line = "";
+            while (std::getline(input_fd, line)) {
+                auto word_list = split(line, ' ');
+                if (word_list.size() > 0) input_paths.push_back(word_list[0]);
+            }
+            for (auto& file_path: input_paths)
+                inputs.push_back(describe_input(file_path));
+        }
+
+        bool resume() {
+            /* loads the manifest of a previous build, returns false if there is none */
+            std::ifstream manifest(path.data());
+            if (!manifest.is_open()) return false;
+
+            std::string line = "", manifest_params = "";
+            std::vector<checkpoint_input_t> manifest_inputs;
+            while (std::getline(manifest, line)) {
+                std::istringstream fields(line);
+                std::string key = "";
+                fields >> key;
+                if (key == "params") {
+                    std::getline(fields >> std::ws, manifest_params);
+                } else if (key == "input") {
+                    checkpoint_input_t input;
+                    fields >> input.size >> input.mtime >> input.hash;
+                    std::getline(fields >> std::ws, input.path);
+                    manifest_inputs.push_back(input);
+                } else if (key == "stage") {
+                    std::string stage = "";
+                    fields >> stage;
+                    stages.push_back(stage);
+                } else if (key == "store") {
+                    checkpoint_store_t store;
+                    fields >> store.name >> store.num_bytes;
+                    std::getline(fields >> std::ws, store.path);
+                    stores.push_back(store);
+                } else if (key == "segment") {
+                    std::string name = "", location = "";
+                    uint64_t offset = 0, length = 0;
+                    fields >> name >> offset >> length >> location;
+                    for (auto& store: stores)
+                        if (store.name == name) store.from_memory.push_back(location == "memory");
+                }
+            }
+
+            if (manifest_params != params)
+                FATAL_ERROR("the build parameters do not match the ones in %s, rerun without --resume.", path.data());
+            if (!same_inputs(manifest_inputs))
+                FATAL_ERROR("the input files have changed since the checkpoint in %s, rerun without --resume.", path.data());
+            return true;
+        }
+
+        void start() {
+            /* starts a new manifest, with no completed stages */
+            stages.clear();
+            stores.clear();
+            write_manifest();
+        }
+
+        bool is_complete(std::string stage) const {
+            return std::find(stages.begin(), stages.end(), stage) != stages.end();
+        }
+
+        void complete(std::string stage) {
+            /* records that the stage is finished, the manifest is replaced atomically */
+            if (is_complete(stage)) return;
+            stages.push_back(stage);
+            write_manifest();
+        }
+
+        void add_store(std::string name, std::string store_path, size_t num_bytes, const std::vector<bool>& from_memory) {
+            /* records a temp store that is part of the checkpoint, a repeated name is overwritten */
+            stores.erase(std::remove_if(stores.begin(), stores.end(), 
+                                        [&](const checkpoint_store_t& store) {return store.name == name;}), stores.end());
+            stores.push_back({name, store_path, num_bytes, from_memory});
+            write_manifest();
+        }
+
+        bool stores_intact() const {
+            /* checks that every recorded temp store still exists, and holds all of its bytes */
+            if (stores.empty()) return false;
+            for (auto& store: stores) {
+                struct stat file_stat;
+                if (stat(store.path.data(), &file_stat) == -1 || (uint64_t) file_stat.st_size < store.num_bytes)
+                    return false;
+            }
+            return true;
+        }
+
+    private:
+        std::string path = "";
+        std::string params = "";
+        bool hash_inputs = false;
+        std::vector<checkpoint_input_t> inputs;
+        std::vector<std::string> stages;
+        std::vector<checkpoint_store_t> stores;
+
+        void write_manifest() {
+            std::string tmp_path = path + ".tmp";
+            std::ofstream manifest(tmp_path.data());
+            manifest << "params " << params << "\n";
+            for (auto& input: inputs)
+                manifest << "input " << input.size << " " << input.mtime << " " << input.hash << " " << input.path << "\n";
+            for (auto& stage: stages)
+                manifest << "stage " << stage << "\n";
+            for (auto& store: stores) {
+                manifest << "store " << store.name << " " << store.num_bytes << " " << store.path << "\n";
+                for (size_t i = 0; i < store.from_memory.size(); i++) {
+                    size_t offset = i * TEMP_SEGMENT_SIZE;
+                    size_t length = std::min((size_t) TEMP_SEGMENT_SIZE, store.num_bytes - offset);
+                    manifest << "segment " << store.name << " " << offset << " " << length << " "
+                             << (store.from_memory[i] ? "memory" : "disk") << "\n";
+                }
+            }
+            manifest.close();
+
+            if (manifest.fail() || std::rename(tmp_path.data(), path.data()) != 0)
+                FATAL_ERROR("issue occurred while writing the build manifest: %s", path.data());
+        }
+
+        checkpoint_input_t describe_input(std::string file_path) const {
+            /* the size and mtime of an input file, and its hash if asked for */
+            checkpoint_input_t input;
+            input.path = file_path;
+            struct stat file_stat;
+            if (stat(file_path.data(), &file_stat) == -1)
+                FATAL_ERROR("unable to read the size of the input file: %s", file_path.data());
+            input.size = file_stat.st_size;
+            input.mtime = file_stat.st_mtim.tv_sec * 1000000000ULL + file_stat.st_mtim.tv_nsec;
+            if (hash_inputs) {
+                std::ostringstream hash;
+                hash << std::hex << hash_file(file_path);
+                input.hash = hash.str();
+            }
+            return input;
+        }
+
+        bool same_inputs(const std::vector<checkpoint_input_t>& manifest_inputs) const {
+            /* 
+             * The inputs match if they have the same paths and sizes, and the same mtimes. 
+             * With --verify-inputs, a hash in the manifest is compared instead of the mtime,
+             * so a copied or touched file with the same contents can still be resumed.
+             */
+            if (manifest_inputs.size() != inputs.size()) return false;
+            for (size_t i = 0; i < inputs.size(); i++) {
+                const checkpoint_input_t& prev = manifest_inputs[i];
+                if (prev.path != inputs[i].path || prev.size != inputs[i].size) return false;
+                bool use_hash = hash_inputs && prev.hash != "-";
+                if (use_hash && prev.hash != inputs[i].hash) return false;
+                if (!use_hash && prev.mtime != inputs[i].mtime) return false;
+            }
+            return true;
+        }
+
+        static uint64_t hash_file(std::string file_path) {
+            /* hashes the contents of the file 8 bytes at a time */
+            std::ifstream input_fd(file_path.data(), std::ios::binary);
+            if (!input_fd.is_open())
+                FATAL_ERROR("unable to open the input file for hashing: %s", file_path.data());
+
+            std::vector<char> buffer(CKPT_HASH_BUFFER_SIZE);
+            uint64_t hash = 0, total_bytes = 0;
+            while (input_fd) {
+                input_fd.read(buffer.data(), buffer.size());
+                size_t num_bytes = input_fd.gcount();
+                if (num_bytes == 0) break;
+
+                // pad the last word with zeros, the length is mixed in at the end
+                std::fill(buffer.begin() + num_bytes, buffer.begin() + ((num_bytes + 7) & ~7ULL), 0);
+                for (size_t i = 0; i < num_bytes; i += 8) {
+                    uint64_t word = 0;
+                    std::memcpy(&word, &buffer[i], 8);
+                    hash = MurmurHash3(hash ^ word);
+                }
+                total_bytes += num_bytes;
+            }
+            return MurmurHash3(hash ^ total_bytes);
+        }
+};
+
+#endif /* end of include guard: _BUILD_CHECKPOINT_H */
@@ -0,0 +1,395 @@
+/*
+ * File: build_planner.hpp
+ * Description: Definition of the build_planner class, which is used by
+ *              the plan sub-command. It scans the file-list to find the
+ *              text length (n), alphabet and number of documents (d),
+ *              and can run a quick parse over a sample of every document
+ *              to estimate the number of BWT runs (r) and the size of the
+ *              dictionary and parse. These estimates are used to predict
+ *              the peak memory and time of the one-pass and two-pass
+ *              constructions, and to pick the options for a memory budget.
+ * Note: the memory model follows the data-structures allocated by
+ *       pf_parsing, pfp_lcp and pfp_lcp_doc_two_pass, so it needs to
+ *       be updated together with them.
+ * Date: October 19th, 2026
+ */
+
+#ifndef _BUILD_PLANNER_H
+#define _BUILD_PLANNER_H
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <chrono>
+#include <algorithm>
+#include <filesystem>
+#include <pfp_doc.hpp>
+#include <pfp_scanner.hpp>
+#include <seq_normalize.hpp>
+#include <minimizer_digest.hpp>
+#include <omp.h>
+
+extern "C" {
+    #include<gsacak.h>
+}
+
+/*
+ * The constants below are rough, they were not calibrated against measured builds. The
+ * sizes come from reading the structures (pf_parsing, the temp records, the lcp queue),
+ * and the throughputs are guesses for a typical machine, so the estimates are only a
+ * starting point for choosing the options.
+ */
+
+/* bytes used by pf_parsing for each char of the dictionary and each phrase of the parse */
+#define PLAN_DICT_BYTES_PER_CHAR 48
+#define PLAN_PARSE_BYTES_PER_PHRASE 64
+
+/* compressed size of a temp record, and size of a queue entry in the one-pass algorithm */
+#define PLAN_TEMP_BYTES_PER_RECORD 4
+#define PLAN_QUEUE_ENTRY_BYTES 48
+
+/* n/r that is assumed when there is no quick parse (low, so the memory is not under-estimated) */
+#define PLAN_DEFAULT_N_OVER_R 4
+
+/* throughput of the profile construction for one thread, and of the temp storage on disk */
+#define PLAN_PROFILE_NS_PER_CHAR 150
+#define PLAN_DISK_BYTES_PER_SEC (200ULL << 20)
+
+/* memory that is kept free for the allocator and the page cache */
+#define PLAN_MEMORY_HEADROOM 0.1
+
+#define PLAN_GB 1073741824ULL
+
+typedef struct
+{
+    size_t n = 0;                // length of the text that is indexed
+    size_t r = 0;                // number of BWT runs
+    size_t d = 0;                // number of documents
+    size_t sigma = 0;            // number of distinct chars in the text
+    size_t num_files = 0;
+    size_t dict_length = 0;
+    size_t parse_length = 0;
+    size_t sample_length = 0;    // 0 if the quick parse was not run
+    double parse_sec_per_char = 0.0;
+} plan_estimates_t;
+
+typedef struct
+{
+    size_t parse_structs = 0;    // pf_parsing and the document boundaries
+    size_t tables = 0;           // predecessor tables and profiles shared by all threads
+    size_t per_thread = 0;       // tables allocated by each profile thread
+    size_t queue = 0;            // lcp queue (one-pass only)
+    size_t temp_total = 0;       // temp storage (two-pass only), in memory or on disk
+    size_t temp_in_memory = 0;
+    size_t lean_runs = 0;        // run heads and lengths kept by lean builds
+
+    size_t peak() const {return parse_structs + tables + queue + temp_in_memory + lean_runs;}
+} plan_memory_t;
+
+class build_planner {
+    public:
+        plan_estimates_t est;
+        plan_memory_t one_pass;
+        plan_memory_t two_pass;
+        size_t threads = 1;
+        size_t tmp_mem_gb = 0;
+        bool fits_budget = false;
+
+        build_planner(PFPDocPlanOptions* opts): opts(opts) {
+            /* scans the inputs, and estimates the memory of each construction */
+            scan_file_list();
+            if (opts->sample_mb > 0)
+                run_quick_parse();
+            else
+                estimate_without_sample();
+
+            one_pass = one_pass_memory();
+            choose_two_pass_options();
+        }
+
+        void print_report() const {
+            /* prints the estimates and the recommendation */
+            STATS_LOG("cliffy::stats", "documents (d): %ld, files: %ld", est.d, est.num_files);
+            STATS_LOG("cliffy::stats", "text length (n): %ld, alphabet size: %ld", est.n, est.sigma);
+            STATS_LOG("cliffy::stats", "BWT runs (r): %ld, n/r = %.2f (%s)", est.r, est.n / (double) std::max(est.r, (size_t) 1),
+                      (est.sample_length > 0) ? "measured on the sample" : "assumed, use -q for an estimate");
+            STATS_LOG("cliffy::stats", "dictionary length: %ld, parse length: %ld", est.dict_length, est.parse_length);
+
+            std::fprintf(stderr, "\n");
+            STATS_LOG("cliffy::stats", "one-pass peak memory: %.2f GB (parse: %.2f GB, tables: %.2f GB, lcp queue: %.2f GB)",
+                      to_gb(one_pass.peak()), to_gb(one_pass.parse_structs), to_gb(one_pass.tables), to_gb(one_pass.queue));
+            STATS_LOG("cliffy::stats", "two-pass peak memory: %.2f GB (parse: %.2f GB, tables: %.2f GB, temp in memory: %.2f GB)",
+                      to_gb(two_pass.peak()), to_gb(two_pass.parse_structs), to_gb(two_pass.tables), to_gb(two_pass.temp_in_memory));
+            STATS_LOG("cliffy::stats", "two-pass temp storage: %.2f GB, %.2f GB of it spills to disk (rough estimate, "
+                      "so it is not used as a limit with -s)",
+                      to_gb(two_pass.temp_total), to_gb(two_pass.temp_total - two_pass.temp_in_memory));
+            if (est.sample_length > 0)
+                STATS_LOG("cliffy::stats", "estimated time with %ld thread(s): %.1f min to parse, %.1f min for the profiles",
+                          threads, parse_seconds() / 60.0, profile_seconds() / 60.0);
+            else
+                STATS_LOG("cliffy::stats", "estimated time with %ld thread(s): %.1f min for the profiles (use -q to time the parse)",
+                          threads, profile_seconds() / 60.0);
+
+            std::fprintf(stderr, "\n");
+            if (!fits_budget)
+                FORCE_LOG("cliffy::log", "warning: the build is expected to need %.2f GB, which is over the budget of %.2f GB. "
+                          "Consider digesting the input (-j or -y) or splitting the documents.",
+                          to_gb(two_pass.peak()), to_gb(opts->mem_budget));
+            if (one_pass.peak() <= usable_memory())
+                FORCE_LOG("cliffy::log", "the one-pass algorithm would fit in the budget, but it is not supported "
+                          "for now, so the two-pass algorithm is recommended.");
+            else
+                FORCE_LOG("cliffy::log", "the one-pass algorithm does not fit in the budget, the two-pass algorithm is recommended.");
+
+            std::filesystem::path temp_dir = std::filesystem::path(opts->temp_prefix).parent_path();
+            std::error_code ec;
+            auto space = std::filesystem::space(temp_dir, ec);
+            size_t spill = two_pass.temp_total - two_pass.temp_in_memory;
+            if (!ec && spill > space.available)
+                FORCE_LOG("cliffy::log", "warning: %s has %.2f GB free, but %.2f GB of temp storage is expected to spill to disk.",
+                          temp_dir.string().data(), to_gb(space.available), to_gb(spill));
+        }
+
+        std::string build_command() const {
+            /* command-line for the build sub-command with the recommended options */
+            std::ostringstream cmd;
+            cmd << TOOL_NAME << " build -f " << opts->input_list << " -o " << opts->output_prefix
+                << " -a " << opts->temp_prefix << " -T " << threads;
+            if (tmp_mem_gb > 0) cmd << " -M " << tmp_mem_gb << "GB";
+            if (opts->use_rcomp) cmd << " -r";
+            if (opts->use_taxcomp) cmd << " -t -k " << opts->numcolsintable;
+            if (opts->use_minimizers) cmd << " -i";
+            if (opts->use_dna_minimizers) cmd << " -j";
+            if (opts->use_dna_syncmers) cmd << " -y";
+            if (opts->use_minimizers || opts->use_dna_minimizers || opts->use_dna_syncmers)
+                cmd << " -b " << opts->small_window_l << " -c " << opts->large_window_l;
+            if (opts->pfp_w != 10) cmd << " -w " << opts->pfp_w;
+            if (opts->hash_mod != 100) cmd << " -m " << opts->hash_mod;
+            if (opts->use_lean) cmd << " -L";
+            return cmd.str();
+        }
+
+    private:
+        PFPDocPlanOptions* opts = nullptr;
+        std::vector<std::string> input_files;
+        std::vector<size_t> file_lengths;
+
+        static double to_gb(size_t num_bytes) {return num_bytes / (double) PLAN_GB;}
+
+        bool use_digest() const {return opts->use_minimizers || opts->use_dna_minimizers || opts->use_dna_syncmers;}
+
+        size_t usable_memory() const {return opts->mem_budget * (1.0 - PLAN_MEMORY_HEADROOM);}
+
+        void scan_file_list() {
+            /* reads the file-list, and counts the sequence chars of every file */
+            std::ifstream input_fd(opts->input_list.data());
+            std::string line = "";
+            while (std::getline(input_fd, line)) {
+                auto word_list = split(line, ' ');
+                ASSERT((word_list.size() >= 2), "Input file-list does not have expected structure.");
+                if (!is_file(word_list[0]))
+                    FATAL_ERROR("The following path in the input list is not valid: %s", word_list[0].data());
+                if (!is_integer(word_list[1]))
+                    FATAL_ERROR("A document ID in the file_list is not an integer: %s", word_list[1].data());
+                input_files.push_back(word_list[0]);
+                est.d = std::max(est.d, (size_t) std::stoi(word_list[1]));
+            }
+            if (input_files.empty())
+                FATAL_ERROR("The provided file-list is empty.");
+            est.num_files = input_files.size();
+
+            // each file is counted on its own thread, along with the chars it uses
+            file_lengths.assign(input_files.size(), 0);
+            std::vector<std::vector<bool>> file_chars(input_files.size(), std::vector<bool>(256, false));
+            #pragma omp parallel for schedule(dynamic, 1) num_threads(opts->threads)
+            for (size_t i = 0; i < input_files.size(); i++)
+                file_lengths[i] = count_sequence_chars(input_files[i], file_chars[i]);
+
+            std::vector<bool> seen(256, false);
+            for (size_t i = 0; i < input_files.size(); i++) {
+                est.n += file_lengths[i];
+                for (size_t ch = 0; ch < 256; ch++) seen[ch] = seen[ch] || file_chars[i][ch];
+            }
+            if (opts->use_rcomp) {
+                est.n *= 2;
+                std::vector<bool> forward_seen = seen;
+                for (size_t ch = 0; ch < 128; ch++)
+                    if (forward_seen[ch]) seen[(uint8_t) comp_tab[ch]] = true;
+            }
+            est.sigma = std::count(seen.begin(), seen.end(), true) + 1; // + 1 for the terminator
+            est.n += 1;
+        }
+
+        static size_t count_sequence_chars(std::string file_path, std::vector<bool>& seen) {
+            /* returns the number of sequence chars in a FASTA file, header lines are skipped */
+            std::ifstream input_fd(file_path.data());
+            std::string line = "";
+            size_t num_chars = 0;
+            while (std::getline(input_fd, line)) {
+                if (line.empty() || line[0] == '>') continue;
+                if (line.back() == '\r') line.pop_back();
+                num_chars += line.size();
+                for (char ch: line) seen[(uint8_t) up_tab[ch & 0x7F]] = true;
+            }
+            return num_chars;
+        }
+
+        void estimate_without_sample() {
+            /* the phrases are p chars apart on average, and the dictionary is about the size of one document */
+            est.r = std::max(est.n / PLAN_DEFAULT_N_OVER_R, (size_t) 1);
+            est.parse_length = est.n / opts->hash_mod + 1;
+            est.dict_length = est.n / std::max(est.d, (size_t) 1) + est.parse_length * opts->pfp_w;
+            est.dict_length = std::min(est.dict_length, est.n + est.parse_length * opts->pfp_w);
+        }
+
+        void run_quick_parse() {
+            /* parses a sample made of the start of every file, and counts the runs in the BWT of the
+               sample. The sample keeps the documents, so the repetition across them is kept too */
+            size_t sample_limit = opts->sample_mb << 20;
+            size_t quota = std::max(sample_limit / input_files.size() / (opts->use_rcomp ? 2 : 1), (size_t) 1);
+
+            std::string sample = "";
+            size_t raw_length = 0;
+            MinimizerDigest digester(opts->small_window_l, opts->large_window_l, false, opts->use_minimizers);
+            if (opts->use_dna_syncmers) digester.set_syncmer_mode(true);
+
+            for (auto& file_path: input_files) {
+                std::string seq = read_sequence_prefix(file_path, quota);
+                upper_case_seq(seq.data(), seq.size());
+                raw_length += seq.size() * (opts->use_rcomp ? 2 : 1);
+                append_to_sample(sample, seq, digester);
+                if (opts->use_rcomp) {
+                    reverse_complement_seq(seq.data(), seq.size());
+                    append_to_sample(sample, seq, digester);
+                }
+            }
+            if (sample.empty())
+                FATAL_ERROR("the sample for the quick parse is empty, check the input files.");
+
+            // digestion shrinks the text, so the full length is scaled by the same ratio
+            if (use_digest())
+                est.n = std::max((size_t) ((est.n - 1) * (sample.size() / (double) raw_length)), (size_t) 1) + 1;
+            est.sample_length = sample.size();
+
+            auto start = std::chrono::system_clock::now();
+            pfp_scanner scanner(opts->pfp_w, opts->hash_mod);
+            scanner.add(sample.data(), sample.size());
+            scanner.finish();
+            est.parse_sec_per_char = std::chrono::duration<double>(std::chrono::system_clock::now() - start).count() / sample.size();
+
+            double scale = (est.n - 1) / (double) sample.size();
+            est.parse_length = scanner.parse.size() * scale;
+            est.dict_length = std::min((size_t) (scanner.dict.size() * scale), est.n + est.parse_length * opts->pfp_w);
+            est.r = std::max((size_t) (count_sample_runs(sample) * scale), (size_t) 1);
+        }
+
+        void append_to_sample(std::string& sample, std::string& seq, MinimizerDigest& digester) const {
+            if (use_digest()) {
+                std::string digest = "";
+                digester.compute_digest(seq.data(), seq.size(), digest);
+                sample.append(digest);
+            } else
+                sample.append(seq);
+        }
+
+        static std::string read_sequence_prefix(std::string file_path, size_t length) {
+            /* reads up to length sequence chars from the start of a FASTA file */
+            std::ifstream input_fd(file_path.data());
+            std::string line = "", seq = "";
+            while (seq.size() < length && std::getline(input_fd, line)) {
+                if (line.empty() || line[0] == '>') continue;
+                if (line.back() == '\r') line.pop_back();
+                seq.append(line, 0, std::min(line.size(), length - seq.size()));
+            }
+            return seq;
+        }
+
+        static size_t count_sample_runs(const std::string& sample) {
+            /* builds the suffix array of the sample, and counts the runs in its BWT */
+            std::vector<uint8_t> text(sample.begin(), sample.end());
+            for (auto& ch: text) ch = std::max(ch, (uint8_t) 2); // 0 and 1 are reserved by gsacak
+            text.push_back(0);
+
+            std::vector<uint_t> sa(text.size());
+            gsacak(text.data(), sa.data(), nullptr, nullptr, text.size());
+
+            size_t num_runs = 0;
+            uint8_t prev_ch = 0;
+            for (size_t i = 0; i < sa.size(); i++) {
+                uint8_t curr_ch = text[(sa[i] > 0) ? sa[i] - 1 : text.size() - 1];
+                num_runs += (i == 0 || curr_ch != prev_ch);
+                prev_ch = curr_ch;
+            }
+            return num_runs;
+        }
+
+        size_t parse_memory() const {
+            /* pf_parsing plus the bitvector of document ends */
+            return est.dict_length * PLAN_DICT_BYTES_PER_CHAR + est.parse_length * PLAN_PARSE_BYTES_PER_PHRASE + est.n / 8;
+        }
+
+        size_t profile_bytes() const {
+            return est.d * DOCWIDTH;
+        }
+
+        plan_memory_t one_pass_memory() const {
+            /* pfp_lcp keeps the predecessor tables (size_t and uint16_t) and a queue of
+               suffixes, where each run boundary in the queue has a profile of size_t */
+            plan_memory_t mem;
+            mem.parse_structs = parse_memory();
+            mem.tables = est.sigma * est.d * (sizeof(size_t) + sizeof(uint16_t) + 1);
+
+            size_t queue_length = std::min((size_t) MAXQUEUELENGTH, est.n);
+            size_t queue_boundaries = std::min(queue_length, (size_t) (queue_length * (2.0 * est.r / est.n)) + 1);
+            mem.queue = queue_length * PLAN_QUEUE_ENTRY_BYTES + queue_boundaries * est.d * sizeof(size_t);
+            mem.lean_runs = (opts->use_lean) ? est.r * (sizeof(uint64_t) + 1) : 0;
+            return mem;
+        }
+
+        plan_memory_t two_pass_memory(size_t num_threads, size_t temp_in_memory) const {
+            /* pfp_lcp_doc_two_pass keeps the predecessor table in uint16_t, and each
+               profile thread has its own table and profile for its range of suffixes */
+            plan_memory_t mem;
+            mem.parse_structs = parse_memory();
+            mem.per_thread = est.sigma * est.d * (sizeof(uint16_t) + 1) + est.d * (sizeof(size_t) + sizeof(uint16_t));
+            mem.tables = est.sigma * est.d * (sizeof(uint16_t) + 1) + num_threads * mem.per_thread;
+            mem.temp_total = est.n * PLAN_TEMP_BYTES_PER_RECORD + 2 * est.r * profile_bytes();
+            mem.temp_in_memory = std::min(temp_in_memory, mem.temp_total);
+            mem.lean_runs = (opts->use_lean) ? est.r * (sizeof(uint64_t) + 1) : 0;
+            return mem;
+        }
+
+        void choose_two_pass_options() {
+            /* uses as many threads as fit, and then keeps as much of the temp storage in memory as fits */
+            size_t budget = usable_memory();
+            size_t max_threads = (opts->threads > 0) ? opts->threads : 1;
+
+            threads = 1;
+            while (threads < max_threads && two_pass_memory(threads + 1, 0).peak() <= budget)
+                threads++;
+
+            plan_memory_t base = two_pass_memory(threads, 0);
+            fits_budget = base.peak() <= budget;
+
+            // the temp options are given in whole GB
+            size_t free_memory = (fits_budget) ? budget - base.peak() : 0;
+            size_t temp_total_gb = (base.temp_total + PLAN_GB - 1) / PLAN_GB;
+            tmp_mem_gb = std::min((size_t) (free_memory / PLAN_GB), temp_total_gb);
+
+            two_pass = two_pass_memory(threads, tmp_mem_gb * PLAN_GB);
+        }
+
+        double parse_seconds() const {
+            /* the parse is timed on the sample, the scanner threads split the text */
+            return est.parse_sec_per_char * est.n / threads;
+        }
+
+        double profile_seconds() const {
+            /* both passes over the text, and writing plus reading back the temp storage that spills */
+            double compute = est.n * PLAN_PROFILE_NS_PER_CHAR * 1e-9 / threads;
+            double disk = 2.0 * (two_pass.temp_total - two_pass.temp_in_memory) / PLAN_DISK_BYTES_PER_SEC;
+            return compute + disk;
+        }
+};
+
+#endif /* end of include guard: _BUILD_PLANNER_H */
@@ -0,0 +1,201 @@
+/*
+ * File: build_report.hpp
+ * Description: Definition of the build_report class, which measures each
+ *              stage of the build (wall and CPU time, peak RSS, heap in
+ *              use, bytes read and written) and collects the key sizes
+ *              of the index. The report is written as JSON, so it can be
+ *              compared across builds and reference collections.
+ * Note: the peak memory is the peak RSS from getrusage, and the heap in use
+ *       comes from mallinfo2() (glibc 2.33 or later), so no allocator
+ *       hooks are needed.
+ * Date: October 19th, 2026
+ */
+
+#ifndef _BUILD_REPORT_H
+#define _BUILD_REPORT_H
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <utility>
+#include <algorithm>
+#include <cstdint>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <malloc.h>
+#include <pfp_doc.hpp>
+
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+#define REPORT_HEAP_COUNT 1
+#else
+#define REPORT_HEAP_COUNT 0
+#endif
+
+typedef struct
+{
+    double wall_sec = 0.0;
+    double user_sec = 0.0;
+    double sys_sec = 0.0;
+    size_t peak_rss = 0;
+    size_t bytes_read = 0;
+    size_t bytes_written = 0;
+} usage_snapshot_t;
+
+typedef struct
+{
+    std::string name = "";
+    usage_snapshot_t usage;      // difference between the end and start of the stage
+    size_t peak_rss = 0;         // peak RSS of the process at the end of the stage
+    size_t heap_current = 0;     // heap in use at the end of the stage
+} stage_report_t;
+
+class build_report {
+    public:
+        build_report(): build_start(take_snapshot()) {}
+
+        void start_stage(std::string name) {
+            /* starts measuring a stage */
+            ASSERT((!in_stage), "a stage of the build report is already being measured.");
+            in_stage = true;
+            curr_stage = {name};
+            stage_start = take_snapshot();
+        }
+
+        void end_stage() {
+            ASSERT((in_stage), "no stage of the build report is being measured.");
+            in_stage = false;
+            usage_snapshot_t stage_end = take_snapshot();
+            curr_stage.usage = difference(stage_end, stage_start);
+            curr_stage.peak_rss = stage_end.peak_rss;
+            curr_stage.heap_current = heap_in_use();
+            stages.push_back(curr_stage);
+        }
+
+        void set_size(std::string key, size_t value) {
+            /* records one of the key sizes of the build, a repeated key is overwritten */
+            for (auto& entry: sizes) {
+                if (entry.first == key) {entry.second = value; return;}
+            }
+            sizes.push_back({key, value});
+        }
+
+        void set_param(std::string params_) {params = params_;}
+
+        void write(std::string path) const {
+            /* writes the report as a JSON object */
+            usage_snapshot_t total = difference(take_snapshot(), build_start);
+
+            std::ostringstream json;
+            json << "{\n";
+            json << "  \"tool\": \"" << TOOL_NAME << "\",\n";
+            json << "  \"version\": \"" << PFPDOC_VERSION << "\",\n";
+            json << "  \"params\": \"" << escape(params) << "\",\n";
+            json << "  \"heap_counted\": " << (REPORT_HEAP_COUNT ? "true" : "false") << ",\n";
+            json << "  \"total\": {";
+            write_usage(json, total);
+            json << ", \"peak_rss\": " << total.peak_rss << ", \"heap_current\": " << heap_in_use() << "},\n";
+
+            json << "  \"stages\": [";
+            for (size_t i = 0; i < stages.size(); i++) {
+                const stage_report_t& stage = stages[i];
+                json << ((i > 0) ? ",\n" : "\n") << "    {\"name\": \"" << escape(stage.name) << "\", ";
+                write_usage(json, stage.usage);
+                json << ", \"peak_rss\": " << stage.peak_rss << ", \"heap_current\": " << stage.heap_current << "}";
+            }
+            json << "\n  ],\n";
+
+            json << "  \"sizes\": {";
+            for (size_t i = 0; i < sizes.size(); i++)
+                json << ((i > 0) ? ", " : "") << "\"" << escape(sizes[i].first) << "\": " << sizes[i].second;
+            json << "}\n}\n";
+
+            std::ofstream report_fd(path.data());
+            report_fd << json.str();
+            report_fd.close();
+            if (report_fd.fail())
+                FATAL_ERROR("issue occurred while writing the build report: %s", path.data());
+        }
+
+    private:
+        usage_snapshot_t build_start;
+        usage_snapshot_t stage_start;
+        stage_report_t curr_stage;
+        bool in_stage = false;
+        std::string params = "";
+        std::vector<stage_report_t> stages;
+        std::vector<std::pair<std::string, size_t>> sizes;
+
+        static usage_snapshot_t take_snapshot() {
+            /* reads the current time, the CPU time and peak RSS of the process, and its I/O counters */
+            usage_snapshot_t snapshot;
+            snapshot.wall_sec = std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+
+            // the CPU time includes the helper programs (e.g. the parser), which run as children
+            struct rusage usage, child_usage;
+            getrusage(RUSAGE_SELF, &usage);
+            getrusage(RUSAGE_CHILDREN, &child_usage);
+            snapshot.user_sec = usage.ru_utime.tv_sec + usage.ru_utime.tv_usec * 1e-6 +
+                                child_usage.ru_utime.tv_sec + child_usage.ru_utime.tv_usec * 1e-6;
+            snapshot.sys_sec = usage.ru_stime.tv_sec + usage.ru_stime.tv_usec * 1e-6 +
+                               child_usage.ru_stime.tv_sec + child_usage.ru_stime.tv_usec * 1e-6;
+            snapshot.peak_rss = std::max(usage.ru_maxrss, child_usage.ru_maxrss) * 1024ULL;
+
+            // the counters in /proc/self/io include the reads served by the page cache,
+            // if it is not available the block counts from getrusage are used instead
+            std::ifstream io_fd("/proc/self/io");
+            std::string key = "";
+            size_t value = 0;
+            bool found = false;
+            while (io_fd >> key >> value) {
+                if (key == "rchar:") {snapshot.bytes_read = value; found = true;}
+                else if (key == "wchar:") snapshot.bytes_written = value;
+            }
+            if (!found) {
+                snapshot.bytes_read = usage.ru_inblock * 512ULL;
+                snapshot.bytes_written = usage.ru_oublock * 512ULL;
+            }
+            return snapshot;
+        }
+
+        static size_t heap_in_use() {
+            /* bytes allocated from the main arena and the other arenas, plus the mmap-ed chunks */
+        #if REPORT_HEAP_COUNT
+            struct mallinfo2 info = mallinfo2();
+            return info.uordblks + info.hblkhd;
+        #else
+            return 0;
+        #endif
+        }
+
+        static usage_snapshot_t difference(const usage_snapshot_t& end, const usage_snapshot_t& start) {
+            usage_snapshot_t diff;
+            diff.wall_sec = end.wall_sec - start.wall_sec;
+            diff.user_sec = end.user_sec - start.user_sec;
+            diff.sys_sec = end.sys_sec - start.sys_sec;
+            diff.peak_rss = end.peak_rss;
+            diff.bytes_read = end.bytes_read - start.bytes_read;
+            diff.bytes_written = end.bytes_written - start.bytes_written;
+            return diff;
+        }
+
+        static void write_usage(std::ostringstream& json, const usage_snapshot_t& usage) {
+            json << "\"wall_sec\": " << usage.wall_sec << ", \"cpu_user_sec\": " << usage.user_sec
+                 << ", \"cpu_sys_sec\": " << usage.sys_sec << ", \"bytes_read\": " << usage.bytes_read
+                 << ", \"bytes_written\": " << usage.bytes_written;
+        }
+
+        static std::string escape(const std::string& str) {
+            /* escapes the chars that are not allowed in a JSON string */
+            std::string out = "";
+            for (char ch: str) {
+                if (ch == '"' || ch == '\\') {out += '\\'; out += ch;}
+                else if ((uint8_t) ch < 0x20) out += ' ';
+                else out += ch;
+            }
+            return out;
+        }
+};
+
+#endif /* end of include guard: _BUILD_REPORT_H */
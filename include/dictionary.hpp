@@ -70,6 +70,13 @@ public:
     std::string tmp_filename = filename + std::string(".dict");
 
     read_file(tmp_filename.c_str(), d);
+    build_from_scan(w);
+  }
+
+  // Builds the dictionary from the content of a *.dict file already in d,
+  // this is also used when the dictionary comes from the in-process scanner.
+  void build_from_scan(size_t w)
+  {
     assert(d[0] == Dollar);
 
     // Prepending w dollars to d
@@ -0,0 +1,141 @@
+/*
+ * File: doc_listing_oracle.hpp
+ * Description: Definition of the doc_listing_oracle class, a brute-force
+ *              reference for the document listings written by the run
+ *              sub-command. It keeps the text and its suffix array, and
+ *              segments each read the same way as the backward search
+ *              (right to left, starting a new match whenever the current
+ *              one no longer occurs), but finds each match by binary
+ *              search on the suffix array and lists the documents of all
+ *              of its occurrences. It is meant for small inputs only.
+ * Date: October 19th, 2026
+ */
+
+#ifndef _DOC_LISTING_ORACLE_H
+#define _DOC_LISTING_ORACLE_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <pfp_doc.hpp>
+
+extern "C" {
+    #include <gsacak.h>
+}
+
+/* one segment of a read, [start, end] inclusive, and the documents it occurs in */
+typedef struct
+{
+    size_t start = 0;
+    size_t end = 0;
+    std::vector<size_t> docs;
+} mem_listing_t;
+
+class doc_listing_oracle {
+    public:
+        doc_listing_oracle(const std::vector<std::string>& docs) {
+            /* concatenates the documents (without separators, like the index) and builds the suffix array */
+            ASSERT((docs.size() > 0), "the oracle needs at least one document.");
+            num_docs = docs.size();
+            std::fill(present, present + 256, false);
+
+            for (size_t doc_num = 0; doc_num < docs.size(); doc_num++) {
+                for (char ch: docs[doc_num]) {
+                    ASSERT(((uint8_t) ch > 2), "the documents cannot contain the chars reserved by gsacak.");
+                    text.push_back(ch);
+                    doc_of_pos.push_back(doc_num);
+                    present[(uint8_t) ch] = true;
+                }
+            }
+            text.push_back(0);
+            doc_of_pos.push_back(num_docs - 1);
+
+            sa.resize(text.size());
+            gsacak(text.data(), sa.data(), nullptr, nullptr, text.size());
+        }
+
+        std::vector<mem_listing_t> query(const std::string& read) const {
+            /* segments the read from right to left, and lists the documents of each segment */
+            std::vector<mem_listing_t> listings;
+            if (read.empty()) return listings;
+
+            int end_pos = read.size() - 1;
+            for (int i = read.size() - 1; i >= 0; i--) {
+                // chars missing from the text end the current match, and get an empty listing
+                if (!present[(uint8_t) read[i]]) {
+                    if (end_pos > i) listings.push_back(make_listing(read, i + 1, end_pos));
+                    listings.push_back({(size_t) i, (size_t) i, {}});
+                    end_pos = i - 1;
+                    continue;
+                }
+                // once read[i..end] does not occur, report read[i+1..end] and restart at i
+                if (end_pos > i && count_occurrences(read.data() + i, end_pos - i + 1) == 0) {
+                    listings.push_back(make_listing(read, i + 1, end_pos));
+                    end_pos = i;
+                }
+            }
+            if (end_pos >= 0) listings.push_back(make_listing(read, 0, end_pos));
+            return listings;
+        }
+
+        std::vector<size_t> list_documents(const char* pattern, size_t length) const {
+            /* sorted list of the documents where an occurrence of the pattern starts */
+            std::pair<size_t, size_t> range = sa_range(pattern, length);
+            std::vector<bool> found(num_docs, false);
+            for (size_t j = range.first; j < range.second; j++)
+                found[doc_of_pos[sa[j]]] = true;
+
+            std::vector<size_t> docs;
+            for (size_t doc_num = 0; doc_num < num_docs; doc_num++)
+                if (found[doc_num]) docs.push_back(doc_num);
+            return docs;
+        }
+
+        size_t count_occurrences(const char* pattern, size_t length) const {
+            std::pair<size_t, size_t> range = sa_range(pattern, length);
+            return range.second - range.first;
+        }
+
+        size_t size() const {return text.size();}
+
+    private:
+        std::vector<uint8_t> text;
+        std::vector<uint_t> sa;
+        std::vector<size_t> doc_of_pos;
+        bool present[256];
+        size_t num_docs = 0;
+
+        mem_listing_t make_listing(const std::string& read, size_t start, size_t end) const {
+            return {start, end, list_documents(read.data() + start, end - start + 1)};
+        }
+
+        int compare_suffix(size_t suffix, const char* pattern, size_t length) const {
+            /* compares the suffix truncated to the pattern length with the pattern */
+            size_t suffix_length = text.size() - suffix;
+            int cmp = std::memcmp(text.data() + suffix, pattern, std::min(length, suffix_length));
+            if (cmp != 0) return cmp;
+            return (suffix_length < length) ? -1 : 0;
+        }
+
+        std::pair<size_t, size_t> sa_range(const char* pattern, size_t length) const {
+            /* [first, second) is the range of suffixes starting with the pattern */
+            size_t lo = 0, hi = sa.size();
+            while (lo < hi) {
+                size_t mid = lo + (hi - lo) / 2;
+                if (compare_suffix(sa[mid], pattern, length) < 0) lo = mid + 1;
+                else hi = mid;
+            }
+            size_t first = lo;
+            hi = sa.size();
+            while (lo < hi) {
+                size_t mid = lo + (hi - lo) / 2;
+                if (compare_suffix(sa[mid], pattern, length) <= 0) lo = mid + 1;
+                else hi = mid;
+            }
+            return {first, lo};
+        }
+};
+
+#endif /* end of include guard: _DOC_LISTING_ORACLE_H */
@@ -17,12 +17,18 @@
 #include <pfp_doc.hpp>
 #include <string>
 #include <minimizer_digest.hpp>
+#include <seq_normalize.hpp>
+#include <alphabet.hpp>
+#include <query_stats.hpp>
+#include <query_engine.hpp>
 
 template <class sparse_bv_type = ri::sparse_sd_vector,
           class rle_string_t = ms_rle_string_sd>
 class doc_queries : ri::r_index<sparse_bv_type, rle_string_t>
 {
     public:
+        query_stats stats;
+
         doc_queries(std::string filename, size_t dummy_val): ri::r_index<sparse_bv_type, rle_string_t>()
         {
             /* special constructor: used to load raw BWT files and then serialize them */
@@ -51,6 +57,31 @@ class doc_queries : ri::r_index<sparse_bv_type, rle_string_t>
             DONE_LOG((std::chrono::system_clock::now() - start));
         }
 
+        doc_queries(std::string filename, std::string run_heads, const std::vector<uint64_t>& run_lengths): 
+                    ri::r_index<sparse_bv_type, rle_string_t>()
+        {
+            /* special constructor: used by lean builds to serialize the BWT runs kept in memory */
+            STATUS_LOG("query_main", "serializing BWT and F to disk");
+            auto start = std::chrono::system_clock::now();
+
+            build_F_from_runs(run_heads, run_lengths);
+            this->bwt = rle_string_t(std::move(run_heads), run_lengths);
+
+            std::string outfile = filename + ".bwt.cliffy";
+            std::ofstream out_bwt(outfile);
+
+            serialize_bwt(out_bwt);
+            out_bwt.close();
+
+            outfile = filename + ".F.cliffy";
+            std::ofstream out_F(outfile, std::ios::binary);
+
+            serialize_F(out_F);
+            out_F.close();
+
+            DONE_LOG((std::chrono::system_clock::now() - start));
+        }
+
         doc_queries(std::string filename,
                     std::string output_path="", 
                     size_t num_profiles=0, 
@@ -60,8 +91,8 @@ class doc_queries : ri::r_index<sparse_bv_type, rle_string_t>
                     output_ref(filename),
                     // start_doc_profiles(256, std::vector<std::vector<uint16_t>>(0, std::vector<uint16_t>(0))),
                     // end_doc_profiles(256, std::vector<std::vector<uint16_t>>(0, std::vector<uint16_t>(0))),
-                    start_doc_profiles2(256, std::vector<std::vector<uint16_t>>(0, std::vector<uint16_t>(0))),
-                    end_doc_profiles2(256, std::vector<std::vector<uint16_t>>(0, std::vector<uint16_t>(0)))
+                    start_doc_profiles2(0, std::vector<std::vector<uint16_t>>(0, std::vector<uint16_t>(0))),
+                    end_doc_profiles2(0, std::vector<std::vector<uint16_t>>(0, std::vector<uint16_t>(0)))
         {
             // load the BWT & F
             STATUS_LOG("query_main", "loading the bwt of the input text and F column");
@@ -114,10 +145,14 @@ class doc_queries : ri::r_index<sparse_bv_type, rle_string_t>
             // load the profiles for starts and ends (new-way)
             STATUS_LOG("query_main", "loading the document array profiles");
             start = std::chrono::system_clock::now();
+
+            // the profile matrices are indexed by the dense rank of each BWT character
+            alphabet = alphabet_map::from_runcnt_file(filename + ".runcnt");
             
             read_doc_profiles_new_way(start_doc_profiles2, 
                                       filename + ".sdap", 
                                       filename + ".runcnt",
+                                      alphabet,
                                       this->num_docs, 
                                       this->r, 
                                       output_path + ".sdap.csv", 
@@ -125,6 +160,7 @@ class doc_queries : ri::r_index<sparse_bv_type, rle_string_t>
             read_doc_profiles_new_way(end_doc_profiles2, 
                                       filename + ".edap",
                                       filename + ".runcnt", 
+                                      alphabet,
                                       this->num_docs, 
                                       this->r, 
                                       output_path + ".edap.csv", 
@@ -142,218 +178,8 @@ class doc_queries : ri::r_index<sparse_bv_type, rle_string_t>
                             size_t small_window_l,
                             size_t large_window_l){
             /* Takes in a file of reads, and lists all the documents containing the read */
-
-            STATUS_LOG("query_main", "processing the patterns");
-            auto start_time = std::chrono::system_clock::now();
-
-            // open output/input files
-            std::ofstream listings_fd (output_prefix + ".listings");
-            gzFile fp; kseq_t* seq;
-            fp = gzopen(pattern_file.data(), "r"); 
-
-            if(fp == 0) {std::exit(1);}
-            seq = kseq_init(fp);
-
-            // lambda to print out the document listing
-            auto process_profile = [&](std::vector<uint16_t> profile, uint16_t length) {
-                    std::string output_str = "{";
-                    bool found_one = false;
-
-                    for (size_t i = 0; i < profile.size(); i++) {
-                        //std::cout << "length = " << length << "  profile_val = " << profile[i] << std::endl;
-                        if (profile[i] >= length) {
-                            output_str += "," + std::to_string(i);
-                            found_one = true;
-                        }
-                    }
-
-                    if (found_one)
-                        output_str = "{" + output_str.substr(2) + "} ";
-                    else {   
-                        output_str = "{} ";
-                    }                
-                    listings_fd << output_str;
-            };
-
-            // build minimizer digest object (only used if needed)
-            MinimizerDigest digester; 
-            digester.set_lexorder(false);
-            digester.set_windows(small_window_l, large_window_l);
-            if (database_type == MINIMIZER) digester.set_minimizer_alp(true);
-
-            // process each read, and print out the document lists
-            while (kseq_read(seq)>=0) {
-                // uppercase every letter in read
-                for (int j = 0; j < seq->seq.l; j++) {seq->seq.s[j] = up_tab[(int) seq->seq.s[j]];}
-
-                // digest read if needed
-                std::string input_read = seq->seq.s;
-                size_t read_length = 0;
-
-                if (database_type == DNA_MINIMIZER) {input_read = digester.compute_digest(input_read);}
-                else if (database_type == MINIMIZER) {input_read = digester.compute_digest(input_read);}
-                read_length = input_read.size();
-
-                listings_fd << ">" << seq->name.s << "\n";
-                
-                // initialize variables to use for backward search
-                size_t start = 0, end = this->bwt.size(), end_pos_of_match = read_length-1;
-                size_t start_run = 0, end_run = this->r - 1;
-                size_t num_ch_before_start = 0, num_ch_before_end = 0;
-                std::vector<uint16_t> curr_profile (this->num_docs, 0);
-                uint16_t length = 0;
-
-                // pointer variables to current profile being "used"
-                uint8_t curr_prof_ch = 0;
-                size_t curr_prof_pos = 0, num_LF_steps = 0;
-
-                // tell us what type of profile to grab based on pointer variables
-                bool use_start = false, use_end = false; bool pointer_set = false;
-
-                // perform backward search and report document listings when
-                // range goes empty or we reach the end
-                for (int i = (read_length-1); i >= 0; i--) {
-
-                    uint8_t next_ch = input_read[i];
-
-                    if (this->bwt.number_of_letter(next_ch) == 0) {
-                        // step 1: print listing for [i+1,end]
-                        if (pointer_set) {
-                            if (use_end)
-                                curr_profile = end_doc_profiles2[curr_prof_ch][curr_prof_pos];
-                            else
-                                curr_profile = start_doc_profiles2[curr_prof_ch][curr_prof_pos];
-                            std::for_each(curr_profile.begin(), curr_profile.end(), [&](uint16_t &x){x = std::min((size_t) MAXLCPVALUE, x+num_LF_steps);});
-
-                            listings_fd << "[" << (i+1) << "," << end_pos_of_match << "] ";
-
-                            length = std::min((size_t) MAXLCPVALUE, (end_pos_of_match-i));
-                            process_profile(curr_profile, length);
-                            end_pos_of_match = i;
-                        }
-                        // step 2: print an empty listing for current character
-                        listings_fd << "[" << i << "," << i << "] {} ";
-                        end_pos_of_match = i - 1;
-
-                        // step 3: reset variables to full bwt range
-                        start = 0; end = this->bwt.size();
-                        start_run = 0; end_run = this->r - 1;
-                        num_ch_before_start = 0;
-                        num_ch_before_end = 0;
-
-                        // step 4: reset pointer and go back to top of loop
-                        pointer_set = false;
-                        continue;
-                    }
-
-                    // identify the run # that start and end are in
-                    num_ch_before_start = this->bwt.rank(start, next_ch); 
-                    num_ch_before_end = this->bwt.rank(end, next_ch);
-                    start_run = this->bwt.run_of_position(start);
-                    end_run = this->bwt.run_of_position(end-1);
-                    
-                    // range spans runs, so there are different BWT characters
-                    if (start_run != end_run) 
-                    {       
-                        // bwt range is empty, so will reset start and end
-                        if (num_ch_before_end == num_ch_before_start) {
-
-                            // grab the correct current profile, and update with steps
-                            if (use_end)
-                                curr_profile = end_doc_profiles2[curr_prof_ch][curr_prof_pos];
-                            else
-                                curr_profile = start_doc_profiles2[curr_prof_ch][curr_prof_pos];
-                            std::for_each(curr_profile.begin(), curr_profile.end(), [&](uint16_t &x){x = std::min((size_t) MAXLCPVALUE, x+num_LF_steps);});
-
-                            listings_fd << "[" << (i+1) << "," << end_pos_of_match << "] ";
-
-                            length = std::min((size_t) MAXLCPVALUE, (end_pos_of_match-i));
-                            process_profile(curr_profile, length);
-                            end_pos_of_match = i;
-
-                            start = 0; end = this->bwt.size();
-                            start_run = 0; end_run = this->r - 1;
-                            num_ch_before_start = 0;
-                            num_ch_before_end = this->bwt.number_of_letter(next_ch);
-                        }
-
-                        // grab any profile at run boundary of next_ch (choose first one)
-                        curr_prof_ch = next_ch;
-                        curr_prof_pos = this->bwt.run_head_rank(start_run, next_ch);
-                        num_LF_steps = 0;
-                        use_start = false; use_end = false;
-                        pointer_set = true;
-
-                        // if the start position run is the same as query
-                        // ch, then we can guarantee that end of run is in the range
-                        // otherwise, we can guarantee the start of run is in range.
-                        if (this->bwt[start] == next_ch)
-                            use_end = true;
-                        else
-                            use_start = true;
-                    } 
-                    // range is within BWT run, but wrong character 
-                    else if (this->bwt[start] != next_ch) 
-                    {
-                        // grab the correct current profile, and update with steps
-                        if (use_end)
-                            curr_profile = end_doc_profiles2[curr_prof_ch][curr_prof_pos];
-                        else
-                            curr_profile = start_doc_profiles2[curr_prof_ch][curr_prof_pos];
-                        std::for_each(curr_profile.begin(), curr_profile.end(), [&](uint16_t &x){x = std::min((size_t) MAXLCPVALUE, x+num_LF_steps);});
-
-                        listings_fd << "[" << (i+1) << "," << end_pos_of_match << "] ";
-
-                        length = std::min((size_t) MAXLCPVALUE, (end_pos_of_match-i));
-                        process_profile(curr_profile, length);
-                        end_pos_of_match = i;
-
-                        start = 0; end = this->bwt.size();
-                        start_run = 0; end_run = this->r - 1;
-                        num_ch_before_start = 0;
-                        num_ch_before_end = this->bwt.number_of_letter(next_ch);
-
-                        // grab any profile at run boundary of next_ch (choose first one)
-                        curr_prof_ch = next_ch;
-                        curr_prof_pos = this->bwt.run_head_rank(start_run, next_ch);
-                        num_LF_steps = 0;
-                        use_start = false; use_end = false;
-                        pointer_set = true;
-
-                        // if the start position run is the same as query
-                        // ch, then we can guarantee that end of run is in the range
-                        // otherwise, we can guarantee the start of run is in range.
-                        if (this->bwt[start] == next_ch)
-                            use_end = true;
-                        else
-                            use_start = true;
-                    }
-                    // range is within BWT run, and is the correct character
-                    else 
-                    {
-                        num_LF_steps++;
-                    }
-
-                    // Perform an LF step
-                    start = num_ch_before_start + this->F[next_ch]; 
-                    end = num_ch_before_end + this->F[next_ch];
-                }
-                // grab the current profile, and update with steps
-                if (use_end)
-                    curr_profile = end_doc_profiles2[curr_prof_ch][curr_prof_pos];
-                else
-                    curr_profile = start_doc_profiles2[curr_prof_ch][curr_prof_pos];
-
-                // update profile based on LF steps
-                std::for_each(curr_profile.begin(), curr_profile.end(), [&](uint16_t &x){x = std::min((size_t) MAXLCPVALUE, x+num_LF_steps);});
-
-                listings_fd << "[" << 0 << "," << end_pos_of_match << "] ";
-                length = std::min((size_t) MAXLCPVALUE, end_pos_of_match+1);
-
-                process_profile(curr_profile, length);
-                listings_fd << "\n";
-            }
-            DONE_LOG((std::chrono::system_clock::now() - start_time));
+            run_query_engine<no_seeding>(*this, pattern_file, output_prefix + ".listings", 
+                                         database_type, small_window_l, large_window_l);
         }
 
         void query_profiles_optimized(std::string pattern_file, 
@@ -361,213 +187,9 @@ class doc_queries : ri::r_index<sparse_bv_type, rle_string_t>
                                       ref_type database_type,
                                       size_t small_window_l,
                                       size_t large_window_l) {
-            /* query reads using the ftab to accelerate queries */
-
-            STATUS_LOG("query_main", "processing the patterns");
-            auto start_time = std::chrono::system_clock::now();
-
-            // open output/input files
-            std::ofstream listings_fd (output_prefix + ".listings");
-            gzFile fp; kseq_t* seq;
-            fp = gzopen(pattern_file.data(), "r"); 
-
-            if(fp == 0) {std::exit(1);}
-            seq = kseq_init(fp);
-
-            // initialize variables for backward search
-            size_t start = 0, end = this->bwt.size(), end_pos_of_match = 0;
-            size_t start_run = 0, end_run = 0;
-            size_t num_ch_before_start = 0, num_ch_before_end = 0;
-
-            std::vector<uint16_t> curr_profile (this->num_docs, 0);
-            uint16_t length = 0; uint8_t next_ch = 0;
-            int i = 0; size_t read_length = 0;
-            bool pointer_set = false;
-
-            // initialize variables for identifying correct document array profile
-            uint8_t curr_prof_ch = 0;
-            size_t curr_prof_pos = 0, num_LF_steps = 0;
-
-            // initialize variables for which profile to use
-            bool use_start = false, use_end = false;
-
-            // lambda to print out the document listing
-            auto process_profile = [&](std::vector<uint16_t> profile, uint16_t length) {
-                    std::string output_str = "{";
-                    bool found_one = false;
-
-                    for (size_t i = 0; i < profile.size(); i++) {
-                        if (profile[i] >= length) {
-                            output_str += "," + std::to_string(i);
-                            found_one = true;
-                        }
-                    }
-
-                    if (found_one)
-                        output_str = "{" + output_str.substr(2) + "} ";
-                    else {   
-                        output_str = "{} ";
-                    }                
-                    listings_fd << output_str;
-            };
-
-            // lambda to output the document listing for current exact match 
-            auto generate_listing = [this, &process_profile, &listings_fd,
-                                         &curr_prof_ch, &curr_prof_pos, &num_LF_steps,
-                                         &i, &end_pos_of_match, &use_end, &length, &pointer_set] 
-                                        () {
-                // only grab pointer if it has been set already
-                if (pointer_set) {
-
-                    // grab the correct current profile
-                    std::vector<uint16_t> curr_profile (this->num_docs, 0);
-                    if (use_end)
-                        curr_profile = end_doc_profiles2[curr_prof_ch][curr_prof_pos];
-                    else
-                        curr_profile = start_doc_profiles2[curr_prof_ch][curr_prof_pos];
-
-                    // update it with LF steps, and print out start/end
-                    std::for_each(curr_profile.begin(), curr_profile.end(), [&](uint16_t &x){x = std::min((size_t) MAXLCPVALUE, x+num_LF_steps);});
-                    listings_fd << "[" << (i+1) << "," << end_pos_of_match << "] ";
-
-                    length = std::min((size_t) MAXLCPVALUE, (end_pos_of_match-i));
-                    process_profile(curr_profile, length);
-                    end_pos_of_match = i;
-                }
-            };
-
-            // lambda to output empty listing for current position
-            auto generate_empty_listing = [this, &i, &end_pos_of_match, &listings_fd] {
-                listings_fd << "[" << i << "," << end_pos_of_match << "] {} ";
-                end_pos_of_match = i - 1;
-            };
-
-            // lambda to reset bwt variables to full range
-            auto initialize_to_full_range = [this, &start, &end, &start_run, &end_run,
-                                             &num_ch_before_start, &num_ch_before_end, &next_ch] () {
-                start = 0; end = this->bwt.size();
-                start_run = 0; end_run = this->r - 1;
-                num_ch_before_start = 0;
-                num_ch_before_end = this->bwt.number_of_letter(next_ch);
-            };
-
-            // lambda to reset bwt variables to full range after empty listing
-            auto initialize_to_full_range_after_empty = [this, &start, &end, &start_run, &end_run,
-                                             &num_ch_before_start, &num_ch_before_end, &next_ch] () {
-                start = 0; end = this->bwt.size();
-                start_run = 0; end_run = this->r - 1;
-                num_ch_before_start = 0;
-                num_ch_before_end = 0;
-            };
-
-            // lambda to choose a new document array profile to use
-            auto update_profile_pointer = [this, &curr_prof_ch, &next_ch, &curr_prof_pos,
-                                           &start_run, &num_LF_steps, &use_start, &use_end, 
-                                           &start, &pointer_set] () {
-                
-                // turn on variable to show we have found set it
-                pointer_set = true;
-
-                // grab any profile at run boundary of next_ch (choose first one)
-                curr_prof_ch = next_ch;
-                curr_prof_pos = this->bwt.run_head_rank(start_run, next_ch);
-                num_LF_steps = 0;
-                use_start = false; use_end = false;
-
-                // if the start position run is the same as query
-                // ch, then we can guarantee that end of run is in the range
-                // otherwise, we can guarantee the start of run is in range.
-                if (this->bwt[start] == next_ch)
-                    use_end = true;
-                else
-                    use_start = true;
-            };
-
-            // build minimizer digest object (only used if needed)
-            MinimizerDigest digester; 
-            digester.set_lexorder(false);
-            digester.set_windows(small_window_l, large_window_l);
-            if (database_type == MINIMIZER) digester.set_minimizer_alp(true);
-
-            // process each read, and print out the document lists
-            while (kseq_read(seq)>=0) {
-                // uppercase every letter in read
-                for (int j = 0; j < seq->seq.l; j++) {seq->seq.s[j] = up_tab[(int) seq->seq.s[j]];}
-
-                // digest read if needed
-                std::string input_read = seq->seq.s;
-                read_length = 0;
-
-                if (database_type == DNA_MINIMIZER) {input_read = digester.compute_digest(input_read);}
-                else if (database_type == MINIMIZER) {input_read = digester.compute_digest(input_read);}
-                read_length = input_read.size();
-
-                // include read name in output file
-                listings_fd << ">" << seq->name.s << "\n";
-
-                // re-initialize variables to use for backward search
-                start = 0; end = this->bwt.size(); 
-                end_pos_of_match = read_length-1; length = 0;
-
-                curr_prof_ch = 0; curr_prof_pos = 0, num_LF_steps = 0;
-                use_start = false, use_end = false; pointer_set = false;
-
-                // initialize position variable 
-                i = (read_length-1);
-
-                // perform backward search and report document listings
-                while (i >= 0) {
-                    // already upper-cased
-                    next_ch = input_read[i];
-
-                    // special case: next_ch does not occur in text
-                    if (this->bwt.number_of_letter(next_ch) == 0) {
-                        generate_listing(); // listing for [i+1,end] ...
-                        generate_empty_listing(); // empty listing for [i,i] ...
-
-                        i--; 
-                        initialize_to_full_range_after_empty();
-                        pointer_set = false;
-                        continue;
-                    }
-
-                    // identify the run # that start and end are in
-                    num_ch_before_start = this->bwt.rank(start, next_ch); 
-                    num_ch_before_end = this->bwt.rank(end, next_ch);
-                    start_run = 0; end_run = 0;
-
-                    // calculate key variables
-                    size_t range_length = end - start;
-                    size_t num_next_ch_in_range = num_ch_before_end - num_ch_before_start;
-
-                    // range is within BWT run, and it is the next character
-                    if (range_length == num_next_ch_in_range) {
-                        num_LF_steps++;
-                    } 
-                    // range does not contain the next character 
-                    else if (num_next_ch_in_range == 0) {
-                        generate_listing();
-                        initialize_to_full_range(); 
-                        update_profile_pointer();
-                    }
-                    // range spans a run boundary, and contains the next character
-                    else {
-                        // update start_run variable here since it is used by following lambda
-                        start_run = this->bwt.run_of_position(start);
-                        update_profile_pointer();
-                    }
-
-                    // Perform an LF step
-                    start = num_ch_before_start + this->F[next_ch]; 
-                    end = num_ch_before_end + this->F[next_ch];
-
-                    // move to next character
-                    i--;
-                }
-                generate_listing(); listings_fd << "\n";
-            }
-            listings_fd.close();
-            DONE_LOG((std::chrono::system_clock::now() - start_time));
+            /* query reads with a single rank query per character when the range stays in one run */
+            run_query_engine<no_seeding>(*this, pattern_file, output_prefix + ".listings", 
+                                         database_type, small_window_l, large_window_l);
         }
 
         void query_profiles_with_ftab(std::string pattern_file, 
@@ -576,267 +198,8 @@ class doc_queries : ri::r_index<sparse_bv_type, rle_string_t>
                                       size_t small_window_l,
                                       size_t large_window_l) {
             /* query reads using the ftab to accelerate queries */
-
-            STATUS_LOG("query_main", "querying the patterns");
-            auto start_time = std::chrono::system_clock::now();
-
-            // open output/input files
-            std::ofstream listings_fd (output_prefix + ".listings");
-            gzFile fp; kseq_t* seq;
-            fp = gzopen(pattern_file.data(), "r"); 
-
-            if(fp == 0) {std::exit(1);}
-            seq = kseq_init(fp);
-
-            // initialize variables for tracking length
-            size_t length_sum = 0, num_matches = 0, num_reads = 0;
-
-            // initialize ftab-related variables
-            size_t curr_ftab_length = FTAB_ENTRY_LENGTH;
-            if (database_type == MINIMIZER) curr_ftab_length = FTAB_ENTRY_LENGTH_MIN;
-
-            char curr_ftab_char[curr_ftab_length+1] = "";
-            std::string curr_ftab_str = "";
-            size_t curr_ftab_num = 0;
-            int ftab_pos = 0;
-
-            // initialize variables for backward search
-            size_t start = 0, end = this->bwt.size(), end_pos_of_match = 0;
-            size_t start_run = 0, end_run = 0;
-            size_t num_ch_before_start = 0, num_ch_before_end = 0;
-
-            std::vector<uint16_t> curr_profile (this->num_docs, 0);
-            uint16_t length = 0; uint8_t next_ch = 0;
-            int i = 0; size_t read_length = 0;
-            bool pointer_set = false;
-
-            // initialize variables for identifying correct document array profile
-            uint8_t curr_prof_ch = 0;
-            size_t curr_prof_pos = 0, num_LF_steps = 0;
-
-            // initialize variables for which profile to use
-            bool use_start = false, use_end = false;
-
-            // lambda to print out the document listing
-            auto process_profile = [&](std::vector<uint16_t> profile, uint16_t length) {
-                    std::string output_str = "{";
-                    bool found_one = false;
-
-                    // go through profile and compare to length
-                    for (size_t i = 0; i < profile.size(); i++) {
-                        if (profile[i] >= length) {
-                            output_str += "," + std::to_string(i);
-                            found_one = true;
-                        }
-                    }
-
-                    if (found_one)
-                        output_str = "{" + output_str.substr(2) + "} ";
-                    else  
-                        output_str = "{} ";             
-                    listings_fd << output_str;
-            };
-
-            // lambda to output the document listing for current exact match 
-            auto generate_listing = [this, &process_profile, &listings_fd,
-                                         &curr_prof_ch, &curr_prof_pos, &num_LF_steps,
-                                         &i, &end_pos_of_match, &use_end, &length,
-                                         &length_sum, &num_matches, &pointer_set] 
-                                        () {
-                if (pointer_set) {
-                    // grab the correct current profile
-                    std::vector<uint16_t> curr_profile (this->num_docs, 0);
-                    if (use_end)
-                        curr_profile = end_doc_profiles2[curr_prof_ch][curr_prof_pos];
-                    else
-                        curr_profile = start_doc_profiles2[curr_prof_ch][curr_prof_pos];
-
-                    // update it with LF steps
-                    std::for_each(curr_profile.begin(), curr_profile.end(), [&](uint16_t &x){x = std::min((size_t) MAXLCPVALUE, x+num_LF_steps);});
-                    listings_fd << "[" << (i+1) << "," << end_pos_of_match << "] ";
-
-                    // use other lambda to produce listing
-                    length = std::min((size_t) MAXLCPVALUE, (end_pos_of_match-i));
-                    process_profile(curr_profile, length);
-                    end_pos_of_match = i;
-
-                    length_sum += length;
-                    num_matches++;
-                }
-            };
-
-            // lambda to output empty listing for current position
-            auto generate_empty_listing = [this, &i, &end_pos_of_match, &listings_fd] {
-                listings_fd << "[" << i << "," << end_pos_of_match << "] {} ";
-                end_pos_of_match = i - 1;
-            };
-
-            // lambda to reset bwt variables to full range
-            auto initialize_to_full_range = [this, &start, &end, &start_run, &end_run,
-                                             &num_ch_before_start, &num_ch_before_end, &next_ch] () {
-                start = 0; end = this->bwt.size();
-                start_run = 0; end_run = this->r - 1;
-                num_ch_before_start = 0;
-                num_ch_before_end = this->bwt.number_of_letter(next_ch);
-            };
-
-            // lambda to reset bwt variables to full range after empty listing
-            auto initialize_to_full_range_after_empty = [this, &start, &end, &start_run, &end_run,
-                                             &num_ch_before_start, &num_ch_before_end, &next_ch] () {
-                start = 0; end = this->bwt.size();
-                start_run = 0; end_run = this->r - 1;
-                num_ch_before_start = 0;
-                num_ch_before_end = 0;
-            };
-
-            // lambda to choose a new document array profile to use
-            auto update_profile_pointer = [this, &curr_prof_ch, &next_ch, &curr_prof_pos,
-                                           &start_run, &num_LF_steps, &use_start, &use_end, 
-                                           &start, &pointer_set] () {
-                
-                // turn on variable to show we have found set it
-                pointer_set = true;
-                
-                // grab any profile at run boundary of next_ch (choose first one)
-                curr_prof_ch = next_ch;
-                curr_prof_pos = this->bwt.run_head_rank(start_run, next_ch);
-                num_LF_steps = 0;
-                use_start = false; use_end = false;
-
-                // if the start position run is the same as query
-                // ch, then we can guarantee that end of run is in the range
-                // otherwise, we can guarantee the start of run is in range.
-                if (this->bwt[start] == next_ch)
-                    use_end = true;
-                else
-                    use_start = true;
-            };
-
-            // lambda to extract ftab entry and load variables
-            auto load_ftab_entry = [this, &ftab_pos, &start, &end, &curr_prof_pos, &num_LF_steps,
-                                    &curr_prof_ch, &use_start, &use_end, &i, &curr_ftab_length, &pointer_set] () {
-                start = ftab[ftab_pos][0]; 
-                end = ftab[ftab_pos][1];
-                curr_prof_pos = ftab[ftab_pos][2]; 
-                num_LF_steps = ftab[ftab_pos][3]; 
-                curr_prof_ch = ftab[ftab_pos][4]; 
-                use_start = ftab[ftab_pos][5];
-                use_end = ftab[ftab_pos][6];
-                i -= curr_ftab_length;
-
-                // update pointer to show we have set it
-                pointer_set = true;
-            };
-
-            // build minimizer digest object (only used if needed)
-            MinimizerDigest digester; 
-            digester.set_lexorder(false);
-            digester.set_windows(small_window_l, large_window_l);
-            if (database_type == MINIMIZER) digester.set_minimizer_alp(true);
-
-            // process each read, and print out the document lists
-            while (kseq_read(seq)>=0) {
-                // uppercase every letter in read
-                for (int j = 0; j < seq->seq.l; j++) {seq->seq.s[j] = up_tab[(int) seq->seq.s[j]];}
-                num_reads++;
-
-                // digest read if needed
-                std::string input_read = seq->seq.s;
-                read_length = 0;
-
-                if (database_type == DNA_MINIMIZER) {input_read = digester.compute_digest(input_read);}
-                else if (database_type == MINIMIZER) {input_read = digester.compute_digest(input_read);}
-                read_length = input_read.size();
-
-                // include read name in output file
-                listings_fd << ">" << seq->name.s << "\n";
-
-                // re-initialize variables to use for backward search
-                start = 0; end = this->bwt.size(); 
-                end_pos_of_match = read_length-1; length = 0;
-
-                curr_prof_ch = 0; curr_prof_pos = 0, num_LF_steps = 0;
-                use_start = false, use_end = false; pointer_set = false;
-
-                // re-initialize ftab-related variables
-                curr_ftab_str = ""; curr_ftab_num = 0;
-
-                // initialize position variable 
-                i = (read_length-1);
-
-                // determine if we can use ftab to start out
-                ftab_pos = check_if_ftab_can_be_used(input_read.data(), i, (database_type == MINIMIZER)); 
-                if (ftab_pos >= 0) {load_ftab_entry();}
-
-                // perform backward search and report document listings
-                while (i >= 0) {
-                    bool ftab_used = false; 
-
-                    // already upper-cased
-                    next_ch = input_read[i];
-
-                    // special case: next_ch does not occur in text
-                    if (this->bwt.number_of_letter(next_ch) == 0) {
-                        generate_listing(); // listing for [i+1,end] ...
-                        generate_empty_listing(); // empty listing for [i,i] ...
-
-                        i--; 
-                        initialize_to_full_range_after_empty();
-                        pointer_set = false;
-                        continue;
-                    }
-
-                    // identify the run # that start and end are in
-                    num_ch_before_start = this->bwt.rank(start, next_ch); 
-                    num_ch_before_end = this->bwt.rank(end, next_ch);
-                    start_run = 0; end_run = 0;
-
-                    // calculate key variables
-                    size_t range_length = end - start;
-                    size_t num_next_ch_in_range = num_ch_before_end - num_ch_before_start;
-
-                    // range is within BWT run, and it is the next character
-                    if (range_length == num_next_ch_in_range) {
-                        num_LF_steps++;
-                    } 
-                    // range does not contain the next character 
-                    else if (num_next_ch_in_range == 0) {
-                        generate_listing();
-                        initialize_to_full_range(); 
-
-                        ftab_pos = check_if_ftab_can_be_used(input_read.data(), i, (database_type == MINIMIZER));
-                        if (ftab_pos >= 0) {
-                            load_ftab_entry();
-                            ftab_used = true;
-                        } else {
-                            update_profile_pointer();
-                        }
-                    }
-                    // range spans a run boundary, and contains the next character
-                    else {
-                        // update start_run variable here since it is used by following lambda
-                        start_run = this->bwt.run_of_position(start);
-                        update_profile_pointer();
-                    }
-
-                    if (!ftab_used) {
-                        // perform an LF step
-                        start = num_ch_before_start + this->F[next_ch]; 
-                        end = num_ch_before_end + this->F[next_ch];
-
-                        // move to next character
-                        i--;
-                    }
-                }
-                generate_listing(); listings_fd << "\n";
-            }
-            listings_fd.close();
-            DONE_LOG((std::chrono::system_clock::now() - start_time));
-
-            // report overall metrics on querying
-            FORCE_LOG("query_main", 
-                      "processed %ld reads (%ld total chars / %ld exact matches = %.2f avg length)",
-                      num_reads, length_sum, num_matches, (length_sum/(num_matches+0.0)));
+            run_query_engine<ftab_seeding>(*this, pattern_file, output_prefix + ".listings", 
+                                           database_type, small_window_l, large_window_l);
         }
 
         size_t serialize(std::ostream &out, std::ostream &out_bwt, int read_length, 
@@ -877,8 +240,8 @@ class doc_queries : ri::r_index<sparse_bv_type, rle_string_t>
                     curr_ch = (curr_ch == 1) ? 0 : curr_ch; // TODO: figure out why $ is 1, but placed in 0
                     size_t curr_pos = ch_pos[curr_ch];
 
-                    curr_start_profile = start_doc_profiles2[curr_ch][curr_pos];
-                    curr_end_profile = end_doc_profiles2[curr_ch][curr_pos];
+                    curr_start_profile = start_doc_profiles2[alphabet[curr_ch]][curr_pos];
+                    curr_end_profile = end_doc_profiles2[alphabet[curr_ch]][curr_pos];
 
                     // Write the profiles to the int vectors
                     size_t start_pos = curr_run_num * num_docs;
@@ -1135,14 +498,17 @@ class doc_queries : ri::r_index<sparse_bv_type, rle_string_t>
         bool rle = true;
         std::string output_ref = "";
 
-        // This vectors has the following dimensions: [256][num of ith char][num_docs]
+        // This vectors has the following dimensions: [sigma][num of ith char][num_docs]
         // This structure stores the DA profiles for each
-        // character separately.
+        // character separately, indexed by the rank in alphabet.
         // std::vector<std::vector<std::vector<uint16_t>>> start_doc_profiles;
         // std::vector<std::vector<std::vector<uint16_t>>> end_doc_profiles;
         std::vector<std::vector<std::vector<uint16_t>>> start_doc_profiles2;
         std::vector<std::vector<std::vector<uint16_t>>> end_doc_profiles2;
 
+        // Maps BWT characters to dense ranks for the profile matrices
+        alphabet_map alphabet;
+
         // This represents the ftab, it is represented as a vector
         // of vectors, indexed by the k-mer and the vectors stores
         // start, end, profile pos, LF steps, and BWT char.
@@ -1151,6 +517,29 @@ class doc_queries : ri::r_index<sparse_bv_type, rle_string_t>
         /*********************************/ 
         /* Private instance methods
         /*********************************/
+        template <class, class, class, class> friend class mem_query_engine;
+
+        const std::vector<uint16_t>& get_profile(uint8_t ch, size_t pos, bool use_end) {
+            /* returns the start or end profile of the pos-th run of ch */
+            if (use_end)
+                return end_doc_profiles2[alphabet[ch]][pos];
+            return start_doc_profiles2[alphabet[ch]][pos];
+        }
+
+        void write_listing(std::ostream& out, const std::vector<uint16_t>& profile, 
+                           uint16_t length, bool use_end, size_t num_LF_steps) {
+            /* prints the documents whose lcp with the match (after the LF steps) covers its length */
+            bool found_one = false;
+            out << "{";
+            for (size_t i = 0; i < profile.size(); i++) {
+                if (std::min((size_t) MAXLCPVALUE, profile[i]+num_LF_steps) >= length) {
+                    out << (found_one ? "," : "") << i;
+                    found_one = true;
+                }
+            }
+            out << "} ";
+        }
+
         void load_bwt_structure(std::string bwt_fname) {
             /* loads the BWT data-structure from the build sub-command */
             if(rle)
@@ -1213,7 +602,8 @@ class doc_queries : ri::r_index<sparse_bv_type, rle_string_t>
                 FATAL_ERROR("invalid file size for *dap files");      
         }
 
-        static void read_doc_profiles(std::vector<std::vector<std::vector<uint16_t>>>& prof_matrix, std::string input_file, size_t num_docs, 
+        static void read_doc_profiles(std::vector<std::vector<std::vector<uint16_t>>>& prof_matrix, std::string input_file, 
+                                    const alphabet_map& alphabet, size_t num_docs, 
                                     size_t num_runs, std::string output_path, size_t num_profiles) {
             /* loads a set of document array profiles into their respective matrix */
 
@@ -1246,6 +636,7 @@ class doc_queries : ri::r_index<sparse_bv_type, rle_string_t>
             // step 3: go through the rest of file and fill in the profiles. Each 
             // profile will start with the BWT character which we will use figure out which
             // list to put it in.
+            prof_matrix.resize(alphabet.size());
             size_t curr_val = 0;
             for (size_t i = 0; i < num_runs; i++) {
                 uint8_t curr_bwt_ch = 0;
@@ -1268,7 +659,7 @@ class doc_queries : ri::r_index<sparse_bv_type, rle_string_t>
                             dap_csv_file << curr_val << "\n";
                     }
                 }
-                prof_matrix[curr_bwt_ch].push_back(curr_profile);
+                prof_matrix[alphabet[curr_bwt_ch]].push_back(curr_profile);
             }
             fclose(fd);
 
@@ -1279,6 +670,7 @@ class doc_queries : ri::r_index<sparse_bv_type, rle_string_t>
         static void read_doc_profiles_new_way(std::vector<std::vector<std::vector<uint16_t>>>& prof_matrix, 
                                               std::string input_file, 
                                               std::string runcnt_file,
+                                              const alphabet_map& alphabet,
                                               size_t num_docs, 
                                               size_t num_runs, 
                                               std::string output_path, 
@@ -1311,10 +703,13 @@ class doc_queries : ri::r_index<sparse_bv_type, rle_string_t>
             fin_runcnt.seekg(0, std::ios::beg);
             fin_runcnt.read(reinterpret_cast<char*>(true_ch_run_cnt.data()), 256 * sizeof(uint64_t));
 
-            // step 4: reserve space for document array table to avoid reallocations
-            for(size_t i = 0; i < 256; i++) {
-                prof_matrix[i].resize(true_ch_run_cnt[i]); 
-                for(size_t j = 0; j < true_ch_run_cnt[i]; j++) {
+            // step 4: reserve space for document array table to avoid reallocations,
+            // only the characters present in the alphabet get a row
+            prof_matrix.resize(alphabet.size());
+            for(size_t i = 0; i < alphabet.size(); i++) {
+                size_t ch = alphabet.chars[i];
+                prof_matrix[i].resize(true_ch_run_cnt[ch]); 
+                for(size_t j = 0; j < true_ch_run_cnt[ch]; j++) {
                     prof_matrix[i][j].resize(num_docs);
                     ASSERT((prof_matrix[i][j].capacity() == (num_docs)), "issue with capacity of prof_matrix[i][j].");
                 }
@@ -1345,12 +740,13 @@ class doc_queries : ri::r_index<sparse_bv_type, rle_string_t>
 
                     // step 5c (ii): get the run id for this bwt char to locate the right vector
                     size_t run_bwt_ch_i = curr_num_ch_runs[curr_bwt_ch];
+                    size_t ch_rank = alphabet[curr_bwt_ch];
                     ASSERT((run_bwt_ch_i < true_ch_run_cnt[curr_bwt_ch]), "run_bwt_ch_i is out of bounds.");
 
                     // step 5c (iii): go through each value and place it directly in array
-                    ASSERT((prof_matrix[curr_bwt_ch][run_bwt_ch_i].size() == (num_docs)), "issue with size of prof_matrix[i][j].");
+                    ASSERT((prof_matrix[ch_rank][run_bwt_ch_i].size() == (num_docs)), "issue with size of prof_matrix[i][j].");
                     for (size_t j = 0; j < (num_docs); j++) {
-                        prof_matrix[curr_bwt_ch][run_bwt_ch_i][j] = main_table_chunk[pos+j+1];
+                        prof_matrix[ch_rank][run_bwt_ch_i][j] = main_table_chunk[pos+j+1];
 
                         // check if we want to print
                         if (print_to_file && profiles_to_print) {
@@ -1542,6 +938,27 @@ class doc_queries : ri::r_index<sparse_bv_type, rle_string_t>
             return this->F;
         }
 
+        void build_F_from_runs(const std::string& run_heads, const std::vector<uint64_t>& run_lengths) {
+            /* same as build_F_, but over the runs kept in memory */
+            this->F = vector<ulint>(256, 0);
+            for (ulint i = 0; i < run_heads.size(); i++)
+            {
+                uint8_t c = run_heads[i];
+                if (c > TERMINATOR)
+                    this->F[c] += run_lengths[i];
+                else
+                {
+                    this->F[TERMINATOR] += run_lengths[i];
+                    this->terminator_position = i;
+                }
+            }
+            for (ulint i = 255; i > 0; --i)
+                this->F[i] = this->F[i - 1];
+            this->F[0] = 0;
+            for (ulint i = 1; i < 256; ++i)
+                this->F[i] += this->F[i - 1];
+        }
+
         ulint LF(ri::ulint i, ri::uchar c){
             // number of c before the interval
             ri::ulint c_before = this->bwt.rank(i, c);
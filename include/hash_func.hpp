@@ -9,6 +9,13 @@
 #ifndef _HASH_FUNC_H
 #define _HASH_FUNC_H
 
+#include <cstdint>
+#include <cstddef>
+
+#if defined(__AVX2__) || (defined(__AVX512F__) && defined(__AVX512DQ__))
+#include <immintrin.h>
+#endif
+
 /* 
  * MurmurHash3 developed by Austin Appleby 
  * (github.com/aappleby/smhasher/blob/master/src/MurmurHash3.cpp)
@@ -24,4 +31,46 @@ uint64_t inline MurmurHash3(uint64_t key) {
     return hash;
 }
 
-#endif
\ No newline at end of file
+#if defined(__AVX2__) && !(defined(__AVX512F__) && defined(__AVX512DQ__))
+inline __m256i mullo_epi64_avx2(__m256i a, __m256i b) {
+    /* low 64 bits of a 64x64-bit product, AVX2 only has 32x32->64-bit multiplies */
+    __m256i lo_lo = _mm256_mul_epu32(a, b);
+    __m256i cross = _mm256_add_epi64(_mm256_mul_epu32(_mm256_srli_epi64(a, 32), b),
+                                     _mm256_mul_epu32(a, _mm256_srli_epi64(b, 32)));
+    return _mm256_add_epi64(lo_lo, _mm256_slli_epi64(cross, 32));
+}
+#endif
+
+inline void MurmurHash3_batch(const uint64_t* keys, uint64_t* hashes, size_t num_keys) {
+    /* applies MurmurHash3 to each key, 8 (AVX-512) or 4 (AVX2) keys at a time */
+    size_t i = 0;
+    #if defined(__AVX512F__) && defined(__AVX512DQ__)
+    const __m512i c1 = _mm512_set1_epi64(0xff51afd7ed558ccd);
+    const __m512i c2 = _mm512_set1_epi64(0xc4ceb9fe1a85ec53);
+    for (; i + 8 <= num_keys; i += 8) {
+        __m512i hash = _mm512_loadu_si512(keys + i);
+        hash = _mm512_xor_si512(hash, _mm512_srli_epi64(hash, 33));
+        hash = _mm512_mullo_epi64(hash, c1);
+        hash = _mm512_xor_si512(hash, _mm512_srli_epi64(hash, 33));
+        hash = _mm512_mullo_epi64(hash, c2);
+        hash = _mm512_xor_si512(hash, _mm512_srli_epi64(hash, 33));
+        _mm512_storeu_si512(hashes + i, hash);
+    }
+    #elif defined(__AVX2__)
+    const __m256i c1 = _mm256_set1_epi64x(0xff51afd7ed558ccd);
+    const __m256i c2 = _mm256_set1_epi64x(0xc4ceb9fe1a85ec53);
+    for (; i + 4 <= num_keys; i += 4) {
+        __m256i hash = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys + i));
+        hash = _mm256_xor_si256(hash, _mm256_srli_epi64(hash, 33));
+        hash = mullo_epi64_avx2(hash, c1);
+        hash = _mm256_xor_si256(hash, _mm256_srli_epi64(hash, 33));
+        hash = mullo_epi64_avx2(hash, c2);
+        hash = _mm256_xor_si256(hash, _mm256_srli_epi64(hash, 33));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(hashes + i), hash);
+    }
+    #endif
+    for (; i < num_keys; i++)
+        hashes[i] = MurmurHash3(keys[i]);
+}
+
+#endif /* end of include guard: _HASH_FUNC_H */
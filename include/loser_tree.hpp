@@ -0,0 +1,106 @@
+/*
+ * File: loser_tree.hpp
+ * Description: Definition of a reusable tournament (loser) tree that
+ *              performs a k-way merge over sorted slices of an array.
+ *              It is used to merge the occurrences (ilist slices) of the
+ *              phrases that share a suffix during the PFP traversal,
+ *              each slice carries a payload (the BWT character).
+ * Date: October 19th, 2026
+ */
+
+#ifndef _LOSER_TREE_H
+#define _LOSER_TREE_H
+
+#include <vector>
+#include <limits>
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+
+template <typename key_t, typename payload_t>
+class loser_tree {
+    public:
+        loser_tree() {}
+
+        void reset() {
+            /* clears the runs, memory is kept so the tree can be re-used for the next group */
+            curr.clear(); ends.clear(); payloads.clear();
+            num_runs = 0; num_leaves = 0; winner = 0;
+        }
+
+        void add_run(const key_t* begin, const key_t* end, payload_t payload) {
+            /* adds a sorted slice [begin, end) to be merged, empty slices are ignored */
+            if (begin == end) return;
+            curr.push_back(begin);
+            ends.push_back(end);
+            payloads.push_back(payload);
+            num_runs++;
+        }
+
+        void build() {
+            /* plays the initial tournament, must be called after all runs are added */
+            winner = 0;
+            if (num_runs <= 1) return; // single run: no merging is needed
+
+            num_leaves = 1;
+            while (num_leaves < num_runs) num_leaves <<= 1;
+            tree.assign(num_leaves, 0);
+
+            // play the tournament bottom-up, storing the loser at each internal
+            // node, and passing the winner to the next level
+            winners.assign(2 * num_leaves, 0);
+            for (size_t i = 0; i < num_leaves; i++)
+                winners[num_leaves + i] = i;
+            for (size_t node = num_leaves - 1; node > 0; node--) {
+                size_t left = winners[2 * node], right = winners[2 * node + 1];
+                if (beats(right, left)) {
+                    winners[node] = right; tree[node] = left;
+                } else {
+                    winners[node] = left; tree[node] = right;
+                }
+            }
+            winner = winners[1];
+        }
+
+        inline bool empty() const {
+            return num_runs == 0 || exhausted(winner);
+        }
+
+        inline key_t top() const {return *curr[winner];}
+        inline payload_t top_payload() const {return payloads[winner];}
+
+        inline void pop() {
+            /* advances the winning run, and replays the matches on its path to the root */
+            curr[winner]++;
+            if (num_runs == 1) return; // fast-path: single run is just a scan
+
+            for (size_t node = (num_leaves + winner) >> 1; node > 0; node >>= 1) {
+                if (beats(tree[node], winner))
+                    std::swap(tree[node], winner);
+            }
+        }
+
+    private:
+        std::vector<const key_t*> curr;
+        std::vector<const key_t*> ends;
+        std::vector<payload_t> payloads;
+        std::vector<size_t> tree; // tree[node] = run that lost the match at node
+        std::vector<size_t> winners; // scratch space for the initial tournament
+        size_t num_runs = 0;
+        size_t num_leaves = 0;
+        size_t winner = 0;
+
+        inline bool exhausted(size_t run) const {
+            /* padding leaves (run >= num_runs) behave like exhausted runs */
+            return run >= num_runs || curr[run] == ends[run];
+        }
+
+        inline bool beats(size_t a, size_t b) const {
+            /* returns true if run a has a strictly smaller head than run b */
+            if (exhausted(a)) return false;
+            if (exhausted(b)) return true;
+            return *curr[a] < *curr[b];
+        }
+};
+
+#endif /* end of include guard: _LOSER_TREE_H */
@@ -1,8 +1,8 @@
 /*
  * File: minimizer_digest.hpp
  * Description: Definition of MinimizerDigest object that can
- *              construct a concatenation of minimizers
- *              which are called a digest.
+ *              construct a concatenation of minimizers (or open
+ *              syncmers) which are called a digest.
  *
  *              This code is based on MinimizerScanner 
  *              object defined in the Kraken2 classification
@@ -18,10 +18,13 @@
 #include <cstdio>
 #include <iostream>
 #include <vector>
+#include <algorithm>
 #include <pfp_doc.hpp>
+#include <seq_normalize.hpp>
 
 #define BITS_PER_CHAR 2
 #define KMER_TO_UINT8_CHAR(x) (char) ((x <= 2) ? (x+3) : x)
+#define HASH_BLOCK_SIZE 256
 
 struct MinimizerData {
     uint64_t pos;
@@ -29,28 +32,89 @@ struct MinimizerData {
     uint64_t hash_val;
 };
 
+/* monotone deque of the k-mers in the large window, stored in a ring buffer */
+class MinimizerQueue {
+    public:
+        void reserve(size_t num_items) {
+            /* capacity is rounded up to a power of two so indices can be masked */
+            size_t cap = 2;
+            while (cap < num_items) cap <<= 1;
+            if (cap > buffer.size()) grow(cap);
+        }
+
+        inline bool empty() const {return head == tail;}
+        inline size_t size() const {return tail - head;}
+        inline void clear() {head = tail = 0;}
+
+        inline MinimizerData& front() {return buffer[head & mask];}
+        inline MinimizerData& back() {return buffer[(tail - 1) & mask];}
+        inline void pop_front() {head++;}
+        inline void pop_back() {tail--;}
+
+        inline void push_back(const MinimizerData& item) {
+            if (size() == buffer.size()) grow(2 * buffer.size());
+            buffer[(tail++) & mask] = item;
+        }
+
+    private:
+        std::vector<MinimizerData> buffer;
+        size_t mask = 0;
+        size_t head = 0;
+        size_t tail = 0;
+
+        void grow(size_t new_cap) {
+            /* moves the items into a larger buffer, keeping their order */
+            size_t num_items = size();
+            std::vector<MinimizerData> new_buffer(std::max(new_cap, (size_t) 2));
+            for (size_t i = 0; i < num_items; i++)
+                new_buffer[i] = buffer[(head + i) & mask];
+            head = 0; tail = num_items;
+            buffer.swap(new_buffer);
+            mask = buffer.size() - 1;
+        }
+};
+
 class MinimizerDigest {
     public:
         MinimizerDigest();
         MinimizerDigest(uint64_t k, uint64_t w, bool lex_order=true, bool minimizer_alp=false);
 
-        std::string compute_digest(std::string input_seq);
+        std::string compute_digest(const std::string& input_seq);
+        void compute_digest(const char* input_seq, size_t length, std::string& digest);
+        void normalize_and_digest(char* input_seq, size_t length, std::string& digest);
+        void compute_digests(const char* const* seqs, const size_t* lengths, size_t num_seqs,
+                             std::string& digests, std::vector<size_t>& offsets);
         uint64_t get_k() {return k;}
         uint64_t get_w() {return w;}
         void set_windows(uint64_t k, uint64_t w);
         void set_lexorder(bool status) {this->lex_order = status;}
         void set_minimizer_alp(bool status) {this->minimizer_alp = status;}
+        void set_syncmer_mode(bool status);
     private:
         uint64_t k = 0;
         uint64_t w = 0;
-        uint8_t lookup_table[UINT8_MAX+1];
-        uint64_t loaded_kmers;
+        packed_seq_t encoded_seq;
+        uint64_t loaded_kmers = 0;
         bool lex_order = true;
         bool minimizer_alp = false;
-        std::vector<MinimizerData> queue;
+        bool syncmer_mode = false;
+        MinimizerQueue queue;
+        std::string curr_digest;
+
+        // k-mer values and hashes for a block of positions, computed together
+        uint64_t kmer_block[HASH_BLOCK_SIZE];
+        uint64_t hash_block[HASH_BLOCK_SIZE];
+        uint64_t hash_block_start = 0;
+        uint64_t hash_block_end = 0;
+
+        // k-mer values and hashes used by the syncmer digest, which needs w-k more than a block
+        std::vector<uint64_t> syncmer_vals;
+        std::vector<uint64_t> syncmer_hashes;
 
-        void update_lookup_table(char ch, uint8_t val);
-        void inititalize_lookup_table();
+        void compute_kmer_hashes(uint64_t start_pos, uint64_t end_pos, uint64_t* vals, uint64_t* hashes);
+        void fill_hash_block(uint64_t start_pos, size_t length);
+        void compute_syncmer_digest(const char* input_seq, size_t length, std::string& digest);
+        void digest_encoded_seq(const char* input_seq, size_t length, std::string& digest);
 };
 
 #endif /* end of include guard: _MINIMIZER_DIGEST_H */
@@ -54,12 +54,6 @@ class ms_rle_string : public ri::rle_string<sparse_bitvector_t, string_t>
         heads.clear(); heads.seekg(0);
         lengths.clear(); lengths.seekg(0);
 
-        this->B = B;
-        auto runs_per_letter_bv = vector<vector<bool> >(256);
-
-        //runs in main bitvector
-        vector<bool> runs_bv;
-
         // Reads the run heads file
         string run_heads_s;
         heads.seekg(0, heads.end);
@@ -67,15 +61,35 @@ class ms_rle_string : public ri::rle_string<sparse_bitvector_t, string_t>
         heads.seekg(0, heads.beg);
         heads.read(&run_heads_s[0], run_heads_s.size());
 
-        size_t pos = 0;
+        build_from_runs(run_heads_s, [&] () {
+            size_t length = 0;
+            lengths.read((char*)&length, 5);
+            return length;
+        }, B);
+    }
+
+    // Construction from the BWT runs kept in memory (lean build)
+    ms_rle_string(string run_heads_s, const vector<uint64_t>& run_lengths, ulint B = 2) {
+        size_t run_num = 0;
+        build_from_runs(run_heads_s, [&] () {return run_lengths[run_num++];}, B);
+    }
+
+    template <class next_length_t>
+    void build_from_runs(string& run_heads_s, next_length_t next_length, ulint B) {
+        /* builds the structure from the run heads, next_length() returns the length of each run in order */
+        this->B = B;
+        auto runs_per_letter_bv = vector<vector<bool> >(256);
+
+        //runs in main bitvector
+        vector<bool> runs_bv;
+
         this->n = 0;
         this->R = run_heads_s.size();
 
         // Compute runs_bv and runs_per_letter_bv
         for (size_t i = 0; i < run_heads_s.size(); ++i)
         {
-            size_t length = 0;
-            lengths.read((char*)&length, 5);
+            size_t length = next_length();
             
             // fixed old bug since previous version did not
             // have the unsigned(), otherwise it will be 
@@ -0,0 +1,332 @@
+/*
+ * File: parallel_dap.hpp
+ * Description: Definition of the parallel_dap_builder class that computes
+ *              the document array profiles from the temporary files of the
+ *              two-pass construction using multiple threads. The BWT is split
+ *              into contiguous ranges, and each range is processed with its
+ *              own predecessor tables, the state that crosses a range
+ *              boundary is stitched together in a short serial scan.
+ * Date: October 19th, 2026
+ */
+
+#ifndef _PARALLEL_DAP_H
+#define _PARALLEL_DAP_H
+
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <omp.h>
+#include <immintrin.h>
+#include <pfp_doc.hpp>
+#include <alphabet.hpp>
+#include <temp_store.hpp>
+#include <temp_records.hpp>
+
+/* MACRO for reading from the document array temp data */
+#define GET_DAP(fd, num) ((0xFF & fd[num * DOCWIDTH]) | ((0xFF & fd[num * DOCWIDTH + 1]) << 8))
+
+#define PARTITION_SEARCH_WINDOW 4096
+
+inline void max_update_dap_row(temp_store& dap_store, size_t num, const std::vector<size_t>& profile,
+                               std::vector<uint16_t>& row_values) {
+    /* raises the stored profile at num to the given one (capped at the max lcp) */
+    size_t num_docs = profile.size();
+    row_values.resize(num_docs);
+    for (size_t i = 0; i < num_docs; i++)
+        row_values[i] = std::min((size_t) MAXLCPVALUE, profile[i]);
+
+    uint16_t* row = (uint16_t*) dap_store.span(num * DOCWIDTH, num_docs * DOCWIDTH);
+    if (row == nullptr) {
+        // the row crosses a segment, so update it one value at a time
+        for (size_t i = 0; i < num_docs; i++) {
+            if (GET_DAP(dap_store, (num+i)) < row_values[i]) {
+                dap_store[(num+i) * DOCWIDTH] = (0xFF & row_values[i]);
+                dap_store[(num+i) * DOCWIDTH + 1] = (0xFF00 & row_values[i]) >> 8;
+            }
+        }
+        return;
+    }
+
+    // the values are stored little-endian, so the row can be used as uint16_t
+    size_t i = 0;
+    #if defined(__AVX2__)
+    for (; i + 16 <= num_docs; i += 16) {
+        __m256i curr = _mm256_loadu_si256((__m256i*) &row[i]);
+        __m256i vals = _mm256_loadu_si256((__m256i*) &row_values[i]);
+        _mm256_storeu_si256((__m256i*) &row[i], _mm256_max_epu16(curr, vals));
+    }
+    #elif defined(__SSE4_1__)
+    for (; i + 8 <= num_docs; i += 8) {
+        __m128i curr = _mm_loadu_si128((__m128i*) &row[i]);
+        __m128i vals = _mm_loadu_si128((__m128i*) &row_values[i]);
+        _mm_storeu_si128((__m128i*) &row[i], _mm_max_epu16(curr, vals));
+    }
+    #endif
+    for (; i < num_docs; i++)
+        row[i] = std::max(row[i], row_values[i]);
+}
+
+/* max lcp for each <ch, doc> pair, and whether the pair has been seen */
+typedef struct
+{
+    std::vector<uint16_t> max_lcp;
+    std::vector<bool> seen;
+} boundary_state_t;
+
+class parallel_dap_builder {
+    public:
+        parallel_dap_builder(const temp_record_stream& lcp_inter, temp_store& dap_inter, size_t num_records, size_t num_docs,
+                             const alphabet_map& alphabet, size_t num_threads):
+                             lcp_inter_store(lcp_inter),
+                             dap_inter_store(dap_inter),
+                             num_records(num_records),
+                             num_docs(num_docs),
+                             alphabet(alphabet),
+                             num_threads(std::max((size_t) 1, num_threads)) {}
+
+        void build() {
+            /*
+             * Computes the profile of every run boundary, and writes it to
+             * the document array temp file in the same order as the serial
+             * two-pass construction so the output files are identical.
+             */
+            choose_partitions();
+            size_t num_parts = part_starts.size() - 1;
+
+            // summarize each range independently: the state it passes forward
+            // (last occurrence of each pair) and backward (first occurrence)
+            std::vector<boundary_state_t> forward_state(num_parts), backward_state(num_parts);
+            std::vector<uint16_t> range_min_lcp(num_parts, MAXLCPVALUE);
+            std::vector<size_t> num_boundaries(num_parts, 0);
+
+            #pragma omp parallel for schedule(static, 1) num_threads(num_threads)
+            for (size_t p = 0; p < num_parts; p++)
+                summarize_partition(p, forward_state[p], backward_state[p], range_min_lcp[p], num_boundaries[p]);
+
+            // stitch the summaries into the state entering each range, this
+            // turns the summaries in-place into the incoming states
+            stitch_forward_states(forward_state, range_min_lcp);
+            stitch_backward_states(backward_state, range_min_lcp);
+
+            std::vector<size_t> dap_offsets(num_parts, 0);
+            for (size_t p = 1; p < num_parts; p++)
+                dap_offsets[p] = dap_offsets[p-1] + num_boundaries[p-1] * num_docs;
+
+            // compute the profiles of each range, seeded with the incoming states
+            #pragma omp parallel for schedule(static, 1) num_threads(num_threads)
+            for (size_t p = 0; p < num_parts; p++) {
+                compute_forward_profiles(p, forward_state[p], dap_offsets[p]);
+                compute_backward_profiles(p, backward_state[p], dap_offsets[p] + num_boundaries[p] * num_docs);
+            }
+        }
+
+        size_t num_partitions() const {return part_starts.size() - 1;}
+
+    private:
+        const temp_record_stream& lcp_inter_store;
+        temp_store& dap_inter_store;
+        size_t num_records = 0;
+        size_t num_docs = 0;
+        const alphabet_map& alphabet;
+        size_t num_threads = 1;
+        std::vector<size_t> part_starts;
+
+        /***********************************************************/
+        /* Section 1: Partitioning and stitching of the BWT ranges
+        /***********************************************************/
+
+        void choose_partitions() {
+            /*
+             * Splits the records into one range per thread. Each cut is placed at
+             * the smallest lcp near the even split, so that the least amount of
+             * state crosses the cut. Any cut is valid since the state is stitched.
+             */
+            size_t num_parts = std::max((size_t) 1, std::min(num_threads, num_records / PARTITION_SEARCH_WINDOW));
+            size_t window = std::min((size_t) PARTITION_SEARCH_WINDOW, num_records / (4 * num_parts));
+            temp_record_reader lcp_reader(lcp_inter_store);
+
+            part_starts.assign(1, 0);
+            for (size_t p = 1; p < num_parts; p++) {
+                size_t target = (num_records / num_parts) * p;
+                size_t best = target;
+                for (size_t i = target - window; i < target + window; i++) {
+                    if (GET_LCP(lcp_reader, i) < GET_LCP(lcp_reader, best))
+                        best = i;
+                }
+                if (best > part_starts.back())
+                    part_starts.push_back(best);
+            }
+            part_starts.push_back(num_records);
+        }
+
+        void summarize_partition(size_t p, boundary_state_t& last_occ, boundary_state_t& first_occ,
+                                 uint16_t& min_lcp, size_t& boundaries) {
+            /*
+             * Scans the range [start, end) to find, for each <ch, doc> pair, the max lcp
+             * of its last occurrence with the end of the range, and the max lcp of its
+             * first occurrence with the start of the range (the lcp at start included).
+             */
+            size_t start = part_starts[p], end = part_starts[p+1];
+            temp_record_reader lcp_reader(lcp_inter_store);
+            init_state(last_occ); init_state(first_occ);
+
+            // backward scan: last occurrence, min lcp of the range, and # of boundaries
+            uint16_t running_min = MAXLCPVALUE;
+            for (size_t i = end; i > start; i--) {
+                size_t pos = table_pos(lcp_reader, i-1);
+                if (!last_occ.seen[pos]) {
+                    last_occ.seen[pos] = true;
+                    last_occ.max_lcp[pos] = std::min(running_min, (uint16_t) GET_SUFFIX_LEN(lcp_reader, (i-1)));
+                }
+                running_min = std::min(running_min, (uint16_t) GET_LCP(lcp_reader, (i-1)));
+                if (GET_IS_START(lcp_reader, (i-1)) || GET_IS_END(lcp_reader, (i-1)))
+                    boundaries++;
+            }
+            min_lcp = running_min;
+
+            // forward scan: first occurrence
+            running_min = MAXLCPVALUE;
+            for (size_t i = start; i < end; i++) {
+                size_t pos = table_pos(lcp_reader, i);
+                running_min = std::min(running_min, (uint16_t) GET_LCP(lcp_reader, i));
+                if (!first_occ.seen[pos]) {
+                    first_occ.seen[pos] = true;
+                    first_occ.max_lcp[pos] = running_min;
+                }
+            }
+        }
+
+        void stitch_forward_states(std::vector<boundary_state_t>& states, const std::vector<uint16_t>& range_min_lcp) {
+            /* turns the last-occurrence summary of range p-1 into the state entering range p */
+            boundary_state_t incoming; init_state(incoming);
+            for (size_t p = 0; p < states.size(); p++) {
+                std::swap(incoming, states[p]);
+                merge_state(incoming, states[p], range_min_lcp[p]);
+            }
+        }
+
+        void stitch_backward_states(std::vector<boundary_state_t>& states, const std::vector<uint16_t>& range_min_lcp) {
+            /* turns the first-occurrence summary of range p+1 into the state entering range p */
+            boundary_state_t incoming; init_state(incoming);
+            for (size_t p = states.size(); p > 0; p--) {
+                std::swap(incoming, states[p-1]);
+                merge_state(incoming, states[p-1], range_min_lcp[p-1]);
+            }
+        }
+
+        void merge_state(boundary_state_t& summary, const boundary_state_t& prev_state, uint16_t min_lcp) {
+            /* pairs not seen in the range carry over the previous state, reduced by the range's min lcp */
+            for (size_t i = 0; i < summary.seen.size(); i++) {
+                if (!summary.seen[i] && prev_state.seen[i]) {
+                    summary.seen[i] = true;
+                    summary.max_lcp[i] = std::min(prev_state.max_lcp[i], min_lcp);
+                }
+            }
+        }
+
+        /***********************************************************/
+        /* Section 2: Computing the profiles within each range
+        /***********************************************************/
+
+        void compute_forward_profiles(size_t p, const boundary_state_t& incoming, size_t dap_ptr) {
+            /* equivalent to the 1st-pass, but the tables start from the incoming state */
+            boundary_state_t state = incoming;
+            std::vector<uint16_t> dirty_lcp_cache(alphabet.size(), MAXLCPVALUE);
+            std::vector<size_t> curr_da_profile(num_docs, 0);
+            temp_record_reader lcp_reader(lcp_inter_store);
+
+            for (size_t i = part_starts[p]; i < part_starts[p+1]; i++) {
+                uint16_t lcp_i = GET_LCP(lcp_reader, i);
+                uint16_t suffix_len = GET_SUFFIX_LEN(lcp_reader, i);
+                uint8_t ch_rank = alphabet[GET_BWT_CH(lcp_reader, i)];
+                size_t doc_of_LF_i = GET_DOC_OF_LF(lcp_reader, i);
+
+                // lazily apply the lcp values seen since the last update of this row
+                for (size_t ch = 0; ch < dirty_lcp_cache.size(); ch++)
+                    dirty_lcp_cache[ch] = std::min(dirty_lcp_cache[ch], lcp_i);
+                flush_row(state, ch_rank, dirty_lcp_cache[ch_rank]);
+                dirty_lcp_cache[ch_rank] = MAXLCPVALUE;
+
+                size_t pos = ch_rank * num_docs + doc_of_LF_i;
+                state.max_lcp[pos] = suffix_len;
+                state.seen[pos] = true;
+
+                if (GET_IS_START(lcp_reader, i) || GET_IS_END(lcp_reader, i)) {
+                    initialize_profile(state, ch_rank, doc_of_LF_i, curr_da_profile);
+                    curr_da_profile[doc_of_LF_i] = suffix_len;
+                    for (size_t j = 0; j < num_docs; j++)
+                        write_dap(dap_ptr + j, curr_da_profile[j]);
+                    dap_ptr += num_docs;
+                }
+            }
+        }
+
+        void compute_backward_profiles(size_t p, const boundary_state_t& incoming, size_t dap_end) {
+            /* equivalent to the 2nd-pass, but the tables start from the incoming state */
+            boundary_state_t state = incoming;
+            std::vector<uint16_t> dirty_lcp_cache(alphabet.size(), MAXLCPVALUE);
+            std::vector<size_t> curr_da_profile(num_docs, 0);
+            std::vector<uint16_t> row_values(num_docs, 0);
+            size_t dap_ptr = dap_end;
+            temp_record_reader lcp_reader(lcp_inter_store);
+
+            for (size_t i = part_starts[p+1]; i > part_starts[p]; i--) {
+                uint16_t lcp_i = GET_LCP(lcp_reader, (i-1));
+                uint8_t ch_rank = alphabet[GET_BWT_CH(lcp_reader, (i-1))];
+                size_t doc_of_LF_i = GET_DOC_OF_LF(lcp_reader, (i-1));
+
+                flush_row(state, ch_rank, dirty_lcp_cache[ch_rank]);
+
+                if (GET_IS_START(lcp_reader, (i-1)) || GET_IS_END(lcp_reader, (i-1))) {
+                    dap_ptr -= num_docs;
+                    initialize_profile(state, ch_rank, doc_of_LF_i, curr_da_profile);
+                    max_update_dap_row(dap_inter_store, dap_ptr, curr_da_profile, row_values);
+                }
+
+                // the lcp of this suffix applies to every occurrence above it
+                size_t pos = ch_rank * num_docs + doc_of_LF_i;
+                state.seen[pos] = true;
+                for (size_t ch = 0; ch < dirty_lcp_cache.size(); ch++)
+                    dirty_lcp_cache[ch] = std::min(dirty_lcp_cache[ch], lcp_i);
+                dirty_lcp_cache[ch_rank] = lcp_i;
+                state.max_lcp[pos] = lcp_i;
+            }
+        }
+
+        /***********************************************************/
+        /* Section 3: Helper methods for the tables
+        /***********************************************************/
+
+        void init_state(boundary_state_t& state) {
+            state.max_lcp.assign(alphabet.size() * num_docs, 0);
+            state.seen.assign(alphabet.size() * num_docs, false);
+        }
+
+        inline size_t table_pos(temp_record_reader& lcp_reader, size_t i) const {
+            return alphabet[GET_BWT_CH(lcp_reader, i)] * num_docs + GET_DOC_OF_LF(lcp_reader, i);
+        }
+
+        inline void flush_row(boundary_state_t& state, uint8_t ch_rank, uint16_t min_lcp_to_flush) {
+            uint16_t* row = &state.max_lcp[ch_rank * num_docs];
+            for (size_t i = 0; i < num_docs; i++)
+                row[i] = std::min(row[i], min_lcp_to_flush);
+        }
+
+        inline void initialize_profile(const boundary_state_t& state, uint8_t ch_rank, size_t doc_of_LF_i,
+                                       std::vector<size_t>& curr_da_profile) {
+            /* profile for the other documents is the max lcp with an occurrence of <ch, doc> plus one */
+            size_t row = ch_rank * num_docs;
+            for (size_t i = 0; i < num_docs; i++) {
+                bool valid = (i != doc_of_LF_i && state.seen[row + i]);
+                curr_da_profile[i] = valid ? state.max_lcp[row + i] + 1 : 0;
+            }
+        }
+
+        inline void write_dap(size_t num, size_t value) {
+            uint16_t curr_lcp = std::min((size_t) MAXLCPVALUE, value);
+            dap_inter_store[num * DOCWIDTH] = (0xFF & curr_lcp);
+            dap_inter_store[num * DOCWIDTH + 1] = ((0xFF << 8) & curr_lcp) >> 8;
+        }
+};
+
+#endif /* end of include guard: _PARALLEL_DAP_H */
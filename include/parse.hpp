@@ -72,18 +72,24 @@ public:
     // Building dictionary from file
     std::string tmp_filename = filename + std::string(".parse");
     read_file(tmp_filename.c_str(), p);
-    p.push_back(0); // this is the terminator for the sacak algorithm
 
     // // Uploading the frequency file
     // tmp_filename = filename + std::string(".occ");
     // read_file(tmp_filename.c_str(), freq);
     // freq.insert(freq.begin(), 1);
 
-    compute_freq();
+    build_from_scan();
+  }
 
-    build();
+  // Builds the parse from the content of a *.parse file already in p,
+  // this is also used when the parse comes from the in-process scanner.
+  void build_from_scan()
+  {
+    p.push_back(0); // this is the terminator for the sacak algorithm
 
+    compute_freq();
 
+    build();
   }
 
   void build(){
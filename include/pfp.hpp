@@ -114,6 +114,37 @@ public:
     clear_unnecessary_elements();
   }
 
+  // Builds the data structures from the *.dict and *.parse content held
+  // in memory, e.g. produced by the in-process scanner (pfp_scanner).
+  pf_parsing( std::vector<uint8_t>&& d_, std::vector<uint32_t>&& p_, size_t w_):
+              s_lcp_T(1,0),
+              pos_T(1,0),
+              w(w_)
+  {
+    dict.d = std::move(d_);
+    dict.build_from_scan(w);
+
+    pars.p = std::move(p_);
+    pars.alphabet_size = dict.n_phrases()+1;
+    pars.build_from_scan();
+
+    // Compute the length of the string;
+    compute_n();
+
+    verbose("Computing pos_T");
+    _elapsed_time(compute_pos_T());
+
+    verbose("Computing s_lcp_T");
+    _elapsed_time(compute_s_lcp_T());
+
+    print_sizes();
+
+    print_stats();
+
+    // Clear unnecessary elements
+    clear_unnecessary_elements();
+  }
+
   void print_sizes()
   {
 
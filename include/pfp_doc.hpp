@@ -11,9 +11,13 @@
 
 #include <string>
 #include <iostream>
+#include <sstream>
 #include <filesystem>
 #include <vector>
 #include <cmath>
+#include <thread>
+#include <algorithm>
+#include <unistd.h>
 
 /* Useful MACROs */
 #define FATAL_ERROR(...)  do {std::fprintf(stderr, "\n\n\033[31m[%s::error] \033[m", TOOL_NAME); \
@@ -47,7 +51,7 @@
 #endif
 
 /* Enum Defintions */
-enum ref_type {DNA, DNA_MINIMIZER, MINIMIZER};
+enum ref_type {DNA, DNA_MINIMIZER, MINIMIZER, DNA_SYNCMER};
 
 /* Definitions */
 #define PFPDOC_VERSION "2.0.0"
@@ -100,10 +104,12 @@ int build_main(int argc, char** argv);
 int run_main(int argc, char** argv);
 int info_main(int argc, char** argv);
 int repstats_main(int argc, char** argv);
+int plan_main(int argc, char** argv);
 int pfpdoc_build_usage();
 int pfpdoc_run_usage();
 int pfpdoc_info_usage();
 int pfpdoc_repstats_usage();
+int pfpdoc_plan_usage();
 int is_file(std::string path);
 int is_dir(std::string path);
 std::vector<std::string> split(std::string input, char delim);
@@ -127,14 +133,14 @@ struct PFPDocInfoOptions {
             
             // check the input files
             ref_file += ".fna";
-            if (!is_file(ref_file))
+            if (!is_file(ref_file) && !is_file(ref_file + ".bwt.heads") && !is_file(ref_file + ".bwt.cliffy"))
                 FATAL_ERROR("The index prefix provided is not valid. %s does not exist.", ref_file.data());
             std::filesystem::path p (output_path);
             if (output_path.size() && !is_dir(p.parent_path().string()))
                 FATAL_ERROR("The output path for profiles is not valid.");  
 
-            // check the core index files (bwt)
-            if (!is_file(ref_file + ".bwt.heads") || !is_file(ref_file + ".bwt.len"))
+            // check the core index files (bwt), lean builds only write the serialized one
+            if (!is_file(ref_file + ".bwt.cliffy") && (!is_file(ref_file + ".bwt.heads") || !is_file(ref_file + ".bwt.len")))
                 FATAL_ERROR("At least one of the index files is not present.");
             
             // check for the document array profiles files
@@ -163,10 +169,17 @@ struct PFPDocBuildOptions {
         std::string output_ref = "";
         std::string temp_prefix = "";
         std::string tmp_size_str = "";
+        std::string tmp_mem_str = "";
+        std::string report_file = "";
         bool use_rcomp = false;
         size_t pfp_w = 10;
         size_t hash_mod = 100;
-        size_t threads = 0;
+        size_t threads = 1;
+        bool in_process = false;
+        bool use_direct_io = false;
+        bool use_lean = false;
+        bool use_resume = false;
+        bool verify_inputs = false;
         bool is_fasta = true;
         bool use_taxcomp = false;
         bool use_topk = false;
@@ -175,10 +188,12 @@ struct PFPDocBuildOptions {
         size_t use_heuristics = true;
         bool use_two_pass = false;
         size_t tmp_size = 0;
+        size_t tmp_mem = 0;
         bool make_ftab = true;
 
         bool use_minimizers = false;
         bool use_dna_minimizers = false;
+        bool use_dna_syncmers = false;
         size_t small_window_l = 4;
         size_t large_window_l = 11;
 
@@ -202,16 +217,29 @@ struct PFPDocBuildOptions {
                 if (!is_dir(p.parent_path().string()))
                     FATAL_ERROR("output path prefix for temporary file is not valid.");
 
-                // makes sure the temp size is valid format, if so, initialize the tmp_size variable
-                if (tmp_size_str.length() == 0 || tmp_size_str.find("GB") == std::string::npos)
-                    FATAL_ERROR("temporary file size argument needs to be in this form (e.g. 4GB)");
+                // the temp storage grows as needed, so its size limit is optional. If it
+                // is given, make sure it is a valid format and initialize the tmp_size variable
+                if (tmp_size_str.length() > 0) {
+                    if (tmp_size_str.find("GB") == std::string::npos)
+                        FATAL_ERROR("temporary file size argument needs to be in this form (e.g. 4GB)");
+
+                    tmp_size_str.erase(tmp_size_str.find("GB"), tmp_size_str.length());
+                    tmp_size = std::atoi(tmp_size_str.data());
+                    tmp_size *= 1073741824;
 
-                tmp_size_str.erase(tmp_size_str.find("GB"), tmp_size_str.length());
-                tmp_size = std::atoi(tmp_size_str.data());
-                tmp_size *= 1073741824;
+                    if (tmp_size == 0)
+                        FATAL_ERROR("temporary memory allocated cannot be 0.");
+                }
 
-                if (tmp_size == 0)
-                    FATAL_ERROR("temporary memory allocated cannot be 0.");
+                // the memory budget for temp storage is also given in GB
+                if (tmp_mem_str.length() > 0) {
+                    if (tmp_mem_str.find("GB") == std::string::npos)
+                        FATAL_ERROR("temporary memory budget argument needs to be in this form (e.g. 4GB)");
+
+                    tmp_mem_str.erase(tmp_mem_str.find("GB"), tmp_mem_str.length());
+                    tmp_mem = std::atoi(tmp_mem_str.data());
+                    tmp_mem *= 1073741824;
+                }
 
                 if (use_topk)
                     FATAL_ERROR("top-k is not implemented yet with two-pass algorithm.");
@@ -219,6 +247,15 @@ struct PFPDocBuildOptions {
                 FATAL_WARN("one-pass build algorithm is not supported for now. Rerun with --two-pass option.");
             }
 
+            // makes sure the build report can be written
+            std::filesystem::path report_path (report_file);
+            if (report_file.length() && report_path.has_parent_path() && !is_dir(report_path.parent_path().string()))
+                FATAL_ERROR("the path for the build report is not in a valid directory.");
+
+            // need at least one thread for parsing and building the profiles
+            if (threads == 0)
+                FATAL_ERROR("the number of threads must be at least 1.");
+
             // can only use one type of compression
             if (use_taxcomp && use_topk)
                 FATAL_ERROR("taxonomic and top-k compression cannot be used together.");   
@@ -228,8 +265,8 @@ struct PFPDocBuildOptions {
                 FATAL_ERROR("cannot extract document array when using compression.");     
 
             // only one type of minimizer digestion can be used
-            if (use_minimizers && use_dna_minimizers)
-                FATAL_ERROR("cannot use both minimizer-alphabet and DNA-alphabet minimizers.");
+            if ((use_minimizers + use_dna_minimizers + use_dna_syncmers) > 1)
+                FATAL_ERROR("only one of minimizer-alphabet minimizers, DNA-alphabet minimizers and syncmers can be used.");
 
             // smaller window of minimizer scheme must be smaller than larger window
             if (small_window_l > large_window_l)
@@ -239,12 +276,31 @@ struct PFPDocBuildOptions {
             if (use_minimizers && small_window_l != 4)
                 FATAL_ERROR("when using minimizer alphabet, the small window must be set to 4.");
 
+            // for syncmers, the small window (s-mer) must be shorter than the large window (syncmer)
+            if (use_dna_syncmers && small_window_l >= large_window_l)
+                FATAL_ERROR("when using syncmers, the small window must be smaller than the large window.");
+
             // checks the number of column argument
             if ((use_taxcomp || use_topk) && (numcolsintable < 2 || numcolsintable > 20))
                 FATAL_ERROR("Invalid number of columns in compressed table, make sure to set it with -c, --num-col");
             
         }
 
+        std::string checkpoint_params() {
+            /* the parameters that change the output files, these must match when resuming */
+            std::ostringstream params;
+            params << "filelist=" << input_list << " output=" << output_prefix
+                   << " revcomp=" << use_rcomp << " window=" << pfp_w << " modulus=" << hash_mod
+                   << " taxcomp=" << use_taxcomp << " top-k=" << use_topk << " num-col=" << numcolsintable
+                   << " print-doc=" << doc_to_extract << " heuristics=" << use_heuristics
+                   << " two-pass=" << use_two_pass << " temp=" << temp_prefix
+                   << " minimizers=" << use_minimizers << " dna-minimizers=" << use_dna_minimizers
+                   << " dna-syncmers=" << use_dna_syncmers << " small-window=" << small_window_l
+                   << " large-window=" << large_window_l << " in-process=" << in_process
+                   << " lean=" << use_lean << " ftab=" << make_ftab;
+            return params.str();
+        }
+
         void validate_for_repstats_method() {
             // check if filelist is a valid file
             if (input_list.length() && !is_file(input_list)) 
@@ -258,8 +314,8 @@ struct PFPDocBuildOptions {
                 FATAL_ERROR("output path prefix is not in a valid directory.");   
 
             // only one type of minimizer digestion can be used
-            if (use_minimizers && use_dna_minimizers)
-                FATAL_ERROR("cannot use both minimizer-alphabet and DNA-alphabet minimizers.");
+            if ((use_minimizers + use_dna_minimizers + use_dna_syncmers) > 1)
+                FATAL_ERROR("only one of minimizer-alphabet minimizers, DNA-alphabet minimizers and syncmers can be used.");
 
             // smaller window of minimizer scheme must be smaller than larger window
             if (small_window_l > large_window_l)
@@ -268,6 +324,84 @@ struct PFPDocBuildOptions {
             // make sure small window is 4 if using minimizer alphabet
             if (use_minimizers && small_window_l != 4)
                 FATAL_ERROR("when using minimizer alphabet, the small window must be set to 4.");  
+
+            // for syncmers, the small window (s-mer) must be shorter than the large window (syncmer)
+            if (use_dna_syncmers && small_window_l >= large_window_l)
+                FATAL_ERROR("when using syncmers, the small window must be smaller than the large window.");
+        }
+};
+
+struct PFPDocPlanOptions {
+    public:
+        std::string input_list = "";
+        std::string output_prefix = "";
+        std::string temp_prefix = "";
+        std::string mem_budget_str = "";
+        size_t mem_budget = 0;
+        size_t threads = 0;
+        size_t sample_mb = 0;
+        bool use_rcomp = false;
+        bool use_taxcomp = false;
+        bool use_lean = false;
+        size_t numcolsintable = 7;
+        size_t pfp_w = 10;
+        size_t hash_mod = 100;
+
+        bool use_minimizers = false;
+        bool use_dna_minimizers = false;
+        bool use_dna_syncmers = false;
+        size_t small_window_l = 4;
+        size_t large_window_l = 11;
+
+        void validate() {
+            /* checks the arguments and makes sure they are valid */
+            if (input_list.length() && !is_file(input_list))
+                FATAL_ERROR("The provided file-list is not valid.");
+            else if (input_list.length() == 0)
+                FATAL_ERROR("need to provide a file-list for processing.");
+
+            // the output and temp prefixes are only used in the suggested command
+            if (output_prefix.length() == 0)
+                output_prefix = std::filesystem::path(input_list).replace_extension("").string();
+            if (temp_prefix.length() == 0)
+                temp_prefix = output_prefix + "_tmp";
+
+            // the memory budget is given in GB, and defaults to the physical memory
+            if (mem_budget_str.length() > 0) {
+                if (mem_budget_str.find("GB") == std::string::npos)
+                    FATAL_ERROR("memory budget argument needs to be in this form (e.g. 16GB)");
+                mem_budget_str.erase(mem_budget_str.find("GB"), mem_budget_str.length());
+                mem_budget = std::atoi(mem_budget_str.data());
+                mem_budget *= 1073741824;
+                if (mem_budget == 0)
+                    FATAL_ERROR("the memory budget cannot be 0.");
+            } else {
+                mem_budget = (size_t) sysconf(_SC_PHYS_PAGES) * (size_t) sysconf(_SC_PAGE_SIZE);
+            }
+
+            // the number of threads defaults to the number of cores
+            if (threads == 0)
+                threads = std::max(std::thread::hardware_concurrency(), 1U);
+
+            // only one type of minimizer digestion can be used
+            if ((use_minimizers + use_dna_minimizers + use_dna_syncmers) > 1)
+                FATAL_ERROR("only one of minimizer-alphabet minimizers, DNA-alphabet minimizers and syncmers can be used.");
+
+            // smaller window of minimizer scheme must be smaller than larger window
+            if (small_window_l > large_window_l)
+                FATAL_ERROR("small window of minimizer scheme cannot be larger than the large window.");
+
+            // make sure small window is 4 if using minimizer alphabet
+            if (use_minimizers && small_window_l != 4)
+                FATAL_ERROR("when using minimizer alphabet, the small window must be set to 4.");
+
+            // for syncmers, the small window (s-mer) must be shorter than the large window (syncmer)
+            if (use_dna_syncmers && small_window_l >= large_window_l)
+                FATAL_ERROR("when using syncmers, the small window must be smaller than the large window.");
+
+            // checks the number of column argument
+            if (use_taxcomp && (numcolsintable < 2 || numcolsintable > 20))
+                FATAL_ERROR("Invalid number of columns in compressed table, make sure to set it with -k, --num-col");
         }
 };
 
@@ -283,9 +417,12 @@ struct PFPDocRunOptions {
         bool use_topk = false;
         bool use_ftab = false;
         bool use_optimized = false;
+        bool use_stats = false;
+        size_t stats_interval = 0;
 
         bool use_minimizers = false;
         bool use_dna_minimizers = false;
+        bool use_dna_syncmers = false;
         size_t small_window_l = 4;
         size_t large_window_l = 11;
     
@@ -293,8 +430,9 @@ struct PFPDocRunOptions {
         /* checks arguments and makes sure they are valid files */
         ref_file += ".fna";
 
-        // check the input files
-        if (!is_file(ref_file) || !is_file(pattern_file))
+        // check the input files, the *.fna file itself is not needed since
+        // an in-process build does not write it (index files are checked below)
+        if (!is_file(pattern_file))
             FATAL_ERROR("At least one of the input files is not valid.");
 
         // check that output prefix is valid
@@ -306,8 +444,8 @@ struct PFPDocRunOptions {
         if (read_length < 0)
             FATAL_ERROR("Length of read must be positive.");
 
-        // check the index files
-        if (!is_file(ref_file + ".bwt.heads") || !is_file(ref_file + ".bwt.len"))
+        // check the index files, lean builds only write the serialized bwt
+        if (!is_file(ref_file + ".bwt.cliffy") && (!is_file(ref_file + ".bwt.heads") || !is_file(ref_file + ".bwt.len")))
             FATAL_ERROR("At least one of the index files is not present.");
 
         // make sure that we didn't try to turn on both types of doc array
@@ -335,8 +473,8 @@ struct PFPDocRunOptions {
             FATAL_ERROR("the number of columns in the document array is not valid or not provided.");
 
         // only one type of minimizer digestion can be used
-        if (use_minimizers && use_dna_minimizers)
-            FATAL_ERROR("cannot use both minimizer-alphabet and DNA-alphabet minimizers.");
+        if ((use_minimizers + use_dna_minimizers + use_dna_syncmers) > 1)
+            FATAL_ERROR("only one of minimizer-alphabet minimizers, DNA-alphabet minimizers and syncmers can be used.");
 
         // smaller window of minimizer scheme must be smaller than larger window
         if (small_window_l > large_window_l)
@@ -345,6 +483,10 @@ struct PFPDocRunOptions {
         // make sure small window is 4 if using minimizer alphabet
         if (use_minimizers && small_window_l != 4)
             FATAL_ERROR("when using minimizer alphabet, the small window must be set to 4.");
+
+        // for syncmers, the small window (s-mer) must be shorter than the large window (syncmer)
+        if (use_dna_syncmers && small_window_l >= large_window_l)
+            FATAL_ERROR("when using syncmers, the small window must be smaller than the large window.");
     }
 };
 
@@ -375,6 +517,7 @@ public:
 void parse_build_options(int argc, char** argv, PFPDocBuildOptions* opts);
 void parse_run_options(int argc, char** argv, PFPDocRunOptions* opts);
 void parse_info_options(int argc, char** argv, PFPDocInfoOptions* opts);
+void parse_plan_options(int argc, char** argv, PFPDocPlanOptions* opts);
 void print_build_status_info(PFPDocBuildOptions* opts);
 void print_repstats_status_info(PFPDocBuildOptions* opts);
 void run_build_parse_cmd(PFPDocBuildOptions* build_opts, HelperPrograms* helper_bins);
@@ -19,6 +19,9 @@ extern "C" {
 
 #include <pfp.hpp>
 #include <ref_builder.hpp>
+#include <alphabet.hpp>
+#include <loser_tree.hpp>
+#include <async_writer.hpp>
 #include <deque>
 #include <vector>
 #include <bits/stdc++.h>
@@ -72,8 +75,12 @@ public:
     size_t length = 0; // length of the current BWT run
 
     bool rle; // run-length encode the BWT
+    bool lean; // only keep what is needed at query time
+    std::string run_heads; // BWT runs kept in memory for lean builds
+    std::vector<uint64_t> run_lengths;
     size_t total_num_runs = 0;
     size_t NUMCOLSFORTABLE = 0; 
+    alphabet_map alphabet; // dense ranks for characters in BWT, indexes per-character tables
 
     /*
      * First alternate approach: Uses a predecessor lcp table to 
@@ -81,19 +88,21 @@ public:
      * in the lcp queue
      */
     pfp_lcp(bool use_heuristics, size_t doc_to_extract, bool taxcomp, bool topk, size_t num_cols, pf_parsing &pfp_, 
-            std::string filename, RefBuilder* ref_build, bool rle_ = true) : 
+            std::string filename, RefBuilder* ref_build, bool lean_ = false, bool rle_ = true) : 
                 pf(pfp_),
                 min_s(1, pf.n),
                 pos_s(1,0),
                 head(0),
                 NUMCOLSFORTABLE(num_cols),
+                alphabet(alphabet_map::from_dictionary(pfp_.dict.d, ref_build->seq_type)),
                 num_docs(ref_build->num_docs),
                 doc_to_print_out(doc_to_extract),
-                ch_doc_counters(256, std::vector<size_t>(ref_build->num_docs, 0)),
-                ch_doc_encountered(256, std::vector<bool>(ref_build->num_docs, false)),
-                predecessor_max_lcp(256, std::vector<size_t>(ref_build->num_docs, ref_build->total_length)),
-                queue_pos_per_tuple(256, std::vector<std::deque<size_t>>(ref_build->num_docs, std::deque<size_t>(0))),
+                ch_doc_counters(alphabet.size(), std::vector<size_t>(ref_build->num_docs, 0)),
+                ch_doc_encountered(alphabet.size(), std::vector<bool>(ref_build->num_docs, false)),
+                predecessor_max_lcp(alphabet.size(), std::vector<size_t>(ref_build->num_docs, ref_build->total_length)),
+                queue_pos_per_tuple(alphabet.size(), std::vector<std::deque<size_t>>(ref_build->num_docs, std::deque<size_t>(0))),
                 rle(rle_),
+                lean(lean_),
                 use_taxcomp(taxcomp),
                 use_topk(topk)
                 // heads(1, 0)
@@ -102,74 +111,77 @@ public:
         auto start = std::chrono::system_clock::now();
 
         // opening output files for data-structures like 
-        // LCP, SA, BWT
-        std::string outfile = filename + std::string(".lcp");
-        if ((lcp_file = fopen(outfile.c_str(), "w")) == nullptr)
-            error("open() file " + outfile + " failed");
-
-        outfile = filename + std::string(".ssa");
-        if ((ssa_file = fopen(outfile.c_str(), "w")) == nullptr)
-            error("open() file " + outfile + " failed");
-
-        outfile = filename + std::string(".esa");
-        if ((esa_file = fopen(outfile.c_str(), "w")) == nullptr)
-            error("open() file " + outfile + " failed");
-
-        if (rle) {
-            outfile = filename + std::string(".bwt.heads");
-            if ((bwt_file = fopen(outfile.c_str(), "w")) == nullptr)
+        // LCP, SA, BWT (lean builds keep the BWT runs in memory)
+        std::string outfile = "";
+        if (!lean) {
+            outfile = filename + std::string(".lcp");
+            if ((lcp_file = async_writer::open(outfile)) == nullptr)
                 error("open() file " + outfile + " failed");
 
-            outfile = filename + std::string(".bwt.len");
-            if ((bwt_file_len = fopen(outfile.c_str(), "w")) == nullptr)
+            outfile = filename + std::string(".ssa");
+            if ((ssa_file = async_writer::open(outfile)) == nullptr)
                 error("open() file " + outfile + " failed");
-        } else {
-            outfile = filename + std::string(".bwt");
-            if ((bwt_file = fopen(outfile.c_str(), "w")) == nullptr)
+
+            outfile = filename + std::string(".esa");
+            if ((esa_file = async_writer::open(outfile)) == nullptr)
                 error("open() file " + outfile + " failed");
+
+            if (rle) {
+                outfile = filename + std::string(".bwt.heads");
+                if ((bwt_file = async_writer::open(outfile)) == nullptr)
+                    error("open() file " + outfile + " failed");
+
+                outfile = filename + std::string(".bwt.len");
+                if ((bwt_file_len = async_writer::open(outfile)) == nullptr)
+                    error("open() file " + outfile + " failed");
+            } else {
+                outfile = filename + std::string(".bwt");
+                if ((bwt_file = async_writer::open(outfile)) == nullptr)
+                    error("open() file " + outfile + " failed");
+            }
         }
 
         // opens files related to document array profiles, it 
         // creates different files based on compression strategy used
         if (taxcomp) {
             outfile = filename + std::string(".taxcomp.sdap");
-            if ((sdap_tax = fopen(outfile.c_str(), "w")) == nullptr) 
+            if ((sdap_tax = async_writer::open(outfile)) == nullptr) 
                 error("open() file " + outfile + " failed");
             outfile = filename + std::string(".taxcomp.edap");
-            if ((edap_tax = fopen(outfile.c_str(), "w")) == nullptr) 
+            if ((edap_tax = async_writer::open(outfile)) == nullptr) 
                 error("open() file " + outfile + " failed");
 
             outfile = filename + std::string(".taxcomp.of.sdap");
-            if ((sdap_overtax = fopen(outfile.c_str(), "w")) == nullptr) 
+            if ((sdap_overtax = async_writer::open(outfile)) == nullptr) 
                 error("open() file " + outfile + " failed");
-            if (fwrite(&ref_build->num_docs, sizeof(size_t), 1, sdap_overtax) != 1)
+            if (sdap_overtax->write(&ref_build->num_docs, sizeof(size_t), 1) != 1)
                 error("SDAP write error: number of documents");
             outfile = filename + std::string(".taxcomp.of.edap");
-            if ((edap_overtax = fopen(outfile.c_str(), "w")) == nullptr) 
+            if ((edap_overtax = async_writer::open(outfile)) == nullptr) 
                 error("open() file " + outfile + " failed");
-            if (fwrite(&ref_build->num_docs, sizeof(size_t), 1, edap_overtax) != 1)
+            if (edap_overtax->write(&ref_build->num_docs, sizeof(size_t), 1) != 1)
                 error("EDAP write error: number of documents");
 
             tax_sdap_overflow_ptr += sizeof(size_t);
             tax_edap_overflow_ptr += sizeof(size_t);
         } else if (topk) {
             outfile = filename + std::string(".topk.sdap");
-            if ((sdap_topk = fopen(outfile.c_str(), "w")) == nullptr) 
+            if ((sdap_topk = async_writer::open(outfile)) == nullptr) 
                 error("open() file " + outfile + " failed");
             outfile = filename + std::string(".topk.edap");
-            if ((edap_topk = fopen(outfile.c_str(), "w")) == nullptr) 
+            if ((edap_topk = async_writer::open(outfile)) == nullptr) 
                 error("open() file " + outfile + " failed");
         } else {
             outfile = filename + std::string(".sdap");
-            if ((sdap_file = fopen(outfile.c_str(), "w")) == nullptr) 
+            if ((sdap_file = async_writer::open(outfile)) == nullptr) 
                 error("open() file " + outfile + " failed");
-            if (fwrite(&ref_build->num_docs, sizeof(size_t), 1, sdap_file) != 1)
+            if (sdap_file->write(&ref_build->num_docs, sizeof(size_t), 1) != 1)
                 error("SDAP write error: number of documents");
 
             outfile = filename + std::string(".edap");
-            if ((edap_file = fopen(outfile.c_str(), "w")) == nullptr)
+            if ((edap_file = async_writer::open(outfile)) == nullptr)
                 error("open() file " + outfile + " failed");
-            if (fwrite(&ref_build->num_docs, sizeof(size_t), 1, edap_file) != 1)
+            if (edap_file->write(&ref_build->num_docs, sizeof(size_t), 1) != 1)
                 error("SDAP write error: number of documents");
         }
 
@@ -198,9 +210,9 @@ public:
         // Initializing the PRED table with length of the text or the 
         // MAXLCPVALUE which is 2^16 - 1
         uint16_t max_lcp_init = (ref_build->total_length > MAXLCPVALUE) ? MAXLCPVALUE : ref_build->total_length;
-        uint16_t predecessor_max_lcp_2[256][num_blocks_of_32 * 32]; 
+        uint16_t predecessor_max_lcp_2[alphabet.size()][num_blocks_of_32 * 32]; 
 
-        for (size_t i = 0; i < 256; i++)
+        for (size_t i = 0; i < alphabet.size(); i++)
             for (size_t j = 0; j < num_blocks_of_32 * 32; j++)
                 predecessor_max_lcp_2[i][j] = max_lcp_init;
 
@@ -228,47 +240,45 @@ public:
 
                 // Hard case: phrases with different BWT characters precediing them
                 int_t lcp_suffix = compute_lcp_suffix(curr, prev);
-                typedef std::pair<int_t *, std::pair<int_t *, uint8_t>> pq_t;
 
-                // using lambda to compare elements.
-                auto cmp = [](const pq_t &lhs, const pq_t &rhs) {
-                    return *lhs.first > *rhs.first;
-                };
-                
-                // Merge a list of occurrences of each phrase in the BWT of the parse
-                std::priority_queue<pq_t, std::vector<pq_t>, decltype(cmp)> pq(cmp);
+                // Merge a list of occurrences of each phrase in the BWT of the parse, when
+                // only one phrase has this suffix the merger just scans its ilist slice
+                ilist_merger.reset();
                 for (auto s: same_suffix)
                 {
                     size_t begin = pf.pars.select_ilist_s(s.phrase + 1);
                     size_t end = pf.pars.select_ilist_s(s.phrase + 2);
-                    pq.push({&pf.pars.ilist[begin], {&pf.pars.ilist[end], s.bwt_char}});
+                    ilist_merger.add_run(&pf.pars.ilist[begin], &pf.pars.ilist[end], s.bwt_char);
                 }
+                ilist_merger.build();
 
                 size_t prev_occ;
                 bool first = true;
-                while (!pq.empty())
+                while (!ilist_merger.empty())
                 {
-                    auto curr_occ = pq.top();
-                    pq.pop();
+                    size_t curr_occ = ilist_merger.top();
+                    uint8_t curr_occ_bwt_ch = ilist_merger.top_payload();
+                    ilist_merger.pop();
 
                     if (!first)
                     {
                         // Compute the minimum s_lcpP of the the current and previous occurrence of the phrase in BWT_P
-                        lcp_suffix = curr.suffix_length + min_s_lcp_T(*curr_occ.first, prev_occ);
+                        lcp_suffix = curr.suffix_length + min_s_lcp_T(curr_occ, prev_occ);
                     }
                     first = false;
 
                     // Update min_s
                     print_lcp(lcp_suffix, j);
-                    update_ssa(curr, *curr_occ.first);
-                    update_bwt(curr_occ.second.second, 1);
-                    update_esa(curr, *curr_occ.first);
+                    update_ssa(curr, curr_occ);
+                    update_bwt(curr_occ_bwt_ch, 1);
+                    update_esa(curr, curr_occ);
 
-                    ssa = (pf.pos_T[*curr_occ.first] - curr.suffix_length) % (pf.n - pf.w + 1ULL);
-                    esa = (pf.pos_T[*curr_occ.first] - curr.suffix_length) % (pf.n - pf.w + 1ULL);
+                    ssa = (pf.pos_T[curr_occ] - curr.suffix_length) % (pf.n - pf.w + 1ULL);
+                    esa = (pf.pos_T[curr_occ] - curr.suffix_length) % (pf.n - pf.w + 1ULL);
 
                     /* Start of the DA Profiles code */
-                    uint8_t curr_bwt_ch = curr_occ.second.second;
+                    uint8_t curr_bwt_ch = curr_occ_bwt_ch;
+                    uint8_t ch_rank = alphabet[curr_bwt_ch];
                     size_t lcp_i = lcp_suffix;
                     size_t sa_i = ssa;
                     size_t doc_i = ref_build->doc_ends_rank(ssa);
@@ -292,8 +302,8 @@ public:
                     // Add the current suffix data to LCP queue 
                     queue_entry_t curr_entry = {curr_run_num-1, curr_bwt_ch, doc_of_LF_i, is_start, is_end, lcp_i, pos_of_LF_i};
                     lcp_queue.push_back(curr_entry);
-                    ch_doc_counters[curr_bwt_ch][doc_of_LF_i] += 1;
-                    ch_doc_encountered[curr_bwt_ch][doc_of_LF_i] = true;
+                    ch_doc_counters[ch_rank][doc_of_LF_i] += 1;
+                    ch_doc_encountered[ch_rank][doc_of_LF_i] = true;
 
                     // Prepare variables to use during the lcp queue traversal
                     size_t min_lcp = lcp_i; // this is lcp with previous suffix
@@ -317,7 +327,7 @@ public:
                     lcp_vals_in_queue.push_back(lcp_i);
 
                     // Update the queue_pos lists for the current <ch, doc> pair
-                    queue_pos_per_tuple[curr_bwt_ch][doc_of_LF_i].push_back(pos);
+                    queue_pos_per_tuple[ch_rank][doc_of_LF_i].push_back(pos);
 
                     // Update the predecessor max lcp structure with the current lcp
                     // so basiscally iterate through all values and take the min
@@ -356,9 +366,9 @@ public:
                         __mmask32 k = ~0; // all 32 bits on, means all 32 values will be written
                         arr2 = _mm512_maskz_loadu_epi16(~0, (const __m512i*) &lcp_i_vector[0]);
 
-                        std::vector<size_t> dna_chars = {65, 67, 71, 84, 85}; // A, C, G, T, U
-                        for (size_t ch_num: dna_chars) { // Optimization for DNA
                         //for (size_t ch_num = 0; ch_num < 256; ch_num++) {
+                        // only iterate over the characters that occur in the text
+                        for (size_t ch_num = 0; ch_num < alphabet.size(); ch_num++) {
                             // use SIMD for all groups of 32
                             for (size_t i = 0; i < (num_blocks_of_32 * 32); i+=32) {
                                 // zero-mask, all the set bit positions are loaded
@@ -369,16 +379,16 @@ public:
                             }
                         }
                         // Reset the LCP with respect to the current <ch, doc> pair
-                        predecessor_max_lcp_2[curr_bwt_ch][doc_of_LF_i] = std::min((size_t) MAXLCPVALUE, ref_build->total_length - pos_of_LF_i);
+                        predecessor_max_lcp_2[ch_rank][doc_of_LF_i] = std::min((size_t) MAXLCPVALUE, ref_build->total_length - pos_of_LF_i);
                     
                     #else                        
-                        for (size_t ch_num = 0; ch_num < 256; ch_num++) {
+                        for (size_t ch_num = 0; ch_num < alphabet.size(); ch_num++) {
                             for (size_t doc_num = 0; doc_num < num_docs; doc_num++) {
                                 predecessor_max_lcp_2[ch_num][doc_num] = std::min(predecessor_max_lcp_2[ch_num][doc_num], (uint16_t) std::min(lcp_i, (size_t) MAXLCPVALUE));
                             }
                         }
                         // Reset the LCP with respect to the current <ch, doc> pair
-                        predecessor_max_lcp_2[curr_bwt_ch][doc_of_LF_i] = std::min((size_t) MAXLCPVALUE, ref_build->total_length - pos_of_LF_i);
+                        predecessor_max_lcp_2[ch_rank][doc_of_LF_i] = std::min((size_t) MAXLCPVALUE, ref_build->total_length - pos_of_LF_i);
                     #endif
 
                     /* End of SIMD changes */
@@ -402,8 +412,8 @@ public:
                     // we check and make sure they occurred to avoid initializing it
                     // with 1 (0 + 1 = 1)
                     for (size_t i = 0; i < num_docs; i++) {
-                        if (i != doc_of_LF_i && ch_doc_encountered[curr_bwt_ch][i])
-                            curr_da_profile[i] = predecessor_max_lcp_2[curr_bwt_ch][i] + 1; //predecessor_max_lcp[curr_bwt_ch][i] + 1;
+                        if (i != doc_of_LF_i && ch_doc_encountered[ch_rank][i])
+                            curr_da_profile[i] = predecessor_max_lcp_2[ch_rank][i] + 1; //predecessor_max_lcp[curr_bwt_ch][i] + 1;
                     }
 
                     // Put together a list of queue positions to traverse. For
@@ -412,7 +422,7 @@ public:
                     // of <A, 1>.
                     auto merge_lists = [&](uint8_t curr_row_ch, size_t curr_row_doc) {
                             std::vector<size_t> queue_pos_for_traversal;
-                            size_t curr_pos_list_size = queue_pos_per_tuple[curr_bwt_ch][curr_row_doc].size();
+                            size_t curr_pos_list_size = queue_pos_per_tuple[curr_row_ch][curr_row_doc].size();
                             
                             // for (auto x: queue_pos_per_tuple[curr_bwt_ch][curr_row_doc])
                             //     std::cout << x << ",";
@@ -421,7 +431,7 @@ public:
                             // lower bound position is the previous occurrence of the same bwt ch and document
                             // pair since we will not have max lcp with any suffixes above that suffix.
                             size_t lower_bound = (curr_pos_list_size >= 2) ?
-                                                 queue_pos_per_tuple[curr_bwt_ch][curr_row_doc][curr_pos_list_size-2] :
+                                                 queue_pos_per_tuple[curr_row_ch][curr_row_doc][curr_pos_list_size-2] :
                                                  0;
 
                             // Grab the last index for each list, and the documents # with non-zero
@@ -455,7 +465,7 @@ public:
 
                     // Determine which queue positions we need to check and 
                     // compute the lcp with.
-                    std::vector<size_t> queue_pos_for_traversal = merge_lists(curr_bwt_ch, doc_of_LF_i);
+                    std::vector<size_t> queue_pos_for_traversal = merge_lists(ch_rank, doc_of_LF_i);
 
                     // Go through all the necessary predecessor suffixes to 
                     // update the profiles
@@ -516,10 +526,8 @@ public:
                         // Method #2 - Heuristic 
                         } else if (lcp_queue.size() % 1000 == 0 && lcp_queue.size() >= 1000) {
                             size_t non_usual_chars = 0;
-                            auto is_usual_char = [] (auto ch) {return (ch == 'A' || ch == 'C' || ch == 'G' || ch == 'T' || ch == 'U');};
-
                             for (auto entry: lcp_queue) {
-                                if (!is_usual_char(entry.bwt_ch))
+                                if (!alphabet.is_usual(alphabet[entry.bwt_ch]))
                                     non_usual_chars++;
                             }
 
@@ -544,7 +552,7 @@ public:
                         bool non_heuristic_done = false;
                         non_heuristic_used = true;
                         while (curr_pos < lcp_queue.size() && !non_heuristic_done) {
-                            uint8_t curr_ch = lcp_queue[curr_pos].bwt_ch;
+                            uint8_t curr_ch = alphabet[lcp_queue[curr_pos].bwt_ch];
                             size_t curr_doc = lcp_queue[curr_pos].doc_num;
                             assert(ch_doc_counters[curr_ch][curr_doc] >= 1);
 
@@ -564,8 +572,7 @@ public:
                                 records_to_remove_non_heuristic++;
                                 ch_doc_counters[curr_ch][curr_doc] -= 1;
                             // TODO: generalize this to take into account characters that only occur once
-                            } else if (curr_ch == EndOfDict || (curr_ch != 'A' && curr_ch != 'C'
-                                    && curr_ch != 'G' && curr_ch != 'T' && curr_ch != 'U')) {
+                            } else if (!alphabet.is_usual(curr_ch)) {
                                 records_to_remove_non_heuristic++;
                                 ch_doc_counters[curr_ch][curr_doc] -= 1;
                             } else {
@@ -586,14 +593,9 @@ public:
                     /* End of the DA Profiles code (except for some update statements below) */
 
                     // Update prevs
-                    prev_occ = *curr_occ.first;
+                    prev_occ = curr_occ;
                     prev_bwt_ch = curr_bwt_ch;
 
-                    // Update pq
-                    curr_occ.first++;
-                    if (curr_occ.first != curr_occ.second.first)
-                        pq.push(curr_occ);
-
                     j += 1;
                     pos += 1;
                 }
@@ -612,20 +614,20 @@ public:
         total_num_runs = curr_run_num;
 
         // Close output files
-        fclose(ssa_file); fclose(esa_file);
-        fclose(bwt_file);
-        fclose(lcp_file);
+        async_writer::close(ssa_file); async_writer::close(esa_file);
+        async_writer::close(bwt_file);
+        async_writer::close(lcp_file);
         leaveout_fd.close();
 
         if (rle)
-            fclose(bwt_file_len);
+            async_writer::close(bwt_file_len);
         if (taxcomp) {
-            fclose(sdap_tax); fclose(edap_tax);
-            fclose(sdap_overtax); fclose(edap_overtax);
+            async_writer::close(sdap_tax); async_writer::close(edap_tax);
+            async_writer::close(sdap_overtax); async_writer::close(edap_overtax);
         } else if (topk) {
-            fclose(sdap_topk); fclose(edap_topk);
+            async_writer::close(sdap_topk); async_writer::close(edap_topk);
         } else {
-            fclose(sdap_file); fclose(edap_file);
+            async_writer::close(sdap_file); async_writer::close(edap_file);
         }
 
         // Write out the time the build took ...
@@ -643,6 +645,10 @@ private:
         uint8_t bwt_char = 0;
     } phrase_suffix_t;
 
+    // Tournament tree used to merge the ilist occurrences of the phrases
+    // sharing a suffix, it is re-used for each group of phrases
+    loser_tree<int_t, uint8_t> ilist_merger;
+
     // Contains the positions in the lcp_queue for each
     // <ch, doc> pair. This allows us to only traverse 
     // entries that are relevant to the current row.
@@ -680,16 +686,16 @@ private:
     size_t tax_sdap_overflow_ptr = 0, tax_edap_overflow_ptr = 0;
     size_t doc_to_print_out = 0;
 
-    FILE *sdap_file; // start of document array profiles
-    FILE *edap_file; // end of document array profiles
-    FILE *sdap_tax, *edap_tax;
-    FILE *sdap_overtax, *edap_overtax;
-    FILE *sdap_topk, *edap_topk;
-    FILE *lcp_file; // LCP array
-    FILE *bwt_file; // BWT (run characters if using rle)
-    FILE *bwt_file_len; // lengths file is using rle
-    FILE *ssa_file; // start of suffix array sample
-    FILE *esa_file; // end of suffix array sample
+    async_writer *sdap_file = nullptr; // start of document array profiles
+    async_writer *edap_file = nullptr; // end of document array profiles
+    async_writer *sdap_tax = nullptr, *edap_tax = nullptr;
+    async_writer *sdap_overtax = nullptr, *edap_overtax = nullptr;
+    async_writer *sdap_topk = nullptr, *edap_topk = nullptr;
+    async_writer *lcp_file = nullptr; // LCP array
+    async_writer *bwt_file = nullptr; // BWT (run characters if using rle)
+    async_writer *bwt_file_len = nullptr; // lengths file is using rle
+    async_writer *ssa_file = nullptr; // start of suffix array sample
+    async_writer *esa_file = nullptr; // end of suffix array sample
 
     std::ofstream leaveout_fd;
 
@@ -716,9 +722,9 @@ private:
                 // remove the DA profile, and print if it's a boundary.
                 // The format for each entry is print out the character of this run
                 // followed by all the DA entries in DOCWIDTH bytes.
-                if (is_start && fwrite(&curr_ch, 1, 1, sdap_file) != 1)
+                if (is_start && sdap_file->write(&curr_ch, 1, 1) != 1)
                     FATAL_ERROR("issue occurred while writing to *.sdap file");
-                if (is_end && fwrite(&curr_ch, 1, 1, edap_file) != 1)
+                if (is_end && edap_file->write(&curr_ch, 1, 1) != 1)
                     FATAL_ERROR("issue occurred while writing to *.edap file");
 
                 // Added for -e (extraction) option
@@ -731,9 +737,9 @@ private:
                     size_t prof_val = std::min(lcp_queue_profiles.front(), (size_t) MAXLCPVALUE);
                     lcp_queue_profiles.pop_front();
 
-                    if (is_start && fwrite(&prof_val, DOCWIDTH, 1, sdap_file) != 1)
+                    if (is_start && sdap_file->write(&prof_val, DOCWIDTH, 1) != 1)
                         error("SA write error 1");
-                    if (is_end && fwrite(&prof_val, DOCWIDTH, 1, edap_file) != 1)
+                    if (is_end && edap_file->write(&prof_val, DOCWIDTH, 1) != 1)
                         error("SA write error 1");
 
                     // Added for -e (extraction) option
@@ -787,7 +793,7 @@ private:
 
                     if (is_start) {
                         // Step 1: Write the BWT char
-                        if (fwrite(&curr_ch, 1, 1, sdap_tax) != 1)
+                        if (sdap_tax->write(&curr_ch, 1, 1) != 1)
                             FATAL_ERROR("issue occurred while writing char to *taxcomp.sdap file");
                         
                         // Step 2: Writes the ordered pairs to the file
@@ -812,7 +818,7 @@ private:
                     }
                     if (is_end) {
                         // Step 1: Write the BWT char
-                        if (fwrite(&curr_ch, 1, 1, edap_tax) != 1)
+                        if (edap_tax->write(&curr_ch, 1, 1) != 1)
                             FATAL_ERROR("issue occurred while writing char to *taxcomp.edap file");
 
                         // Step 2: Writes the ordered pairs to the file
@@ -874,9 +880,9 @@ private:
                     assert(pq.size() == NUMCOLSFORTABLE);
 
                     // Step 1: Write the BWT character 
-                    if (is_start && fwrite(&curr_ch, 1, 1, sdap_topk) != 1)
+                    if (is_start && sdap_topk->write(&curr_ch, 1, 1) != 1)
                         FATAL_ERROR("issue occurred while writing char to *topk.sdap file");
-                    if (is_end && fwrite(&curr_ch, 1, 1, edap_topk) != 1)
+                    if (is_end && edap_topk->write(&curr_ch, 1, 1) != 1)
                         FATAL_ERROR("issue occurred while writing char to *topk.edap file");
 
                     // Step 2: Write the topk documents to the index files
@@ -886,13 +892,13 @@ private:
                         size_t lcp_num = (-1 * tup1.lcp);
                         pq.pop();
 
-                        if (is_start && fwrite(&doc_num, DOCWIDTH, 1, sdap_topk) != 1)
+                        if (is_start && sdap_topk->write(&doc_num, DOCWIDTH, 1) != 1)
                             FATAL_ERROR("error occurred while writing to *topk.sdap file");
-                        if (is_start && fwrite(&lcp_num, DOCWIDTH, 1, sdap_topk) != 1)
+                        if (is_start && sdap_topk->write(&lcp_num, DOCWIDTH, 1) != 1)
                             FATAL_ERROR("error occurred while writing to *topk.sdap file");
-                        if (is_end && fwrite(&doc_num, DOCWIDTH, 1, edap_topk) != 1)
+                        if (is_end && edap_topk->write(&doc_num, DOCWIDTH, 1) != 1)
                             FATAL_ERROR("error occurred while writing to *topk.edap file");
-                        if (is_end && fwrite(&lcp_num, DOCWIDTH, 1, edap_topk) != 1)
+                        if (is_end && edap_topk->write(&lcp_num, DOCWIDTH, 1) != 1)
                             FATAL_ERROR("error occurred while writing to *topk.edap file");
                     }
             
@@ -925,11 +931,11 @@ private:
 
             // Update <ch, doc> count matrix
             if (update_table)
-                ch_doc_counters[curr_ch][curr_doc] -= 1;
+                ch_doc_counters[alphabet[curr_ch]][curr_doc] -= 1;
 
             // Update the queue position lists
             num_records_ejected++;
-            queue_pos_per_tuple[curr_ch][curr_doc].pop_front();
+            queue_pos_per_tuple[alphabet[curr_ch]][curr_doc].pop_front();
             
             // Update the lcp value in the queue vector, and the queue_entry
             lcp_vals_in_queue.pop_front();
@@ -943,18 +949,18 @@ private:
                 // remove the DA profile, and print if it's a boundary.
                 // The format for each entry is print out the character of this run
                 // followed by all the DA entries in DOCWIDTH bytes.
-                if (is_start && fwrite(&curr_ch, 1, 1, sdap_file) != 1)
+                if (is_start && sdap_file->write(&curr_ch, 1, 1) != 1)
                     FATAL_ERROR("issue occurred while writing to *.sdap file");
-                if (is_end && fwrite(&curr_ch, 1, 1, edap_file) != 1)
+                if (is_end && edap_file->write(&curr_ch, 1, 1) != 1)
                     FATAL_ERROR("issue occurred while writing to *.edap file");
                     
                 for (size_t j = 0; j < num_docs; j++) {
                     size_t prof_val = std::min(lcp_queue_profiles.front(), (size_t) MAXLCPVALUE);
                     lcp_queue_profiles.pop_front();
 
-                    if (is_start && fwrite(&prof_val, DOCWIDTH, 1, sdap_file) != 1)
+                    if (is_start && sdap_file->write(&prof_val, DOCWIDTH, 1) != 1)
                         error("SA write error 1");
-                    if (is_end && fwrite(&prof_val, DOCWIDTH, 1, edap_file) != 1)
+                    if (is_end && edap_file->write(&prof_val, DOCWIDTH, 1) != 1)
                         error("SA write error 1");
                     
                     // Added for the -e (extraction) option
@@ -1009,7 +1015,7 @@ private:
 
                     if (is_start) {
                         // Step 1: Write the BWT char
-                        if (fwrite(&curr_ch, 1, 1, sdap_tax) != 1)
+                        if (sdap_tax->write(&curr_ch, 1, 1) != 1)
                             FATAL_ERROR("issue occurred while writing char to *taxcomp.sdap file");
                         
                         // Step 2: Writes the ordered pairs to the file
@@ -1034,7 +1040,7 @@ private:
                     }
                     if (is_end) {
                         // Step 1: Write the BWT char
-                        if (fwrite(&curr_ch, 1, 1, edap_tax) != 1)
+                        if (edap_tax->write(&curr_ch, 1, 1) != 1)
                             FATAL_ERROR("issue occurred while writing char to *taxcomp.edap file");
                         
                         // Step 2: Writes the ordered pairs to the file
@@ -1097,9 +1103,9 @@ private:
                     assert(pq.size() == NUMCOLSFORTABLE);
 
                     // Step 1: Write the BWT character 
-                    if (is_start && fwrite(&curr_ch, 1, 1, sdap_topk) != 1)
+                    if (is_start && sdap_topk->write(&curr_ch, 1, 1) != 1)
                         FATAL_ERROR("issue occurred while writing char to *topk.sdap file");
-                    if (is_end && fwrite(&curr_ch, 1, 1, edap_topk) != 1)
+                    if (is_end && edap_topk->write(&curr_ch, 1, 1) != 1)
                         FATAL_ERROR("issue occurred while writing char to *topk.edap file");
 
                     // Step 2: Write the topk documents to the index files
@@ -1109,13 +1115,13 @@ private:
                         size_t lcp_num = (-1 * tup1.lcp);
                         pq.pop();
 
-                        if (is_start && fwrite(&doc_num, DOCWIDTH, 1, sdap_topk) != 1)
+                        if (is_start && sdap_topk->write(&doc_num, DOCWIDTH, 1) != 1)
                             FATAL_ERROR("error occurred while writing to *topk.sdap file");
-                        if (is_start && fwrite(&lcp_num, DOCWIDTH, 1, sdap_topk) != 1)
+                        if (is_start && sdap_topk->write(&lcp_num, DOCWIDTH, 1) != 1)
                             FATAL_ERROR("error occurred while writing to *topk.sdap file");
-                        if (is_end && fwrite(&doc_num, DOCWIDTH, 1, edap_topk) != 1)
+                        if (is_end && edap_topk->write(&doc_num, DOCWIDTH, 1) != 1)
                             FATAL_ERROR("error occurred while writing to *topk.edap file");
-                        if (is_end && fwrite(&lcp_num, DOCWIDTH, 1, edap_topk) != 1)
+                        if (is_end && edap_topk->write(&lcp_num, DOCWIDTH, 1) != 1)
                             FATAL_ERROR("error occurred while writing to *topk.edap file");
                     }
                 }
@@ -1123,7 +1129,7 @@ private:
         }
     }
 
-    size_t write_remaining_pairs_to_overflow(FILE* outfile, std::vector<size_t>& inc_pairs, size_t curr_ptr_pos){
+    size_t write_remaining_pairs_to_overflow(async_writer* outfile, std::vector<size_t>& inc_pairs, size_t curr_ptr_pos){
         /* 
          * Note: 
          * This method is only called when the document array profile has an 
@@ -1136,14 +1142,14 @@ private:
         size_t num_to_write = (diff > 0) ? diff : 0; 
         ASSERT((num_to_write < 256), "we need less than 255 values to compress the profiles.");
 
-        if (fwrite(&num_to_write, 1, 1, outfile) != 1)
+        if (outfile->write(&num_to_write, 1, 1) != 1)
             FATAL_ERROR("issue occurred while writing to overflow table.");
         curr_ptr_pos += 1;
 
         if (num_to_write > 0) {
             for (size_t j = NUMCOLSFORTABLE; j < inc_pairs.size()/2; j++) {
-                bool success = (fwrite(&inc_pairs[j*2], DOCWIDTH, 1, outfile) == 1);
-                success &= fwrite(&inc_pairs[j*2+1], DOCWIDTH, 1, outfile) == 1;
+                bool success = (outfile->write(&inc_pairs[j*2], DOCWIDTH, 1) == 1);
+                success &= outfile->write(&inc_pairs[j*2+1], DOCWIDTH, 1) == 1;
                 if (!success)
                     FATAL_ERROR("issue occurred while writing the left data to overflow table.");
                 curr_ptr_pos += (DOCWIDTH * 2);
@@ -1152,32 +1158,32 @@ private:
         return curr_ptr_pos;
     }
 
-    void write_to_taxcomp_dap(FILE* outfile, std::vector<size_t>& left_inc, std::vector<size_t>& right_inc, size_t col_num){
+    void write_to_taxcomp_dap(async_writer* outfile, std::vector<size_t>& left_inc, std::vector<size_t>& right_inc, size_t col_num){
         size_t index = col_num * 2;
         size_t left_pos = (col_num < left_inc.size()/2) ? left_inc[index]: MAXLCPVALUE;
         size_t left_lcp = (col_num < left_inc.size()/2) ? left_inc[index+1]: MAXLCPVALUE;
         size_t right_pos = (col_num < right_inc.size()/2) ? right_inc[index]: MAXLCPVALUE;
         size_t right_lcp = (col_num < right_inc.size()/2) ? right_inc[index+1]: MAXLCPVALUE;
 
-        bool success = fwrite(&left_pos, DOCWIDTH, 1, outfile) == 1;
-        success &= fwrite(&left_lcp, DOCWIDTH, 1, outfile) == 1;
-        success &= fwrite(&right_pos, DOCWIDTH, 1, outfile) == 1;
-        success &= fwrite(&right_lcp, DOCWIDTH, 1, outfile) == 1;
+        bool success = outfile->write(&left_pos, DOCWIDTH, 1) == 1;
+        success &= outfile->write(&left_lcp, DOCWIDTH, 1) == 1;
+        success &= outfile->write(&right_pos, DOCWIDTH, 1) == 1;
+        success &= outfile->write(&right_lcp, DOCWIDTH, 1) == 1;
         if (!success)
             FATAL_ERROR("issue occurred during the writing to the *.taxcomp.dap file");
     }
 
-    void append_overflow_pointer(FILE* outfile, size_t curr_pos, size_t num_left_inc, size_t num_right_inc){
+    void append_overflow_pointer(async_writer* outfile, size_t curr_pos, size_t num_left_inc, size_t num_right_inc){
         // When there is overflow, we write the pointer to the starting position
         // in overflow file, otherwise it will just be 0. Take note that 0 would
         // never be a valid position since we initialize the overflow document
         // with number of documents so first possible position is 8.
         if (num_left_inc > NUMCOLSFORTABLE || num_right_inc > NUMCOLSFORTABLE) {
-            if (fwrite(&curr_pos, sizeof(size_t), 1, outfile) != 1)
+            if (outfile->write(&curr_pos, sizeof(size_t), 1) != 1)
                 FATAL_ERROR("issue occurred when writing the overflow pointer.");
         } else {
             size_t overflow_pos = 0;
-            if (fwrite(&overflow_pos, sizeof(size_t), 1, outfile) != 1)
+            if (outfile->write(&overflow_pos, sizeof(size_t), 1) != 1)
                 FATAL_ERROR("issue occurred when writing the overflow pointer.");
         }
     }
@@ -1245,8 +1251,9 @@ private:
     }
 
     inline void print_lcp(int_t val, size_t pos){
+        if (lean) return;
         size_t tmp_val = val;
-        if (fwrite(&tmp_val, THRBYTES, 1, lcp_file) != 1)
+        if (lcp_file->write(&tmp_val, THRBYTES, 1) != 1)
             error("LCP write error 1");
     }
 
@@ -1267,21 +1274,22 @@ private:
     }
 
     inline void print_sa(){
+        if (lean) return;
         if (j < (pf.n - pf.w + 1ULL))
         {
             size_t pos = j;
-            if (fwrite(&pos, SSABYTES, 1, ssa_file) != 1)
+            if (ssa_file->write(&pos, SSABYTES, 1) != 1)
                 error("SA write error 1");
-            if (fwrite(&ssa, SSABYTES, 1, ssa_file) != 1)
+            if (ssa_file->write(&ssa, SSABYTES, 1) != 1)
                 error("SA write error 2");
         }
 
         if (j > 0)
         {
             size_t pos = j - 1;
-            if (fwrite(&pos, SSABYTES, 1, esa_file) != 1)
+            if (esa_file->write(&pos, SSABYTES, 1) != 1)
                 error("SA write error 1");
-            if (fwrite(&esa, SSABYTES, 1, esa_file) != 1)
+            if (esa_file->write(&esa, SSABYTES, 1) != 1)
                 error("SA write error 2");
         }
     }
@@ -1289,18 +1297,21 @@ private:
     inline void print_bwt(){   
         if (length > 0)
         {
-            if (rle) {
+            if (lean) {
+                run_heads.push_back(head);
+                run_lengths.push_back(length);
+            } else if (rle) {
                 // write the head character
-                if (fputc(head, bwt_file) == EOF)
+                if (bwt_file->put(head) == EOF)
                     error("BWT write error 1");
 
                 // write the length of that run
-                if (fwrite(&length, BWTBYTES, 1, bwt_file_len) != 1)
+                if (bwt_file_len->write(&length, BWTBYTES, 1) != 1)
                     error("BWT write error 2");
             } else {
                 for (size_t i = 0; i < length; ++i)
                 {
-                    if (fputc(head, bwt_file) == EOF)
+                    if (bwt_file->put(head) == EOF)
                         error("BWT write error 1");
                 }
             }
@@ -18,6 +18,15 @@ extern "C" {
 }
 #include <pfp.hpp>
 #include <ref_builder.hpp>
+#include <alphabet.hpp>
+#include <loser_tree.hpp>
+#include <spsc_queue.hpp>
+#include <parallel_dap.hpp>
+#include <temp_store.hpp>
+#include <temp_records.hpp>
+#include <async_writer.hpp>
+#include <build_checkpoint.hpp>
+#include <predecessor_table.hpp>
 #include <deque>
 #include <vector>
 #include <bits/stdc++.h>
@@ -27,16 +36,9 @@ extern "C" {
 #include <emmintrin.h>
 #include <cstdio>
 #include <algorithm>
+#include <thread>
 
-#define TEMPDATA_RECORD 6
-
-/* MACROS for reading from file */
-#define GET_IS_START(fd, num) (0x2 & fd[num * TEMPDATA_RECORD]) >> 1
-#define GET_IS_END(fd, num) (0x1 & fd[num * TEMPDATA_RECORD])
-#define GET_BWT_CH(fd, num) (fd[num * TEMPDATA_RECORD + 1])
-#define GET_DOC_OF_LF(fd, num) ((0xFF & fd[num * TEMPDATA_RECORD + 2]) | ((0xFF & fd[num * TEMPDATA_RECORD + 3]) << 8))
-#define GET_LCP(fd, num) ((0xFF & fd[num * TEMPDATA_RECORD + 4]) | ((0xFF & fd[num * TEMPDATA_RECORD + 5]) << 8))
-#define GET_DAP(fd, num) ((0xFF & fd[num * DOCWIDTH]) | ((0xFF & fd[num * DOCWIDTH + 1]) << 8))
+#define DAP_CHUNK_BLOCKS 16
 
 /* struct for temp lcp queue data */
 typedef struct
@@ -46,8 +48,43 @@ typedef struct
     uint8_t bwt_ch = 0;
     size_t doc_num = 0;
     size_t lcp_i = 0;
+    size_t suffix_length = 0;
 } temp_data_entry_t;
 
+/* profiles of a chunk of the temp records, formatted by print_dap before they are written */
+typedef struct
+{
+    std::vector<char> sdap, edap;               // full profiles, or taxcomp tables
+    std::vector<size_t> sdap_ofptr, edap_ofptr; // taxcomp overflow pointers (plus one, 0 if none)
+    std::vector<char> sdap_over, edap_over;     // taxcomp overflow pairs
+    std::vector<uint64_t> char_run_count;
+} dap_chunk_t;
+
+/* record passed from the BWT/LCP stage to the profile stage */
+typedef struct
+{
+    size_t lcp_i = 0;
+    size_t pos_of_LF_i = 0;
+    uint8_t bwt_ch = 0;
+    bool is_start = false;
+    bool is_end = false;
+} suffix_record_t;
+
+/* record passed to the output stage for the BWT, SA and LCP files */
+enum OutputRecordType {
+    OUTPUT_LCP,
+    OUTPUT_SSA,
+    OUTPUT_ESA,
+    OUTPUT_BWT
+};
+
+typedef struct
+{
+    OutputRecordType type = OUTPUT_LCP;
+    size_t first = 0;
+    size_t second = 0;
+} output_record_t;
+
 /* struct for each phrase suffix */
 typedef struct
 {
@@ -68,42 +105,59 @@ enum ConstructorType {
 class pfp_lcp_doc_two_pass {
     public:
         size_t total_num_runs = 0;
+        size_t total_tmp_used = 0;
+        size_t total_tmp_in_memory = 0;
         ConstructorType constructor_type;
 
+        // BWT runs kept in memory for lean builds
+        std::string run_heads;
+        std::vector<uint64_t> run_lengths;
+
+        static void remove_checkpoint_files(std::string temp_prefix) {
+            /* deletes the files of the 1st-pass checkpoint, once the profiles are written */
+            for (auto suffix: {".ckpt_state", ".ckpt_lcp_data", ".ckpt_dap_data"})
+                std::remove((temp_prefix + suffix).data());
+        }
+
     pfp_lcp_doc_two_pass(pf_parsing &pfp_, std::string filename, RefBuilder* ref_build, 
-                            std::string temp_prefix, size_t tmp_size, bool taxcomp, bool topk, 
-                            size_t num_cols, bool rle_ = true) : 
+                            std::string temp_prefix, size_t tmp_size, size_t tmp_mem, bool taxcomp, bool topk, 
+                            size_t num_cols, size_t threads = 1, bool lean_ = false, 
+                            build_checkpoint* checkpoint = nullptr, bool rle_ = true) : 
                 pf(pfp_),
                 min_s(1, pf.n),
                 pos_s(1,0),
                 head(0),
                 NUMCOLSFORTABLE(num_cols),
                 num_docs(ref_build->num_docs),
-                ch_doc_encountered(256, std::vector<bool>(ref_build->num_docs, false)),
+                alphabet(alphabet_map::from_dictionary(pfp_.dict.d, ref_build->seq_type)),
+                ref_builder(ref_build),
                 rle(rle_),
+                lean(lean_),
                 tmp_file_size(tmp_size),
+                tmp_mem_size(tmp_mem),
+                num_threads(std::max((size_t) 1, threads)),
                 use_taxcomp(taxcomp),
                 use_topk(topk),
                 constructor_type(BUILD_ALL)
     {   
         /* construction algorithm for document array profiles */
-
-        STATUS_LOG("build_main", "building bwt and doc profiles based on pfp (1st-pass)");
-        auto start = std::chrono::system_clock::now();
-
-        initialize_index_files(filename, temp_prefix);  
         initialize_tmp_size_variables();
-        assert(pf.dict.d[pf.dict.saD[0]] == EndOfDict);
+        deferred_profiles = (num_threads > 1);
 
-        // variables for bwt/lcp/sa construction
-        phrase_suffix_t curr;
-        phrase_suffix_t prev;
+        // a resumed build restarts from the temp data saved after the 1st-pass
+        bool resume_second_pass = (checkpoint != nullptr && checkpoint->is_complete(CKPT_FIRST_PASS)
+                                   && is_file(temp_prefix + ".ckpt_state") && checkpoint->stores_intact());
+        initialize_index_files(filename, temp_prefix, !resume_second_pass);
+        if (resume_second_pass)
+            load_first_pass_state(temp_prefix);
 
         // variables for doc profile construction 
-        uint8_t prev_bwt_ch = 0;
-        size_t curr_run_num = 0;
-        size_t pos = 0;
-        std::vector<size_t> curr_da_profile (ref_build->num_docs, 0);
+        std::vector<size_t> curr_da_profile (num_docs, 0);
+
+        // all of the per-character tables are indexed by the dense 
+        // rank of the character rather than the character itself
+        size_t sigma = alphabet.size();
+        ch_doc_encountered.assign(sigma, std::vector<bool>(num_docs, false));
 
         // create a predecessor max lcp table, and re-initialize with max_lcp
         num_blocks_of_32 = num_docs/32;
@@ -113,254 +167,127 @@ class pfp_lcp_doc_two_pass {
         // maintain a table that keep track of maximum predecessor 
         // lcp for each doc and char (small note: it ends with 2, because
         // i replaced the old way with this new, "lazy" approach)
-        predecessor_max_lcp2 = new uint16_t*[256];
-        for (size_t i = 0; i < 256; i++) {
+        predecessor_max_lcp2 = new uint16_t*[sigma];
+        for (size_t i = 0; i < sigma; i++) {
             predecessor_max_lcp2[i] =  new uint16_t[num_blocks_of_32 * 32];
         }
-        for (size_t i = 0; i < 256; i++)
+        for (size_t i = 0; i < sigma; i++)
             for (size_t j = 0; j < num_blocks_of_32 * 32; j++)
                 predecessor_max_lcp2[i][j] = max_lcp_init;
         
         // maintain a cache to help speed updates each iteration
-        last_updated_row = 256;
-        dirty_lcp_cache = new uint16_t[256];
-        for (size_t i = 0; i < 256; i++)
+        last_updated_row = sigma;
+        dirty_lcp_cache = new uint16_t[sigma];
+        for (size_t i = 0; i < sigma; i++)
             dirty_lcp_cache[i] = max_lcp_init;
 
-        // create a struct to store data for temp file
-        temp_data_entry_t curr_data_entry;
-
-        // start of construction ... this loop generates the SA, LCP and BWT
-        inc(curr);
-        while (curr.i < pf.dict.saD.size())
-        {
-            // make sure current suffix is a valid proper phrase suffix 
-            // (at least w characters but not whole phrase)
-            if(is_valid(curr))
-            {
-                // compute the next character of the BWT of T
-                std::vector<phrase_suffix_t> same_suffix(1, curr);
-                phrase_suffix_t next = curr;
-
-                // go through suffix array of dictionary and store all phrase ids with same suffix
-                while (inc(next) && (pf.dict.lcpD[next.i] >= curr.suffix_length))
-                {
-                    assert(next.suffix_length >= curr.suffix_length);
-                    assert((pf.dict.b_d[next.sn] == 0 && next.suffix_length >= pf.w) || (next.suffix_length != curr.suffix_length));
-                    if (next.suffix_length == curr.suffix_length)
-                    {
-                        same_suffix.push_back(next);
-                    }
-                }
-
-                // hard case: phrases with different BWT characters precediing them
-                int_t lcp_suffix = compute_lcp_suffix(curr, prev);
-                typedef std::pair<int_t *, std::pair<int_t *, uint8_t>> pq_t;
-
-                // using lambda to compare elements.
-                auto cmp = [](const pq_t &lhs, const pq_t &rhs) {
-                    return *lhs.first > *rhs.first;
-                };
-                
-                // merge a list of occurrences of each phrase in the BWT of the parse
-                std::priority_queue<pq_t, std::vector<pq_t>, decltype(cmp)> pq(cmp);
-                for (auto s: same_suffix)
-                {
-                    size_t begin = pf.pars.select_ilist_s(s.phrase + 1);
-                    size_t end = pf.pars.select_ilist_s(s.phrase + 2);
-                    pq.push({&pf.pars.ilist[begin], {&pf.pars.ilist[end], s.bwt_char}});
-                }
-
-                size_t prev_occ;
-                bool first = true;
-                while (!pq.empty())
-                {
-                    auto curr_occ = pq.top();
-                    pq.pop();
-
-                    if (!first)
-                    {
-                        // compute the minimum s_lcpP of the the current and previous 
-                        // occurrence of the phrase in BWT_P
-                        lcp_suffix = curr.suffix_length + min_s_lcp_T(*curr_occ.first, prev_occ);
-                    }
-                    first = false;
-
-                    // update min_s
-                    print_lcp(lcp_suffix, j);
-                    update_ssa(curr, *curr_occ.first);
-                    update_bwt(curr_occ.second.second, 1);
-                    update_esa(curr, *curr_occ.first);
-
-                    ssa = (pf.pos_T[*curr_occ.first] - curr.suffix_length) % (pf.n - pf.w + 1ULL);
-                    esa = (pf.pos_T[*curr_occ.first] - curr.suffix_length) % (pf.n - pf.w + 1ULL);
-
-                    /* Start of DA Code */
-                    curr_bwt_ch = curr_occ.second.second;
-                    size_t lcp_i = lcp_suffix;
-                    size_t sa_i = ssa;
-                    size_t doc_i = ref_build->doc_ends_rank(ssa);
-
-                    // determine whether current suffix is a run boundary   
-                    bool is_start = (pos == 0 || curr_bwt_ch != prev_bwt_ch) ? 1 : 0;
-                    bool is_end = (pos == ref_build->total_length-1); // only special case, common case is below
-
-                    // handle scenario where the previous suffix was a end of a run
-                    if (pos > 0 && prev_bwt_ch != curr_bwt_ch)
-                        curr_data_entry.is_end = true;
-                    
-                    // push previous suffix data into temp data file
-                    if (pos > 0) {
-                        write_data_to_temp_file(curr_data_entry);
-                        if (curr_data_entry.is_start || curr_data_entry.is_end)
-                            write_profile_to_temp_file(curr_da_profile);
-                    }
-                    
-                    if (is_start) {curr_run_num++;}
-                    size_t pos_of_LF_i = (sa_i > 0) ? (sa_i - 1) : (ref_build->total_length-1);
-                    size_t doc_of_LF_i = ref_build->doc_ends_rank(pos_of_LF_i);
-
-                    DEBUG_MSG("pos = " << pos << 
-                              ", run_num = " << curr_run_num <<  
-                              ", ch = " << curr_bwt_ch << 
-                              ", doc = " << doc_of_LF_i << 
-                              ", lcp = " << lcp_i << 
-                              ", suffix_length = " << (ref_build->total_length - pos_of_LF_i));
-
-                    // gather current suffix data
-                    curr_data_entry = {is_start, is_end, curr_bwt_ch, doc_of_LF_i, lcp_i};
-
-                    // update matrices based on current BWT character, and doc
-                    ch_doc_encountered[curr_bwt_ch][doc_of_LF_i] = true;
-
-                    // re-initialize doc profiles and max lcp with current document (itself)
-                    std::fill(curr_da_profile.begin(), curr_da_profile.end(), 0);
-                    curr_da_profile[doc_of_LF_i] = ref_build->total_length - pos_of_LF_i;
-                    
-                    // update the predecessor table, and initialize current document array profile
-                    update_predecessor_max_lcp_table_lazy_version(lcp_i, ref_build->total_length, pos_of_LF_i, doc_of_LF_i, curr_bwt_ch);
-                    initialize_current_row_profile_lazy_version(doc_of_LF_i, curr_da_profile, curr_bwt_ch);
-
-                    /* End of DA Code */
-
-                    // Update prevs
-                    prev_occ = *curr_occ.first;
-                    prev_bwt_ch = curr_bwt_ch;
-
-                    // Update pq
-                    curr_occ.first++;
-                    if (curr_occ.first != curr_occ.second.first)
-                        pq.push(curr_occ);
-
-                    j += 1;
-                    pos += 1;
-                }
-                prev = same_suffix.back();
-                curr = next;
-            }
-            else {
-                inc(curr);
+        if (!resume_second_pass) {
+            run_first_pass();
+            if (checkpoint != nullptr) {
+                save_first_pass_state(temp_prefix, checkpoint);
+                checkpoint->complete(CKPT_FIRST_PASS);
             }
         }
-        DONE_LOG((std::chrono::system_clock::now() - start));
 
-        // make sure to write the last suffix to temp data
-        write_data_to_temp_file(curr_data_entry);
-        if (curr_data_entry.is_start || curr_data_entry.is_end)
-            write_profile_to_temp_file(curr_da_profile);
+        auto start = std::chrono::system_clock::now();
 
-        // re-initialize the predecessor table, and other structures
-        for (size_t i = 0; i < 256; i++)
-            for (size_t j = 0; j < num_blocks_of_32 * 32; j++)
-                predecessor_max_lcp2[i][j] = max_lcp_init;
+        if (deferred_profiles) {
+            // the profiles are computed from the temp files by splitting the BWT
+            // into ranges, which replaces the updates in both passes. This is also
+            // used with one thread when resuming a 1st-pass that deferred them.
+            STATUS_LOG("build_main", "computing doc profiles using %ld threads", num_threads);
+            start = std::chrono::system_clock::now();
+
+            parallel_dap_builder dap_builder(lcp_inter_store, dap_inter_store, num_lcp_temp_data, 
+                                             num_docs, alphabet, num_threads);
+            dap_builder.build();
+            DONE_LOG((std::chrono::system_clock::now() - start));
+        } else {
+            // re-initialize the predecessor table, and other structures
+            for (size_t i = 0; i < sigma; i++)
+                for (size_t j = 0; j < num_blocks_of_32 * 32; j++)
+                    predecessor_max_lcp2[i][j] = max_lcp_init;
         
-        last_updated_row = 256;
-        for (size_t i = 0; i < 256; i++)
-            dirty_lcp_cache[i] = max_lcp_init;
+            last_updated_row = sigma;
+            for (size_t i = 0; i < sigma; i++)
+                dirty_lcp_cache[i] = max_lcp_init;
 
-        for (size_t i = 0; i < 256; i++) {
-            for (size_t j = 0; j < num_docs; j++)
-                ch_doc_encountered[i][j] = false;
-        }
-
-        // perform 2nd pass which focuses only on document array profiles...
-        STATUS_LOG("build_main", "performing 2nd pass to update profiles");
-        start = std::chrono::system_clock::now();
+            for (size_t i = 0; i < sigma; i++) {
+                for (size_t j = 0; j < num_docs; j++)
+                    ch_doc_encountered[i][j] = false;
+            }
 
-        size_t dap_ptr = num_dap_temp_data - num_docs;
-        for (size_t i = num_lcp_temp_data; i > 0; i--) {
-            // re-initialize at each position
-            std::fill(curr_da_profile.begin(), curr_da_profile.end(), 0);
+            // perform 2nd pass which focuses only on document array profiles...
+            STATUS_LOG("build_main", "performing 2nd pass to update profiles");
+            start = std::chrono::system_clock::now();
+
+            size_t dap_ptr = num_dap_temp_data - num_docs;
+            std::vector<uint16_t> dap_row_values(num_docs, 0);
+            temp_record_reader lcp_reader(lcp_inter_store);
+            for (size_t b = lcp_inter_store.num_blocks(); b > 0; b--) {
+                // decode the columns of the block, and walk it backward
+                const temp_record_block_t& block = lcp_reader.load_block(b-1);
+                for (size_t k = block.num_records; k > 0; k--) {
+                    // re-initialize at each position
+                    std::fill(curr_da_profile.begin(), curr_da_profile.end(), 0);
 
-            // grab the data for current suffix
-            bool is_start = GET_IS_START(mmap_lcp_inter, (i-1));
-            bool is_end = GET_IS_END(mmap_lcp_inter, (i-1));
-            uint8_t bwt_ch = GET_BWT_CH(mmap_lcp_inter, (i-1));
-            size_t doc_of_LF_i = GET_DOC_OF_LF(mmap_lcp_inter, (i-1));
+                    // grab the data for current suffix
+                    bool is_start = block.flags[k-1] & TEMP_FLAG_IS_START;
+                    bool is_end = block.flags[k-1] & TEMP_FLAG_IS_END;
+                    uint8_t bwt_ch = block.bwt_ch[k-1];
+                    uint8_t ch_rank = alphabet[bwt_ch];
+                    size_t doc_of_LF_i = block.doc_num[k-1];
 
-            flush_row_of_lcp_table_up(bwt_ch);
+                    flush_row_of_lcp_table_up(ch_rank);
 
-            DEBUG_MSG("pos = " << pos << 
-                      ", run_num = " << curr_run_num <<  
-                      ", bwt_ch = " << bwt_ch << 
-                      ", doc = " << doc_of_LF_i << 
-                      ", lcp = " << lcp_i << 
-                      ", suffix_length = " << (ref_build->total_length - pos_of_LF_i));
-
-            // if suffix is a run boundary, update its profile if necessary
-            if (is_start || is_end) {
-                initialize_current_row_profile_lazy_version(doc_of_LF_i, curr_da_profile, bwt_ch);
-                for (size_t j = 0; j < num_docs; j++) {
-                    if (GET_DAP(mmap_dap_inter, (dap_ptr+j)) < curr_da_profile[j]){
-                        size_t new_lcp_i = std::min((size_t) MAXLCPVALUE, curr_da_profile[j]);
-                        mmap_dap_inter[(dap_ptr+j) * DOCWIDTH] = (0xFF & new_lcp_i);
-                        mmap_dap_inter[(dap_ptr+j) * DOCWIDTH + 1] = ((0xFF << 8) & new_lcp_i) >> 8;
+                    // if suffix is a run boundary, update its profile if necessary
+                    if (is_start || is_end) {
+                        initialize_current_row_profile_lazy_version(doc_of_LF_i, curr_da_profile, ch_rank);
+                        max_update_dap_row(dap_inter_store, dap_ptr, curr_da_profile, dap_row_values);
+                        dap_ptr -= num_docs;
                     }
+                    ch_doc_encountered[ch_rank][doc_of_LF_i] = true;
+
+                    // update the predecessor table for next suffix
+                    size_t lcp_i = block.lcp[k-1];
+                    update_predecessor_max_lcp_table_up_lazy_version(lcp_i, doc_of_LF_i, ch_rank);
                 }
-                dap_ptr -= num_docs;
             }
-            ch_doc_encountered[bwt_ch][doc_of_LF_i] = true;
-
-            // update the predecessor table for next suffix
-            size_t lcp_i = GET_LCP(mmap_lcp_inter, (i-1));            
-            update_predecessor_max_lcp_table_up_lazy_version(lcp_i, doc_of_LF_i, bwt_ch);
-
+            // print out build time
+            DONE_LOG((std::chrono::system_clock::now() - start));
         }
-        // print out build time
-        DONE_LOG((std::chrono::system_clock::now() - start));
 
         // print the document array profiles
-        print_dap(num_lcp_temp_data);
-
-        // print last BWT char and SA sample
-        print_sa();
-        print_bwt();
-        total_num_runs = curr_run_num;
+        print_dap();
 
         // close output files
-        fclose(ssa_file); fclose(esa_file);
-        fclose(bwt_file);
-        fclose(bwt_file_len);
-        fclose(lcp_file);
-        fclose(run_cnt_file); 
+        async_writer::close(ssa_file); async_writer::close(esa_file);
+        async_writer::close(bwt_file);
+        async_writer::close(bwt_file_len);
+        async_writer::close(lcp_file);
+        async_writer::close(run_cnt_file); 
 
         // close the approriate dap files
         if (use_taxcomp) {
-            fclose(sdap_tax); fclose(edap_tax);
-            fclose(sdap_ofptr_tax); fclose(edap_ofptr_tax);
-            fclose(sdap_overtax); fclose(edap_overtax);  
+            async_writer::close(sdap_tax); async_writer::close(edap_tax);
+            async_writer::close(sdap_ofptr_tax); async_writer::close(edap_ofptr_tax);
+            async_writer::close(sdap_overtax); async_writer::close(edap_overtax);  
         } else {   
-            fclose(sdap_file); 
-            fclose(edap_file);
+            async_writer::close(sdap_file); 
+            async_writer::close(edap_file);
         }
 
         // delete temporary files
         delete_temp_files(temp_prefix);
 
         // print out statistics
-        size_t total_tmp_used = (num_lcp_temp_data * TEMPDATA_RECORD) + (num_dap_temp_data * DOCWIDTH);
-        STATS_LOG("build_main", "stats: n = %ld, r = %ld, total_tmp_used = %ld (%ld + %ld)", 
-                  j, total_num_runs, total_tmp_used, (num_lcp_temp_data * TEMPDATA_RECORD), (num_dap_temp_data * DOCWIDTH)); 
+        total_tmp_used = lcp_inter_store.bytes_used() + (num_dap_temp_data * DOCWIDTH);
+        total_tmp_in_memory = lcp_inter_store.bytes_in_memory() + dap_inter_store.bytes_in_memory();
+        STATS_LOG("build_main", "stats: n = %ld, r = %ld, total_tmp_used = %ld (%ld + %ld), tmp_in_memory = %ld", 
+                  j, total_num_runs, total_tmp_used, lcp_inter_store.bytes_used(), (num_dap_temp_data * DOCWIDTH),
+                  total_tmp_in_memory); 
+        STATS_LOG("build_main", "stats: lcp temp data compressed from %ld to %ld bytes", 
+                  (num_lcp_temp_data * TEMPDATA_RECORD), lcp_inter_store.bytes_used());
     }
 
     pfp_lcp_doc_two_pass(pf_parsing &pfp_, std::string filename, RefBuilder* ref_build, bool rle_ = true) : 
@@ -417,48 +344,45 @@ class pfp_lcp_doc_two_pass {
 
                 // hard case: phrases with different BWT characters precediing them
                 int_t lcp_suffix = compute_lcp_suffix(curr, prev);
-                typedef std::pair<int_t *, std::pair<int_t *, uint8_t>> pq_t;
 
-                // using lambda to compare elements.
-                auto cmp = [](const pq_t &lhs, const pq_t &rhs) {
-                    return *lhs.first > *rhs.first;
-                };
-                
-                // merge a list of occurrences of each phrase in the BWT of the parse
-                std::priority_queue<pq_t, std::vector<pq_t>, decltype(cmp)> pq(cmp);
+                // merge a list of occurrences of each phrase in the BWT of the parse, when
+                // only one phrase has this suffix the merger just scans its ilist slice
+                ilist_merger.reset();
                 for (auto s: same_suffix)
                 {
                     size_t begin = pf.pars.select_ilist_s(s.phrase + 1);
                     size_t end = pf.pars.select_ilist_s(s.phrase + 2);
-                    pq.push({&pf.pars.ilist[begin], {&pf.pars.ilist[end], s.bwt_char}});
+                    ilist_merger.add_run(&pf.pars.ilist[begin], &pf.pars.ilist[end], s.bwt_char);
                 }
+                ilist_merger.build();
 
                 size_t prev_occ;
                 bool first = true;
-                while (!pq.empty())
+                while (!ilist_merger.empty())
                 {
-                    auto curr_occ = pq.top();
-                    pq.pop();
+                    size_t curr_occ = ilist_merger.top();
+                    uint8_t curr_occ_bwt_ch = ilist_merger.top_payload();
+                    ilist_merger.pop();
 
                     if (!first)
                     {
                         // compute the minimum s_lcpP of the the current and previous 
                         // occurrence of the phrase in BWT_P
-                        lcp_suffix = curr.suffix_length + min_s_lcp_T(*curr_occ.first, prev_occ);
+                        lcp_suffix = curr.suffix_length + min_s_lcp_T(curr_occ, prev_occ);
                     }
                     first = false;
 
                     // update min_s
                     print_lcp(lcp_suffix, j);
-                    update_ssa(curr, *curr_occ.first);
-                    update_bwt(curr_occ.second.second, 1);
-                    update_esa(curr, *curr_occ.first);
+                    update_ssa(curr, curr_occ);
+                    update_bwt(curr_occ_bwt_ch, 1);
+                    update_esa(curr, curr_occ);
 
-                    ssa = (pf.pos_T[*curr_occ.first] - curr.suffix_length) % (pf.n - pf.w + 1ULL);
-                    esa = (pf.pos_T[*curr_occ.first] - curr.suffix_length) % (pf.n - pf.w + 1ULL);
+                    ssa = (pf.pos_T[curr_occ] - curr.suffix_length) % (pf.n - pf.w + 1ULL);
+                    esa = (pf.pos_T[curr_occ] - curr.suffix_length) % (pf.n - pf.w + 1ULL);
 
                     /* Start of tag code */
-                    curr_bwt_ch = curr_occ.second.second;
+                    curr_bwt_ch = curr_occ_bwt_ch;
                     size_t lcp_i = lcp_suffix;
                     size_t sa_i = ssa;
                     size_t doc_i = ref_build->doc_ends_rank(ssa);
@@ -479,14 +403,9 @@ class pfp_lcp_doc_two_pass {
                     /* End of tag code */
 
                     // Update prevs
-                    prev_occ = *curr_occ.first;
+                    prev_occ = curr_occ;
                     prev_bwt_ch = curr_bwt_ch;
 
-                    // Update pq
-                    curr_occ.first++;
-                    if (curr_occ.first != curr_occ.second.first)
-                        pq.push(curr_occ);
-
                     j += 1;
                     pos += 1;
                 }
@@ -506,10 +425,10 @@ class pfp_lcp_doc_two_pass {
         total_num_runs = curr_run_num;
 
         // close output files
-        fclose(ssa_file); fclose(esa_file);
-        fclose(bwt_file);
-        fclose(bwt_file_len);
-        fclose(lcp_file);
+        async_writer::close(ssa_file); async_writer::close(esa_file);
+        async_writer::close(bwt_file);
+        async_writer::close(bwt_file_len);
+        async_writer::close(lcp_file);
 
         // print out statistics
         double n_over_r = (pos + 0.0)/total_num_runs;
@@ -520,13 +439,8 @@ class pfp_lcp_doc_two_pass {
 
     ~pfp_lcp_doc_two_pass() {
         if (constructor_type == BUILD_ALL) {
-            // unmap the temp data file
-            munmap(mmap_lcp_inter, tmp_file_size);
-            munmap(mmap_dap_inter, tmp_file_size);
-            close(dap_inter_fd); close(lcp_inter_fd);
-
             // deallocate memory for predecessor table
-            for (size_t i = 0; i < 256; i++)
+            for (size_t i = 0; i < alphabet.size(); i++)
                 delete[] predecessor_max_lcp2[i];
             delete[] predecessor_max_lcp2;
 
@@ -548,27 +462,31 @@ class pfp_lcp_doc_two_pass {
         size_t length = 0; // length of the current BWT run
 
         bool rle; // run-length encode the BWT
+        bool lean = false; // only keep what is needed at query time
         bool use_taxcomp = false;
         bool use_topk = false; 
 
         size_t NUMCOLSFORTABLE = 0; 
-
-        size_t tmp_file_size = 0;
-        size_t max_dap_records = 0;
-        size_t max_lcp_records = 0;
-
-        FILE *lcp_file; // LCP array
-        FILE *bwt_file; // BWT (run characters if using rle)
-        FILE *bwt_file_len; // lengths file is using rle
-        FILE *ssa_file; // start of run: suffix array sample
-        FILE *esa_file; // end of run: suffix array sample
-        FILE *run_cnt_file; // number of runs for each character
-
-        FILE *sdap_file; // start of run: document array profiles
-        FILE *edap_file; // end of run: document array profiles
-        FILE *sdap_tax, *edap_tax; // start or end when taxonomically compressing DAP
-        FILE *sdap_ofptr_tax, *edap_ofptr_tax; // contains overflow pointers for each row in DAP
-        FILE *sdap_overtax, *edap_overtax; // overflow file when taxonomically compressing DAP
+        alphabet_map alphabet; // dense ranks for characters in BWT, indexes per-character tables
+        RefBuilder* ref_builder = nullptr;
+
+        size_t tmp_file_size = 0; // limit on the size of each temp store, 0 means no limit
+        size_t tmp_mem_size = 0; // temp data is kept in memory up to this size
+        size_t num_threads = 1;
+        bool deferred_profiles = false; // the 1st-pass leaves the dap rows empty for parallel_dap_builder
+
+        async_writer *lcp_file = nullptr; // LCP array
+        async_writer *bwt_file = nullptr; // BWT (run characters if using rle)
+        async_writer *bwt_file_len = nullptr; // lengths file is using rle
+        async_writer *ssa_file = nullptr; // start of run: suffix array sample
+        async_writer *esa_file = nullptr; // end of run: suffix array sample
+        async_writer *run_cnt_file = nullptr; // number of runs for each character
+
+        async_writer *sdap_file = nullptr; // start of run: document array profiles
+        async_writer *edap_file = nullptr; // end of run: document array profiles
+        async_writer *sdap_tax = nullptr, *edap_tax = nullptr; // start or end when taxonomically compressing DAP
+        async_writer *sdap_ofptr_tax = nullptr, *edap_ofptr_tax = nullptr; // contains overflow pointers for each row in DAP
+        async_writer *sdap_overtax = nullptr, *edap_overtax = nullptr; // overflow file when taxonomically compressing DAP
 
         size_t num_docs = 0;
         size_t j = 0;
@@ -582,6 +500,17 @@ class pfp_lcp_doc_two_pass {
 
         size_t num_dap_temp_data = 0;
         size_t num_lcp_temp_data = 0;
+
+        /* tournament tree to merge the ilist occurrences of phrases sharing a suffix */
+        loser_tree<int_t, uint8_t> ilist_merger;
+
+        /* queues and state for the stages of the 1st-pass pipeline */
+        bool use_pipeline = false;
+        spsc_queue<suffix_record_t> suffix_queue;
+        spsc_queue<output_record_t> output_queue;
+        temp_data_entry_t pending_entry;
+        std::vector<size_t> pending_profile;
+        size_t records_processed = 0;
         
         /***********************************************************/
         /* matrix of <ch, doc> pairs that keep track of which pairs 
@@ -603,141 +532,236 @@ class pfp_lcp_doc_two_pass {
         /***********************************************************/
         std::deque<size_t> lcp_queue_profiles;
 
-        /* variables are used for the intermediate file */
-        int dap_inter_fd, lcp_inter_fd;
-        struct stat file_info_dap_inter;
-        struct stat file_info_lcp_inter;
-        char* mmap_dap_inter;
-        char* mmap_lcp_inter;
+        /* segmented storage for the intermediate data, it grows on demand */
+        temp_memory_budget_t temp_budget;
+        temp_store dap_inter_store;
+        temp_record_stream lcp_inter_store;
 
         /***********************************************************/
         /* Section 1: Document Array Profiles related methods
         /***********************************************************/
-        void initialize_index_files(std::string filename, std::string temp_prefix) {
-            /* opening output files for data-structures like  LCP, SA, BWT */
+        void run_first_pass() {
+            /* 1st-pass: generates the BWT, SA, LCP and writes the temp data for the profiles */
+            STATUS_LOG("build_main", "building bwt and doc profiles based on pfp (1st-pass)");
+            auto start = std::chrono::system_clock::now();
+            assert(pf.dict.d[pf.dict.saD[0]] == EndOfDict);
+
+            // variables for bwt/lcp/sa construction
+            phrase_suffix_t curr;
+            phrase_suffix_t prev;
+
+            // variables for doc profile construction 
+            uint8_t prev_bwt_ch = 0;
+            size_t curr_run_num = 0;
+            size_t pos = 0;
+
+            // state used by the profile stage for the previous suffix
+            pending_profile.assign(num_docs, 0);
+            records_processed = 0;
+
+            /*
+             * The 1st-pass is split into three stages: this thread generates the
+             * BWT/SA/LCP (producer), the profile stage maintains the predecessor
+             * tables and writes the temp files, and the output stage writes the
+             * BWT/SA/LCP files. The stages are connected by SPSC queues, and when
+             * the build uses one thread (or only one core is available), they are
+             * run inline on this thread.
+             */
+            use_pipeline = (num_threads > 1 && std::thread::hardware_concurrency() > 1);
+            std::thread profile_thread, output_thread;
+            if (use_pipeline) {
+                profile_thread = std::thread(&pfp_lcp_doc_two_pass::run_profile_stage, this);
+                output_thread = std::thread(&pfp_lcp_doc_two_pass::run_output_stage, this);
+            }
 
-            // LCP data-structure
-            std::string outfile = filename + std::string(".lcp");
-            if ((lcp_file = fopen(outfile.c_str(), "w")) == nullptr)
-                error("open() file " + outfile + " failed");
-            
-            // Suffix array samples at start of runs
-            outfile = filename + std::string(".ssa");
-            if ((ssa_file = fopen(outfile.c_str(), "w")) == nullptr)
-                error("open() file " + outfile + " failed");
-            
-            // Suffix array samples at end of runs
-            outfile = filename + std::string(".esa");
-            if ((esa_file = fopen(outfile.c_str(), "w")) == nullptr)
-                error("open() file " + outfile + " failed");
-            
-            // BWT index files
-            if (rle) {
-                outfile = filename + std::string(".bwt.heads");
-                if ((bwt_file = fopen(outfile.c_str(), "w")) == nullptr)
-                    error("open() file " + outfile + " failed");
+            // start of construction ... this loop generates the SA, LCP and BWT
+            inc(curr);
+            while (curr.i < pf.dict.saD.size())
+            {
+                // make sure current suffix is a valid proper phrase suffix 
+                // (at least w characters but not whole phrase)
+                if(is_valid(curr))
+                {
+                    // compute the next character of the BWT of T
+                    std::vector<phrase_suffix_t> same_suffix(1, curr);
+                    phrase_suffix_t next = curr;
 
-                outfile = filename + std::string(".bwt.len");
-                if ((bwt_file_len = fopen(outfile.c_str(), "w")) == nullptr)
-                    error("open() file " + outfile + " failed");
-            } else {
-                outfile = filename + std::string(".bwt");
-                if ((bwt_file = fopen(outfile.c_str(), "w")) == nullptr)
-                    error("open() file " + outfile + " failed");
-            }   
+                    // go through suffix array of dictionary and store all phrase ids with same suffix
+                    while (inc(next) && (pf.dict.lcpD[next.i] >= curr.suffix_length))
+                    {
+                        assert(next.suffix_length >= curr.suffix_length);
+                        assert((pf.dict.b_d[next.sn] == 0 && next.suffix_length >= pf.w) || (next.suffix_length != curr.suffix_length));
+                        if (next.suffix_length == curr.suffix_length)
+                        {
+                            same_suffix.push_back(next);
+                        }
+                    }
+
+                    // hard case: phrases with different BWT characters precediing them
+                    int_t lcp_suffix = compute_lcp_suffix(curr, prev);
+
+                    // merge a list of occurrences of each phrase in the BWT of the parse, when
+                    // only one phrase has this suffix the merger just scans its ilist slice
+                    ilist_merger.reset();
+                    for (auto s: same_suffix)
+                    {
+                        size_t begin = pf.pars.select_ilist_s(s.phrase + 1);
+                        size_t end = pf.pars.select_ilist_s(s.phrase + 2);
+                        ilist_merger.add_run(&pf.pars.ilist[begin], &pf.pars.ilist[end], s.bwt_char);
+                    }
+                    ilist_merger.build();
+
+                    size_t prev_occ;
+                    bool first = true;
+                    while (!ilist_merger.empty())
+                    {
+                        size_t curr_occ = ilist_merger.top();
+                        uint8_t curr_occ_bwt_ch = ilist_merger.top_payload();
+                        ilist_merger.pop();
+
+                        if (!first)
+                        {
+                            // compute the minimum s_lcpP of the the current and previous 
+                            // occurrence of the phrase in BWT_P
+                            lcp_suffix = curr.suffix_length + min_s_lcp_T(curr_occ, prev_occ);
+                        }
+                        first = false;
+
+                        // update min_s
+                        print_lcp(lcp_suffix, j);
+                        update_ssa(curr, curr_occ);
+                        update_bwt(curr_occ_bwt_ch, 1);
+                        update_esa(curr, curr_occ);
+
+                        ssa = (pf.pos_T[curr_occ] - curr.suffix_length) % (pf.n - pf.w + 1ULL);
+                        esa = (pf.pos_T[curr_occ] - curr.suffix_length) % (pf.n - pf.w + 1ULL);
+
+                        /* Start of DA Code */
+                        curr_bwt_ch = curr_occ_bwt_ch;
+                        size_t sa_i = ssa;
+
+                        // determine whether current suffix is a run boundary, the end of the
+                        // previous run is marked by the profile stage when it sees the next start
+                        bool is_start = (pos == 0 || curr_bwt_ch != prev_bwt_ch) ? 1 : 0;
+                        bool is_end = (pos == ref_builder->total_length-1); // only special case
+                    
+                        if (is_start) {curr_run_num++;}
+                        size_t pos_of_LF_i = (sa_i > 0) ? (sa_i - 1) : (ref_builder->total_length-1);
+
+                        // hand off the current suffix to the profile stage
+                        suffix_record_t curr_record = {(size_t) lcp_suffix, pos_of_LF_i, curr_bwt_ch, is_start, is_end};
+                        if (use_pipeline)
+                            suffix_queue.push(curr_record);
+                        else
+                            process_suffix_record(curr_record);
+
+                        /* End of DA Code */
+
+                        // Update prevs
+                        prev_occ = curr_occ;
+                        prev_bwt_ch = curr_bwt_ch;
+
+                        j += 1;
+                        pos += 1;
+                    }
+                    prev = same_suffix.back();
+                    curr = next;
+                }
+                else {
+                    inc(curr);
+                }
+            }
+
+            // print last BWT char and SA sample
+            print_sa();
+            print_bwt();
+            total_num_runs = curr_run_num;
+
+            // wait for the other stages to drain their queues
+            if (use_pipeline) {
+                suffix_queue.close(); output_queue.close();
+                profile_thread.join(); output_thread.join();
+                use_pipeline = false;
+            }
+            DONE_LOG((std::chrono::system_clock::now() - start));
+
+            // make sure to write the last suffix to temp data
+            flush_pending_suffix_record();
+            lcp_inter_store.finish();
+
+            // the BWT, SA and LCP files are complete after the 1st-pass
+            close_first_pass_files();
+        }
+
+        void initialize_index_files(std::string filename, std::string temp_prefix, bool first_pass_files = true) {
+            /* opening output files for data-structures like  LCP, SA, BWT */
+
+            // the LCP, SA samples and raw BWT are skipped by lean builds, and
+            // they are already complete when resuming from the 2nd-pass
+            std::string outfile = "";
+            if (!lean && first_pass_files)
+                initialize_index_files_for_partial_build(filename);
 
             // Document Array Profiles file
             if (use_taxcomp) {
                 // main table files: start and ends
                 outfile = filename + std::string(".taxcomp.sdap");
-                if ((sdap_tax = fopen(outfile.c_str(), "w")) == nullptr) 
+                if ((sdap_tax = async_writer::open(outfile)) == nullptr) 
                     error("open() file " + outfile + " failed");
                 outfile = filename + std::string(".taxcomp.edap");
-                if ((edap_tax = fopen(outfile.c_str(), "w")) == nullptr) 
+                if ((edap_tax = async_writer::open(outfile)) == nullptr) 
                     error("open() file " + outfile + " failed");
                 
                 // overflow pointers: start and ends
                 outfile = filename + std::string(".taxcomp.ofptr.sdap");
-                if ((sdap_ofptr_tax = fopen(outfile.c_str(), "w")) == nullptr) 
+                if ((sdap_ofptr_tax = async_writer::open(outfile)) == nullptr) 
                     error("open() file " + outfile + " failed");
                 outfile = filename + std::string(".taxcomp.ofptr.edap");
-                if ((edap_ofptr_tax = fopen(outfile.c_str(), "w")) == nullptr) 
+                if ((edap_ofptr_tax = async_writer::open(outfile)) == nullptr) 
                     error("open() file " + outfile + " failed");
                 
                 // number of runs of each char file
                 outfile = filename + std::string(".runcnt");
-                if ((run_cnt_file = fopen(outfile.c_str(), "w")) == nullptr) 
+                if ((run_cnt_file = async_writer::open(outfile)) == nullptr) 
                     error("open() file " + outfile + " failed");
                 
                 // overflow files: start and ends
                 outfile = filename + std::string(".taxcomp.of.sdap");
-                if ((sdap_overtax = fopen(outfile.c_str(), "w")) == nullptr) 
+                if ((sdap_overtax = async_writer::open(outfile)) == nullptr) 
                     error("open() file " + outfile + " failed");
-                if (fwrite(&num_docs, sizeof(size_t), 1, sdap_overtax) != 1)
+                if (sdap_overtax->write(&num_docs, sizeof(size_t), 1) != 1)
                     error("SDAP write error: number of documents");
                 outfile = filename + std::string(".taxcomp.of.edap");
-                if ((edap_overtax = fopen(outfile.c_str(), "w")) == nullptr) 
+                if ((edap_overtax = async_writer::open(outfile)) == nullptr) 
                     error("open() file " + outfile + " failed");
-                if (fwrite(&num_docs, sizeof(size_t), 1, edap_overtax) != 1)
+                if (edap_overtax->write(&num_docs, sizeof(size_t), 1) != 1)
                     error("EDAP write error: number of documents");
 
                 tax_sdap_overflow_ptr += sizeof(size_t);
                 tax_edap_overflow_ptr += sizeof(size_t);
             } else {
                 outfile = filename + std::string(".sdap");
-                if ((sdap_file = fopen(outfile.c_str(), "w")) == nullptr) 
+                if ((sdap_file = async_writer::open(outfile)) == nullptr) 
                     error("open() file " + outfile + " failed");
-                if (fwrite(&num_docs, sizeof(size_t), 1, sdap_file) != 1)
+                if (sdap_file->write(&num_docs, sizeof(size_t), 1) != 1)
                     error("SDAP write error: number of documents");
 
                 outfile = filename + std::string(".edap");
-                if ((edap_file = fopen(outfile.c_str(), "w")) == nullptr)
+                if ((edap_file = async_writer::open(outfile)) == nullptr)
                     error("open() file " + outfile + " failed");
-                if (fwrite(&num_docs, sizeof(size_t), 1, edap_file) != 1)
+                if (edap_file->write(&num_docs, sizeof(size_t), 1) != 1)
                     error("SDAP write error: number of documents"); 
 
                 // number of runs of each char file
                 outfile = filename + std::string(".runcnt");
-                if ((run_cnt_file = fopen(outfile.c_str(), "w")) == nullptr) 
+                if ((run_cnt_file = async_writer::open(outfile)) == nullptr) 
                     error("open() file " + outfile + " failed");
             }
 
-            // Open intermediate files for storing data
-            mode_t mode = S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH;
-
-            // 1. File for LCP Queue data
-            outfile = temp_prefix + std::string(".tmp_lcp_data");
-            lcp_inter_fd = open(outfile.c_str(), O_RDWR | O_CREAT | O_TRUNC, mode);
-            ftruncate(lcp_inter_fd, tmp_file_size);
-
-            if (lcp_inter_fd == -1)
-                FATAL_ERROR("Issue occurred when opening file for intermediate file.");
-            if (fstat(lcp_inter_fd, &file_info_lcp_inter) == -1)
-                FATAL_ERROR("Issue with checking file size on overflow file.");
-
-            mmap_lcp_inter = (char*) mmap(NULL, 
-                                         tmp_file_size, 
-                                         PROT_READ | PROT_WRITE, 
-                                         MAP_SHARED, 
-                                         lcp_inter_fd, 0);
-            assert(mmap_lcp_inter != MAP_FAILED);
-            
-            // 2. File for Document Array Profiles
-            outfile = temp_prefix + std::string(".tmp_dap_data");
-            dap_inter_fd = open(outfile.c_str(), O_RDWR | O_CREAT | O_TRUNC, mode);
-            ftruncate(dap_inter_fd, tmp_file_size);
-
-            if (dap_inter_fd == -1)
-                FATAL_ERROR("Issue occurred when opening file for intermediate file.");
-            if (fstat(dap_inter_fd, &file_info_dap_inter) == -1)
-                FATAL_ERROR("Issue with checking file size on overflow file.");
-
-            mmap_dap_inter = (char*) mmap(NULL, 
-                                         tmp_file_size, 
-                                         PROT_READ | PROT_WRITE, 
-                                         MAP_SHARED, 
-                                         dap_inter_fd, 0);
-            assert(mmap_dap_inter != MAP_FAILED);
+            // Intermediate storage for the LCP queue data and the document array
+            // profiles, the files are only created if they do not fit in memory
+            lcp_inter_store.init(temp_prefix + std::string(".tmp_lcp_data"), &temp_budget, tmp_file_size);
+            dap_inter_store.init(temp_prefix + std::string(".tmp_dap_data"), &temp_budget, tmp_file_size);
         }
 
         void initialize_index_files_for_partial_build(std::string filename) {
@@ -745,42 +769,113 @@ class pfp_lcp_doc_two_pass {
 
             // LCP data-structure
             std::string outfile = filename + std::string(".lcp");
-            if ((lcp_file = fopen(outfile.c_str(), "w")) == nullptr)
+            if ((lcp_file = async_writer::open(outfile)) == nullptr)
                 error("open() file " + outfile + " failed");
             
             // Suffix array samples at start of runs
             outfile = filename + std::string(".ssa");
-            if ((ssa_file = fopen(outfile.c_str(), "w")) == nullptr)
+            if ((ssa_file = async_writer::open(outfile)) == nullptr)
                 error("open() file " + outfile + " failed");
             
             // Suffix array samples at end of runs
             outfile = filename + std::string(".esa");
-            if ((esa_file = fopen(outfile.c_str(), "w")) == nullptr)
+            if ((esa_file = async_writer::open(outfile)) == nullptr)
                 error("open() file " + outfile + " failed");
             
             // BWT index files
             if (rle) {
                 outfile = filename + std::string(".bwt.heads");
-                if ((bwt_file = fopen(outfile.c_str(), "w")) == nullptr)
+                if ((bwt_file = async_writer::open(outfile)) == nullptr)
                     error("open() file " + outfile + " failed");
 
                 outfile = filename + std::string(".bwt.len");
-                if ((bwt_file_len = fopen(outfile.c_str(), "w")) == nullptr)
+                if ((bwt_file_len = async_writer::open(outfile)) == nullptr)
                     error("open() file " + outfile + " failed");
             } else {
                 outfile = filename + std::string(".bwt");
-                if ((bwt_file = fopen(outfile.c_str(), "w")) == nullptr)
+                if ((bwt_file = async_writer::open(outfile)) == nullptr)
                     error("open() file " + outfile + " failed");
             }   
         }
 
+        void close_first_pass_files() {
+            async_writer::close(ssa_file); async_writer::close(esa_file);
+            async_writer::close(bwt_file);
+            async_writer::close(bwt_file_len);
+            async_writer::close(lcp_file);
+        }
+
+        void save_first_pass_state(std::string temp_prefix, build_checkpoint* checkpoint) {
+            /* 
+             * Saves the temp data and counters needed to restart from the 2nd-pass. The temp
+             * stores are checkpointed in place: their files are renamed, and only the segments
+             * held in memory are written into them. The disk segments keep being updated by the
+             * 2nd-pass, and a rerun still gives the same rows: the lcp data is only read, and
+             * the 2nd-pass that matches the 1st-pass is used (see deferred_profiles). It either
+             * overwrites the rows (parallel_dap_builder) or max-updates them with the same values.
+             */
+            STATUS_LOG("build_main", "saving the 1st-pass checkpoint");
+            auto start = std::chrono::system_clock::now();
+
+            std::string lcp_path = temp_prefix + ".ckpt_lcp_data";
+            std::string dap_path = temp_prefix + ".ckpt_dap_data";
+            std::string state_file = temp_prefix + ".ckpt_state";
+            std::ofstream state_out(state_file + ".tmp", std::ios::binary);
+            uint64_t counters[7] = {num_docs, j, total_num_runs, num_lcp_temp_data, num_dap_temp_data, 
+                                    run_heads.size(), deferred_profiles};
+            state_out.write((char*) counters, sizeof(counters));
+            state_out.write((char*) &alphabet, sizeof(alphabet_map));
+            state_out.write(run_heads.data(), run_heads.size());
+            state_out.write((char*) run_lengths.data(), run_lengths.size() * sizeof(uint64_t));
+            auto lcp_segments = lcp_inter_store.checkpoint(state_out, lcp_path);
+            auto dap_segments = dap_inter_store.checkpoint(dap_path, num_dap_temp_data * DOCWIDTH);
+            state_out.close();
+
+            // the state file is renamed last, so it only exists once the temp data is complete
+            if (state_out.fail() || std::rename((state_file + ".tmp").data(), state_file.data()) != 0)
+                FATAL_ERROR("issue occurred while writing the 1st-pass checkpoint.");
+            checkpoint->add_store("lcp", lcp_path, lcp_inter_store.bytes_used(), lcp_segments);
+            checkpoint->add_store("dap", dap_path, num_dap_temp_data * DOCWIDTH, dap_segments);
+            DONE_LOG((std::chrono::system_clock::now() - start));
+        }
+
+        void load_first_pass_state(std::string temp_prefix) {
+            /* restores the state saved by save_first_pass_state(), instead of running the 1st-pass */
+            STATUS_LOG("build_main", "resuming from the 1st-pass checkpoint");
+            auto start = std::chrono::system_clock::now();
+
+            std::ifstream state_in(temp_prefix + ".ckpt_state", std::ios::binary);
+            uint64_t counters[7] = {0, 0, 0, 0, 0, 0, 0};
+            state_in.read((char*) counters, sizeof(counters));
+            ASSERT((counters[0] == num_docs), "the 1st-pass checkpoint was made with a different number of documents.");
+            j = counters[1]; total_num_runs = counters[2];
+            num_lcp_temp_data = counters[3]; num_dap_temp_data = counters[4];
+
+            // the rows are only complete after the 2nd-pass that matches the 1st-pass, the
+            // serial one max-updates them so it cannot be used if they were left empty
+            deferred_profiles = counters[6];
+            if (deferred_profiles && num_threads == 1)
+                FORCE_LOG("build_main", "the 1st-pass checkpoint was made with multiple threads, its profiles are computed by the parallel builder");
+            state_in.read((char*) &alphabet, sizeof(alphabet_map));
+            run_heads.resize(counters[5]);
+            run_lengths.resize(counters[5]);
+            state_in.read(&run_heads[0], run_heads.size());
+            state_in.read((char*) run_lengths.data(), run_lengths.size() * sizeof(uint64_t));
+            if (!state_in)
+                FATAL_ERROR("the 1st-pass checkpoint is incomplete, rerun without --resume.");
+
+            // the temp data is mapped from the checkpoint files, not read
+            lcp_inter_store.restore(state_in, temp_prefix + ".ckpt_lcp_data");
+            dap_inter_store.restore(temp_prefix + ".ckpt_dap_data", num_dap_temp_data * DOCWIDTH);
+            DONE_LOG((std::chrono::system_clock::now() - start));
+        }
+
         void initialize_tmp_size_variables() {
-            /* determine how many records we can store in each temporary file */
-            max_lcp_records = tmp_file_size/TEMPDATA_RECORD; 
-            max_dap_records = tmp_file_size/DOCWIDTH;
+            /* the memory budget is shared by both temp stores */
+            temp_budget.remaining = tmp_mem_size;
         }
 
-        void update_predecessor_max_lcp_table(size_t lcp_i, size_t total_length, size_t pos_of_LF_i, size_t doc_of_LF_i, uint8_t bwt_ch) {
+        void update_predecessor_max_lcp_table(size_t lcp_i, size_t total_length, size_t pos_of_LF_i, size_t doc_of_LF_i, uint8_t ch_rank) {
             /* 
              * Update the predecessor lcp table, this allows us to compute the maximum
              * lcp with respect to all the predecessor occurrences of other documents.
@@ -809,10 +904,9 @@ class pfp_lcp_doc_two_pass {
 
                 //std::vector<size_t> dna_chars = {65, 67, 71, 78, 84, 85, 89}; // A, C, G, N, T, U, Y
                 //for (size_t ch_num: dna_chars) { // Optimization for DNA
-
-                // This loop only iterates over possible uint8_t chars, and 
-                // 0, 1, and 2 are reserved for PFP so the range is [3, 255]
-                for (size_t ch_num = 3; ch_num < 256; ch_num++) {
+ 
+                // only iterate over the characters that occur in the text
+                for (size_t ch_num = 0; ch_num < alphabet.size(); ch_num++) {
                     // use SIMD for all groups of 32
                     for (size_t i = 0; i < (num_blocks_of_32 * 32); i+=32) {
                         // zero-mask, all the set bit positions are loaded
@@ -823,7 +917,7 @@ class pfp_lcp_doc_two_pass {
                     }
                 }
                 // reset the LCP with respect to the current <ch, doc> pair
-                predecessor_max_lcp[bwt_ch][doc_of_LF_i] = std::min((size_t) MAXLCPVALUE, total_length - pos_of_LF_i);
+                predecessor_max_lcp[ch_rank][doc_of_LF_i] = std::min((size_t) MAXLCPVALUE, total_length - pos_of_LF_i);
 
                 // DEBUG: START --------------------------------------------
 
@@ -858,13 +952,13 @@ class pfp_lcp_doc_two_pass {
                 // DEBUG: END ----------------------------------------------
 
             #else                        
-                for (size_t ch_num = 0; ch_num < 256; ch_num++) {
+                for (size_t ch_num = 0; ch_num < alphabet.size(); ch_num++) {
                     for (size_t doc_num = 0; doc_num < num_docs; doc_num++) {
                         predecessor_max_lcp[ch_num][doc_num] = std::min(predecessor_max_lcp[ch_num][doc_num], (uint16_t) std::min(lcp_i, (size_t) MAXLCPVALUE));
                     }
                 }
                 // reset the LCP with respect to the current <ch, doc> pair
-                predecessor_max_lcp[bwt_ch][doc_of_LF_i] = std::min((size_t) MAXLCPVALUE, total_length - pos_of_LF_i);
+                predecessor_max_lcp[ch_rank][doc_of_LF_i] = std::min((size_t) MAXLCPVALUE, total_length - pos_of_LF_i);
 
 
                 // DEBUG: START --------------------------------------------
@@ -901,83 +995,43 @@ class pfp_lcp_doc_two_pass {
             #endif
         }
 
-        void update_predecessor_max_lcp_table_lazy_version(size_t lcp_i, size_t total_length, size_t pos_of_LF_i, size_t doc_of_LF_i, uint8_t bwt_ch) {
+        void update_predecessor_max_lcp_table_lazy_version(size_t lcp_i, size_t total_length, size_t pos_of_LF_i, size_t doc_of_LF_i, uint8_t ch_rank) {
             /* 
              * Update the predecessor lcp table, this allows us to compute the maximum
              * lcp with respect to all the predecessor occurrences of other documents.
              * For example: if we are at <A, 2>, we will find the maximum lcp with the 
              * the previous occurrences of <A, 0> and <A, 1> for 3 documents.
+             *
+             * Note: ch_rank is the dense rank of the BWT character in the alphabet_map, 
+             * and the same holds for all of the other predecessor table methods.
              */
 
             // avoid overflow issues
             uint16_t truncated_lcp_i = std::min((size_t) MAXLCPVALUE, lcp_i);
 
             // update the dirty lcp table for each character
-            for (size_t i = 0; i < 256; i++) {
+            for (size_t i = 0; i < alphabet.size(); i++) {
                 dirty_lcp_cache[i] = std::min(dirty_lcp_cache[i], truncated_lcp_i);
             }
 
             // update the position corresponding the previous bwt_ch since
             // it was set to zero after flushing the previous lcp_i value
-            if (last_updated_row < 256)
+            if (last_updated_row < alphabet.size())
                 dirty_lcp_cache[last_updated_row] = truncated_lcp_i;
             
             // use this lcp value update current bwt char
-            uint16_t min_lcp_to_flush = dirty_lcp_cache[bwt_ch];
-
-            #if AVX512BW_PRESENT       
-                /*
-                * NOTE: I decided to use the mask store/load because the non-mask
-                * version of the same function was not present. I looked online and 
-                * found this thread, that describes how you can replicate their function
-                * by using masks which is what I did: https://gcc.gnu.org/bugzilla/show_bug.cgi?id=95483
-                * This link was helpful in understanding conditional
-                * load masks: https://www.cs.virginia.edu/~cr4bd/3330/F2018/simdref.html
-                */
-
-                // initialize an lcp_i vector
-                uint16_t lcp_i_vector[32];
-                for (size_t i = 0; i < 32; i++)
-                    lcp_i_vector[i] = min_lcp_to_flush;
-
-                // load the array of constants (lcp_i)
-                __m512i arr1, arr2, arr3; 
-                __mmask32 k = ~0; // all 32 bits on, means all 32 values will be written
-                arr2 = _mm512_maskz_loadu_epi16(~0, (const __m512i*) &lcp_i_vector[0]);
-                
-                // // update the bwt_ch row of table with minimum lcp since last update
-                // uint16_t min_lcp_to_flush = dirty_lcp_cache[bwt_ch];
-                // for (size_t i = 0; i < num_docs; i++) {
-                    
-                //     predecessor_max_lcp2[bwt_ch][i] = std::min(predecessor_max_lcp2[bwt_ch][i], min_lcp_to_flush);
-                //     //std::cout << "lcp2[" << bwt_ch << "][" << i << "] = " << predecessor_max_lcp2[bwt_ch][i] << std::endl;
-                // }
-
-                // use SIMD for all groups of 32
-                for (size_t i = 0; i < (num_blocks_of_32 * 32); i+=32) {
-                    // zero-mask, all the set bit positions are loaded
-                    arr1 = _mm512_maskz_loadu_epi16(~0, (const __m512i*) &predecessor_max_lcp2[bwt_ch][i]); 
-                    arr3 = _mm512_min_epu16(arr1, arr2);
-                    _mm512_mask_storeu_epi16((__m512i*) &predecessor_max_lcp2[bwt_ch][i], k, arr3); 
-                }
-                
-            #else                                   
-                // update the bwt_ch row of table with minimum lcp since last update
-                for (size_t i = 0; i < num_docs; i++) {
-                    predecessor_max_lcp2[bwt_ch][i] = std::min(predecessor_max_lcp2[bwt_ch][i], min_lcp_to_flush);
-                }
-                
-            #endif   
+            uint16_t min_lcp_to_flush = dirty_lcp_cache[ch_rank];
+            lcp_row_min(predecessor_max_lcp2[ch_rank], num_docs, min_lcp_to_flush);
 
             // update table with length of current suffix
-            predecessor_max_lcp2[bwt_ch][doc_of_LF_i] = std::min((size_t) MAXLCPVALUE, total_length-pos_of_LF_i);
+            predecessor_max_lcp2[ch_rank][doc_of_LF_i] = std::min((size_t) MAXLCPVALUE, total_length-pos_of_LF_i);
             
             // update dirty lcp cache since we have already flush lcp_i to table
-            dirty_lcp_cache[bwt_ch] = 0;
-            last_updated_row = bwt_ch;
+            dirty_lcp_cache[ch_rank] = 0;
+            last_updated_row = ch_rank;
         }
 
-        void update_predecessor_max_lcp_table_up(size_t lcp_i, size_t doc_of_LF_i, uint8_t bwt_ch) {
+        void update_predecessor_max_lcp_table_up(size_t lcp_i, size_t doc_of_LF_i, uint8_t ch_rank) {
             /* 
              * Update the predecessor lcp table, this allows us to compute the maximum
              * lcp with respect to all the predecessor occurrences of other documents.
@@ -1005,14 +1059,13 @@ class pfp_lcp_doc_two_pass {
                 arr2 = _mm512_maskz_loadu_epi16(~0, (const __m512i*) &lcp_i_vector[0]);
 
                 // Reset the LCP with respect to the current <ch, doc> pair
-                predecessor_max_lcp[bwt_ch][doc_of_LF_i] = std::min((size_t) MAXLCPVALUE, lcp_i);
+                predecessor_max_lcp[ch_rank][doc_of_LF_i] = std::min((size_t) MAXLCPVALUE, lcp_i);
 
                 //std::vector<size_t> dna_chars = {65, 67, 71, 78, 84, 85, 89}; // A, C, G, N, T, U, Y
                 //for (size_t ch_num: dna_chars) { // Optimization for DNA
                 
-                // This loop only iterates over possible uint8_t chars, and 
-                // 0, 1, and 2 are reserved for PFP so the range is [3, 255]
-                for (size_t ch_num = 3; ch_num < 256; ch_num++) {
+                // only iterate over the characters that occur in the text
+                for (size_t ch_num = 0; ch_num < alphabet.size(); ch_num++) {
                     // use SIMD for all groups of 32
                     for (size_t i = 0; i < (num_blocks_of_32 * 32); i+=32) {
                         // zero-mask, all the set bit positions are loaded
@@ -1059,9 +1112,9 @@ class pfp_lcp_doc_two_pass {
                 // DEBUG: END --------------------------------------------        
             #else        
                 // Reset the LCP with respect to the current <ch, doc> pair
-                predecessor_max_lcp[bwt_ch][doc_of_LF_i] = std::min((size_t) MAXLCPVALUE, lcp_i);
+                predecessor_max_lcp[ch_rank][doc_of_LF_i] = std::min((size_t) MAXLCPVALUE, lcp_i);
 
-                for (size_t ch_num = 0; ch_num < 256; ch_num++) {
+                for (size_t ch_num = 0; ch_num < alphabet.size(); ch_num++) {
                     for (size_t doc_num = 0; doc_num < num_docs; doc_num++) {
                         predecessor_max_lcp[ch_num][doc_num] = std::min(predecessor_max_lcp[ch_num][doc_num], (uint16_t) std::min(lcp_i, (size_t) MAXLCPVALUE));
                     }
@@ -1099,7 +1152,7 @@ class pfp_lcp_doc_two_pass {
             #endif    
         }
 
-        void update_predecessor_max_lcp_table_up_lazy_version(size_t lcp_i, size_t doc_of_LF_i, uint8_t bwt_ch) {
+        void update_predecessor_max_lcp_table_up_lazy_version(size_t lcp_i, size_t doc_of_LF_i, uint8_t ch_rank) {
             /* 
              * Update the predecessor lcp table, this allows us to compute the maximum
              * lcp with respect to all the predecessor occurrences of other documents.
@@ -1109,42 +1162,19 @@ class pfp_lcp_doc_two_pass {
             uint16_t truncated_lcp_i = std::min((size_t) MAXLCPVALUE, lcp_i);
             
             // update the dirty lcp table for each character
-            for (size_t i = 0; i < 256; i++) {
+            for (size_t i = 0; i < alphabet.size(); i++) {
                 dirty_lcp_cache[i] = std::min(dirty_lcp_cache[i], truncated_lcp_i);
             }
-            dirty_lcp_cache[bwt_ch] = truncated_lcp_i;
-            predecessor_max_lcp2[bwt_ch][doc_of_LF_i] = truncated_lcp_i;
+            dirty_lcp_cache[ch_rank] = truncated_lcp_i;
+            predecessor_max_lcp2[ch_rank][doc_of_LF_i] = truncated_lcp_i;
         }
 
-        void flush_row_of_lcp_table_up(uint8_t bwt_ch) {
-            uint16_t min_lcp_to_flush = dirty_lcp_cache[bwt_ch];
-            #if AVX512BW_PRESENT
-                // initialize an lcp_i vector
-                uint16_t lcp_i_vector[32];
-                for (size_t i = 0; i < 32; i++)
-                    lcp_i_vector[i] = min_lcp_to_flush;
-
-                // load the array of constants (lcp_i)
-                __m512i arr1, arr2, arr3; 
-                __mmask32 k = ~0; // all 32 bits on, means all 32 values will be written
-                arr2 = _mm512_maskz_loadu_epi16(~0, (const __m512i*) &lcp_i_vector[0]);          
-
-                // use SIMD for all groups of 32
-                for (size_t i = 0; i < (num_blocks_of_32 * 32); i+=32) {
-                    // zero-mask, all the set bit positions are loaded
-                    arr1 = _mm512_maskz_loadu_epi16(~0, (const __m512i*) &predecessor_max_lcp2[bwt_ch][i]); 
-                    arr3 = _mm512_min_epu16(arr1, arr2);
-                    _mm512_mask_storeu_epi16((__m512i*) &predecessor_max_lcp2[bwt_ch][i], k, arr3); 
-                }
-
-            #else
-                for (size_t i = 0; i < num_docs; i++) {
-                    predecessor_max_lcp2[bwt_ch][i] = std::min(predecessor_max_lcp2[bwt_ch][i], min_lcp_to_flush);
-                }
-            #endif
+        void flush_row_of_lcp_table_up(uint8_t ch_rank) {
+            uint16_t min_lcp_to_flush = dirty_lcp_cache[ch_rank];
+            lcp_row_min(predecessor_max_lcp2[ch_rank], num_docs, min_lcp_to_flush);
         }
 
-        void initialize_current_row_profile(size_t doc_of_LF_i, std::vector<size_t>& curr_da_profile, uint8_t bwt_ch){
+        void initialize_current_row_profile(size_t doc_of_LF_i, std::vector<size_t>& curr_da_profile, uint8_t ch_rank){
             /* 
              * Initialize the curr_da_profile with max lcp for predecessor 
              * occurrences of the same BWT character from another document, and
@@ -1153,8 +1183,8 @@ class pfp_lcp_doc_two_pass {
              */
              //std::cout << "initialize: bwt_ch = " << bwt_ch << ", ";
             for (size_t i = 0; i < num_docs; i++) {
-                if (i != doc_of_LF_i && ch_doc_encountered[bwt_ch][i]) {
-                    curr_da_profile[i] = predecessor_max_lcp[bwt_ch][i] + 1;
+                if (i != doc_of_LF_i && ch_doc_encountered[ch_rank][i]) {
+                    curr_da_profile[i] = predecessor_max_lcp[ch_rank][i] + 1;
                     
                     // if (predecessor_max_lcp[bwt_ch][i] != predecessor_max_lcp2[bwt_ch][i]) {
                     //     std::cout << "lcp[" << bwt_ch << "][" << i << "] = " << predecessor_max_lcp[bwt_ch][i] << ", ";
@@ -1168,7 +1198,7 @@ class pfp_lcp_doc_two_pass {
             }
         }
 
-        void initialize_current_row_profile_lazy_version(size_t doc_of_LF_i, std::vector<size_t>& curr_da_profile, uint8_t bwt_ch){
+        void initialize_current_row_profile_lazy_version(size_t doc_of_LF_i, std::vector<size_t>& curr_da_profile, uint8_t ch_rank){
             /* 
              * Initialize the curr_da_profile with max lcp for predecessor 
              * occurrences of the same BWT character from another document, and
@@ -1176,115 +1206,207 @@ class pfp_lcp_doc_two_pass {
              * with 1 (0 + 1 = 1)
              */
             for (size_t i = 0; i < num_docs; i++) {
-                if (i != doc_of_LF_i && ch_doc_encountered[bwt_ch][i]) {
-                    curr_da_profile[i] = predecessor_max_lcp2[bwt_ch][i] + 1;
+                if (i != doc_of_LF_i && ch_doc_encountered[ch_rank][i]) {
+                    curr_da_profile[i] = predecessor_max_lcp2[ch_rank][i] + 1;
                 }
             }
         }
 
+        void process_suffix_record(const suffix_record_t& record) {
+            /* 
+             * profile stage of the 1st-pass: writes the previous suffix to the
+             * temp files, and updates the predecessor tables with the current suffix
+             */
+            size_t total_length = ref_builder->total_length;
+
+            // the start of a run means the previous suffix was the end of a run, and
+            // then the previous suffix is pushed into the temp data file
+            if (records_processed > 0) {
+                if (record.is_start)
+                    pending_entry.is_end = true;
+                write_data_to_temp_file(pending_entry);
+                if (pending_entry.is_start || pending_entry.is_end)
+                    write_profile_to_temp_file(pending_profile);
+            }
+            size_t doc_of_LF_i = ref_builder->doc_ends_rank(record.pos_of_LF_i);
+
+            DEBUG_MSG("pos = " << records_processed << 
+                      ", ch = " << record.bwt_ch << 
+                      ", doc = " << doc_of_LF_i << 
+                      ", lcp = " << record.lcp_i << 
+                      ", suffix_length = " << (total_length - record.pos_of_LF_i));
+
+            // gather current suffix data
+            pending_entry = {record.is_start, record.is_end, record.bwt_ch, doc_of_LF_i, 
+                             record.lcp_i, total_length - record.pos_of_LF_i};
+            records_processed++;
+
+            // the profiles are computed after the 1st-pass when using multiple threads,
+            // the pending profile stays empty so it only reserves space in the temp file
+            if (deferred_profiles) return;
+
+            // update matrices based on current BWT character, and doc
+            uint8_t ch_rank = alphabet[record.bwt_ch];
+            ch_doc_encountered[ch_rank][doc_of_LF_i] = true;
+
+            // re-initialize doc profiles and max lcp with current document (itself)
+            std::fill(pending_profile.begin(), pending_profile.end(), 0);
+            pending_profile[doc_of_LF_i] = total_length - record.pos_of_LF_i;
+
+            // update the predecessor table, and initialize current document array profile
+            update_predecessor_max_lcp_table_lazy_version(record.lcp_i, total_length, record.pos_of_LF_i, doc_of_LF_i, ch_rank);
+            initialize_current_row_profile_lazy_version(doc_of_LF_i, pending_profile, ch_rank);
+        }
+
+        void flush_pending_suffix_record() {
+            /* writes the last suffix seen by the profile stage to the temp files */
+            if (records_processed == 0) return;
+            write_data_to_temp_file(pending_entry);
+            if (pending_entry.is_start || pending_entry.is_end)
+                write_profile_to_temp_file(pending_profile);
+        }
+
+        void run_profile_stage() {
+            /* profile stage thread: drains the queue filled by the BWT/LCP stage */
+            suffix_record_t record;
+            while (suffix_queue.pop(record))
+                process_suffix_record(record);
+        }
+
         void write_data_to_temp_file(temp_data_entry_t data_entry) {
-            /* write to temp lcp queue data to the file */
-            size_t start_pos = num_lcp_temp_data * TEMPDATA_RECORD;
-            mmap_lcp_inter[start_pos] = 0x00 | (data_entry.is_start << 1)  | (data_entry.is_end);
-            mmap_lcp_inter[start_pos + 1] = data_entry.bwt_ch;
-            
-            // little-endian orientation
+            /* appends the temp lcp queue data to the compressed record stream */
+            temp_record_t record;
+            record.is_start = data_entry.is_start;
+            record.is_end = data_entry.is_end;
+            record.bwt_ch = data_entry.bwt_ch;
+
             ASSERT((data_entry.doc_num < MAXDOCS), "invalid document number encountered when writing temp file.");
-            mmap_lcp_inter[start_pos + 2] = (data_entry.doc_num & 0xFF);
-            mmap_lcp_inter[start_pos + 3] = (data_entry.doc_num & (0xFF << 8)) >> 8;
+            record.doc_num = data_entry.doc_num;
+            record.lcp = std::min((size_t) MAXLCPVALUE, data_entry.lcp_i);
+            record.suffix_length = std::min((size_t) MAXLCPVALUE, data_entry.suffix_length);
 
-            size_t new_lcp_i = std::min((size_t) MAXLCPVALUE, data_entry.lcp_i);
-            mmap_lcp_inter[start_pos + 4] = (new_lcp_i & 0xFF);
-            mmap_lcp_inter[start_pos + 5] = (new_lcp_i & (0xFF << 8)) >> 8;
-            
+            lcp_inter_store.append(record);
             num_lcp_temp_data += 1;
-            ASSERT((max_lcp_records > num_lcp_temp_data), "the space in the temporary file has been used up.");
         }
 
         void write_profile_to_temp_file(std::vector<size_t>& curr_prof) {
             /* write the current profile to the temporary storage */
             size_t start_pos = num_dap_temp_data * DOCWIDTH;
+            dap_inter_store.reserve(start_pos + curr_prof.size() * DOCWIDTH);
             for (size_t i = 0; i < curr_prof.size(); i++) {
                 uint16_t curr_lcp = std::min((size_t) MAXLCPVALUE, curr_prof[i]);
-                mmap_dap_inter[start_pos + (i*DOCWIDTH)] = (0xFF & curr_lcp);
-                mmap_dap_inter[start_pos + (i*DOCWIDTH) + 1] = ((0xFF << 8) & curr_lcp) >> 8;
+                dap_inter_store[start_pos + (i*DOCWIDTH)] = (0xFF & curr_lcp);
+                dap_inter_store[start_pos + (i*DOCWIDTH) + 1] = ((0xFF << 8) & curr_lcp) >> 8;
             } 
             num_dap_temp_data += curr_prof.size();
-            
-            ASSERT((max_dap_records > (num_dap_temp_data+num_docs)), 
-                    "the space in the document array temp file is not large enough.");
         }
 
         void delete_temp_files(std::string filename) {
-            /* delete the temporary files */
-            if (std::remove((filename + ".tmp_dap_data").data()))
-                FATAL_ERROR("issue occurred while deleting temporary file."); 
-            if (std::remove((filename + ".tmp_lcp_data").data()))
-                FATAL_ERROR("issue occurred while deleting temporary file."); 
+            /* delete the temporary files, if they were needed */
+            dap_inter_store.remove_file();
+            lcp_inter_store.remove_file();
         }
 
-        void print_dap(size_t num_entries) {
-            /* writes the document-array profiles to file */
-            
-            // initialize vectors to store profiles
-            std::vector<size_t> curr_profile;
-            std::vector<size_t> left_increases, right_increases;
-            curr_profile.resize(num_docs);
+        void print_dap() {
+            /*
+             * Writes the document-array profiles to file. The records are split into
+             * chunks of blocks that are formatted in parallel into in-memory buffers,
+             * and the buffers of each round of chunks are then written out in order.
+             */
+            size_t num_blocks = lcp_inter_store.num_blocks();
+            size_t num_chunks = (num_blocks + DAP_CHUNK_BLOCKS - 1) / DAP_CHUNK_BLOCKS;
+            std::vector<dap_chunk_t> chunks(num_threads);
+            std::vector<size_t> chunk_dap_ptr(num_threads, 0);
 
-            // initialize vector for storing char run count (only used for taxcomp)
+            // initialize vector for storing char run count
             std::vector<uint64_t> char_run_count(256, 0);
 
             size_t dap_ptr = 0;
-            for (size_t i = 0; i < num_entries; i++) {
-                // Grab the data for current suffix
-                bool is_start = GET_IS_START(mmap_lcp_inter, i);
-                bool is_end = GET_IS_END(mmap_lcp_inter, i);
-                uint8_t bwt_ch = GET_BWT_CH(mmap_lcp_inter, i);
-                size_t doc_of_LF_i = GET_DOC_OF_LF(mmap_lcp_inter, i);
-
-                // Load profiles if its a run-boundary
-                if (is_start || is_end) {
-                    
+            for (size_t first_chunk = 0; first_chunk < num_chunks; first_chunk += num_threads) {
+                size_t round_chunks = std::min(num_threads, num_chunks - first_chunk);
+
+                // position of each chunk in the document array temp data
+                for (size_t c = 0; c < round_chunks; c++) {
+                    chunk_dap_ptr[c] = dap_ptr;
+                    size_t first_block = (first_chunk + c) * DAP_CHUNK_BLOCKS;
+                    size_t last_block = std::min(num_blocks, first_block + DAP_CHUNK_BLOCKS);
+                    for (size_t b = first_block; b < last_block; b++)
+                        dap_ptr += lcp_inter_store.num_boundaries(b) * num_docs;
+                }
+
+                #pragma omp parallel for schedule(static, 1) num_threads(num_threads)
+                for (size_t c = 0; c < round_chunks; c++) {
+                    size_t first_block = (first_chunk + c) * DAP_CHUNK_BLOCKS;
+                    size_t last_block = std::min(num_blocks, first_block + DAP_CHUNK_BLOCKS);
+                    format_dap_chunk(first_block, last_block, chunk_dap_ptr[c], chunks[c]);
+                }
+
+                for (size_t c = 0; c < round_chunks; c++)
+                    write_dap_chunk(chunks[c], char_run_count);
+
+                // the temp data before this round is not needed anymore
+                lcp_inter_store.release_before(std::min(num_blocks, (first_chunk + round_chunks) * DAP_CHUNK_BLOCKS) * TEMP_BLOCK_RECORDS);
+                dap_inter_store.release_before(dap_ptr * DOCWIDTH);
+            }
+
+            // write out the character run count to *.fna.runcnt file
+            for (uint64_t ch_i = 0; ch_i < 256; ch_i++) {
+                if (run_cnt_file->write(&char_run_count[ch_i], sizeof(uint64_t), 1) != 1)
+                    FATAL_ERROR("issue occurred while writing char count to *.runcnt file");
+            }
+        }
+
+        void format_dap_chunk(size_t first_block, size_t last_block, size_t dap_ptr, dap_chunk_t& chunk) {
+            /* formats the profiles of the run boundaries in the blocks into the chunk's buffers */
+            chunk.sdap.clear(); chunk.edap.clear();
+            chunk.sdap_ofptr.clear(); chunk.edap_ofptr.clear();
+            chunk.sdap_over.clear(); chunk.edap_over.clear();
+            chunk.char_run_count.assign(256, 0);
+
+            // initialize vectors to store profiles
+            std::vector<size_t> curr_profile(num_docs, 0);
+            std::vector<size_t> left_increases, right_increases;
+            temp_record_reader lcp_reader(lcp_inter_store);
+
+            for (size_t b = first_block; b < last_block; b++) {
+                const temp_record_block_t& block = lcp_reader.load_block(b);
+                for (size_t k = 0; k < block.num_records; k++) {
+                    // Grab the data for current suffix
+                    bool is_start = block.flags[k] & TEMP_FLAG_IS_START;
+                    bool is_end = block.flags[k] & TEMP_FLAG_IS_END;
+                    uint8_t bwt_ch = block.bwt_ch[k];
+
+                    // only the run-boundaries have a profile
+                    if (!is_start && !is_end)
+                        continue;
+
                     // option 1: write full document array profile
                     if (!use_taxcomp && !use_topk) {
+                        // step 1: write out the BWT character as 2 bytes, and then the lcps
+                        if (is_start) append_dap_value(chunk.sdap, bwt_ch);
+                        if (is_end) append_dap_value(chunk.edap, bwt_ch);
 
-                        // step 1: write out the BWT character as 2 bytes
-                        uint16_t bwt_as_two_bytes = 0 | bwt_ch;
-                        ASSERT((bwt_as_two_bytes < 256), "issue occurred in print_dap() for full dap.");
-
-                        if (is_start && fwrite(&bwt_as_two_bytes, DOCWIDTH, 1, sdap_file) != 1)
-                            FATAL_ERROR("issue occurred while writing to *.sdap file");
-                        if (is_end && fwrite(&bwt_as_two_bytes, DOCWIDTH, 1, edap_file) != 1)
-                            FATAL_ERROR("issue occurred while writing to *.sdap file");
-                        
-                        // step 2: write out the lcps
                         for (size_t j = 0; j < num_docs; j++) {
-                            size_t prof_val = GET_DAP(mmap_dap_inter, (dap_ptr+j));
+                            size_t prof_val = GET_DAP(dap_inter_store, (dap_ptr+j));
                             ASSERT((prof_val <= MAXLCPVALUE), "issue occurred obtaining DAP value");
-
-                            if (is_start && fwrite(&prof_val, DOCWIDTH, 1, sdap_file) != 1)
-                                FATAL_ERROR("issue occurred while writing to *.sdap file");
-                            if (is_end && fwrite(&prof_val, DOCWIDTH, 1, edap_file) != 1)
-                                FATAL_ERROR("issue occurred while writing to *.edap file");
+                            if (is_start) append_dap_value(chunk.sdap, prof_val);
+                            if (is_end) append_dap_value(chunk.edap, prof_val);
                         }
 
-                        // step 3: increment run character counter for *.fna.runcnt file
+                        // step 2: increment run character counter for *.fna.runcnt file
                         if (is_start)
-                            char_run_count[bwt_as_two_bytes] += 1;
+                            chunk.char_run_count[bwt_ch] += 1;
 
                     // option 2: use taxonomic compression
                     } else if (use_taxcomp) {
                         size_t curr_val = 0; 
-                        size_t prev_max = std::min(GET_DAP(mmap_dap_inter, (dap_ptr)), MAXLCPVALUE);
+                        size_t prev_max = std::min(GET_DAP(dap_inter_store, (dap_ptr)), MAXLCPVALUE);
                         left_increases.push_back(0);
                         left_increases.push_back(prev_max);
 
-                        // reinitialize the vector to 0
-                        std::fill(curr_profile.begin(), curr_profile.end(), 0);
-
                         // keep track of increases from left
                         for (size_t j = 0; j < num_docs; j++) {
-                            curr_val = GET_DAP(mmap_dap_inter, (dap_ptr+j));
+                            curr_val = GET_DAP(dap_inter_store, (dap_ptr+j));
                             ASSERT((curr_val <= MAXLCPVALUE), "issue occurred in writing of DAP. (taxcomp - 1)");
                             curr_profile[j] = curr_val;
 
@@ -1295,8 +1417,6 @@ class pfp_lcp_doc_two_pass {
                             }
                         }
                         ASSERT((left_increases.size() % 2 == 0), "issue occurred in writing of DAP. (taxcomp - 2)");
-                        size_t num_left_inc = left_increases.size()/2;
-                        size_t num_right_inc = 0;
 
                         // gather the increases from right
                         prev_max = curr_profile[num_docs-1];
@@ -1311,71 +1431,15 @@ class pfp_lcp_doc_two_pass {
                             }
                         }
                         ASSERT((right_increases.size() % 2 == 0), "issue occurred in writing of DAP. (taxcomp - 3)");
-                        num_right_inc = right_increases.size() / 2;
-
-                        size_t old_sdap_overflow_pos = tax_sdap_overflow_ptr;
-                        size_t old_edap_overflow_pos = tax_edap_overflow_ptr;
 
-                        // number of overflow pairs
-                        size_t num_of_pairs = (num_left_inc > NUMCOLSFORTABLE) ? (num_left_inc-NUMCOLSFORTABLE) : 0;
-                        num_of_pairs += (num_right_inc > NUMCOLSFORTABLE) ? (num_right_inc-NUMCOLSFORTABLE) : 0;
-
-                        // write to start-runs file
+                        // write to start-runs file, and increment character count (only here to avoid double counting)
                         if (is_start) {
-                            // Step 1: Write the BWT char
-                            uint16_t bwt_as_two_bytes = 0 | bwt_ch;
-                            if (fwrite(&bwt_as_two_bytes, DOCWIDTH, 1, sdap_tax) != 1)
-                                FATAL_ERROR("issue occurred while writing char to *taxcomp.sdap file");
-                            
-                            // Step 2: Writes the ordered pairs to the file
-                            for (size_t i = 0; i < NUMCOLSFORTABLE; i++) 
-                                write_to_taxcomp_dap(sdap_tax, left_increases, right_increases, i);
-                            
-                            // Step 3: Writes the overflow pointer to a file in order to be able to go to overflow file
-                            append_overflow_pointer(sdap_ofptr_tax, tax_sdap_overflow_ptr, num_left_inc, num_right_inc);
-                            
-                            // Step 4: Write any leftover pairs to overflow table
-                            if (num_left_inc > NUMCOLSFORTABLE || num_right_inc > NUMCOLSFORTABLE) {
-                                tax_sdap_overflow_ptr = write_remaining_pairs_to_overflow(sdap_overtax, left_increases, tax_sdap_overflow_ptr);
-                                tax_sdap_overflow_ptr = write_remaining_pairs_to_overflow(sdap_overtax, right_increases, tax_sdap_overflow_ptr);
-                            }
-
-                            // Step 5: Check that overflow ptr is being incremented as expected
-                            if (num_of_pairs > 0)
-                                ASSERT((tax_sdap_overflow_ptr == (old_sdap_overflow_pos + 2 + (DOCWIDTH * 2 * num_of_pairs))),  "issue occurred in writing of DAP. (taxcomp - 4)");
-                            else
-                                ASSERT((tax_sdap_overflow_ptr == old_sdap_overflow_pos), "issue occurred in writing of DAP. (taxcomp - 5)");
-                            
-                            // Step 6: Increment character count, important: notice I am only doing this in use_start to avoid double counting
-                            char_run_count[bwt_ch] += 1;
-
+                            append_taxcomp_profile(chunk.sdap, chunk.sdap_ofptr, chunk.sdap_over, bwt_ch, left_increases, right_increases);
+                            chunk.char_run_count[bwt_ch] += 1;
                         }
                         // write to end-runs file
-                        if (is_end) {
-                            // Step 1: Write the BWT char
-                            uint16_t bwt_as_two_bytes = 0 | bwt_ch;
-                            if (fwrite(&bwt_as_two_bytes, DOCWIDTH, 1, edap_tax) != 1)
-                                FATAL_ERROR("issue occurred while writing char to *taxcomp.edap file");
-
-                            // Step 2: Writes the ordered pairs to the file
-                            for (size_t i = 0; i < NUMCOLSFORTABLE; i++) 
-                                write_to_taxcomp_dap(edap_tax, left_increases, right_increases, i);
-                            
-                            // Step 3: Writes the overflow pointer to a file in order to be able to go to overflow file
-                            append_overflow_pointer(edap_ofptr_tax, tax_edap_overflow_ptr, num_left_inc, num_right_inc);
-                            
-                            // Step 4: Write any leftover pairs to overflow table
-                            if (num_left_inc > NUMCOLSFORTABLE || num_right_inc > NUMCOLSFORTABLE) {
-                                tax_edap_overflow_ptr = write_remaining_pairs_to_overflow(edap_overtax, left_increases, tax_edap_overflow_ptr);
-                                tax_edap_overflow_ptr = write_remaining_pairs_to_overflow(edap_overtax, right_increases, tax_edap_overflow_ptr);
-                            }
-
-                            // Step 5: Check that overflow ptr is being incremented as expected
-                            if (num_of_pairs > 0)
-                                ASSERT ((tax_edap_overflow_ptr == (old_edap_overflow_pos + 2 + (DOCWIDTH * 2 * num_of_pairs))), "issue occurred in writing of DAP. (taxcomp - 6)");
-                            else
-                                ASSERT ((tax_edap_overflow_ptr == old_edap_overflow_pos), "issue occurred in writing of DAP. (taxcomp - 7)");
-                        }
+                        if (is_end)
+                            append_taxcomp_profile(chunk.edap, chunk.edap_ofptr, chunk.edap_over, bwt_ch, left_increases, right_increases);
 
                         // empty the vectors
                         left_increases.clear();
@@ -1390,45 +1454,96 @@ class pfp_lcp_doc_two_pass {
                     dap_ptr += num_docs;
                 }
             }
+        }
 
-            // write out the character run count to *.fna.runcnt file
-            for (uint64_t ch_i = 0; ch_i < 256; ch_i++) {
-                if (fwrite(&char_run_count[ch_i], sizeof(uint64_t), 1, run_cnt_file) != 1)
-                    FATAL_ERROR("issue occurred while writing char count to *.runcnt file");
+        void write_dap_chunk(dap_chunk_t& chunk, std::vector<uint64_t>& char_run_count) {
+            /* writes a formatted chunk to the profile files, and moves the overflow pointers to file positions */
+            async_writer* sdap_out = use_taxcomp ? sdap_tax : sdap_file;
+            async_writer* edap_out = use_taxcomp ? edap_tax : edap_file;
+            if (sdap_out->write(chunk.sdap.data(), 1, chunk.sdap.size()) != chunk.sdap.size())
+                FATAL_ERROR("issue occurred while writing to the start-run profile file");
+            if (edap_out->write(chunk.edap.data(), 1, chunk.edap.size()) != chunk.edap.size())
+                FATAL_ERROR("issue occurred while writing to the end-run profile file");
+
+            if (use_taxcomp) {
+                write_overflow_pointers(sdap_ofptr_tax, chunk.sdap_ofptr, tax_sdap_overflow_ptr);
+                write_overflow_pointers(edap_ofptr_tax, chunk.edap_ofptr, tax_edap_overflow_ptr);
+
+                if (sdap_overtax->write(chunk.sdap_over.data(), 1, chunk.sdap_over.size()) != chunk.sdap_over.size())
+                    FATAL_ERROR("issue occurred while writing to overflow table.");
+                if (edap_overtax->write(chunk.edap_over.data(), 1, chunk.edap_over.size()) != chunk.edap_over.size())
+                    FATAL_ERROR("issue occurred while writing to overflow table.");
+                tax_sdap_overflow_ptr += chunk.sdap_over.size();
+                tax_edap_overflow_ptr += chunk.edap_over.size();
             }
+
+            for (size_t ch_i = 0; ch_i < 256; ch_i++)
+                char_run_count[ch_i] += chunk.char_run_count[ch_i];
         }
 
-        void write_to_taxcomp_dap(FILE* outfile, std::vector<size_t>& left_inc, std::vector<size_t>& right_inc, size_t col_num){
-            size_t index = col_num * 2;
-            size_t left_pos = (col_num < left_inc.size()/2) ? left_inc[index]: MAXLCPVALUE;
-            size_t left_lcp = (col_num < left_inc.size()/2) ? left_inc[index+1]: MAXLCPVALUE;
-            size_t right_pos = (col_num < right_inc.size()/2) ? right_inc[index]: MAXLCPVALUE;
-            size_t right_lcp = (col_num < right_inc.size()/2) ? right_inc[index+1]: MAXLCPVALUE;
+        void write_overflow_pointers(async_writer* outfile, std::vector<size_t>& local_ptrs, size_t overflow_start) {
+            /* chunk pointers are stored plus one (0 means no overflow), so they are shifted to the file position */
+            for (size_t i = 0; i < local_ptrs.size(); i++)
+                local_ptrs[i] = (local_ptrs[i] > 0) ? (local_ptrs[i] - 1 + overflow_start) : 0;
+            if (outfile->write(local_ptrs.data(), sizeof(size_t), local_ptrs.size()) != local_ptrs.size())
+                FATAL_ERROR("issue occurred when writing the overflow pointer.");
+        }
 
-            bool success = fwrite(&left_pos, DOCWIDTH, 1, outfile) == 1;
-            success &= fwrite(&left_lcp, DOCWIDTH, 1, outfile) == 1;
-            success &= fwrite(&right_pos, DOCWIDTH, 1, outfile) == 1;
-            success &= fwrite(&right_lcp, DOCWIDTH, 1, outfile) == 1;
-            if (!success)
-                FATAL_ERROR("issue occurred during the writing to the *.taxcomp.dap file");
+        inline void append_dap_value(std::vector<char>& buffer, size_t value) {
+            /* appends the value using DOCWIDTH bytes, in little-endian order */
+            buffer.push_back(value & 0xFF);
+            buffer.push_back((value >> 8) & 0xFF);
         }
 
-        void append_overflow_pointer(FILE* outfile, size_t curr_pos, size_t num_left_inc, size_t num_right_inc){
-            // When there is overflow, we write the pointer to the starting position
-            // in overflow file, otherwise it will just be 0. Take note that 0 would
-            // never be a valid position since we initialize the overflow document
-            // with number of documents so first possible position is 8.
+        void append_taxcomp_profile(std::vector<char>& table, std::vector<size_t>& ofptrs, std::vector<char>& overflow,
+                                    uint8_t bwt_ch, std::vector<size_t>& left_inc, std::vector<size_t>& right_inc) {
+            /* appends a profile to the taxcomp table, and its leftover pairs to the overflow table */
+            size_t num_left_inc = left_inc.size()/2;
+            size_t num_right_inc = right_inc.size()/2;
+            size_t old_overflow_pos = overflow.size();
+
+            // number of overflow pairs
+            size_t num_of_pairs = (num_left_inc > NUMCOLSFORTABLE) ? (num_left_inc-NUMCOLSFORTABLE) : 0;
+            num_of_pairs += (num_right_inc > NUMCOLSFORTABLE) ? (num_right_inc-NUMCOLSFORTABLE) : 0;
+
+            // Step 1: Write the BWT char
+            append_dap_value(table, bwt_ch);
+
+            // Step 2: Writes the ordered pairs to the table
+            for (size_t i = 0; i < NUMCOLSFORTABLE; i++) 
+                write_to_taxcomp_dap(table, left_inc, right_inc, i);
+
+            // Step 3: Writes the overflow pointer (plus one, since the chunk's overflow starts at 0)
+            // and any leftover pairs to overflow table
             if (num_left_inc > NUMCOLSFORTABLE || num_right_inc > NUMCOLSFORTABLE) {
-                if (fwrite(&curr_pos, sizeof(size_t), 1, outfile) != 1)
-                    FATAL_ERROR("issue occurred when writing the overflow pointer.");
+                ofptrs.push_back(overflow.size() + 1);
+                write_remaining_pairs_to_overflow(overflow, left_inc);
+                write_remaining_pairs_to_overflow(overflow, right_inc);
             } else {
-                size_t overflow_pos = 0;
-                if (fwrite(&overflow_pos, sizeof(size_t), 1, outfile) != 1)
-                    FATAL_ERROR("issue occurred when writing the overflow pointer.");
+                ofptrs.push_back(0);
             }
+
+            // Step 4: Check that overflow ptr is being incremented as expected
+            if (num_of_pairs > 0)
+                ASSERT((overflow.size() == (old_overflow_pos + 2 + (DOCWIDTH * 2 * num_of_pairs))),  "issue occurred in writing of DAP. (taxcomp - 4)");
+            else
+                ASSERT((overflow.size() == old_overflow_pos), "issue occurred in writing of DAP. (taxcomp - 5)");
         }
 
-        size_t write_remaining_pairs_to_overflow(FILE* outfile, std::vector<size_t>& inc_pairs, size_t curr_ptr_pos){
+        void write_to_taxcomp_dap(std::vector<char>& table, std::vector<size_t>& left_inc, std::vector<size_t>& right_inc, size_t col_num){
+            size_t index = col_num * 2;
+            size_t left_pos = (col_num < left_inc.size()/2) ? left_inc[index]: MAXLCPVALUE;
+            size_t left_lcp = (col_num < left_inc.size()/2) ? left_inc[index+1]: MAXLCPVALUE;
+            size_t right_pos = (col_num < right_inc.size()/2) ? right_inc[index]: MAXLCPVALUE;
+            size_t right_lcp = (col_num < right_inc.size()/2) ? right_inc[index+1]: MAXLCPVALUE;
+
+            append_dap_value(table, left_pos);
+            append_dap_value(table, left_lcp);
+            append_dap_value(table, right_pos);
+            append_dap_value(table, right_lcp);
+        }
+
+        void write_remaining_pairs_to_overflow(std::vector<char>& overflow, std::vector<size_t>& inc_pairs){
            /* 
             * Note: 
             * This method is only called when the document array profile has an 
@@ -1440,21 +1555,14 @@ class pfp_lcp_doc_two_pass {
             int diff = (inc_pairs.size()/2 - NUMCOLSFORTABLE);
             size_t num_to_write = (diff > 0) ? diff : 0; 
             ASSERT((num_to_write < 256), "we need less than 255 values to compress the profiles.");
-
-            if (fwrite(&num_to_write, 1, 1, outfile) != 1)
-                FATAL_ERROR("issue occurred while writing to overflow table.");
-            curr_ptr_pos += 1;
+            overflow.push_back(num_to_write);
 
             if (num_to_write > 0) {
                 for (size_t j = NUMCOLSFORTABLE; j < inc_pairs.size()/2; j++) {
-                    bool success = (fwrite(&inc_pairs[j*2], DOCWIDTH, 1, outfile) == 1);
-                    success &= fwrite(&inc_pairs[j*2+1], DOCWIDTH, 1, outfile) == 1;
-                    if (!success)
-                        FATAL_ERROR("issue occurred while writing the left data to overflow table.");
-                    curr_ptr_pos += (DOCWIDTH * 2);
+                    append_dap_value(overflow, inc_pairs[j*2]);
+                    append_dap_value(overflow, inc_pairs[j*2+1]);
                 }
             }
-            return curr_ptr_pos;
         }
 
         /***********************************************************/
@@ -1523,9 +1631,8 @@ class pfp_lcp_doc_two_pass {
         }
 
         inline void print_lcp(int_t val, size_t pos){
-            size_t tmp_val = val;
-            if (fwrite(&tmp_val, THRBYTES, 1, lcp_file) != 1)
-                error("LCP write error 1");
+            if (!lean)
+                emit_output({OUTPUT_LCP, (size_t) val, pos});
         }
 
         inline void new_min_s(int_t val, size_t pos){
@@ -1545,46 +1652,74 @@ class pfp_lcp_doc_two_pass {
         }
 
         inline void print_sa(){
+            if (lean) return;
             if (j < (pf.n - pf.w + 1ULL))
-            {
-                size_t pos = j;
-                if (fwrite(&pos, SSABYTES, 1, ssa_file) != 1)
-                    error("SA write error 1");
-                if (fwrite(&ssa, SSABYTES, 1, ssa_file) != 1)
-                    error("SA write error 2");
-            }
+                emit_output({OUTPUT_SSA, j, ssa});
 
             if (j > 0)
-            {
-                size_t pos = j - 1;
-                if (fwrite(&pos, SSABYTES, 1, esa_file) != 1)
-                    error("SA write error 1");
-                if (fwrite(&esa, SSABYTES, 1, esa_file) != 1)
-                    error("SA write error 2");
-            }
+                emit_output({OUTPUT_ESA, j - 1, esa});
         }
 
         inline void print_bwt(){   
             if (length > 0)
-            {
-                if (rle) {
-                    // write the head character
-                    if (fputc(head, bwt_file) == EOF)
-                        error("BWT write error 1");
-
-                    // write the length of that run
-                    if (fwrite(&length, BWTBYTES, 1, bwt_file_len) != 1)
-                        error("BWT write error 2");
-                } else {
-                    for (size_t i = 0; i < length; ++i)
-                    {
-                        if (fputc(head, bwt_file) == EOF)
+                emit_output({OUTPUT_BWT, head, length});
+        }
+
+        inline void emit_output(output_record_t record){
+            /* sends the record to the output stage if pipelined, otherwise writes it directly */
+            if (use_pipeline)
+                output_queue.push(record);
+            else
+                write_output_record(record);
+        }
+
+        void write_output_record(const output_record_t& record){
+            /* writes a single LCP value, SA sample, or BWT run to the index files */
+            size_t first = record.first, second = record.second;
+            switch (record.type) {
+                case OUTPUT_LCP:
+                    if (lcp_file->write(&first, THRBYTES, 1) != 1)
+                        error("LCP write error 1");
+                    break;
+                case OUTPUT_SSA:
+                case OUTPUT_ESA: {
+                    async_writer* sa_file = (record.type == OUTPUT_SSA) ? ssa_file : esa_file;
+                    if (sa_file->write(&first, SSABYTES, 1) != 1)
+                        error("SA write error 1");
+                    if (sa_file->write(&second, SSABYTES, 1) != 1)
+                        error("SA write error 2");
+                    break;
+                }
+                case OUTPUT_BWT:
+                    if (lean) {
+                        run_heads.push_back(first);
+                        run_lengths.push_back(second);
+                    } else if (rle) {
+                        // write the head character
+                        if (bwt_file->put(first) == EOF)
                             error("BWT write error 1");
+
+                        // write the length of that run
+                        if (bwt_file_len->write(&second, BWTBYTES, 1) != 1)
+                            error("BWT write error 2");
+                    } else {
+                        for (size_t i = 0; i < second; ++i)
+                        {
+                            if (bwt_file->put(first) == EOF)
+                                error("BWT write error 1");
+                        }
                     }
-                }
+                    break;
             }
         }
 
+        void run_output_stage(){
+            /* output stage of the 1st-pass: drains the queue into the index files */
+            output_record_t record;
+            while (output_queue.pop(record))
+                write_output_record(record);
+        }
+
         inline void update_bwt(uint8_t next_char, size_t length_){
             if (head != next_char)
             {
@@ -0,0 +1,149 @@
+/*
+ * File: pfp_scanner.hpp
+ * Description: Definition of the pfp_scanner class, an in-process
+ *              version of Big-BWT's scanner (newscanNT.x). Sequences
+ *              are streamed into it as they are read, and it produces
+ *              the dictionary and parse in memory with the same content
+ *              as the *.dict and *.parse files written by the scanner.
+ * Note: the hashing and parsing rules follow newscan.cpp in Big-BWT.
+ * Date: October 19th, 2026
+ */
+
+#ifndef _PFP_SCANNER_H
+#define _PFP_SCANNER_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <unordered_map>
+#include <common.hpp>
+#include <pfp_doc.hpp>
+
+/* rolling Karp-Rabin hash over the last w characters (used to find trigger strings) */
+struct kr_window {
+    const uint64_t prime = 1999999973;
+    const uint64_t asize = 256;
+    size_t wsize = 0;
+    std::vector<uint64_t> window;
+    uint64_t hash = 0;
+    uint64_t tot_char = 0;
+    uint64_t asize_pot = 1; // asize^(wsize-1) mod prime
+
+    kr_window(size_t w): wsize(w), window(w, 0) {
+        for (size_t i = 1; i < wsize; i++)
+            asize_pot = (asize_pot * asize) % prime;
+    }
+
+    inline uint64_t addchar(uint8_t c) {
+        size_t k = tot_char++ % wsize;
+        hash += (prime - (window[k] * asize_pot) % prime); // remove window[k] contribution
+        hash = (asize * hash + c) % prime;                 // add current char
+        window[k] = c;
+        return hash;
+    }
+};
+
+class pfp_scanner {
+    public:
+        std::vector<uint8_t> dict;   // same content as the *.dict file
+        std::vector<uint32_t> parse; // same content as the *.parse file
+
+        pfp_scanner(size_t w, size_t p): w(w), p(p), krw(w) {
+            word.assign(1, Dollar);
+        }
+
+        void add(const char* seq, size_t length) {
+            /* streams the next piece of the text into the parsing */
+            ASSERT((!finished), "cannot add text to the scanner after it is finished.");
+            for (size_t i = 0; i < length; i++) {
+                uint8_t c = seq[i];
+                if (c <= Dollar)
+                    FATAL_ERROR("invalid character (%d) found in the text given to the scanner.", c);
+
+                word.push_back(c);
+                if (krw.addchar(c) % p == 0)
+                    save_word();
+            }
+        }
+
+        void finish() {
+            /* closes the last phrase, and builds the sorted dictionary and the parse of ranks */
+            ASSERT((!finished), "the scanner has already been finished.");
+            finished = true;
+
+            // virtually add w dollars to the end of the text, and save the last phrase
+            word.append(w, Dollar);
+            save_word();
+
+            // sort the phrases lexicographically, the rank of each phrase is its id
+            std::vector<std::pair<const std::string*, word_stats_t*>> sorted_words;
+            sorted_words.reserve(word_freq.size());
+            for (auto& entry: word_freq)
+                sorted_words.push_back({&entry.second.str, &entry.second});
+            std::sort(sorted_words.begin(), sorted_words.end(),
+                      [](const auto& a, const auto& b) {return *a.first < *b.first;});
+
+            dict.clear();
+            uint32_t curr_rank = 1;
+            for (auto& entry: sorted_words) {
+                dict.insert(dict.end(), entry.first->begin(), entry.first->end());
+                dict.push_back(EndOfWord);
+                entry.second->rank = curr_rank++;
+            }
+            dict.push_back(EndOfDict);
+
+            // replace the phrase hashes with their ranks
+            parse.resize(parse_hashes.size());
+            for (size_t i = 0; i < parse_hashes.size(); i++)
+                parse[i] = word_freq.at(parse_hashes[i]).rank;
+
+            std::vector<uint64_t>().swap(parse_hashes);
+            std::unordered_map<uint64_t, word_stats_t>().swap(word_freq);
+        }
+
+    private:
+        typedef struct {
+            std::string str = "";
+            size_t occ = 0;
+            uint32_t rank = 0;
+        } word_stats_t;
+
+        size_t w = 0;
+        size_t p = 0;
+        kr_window krw;
+        bool finished = false;
+
+        std::string word = "";
+        std::vector<uint64_t> parse_hashes;
+        std::unordered_map<uint64_t, word_stats_t> word_freq;
+
+        static uint64_t kr_hash(const std::string& s) {
+            /* hash of a whole phrase, used to identify it in the frequency table */
+            const uint64_t prime = 27162335252586509ULL;
+            uint64_t hash = 0;
+            for (size_t k = 0; k < s.size(); k++)
+                hash = (256 * hash + (uint8_t) s[k]) % prime;
+            return hash;
+        }
+
+        void save_word() {
+            /* saves the current phrase, and keeps its last w characters to start the next one */
+            if (word.size() <= w) return;
+
+            uint64_t hash = kr_hash(word);
+            parse_hashes.push_back(hash);
+
+            auto iter = word_freq.find(hash);
+            if (iter == word_freq.end()) {
+                word_freq[hash] = {word, 1, 0};
+            } else {
+                if (iter->second.str != word)
+                    FATAL_ERROR("hash collision found between two phrases in the scanner.");
+                iter->second.occ++;
+            }
+            word.erase(0, word.size() - w);
+        }
+};
+
+#endif /* end of include guard: _PFP_SCANNER_H */
@@ -0,0 +1,42 @@
+/*
+ * File: predecessor_table.hpp
+ * Description: Kernel used to update a row of the predecessor max lcp
+ *              table during the construction of the document array
+ *              profiles. Every entry of the row is lowered to at most
+ *              the given lcp, 32 entries at a time with AVX-512BW.
+ * Note: the rows must be allocated with a multiple of 32 entries, so
+ *       the last block can be loaded and stored as a whole.
+ * Date: October 19th, 2026
+ */
+
+#ifndef _PREDECESSOR_TABLE_H
+#define _PREDECESSOR_TABLE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include <pfp_doc.hpp>
+
+#if AVX512BW_PRESENT
+#include <immintrin.h>
+#endif
+
+inline void lcp_row_min(uint16_t* row, size_t row_length, uint16_t lcp) {
+    /* sets row[i] = min(row[i], lcp) for the first row_length entries */
+    #if AVX512BW_PRESENT
+        /*
+         * NOTE: the mask load/store is used since the non-mask versions
+         * were not present, see https://gcc.gnu.org/bugzilla/show_bug.cgi?id=95483
+         */
+        const __m512i lcp_vector = _mm512_set1_epi16(lcp);
+        for (size_t i = 0; i < row_length; i += 32) {
+            __m512i curr_block = _mm512_maskz_loadu_epi16(~0, (const __m512i*) &row[i]);
+            _mm512_mask_storeu_epi16((__m512i*) &row[i], ~0, _mm512_min_epu16(curr_block, lcp_vector));
+        }
+    #else
+        for (size_t i = 0; i < row_length; i++)
+            row[i] = std::min(row[i], lcp);
+    #endif
+}
+
+#endif /* end of include guard: _PREDECESSOR_TABLE_H */
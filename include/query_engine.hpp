@@ -0,0 +1,335 @@
+/*
+ * File: query_engine.hpp
+ * Description: Definition of the mem_query_engine class, the backward
+ *              search loop shared by the doc, taxcomp and top-k queries.
+ *              It segments each read into exact matches from right to
+ *              left, and keeps a pointer to a document array profile at
+ *              a run boundary (plus the number of LF steps taken since)
+ *              for the current match. The engine is parameterized by
+ *              four policies: the profile storage (the query class
+ *              itself, which fetches a profile and prints its listing),
+ *              the seeding (whether a new match starts with an ftab
+ *              lookup), the read alphabet (whether the reads are
+ *              digested before the search), and the stats (whether the
+ *              reads are timed and counted, only with -S).
+ * Date: October 19th, 2026
+ */
+
+#ifndef _QUERY_ENGINE_H
+#define _QUERY_ENGINE_H
+
+#include <kseq.h>
+#include <zlib.h>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <chrono>
+#include <algorithm>
+#include <pfp_doc.hpp>
+#include <minimizer_digest.hpp>
+#include <seq_normalize.hpp>
+#include <query_stats.hpp>
+
+/* seeding policies: whether each new match starts with a lookup in the ftab */
+struct no_seeding {
+    static constexpr bool use_ftab = false;
+};
+
+struct ftab_seeding {
+    static constexpr bool use_ftab = true;
+};
+
+/* stats policies: whether the counters and the read timings are collected (-S) */
+struct no_stats {
+    static constexpr bool enabled = false;
+};
+
+struct with_stats {
+    static constexpr bool enabled = true;
+};
+
+/* alphabet policy: how the reads are converted to the alphabet of the index */
+template <ref_type type>
+struct read_alphabet {
+    static constexpr bool digest_reads = (type == DNA_MINIMIZER || type == MINIMIZER || type == DNA_SYNCMER);
+    static constexpr bool minimizer_alp = (type == MINIMIZER);
+    static constexpr bool syncmer_mode = (type == DNA_SYNCMER);
+    static constexpr size_t ftab_length = minimizer_alp ? FTAB_ENTRY_LENGTH_MIN : FTAB_ENTRY_LENGTH;
+};
+
+/*
+ * The profile storage is the query class, which has to provide (usually
+ * privately, with the engine as a friend) the bwt and F of its r-index,
+ * a stats member, and these two methods:
+ *
+ *   get_profile(ch, pos, use_end): the start or end profile of the pos-th run of ch
+ *   write_listing(out, profile, length, use_end, num_LF_steps): prints the documents
+ *       of a match of that length, where the lcp values of the profile are
+ *       increased by num_LF_steps (capped at MAXLCPVALUE) before the comparison
+ *
+ * and, when used with ftab_seeding, the ftab and check_if_ftab_can_be_used().
+ */
+template <class profile_storage_t, class seeding_t, class alphabet_t, class stats_t>
+class mem_query_engine
+{
+    public:
+        mem_query_engine(profile_storage_t& index, std::ostream& listings_fd):
+                        index(index),
+                        listings_fd(listings_fd) {}
+
+        void run(std::string pattern_file, size_t small_window_l, size_t large_window_l) {
+            /* goes through each read in the file, and prints the listings of its exact matches */
+            gzFile fp; kseq_t* seq;
+            fp = gzopen(pattern_file.data(), "r");
+
+            if(fp == 0) {std::exit(1);}
+            seq = kseq_init(fp);
+
+            // build minimizer digest object (only used if needed)
+            MinimizerDigest digester;
+            digester.set_lexorder(false);
+            digester.set_windows(small_window_l, large_window_l);
+            if (alphabet_t::minimizer_alp) digester.set_minimizer_alp(true);
+            if (alphabet_t::syncmer_mode) digester.set_syncmer_mode(true);
+
+            // process each read, and print out the document lists
+            if constexpr (stats_t::enabled) index.stats.start();
+            while (kseq_read(seq)>=0) {
+                if constexpr (stats_t::enabled) index.stats.start_read();
+                num_reads++;
+
+                // uppercase every letter in read, and digest it if needed (the
+                // digester upper-cases the read while encoding it)
+                std::string input_read;
+                if constexpr (alphabet_t::digest_reads) {
+                    digester.normalize_and_digest(seq->seq.s, seq->seq.l, input_read);
+                } else {
+                    upper_case_seq(seq->seq.s, seq->seq.l);
+                    input_read.assign(seq->seq.s, seq->seq.l);
+                }
+
+                // include read name in output file
+                listings_fd << ">" << seq->name.s << "\n";
+                query_read(input_read);
+                listings_fd << "\n";
+
+                if constexpr (stats_t::enabled) index.stats.end_read(seq->seq.l);
+            }
+            kseq_destroy(seq);
+            gzclose(fp);
+        }
+
+        void report() const {
+            /* prints the overall metrics on querying */
+            FORCE_LOG("query_main",
+                      "processed %ld reads (%ld total chars / %ld exact matches = %.2f avg length)",
+                      num_reads, length_sum, num_matches, (length_sum/(num_matches+0.0)));
+        }
+
+    private:
+        profile_storage_t& index;
+        std::ostream& listings_fd;
+
+        // backward search range, and the position in the read
+        size_t start = 0, end = 0, end_pos_of_match = 0;
+        int i = 0;
+
+        // pointer to the profile used for the current match
+        uint8_t curr_prof_ch = 0;
+        size_t curr_prof_pos = 0, num_LF_steps = 0;
+        bool use_end = false, pointer_set = false;
+
+        // variables for tracking the length of the matches
+        size_t length_sum = 0, num_matches = 0, num_reads = 0;
+
+        void query_read(const std::string& input_read) {
+            /* performs backward search on the read and reports the document listings */
+            int read_length = input_read.size();
+
+            // re-initialize variables to use for backward search
+            start = 0; end = index.bwt.size();
+            end_pos_of_match = read_length-1;
+            curr_prof_ch = 0; curr_prof_pos = 0; num_LF_steps = 0;
+            use_end = false; pointer_set = false;
+            i = (read_length-1);
+
+            // determine if we can use ftab to start out
+            if (i >= 0) seed_from_ftab(input_read);
+
+            while (i >= 0) {
+                // already upper-cased
+                uint8_t next_ch = input_read[i];
+
+                // special case: next_ch does not occur in text
+                if (index.bwt.number_of_letter(next_ch) == 0) {
+                    generate_listing(); // listing for [i+1,end] ...
+                    generate_empty_listing(); // empty listing for [i,i] ...
+
+                    i--;
+                    initialize_to_full_range();
+                    pointer_set = false;
+                    continue;
+                }
+
+                // identify the number of next_ch before start and end
+                size_t num_ch_before_start = index.bwt.rank(start, next_ch);
+                size_t num_ch_before_end = index.bwt.rank(end, next_ch);
+                count(&query_counters_t::rank_lookups, 2);
+
+                // calculate key variables
+                size_t range_length = end - start;
+                size_t num_next_ch_in_range = num_ch_before_end - num_ch_before_start;
+
+                // range is within BWT run, and it is the next character
+                if (range_length == num_next_ch_in_range) {
+                    num_LF_steps++;
+                }
+                // range does not contain the next character
+                else if (num_next_ch_in_range == 0) {
+                    generate_listing();
+                    initialize_to_full_range();
+                    num_ch_before_start = 0;
+                    num_ch_before_end = index.bwt.number_of_letter(next_ch);
+
+                    // the ftab entry already includes its LF steps
+                    if (seed_from_ftab(input_read))
+                        continue;
+                    update_profile_pointer(next_ch, 0);
+                }
+                // range spans a run boundary, and contains the next character
+                else {
+                    size_t start_run = index.bwt.run_of_position(start);
+                    count(&query_counters_t::run_lookups);
+                    update_profile_pointer(next_ch, start_run);
+                }
+
+                // perform an LF step
+                start = num_ch_before_start + index.F[next_ch];
+                end = num_ch_before_end + index.F[next_ch];
+                count(&query_counters_t::lf_steps);
+
+                // move to next character
+                i--;
+            }
+            generate_listing();
+        }
+
+        inline void count(uint64_t query_counters_t::* counter, uint64_t amount = 1) {
+            /* updates one of the counters of the stats, this is compiled out without -S */
+            if constexpr (stats_t::enabled) index.stats.counters.*counter += amount;
+        }
+
+        void generate_listing() {
+            /* outputs the document listing for the current exact match, [i+1, end_pos_of_match] */
+            if (!pointer_set) return;
+            count(&query_counters_t::mems);
+            count(&query_counters_t::profile_fetches);
+
+            listings_fd << "[" << (i+1) << "," << end_pos_of_match << "] ";
+            uint16_t length = std::min((size_t) MAXLCPVALUE, (end_pos_of_match-i));
+            index.write_listing(listings_fd,
+                                index.get_profile(curr_prof_ch, curr_prof_pos, use_end),
+                                length, use_end, num_LF_steps);
+            end_pos_of_match = i;
+
+            length_sum += length;
+            num_matches++;
+        }
+
+        void generate_empty_listing() {
+            /* outputs an empty listing for a character that does not occur in the text */
+            listings_fd << "[" << i << "," << end_pos_of_match << "] {} ";
+            end_pos_of_match = i - 1;
+        }
+
+        void initialize_to_full_range() {
+            /* resets the bwt range to the full range */
+            start = 0; end = index.bwt.size();
+            count(&query_counters_t::range_resets);
+        }
+
+        void update_profile_pointer(uint8_t next_ch, size_t start_run) {
+            /* chooses a new document array profile at a run boundary of next_ch */
+            pointer_set = true;
+
+            // grab any profile at run boundary of next_ch (choose first one)
+            curr_prof_ch = next_ch;
+            curr_prof_pos = index.bwt.run_head_rank(start_run, next_ch);
+            count(&query_counters_t::run_lookups);
+            num_LF_steps = 0;
+
+            // if the start position run is the same as query
+            // ch, then we can guarantee that end of run is in the range
+            // otherwise, we can guarantee the start of run is in range.
+            use_end = (index.bwt[start] == next_ch);
+        }
+
+        bool seed_from_ftab(const std::string& input_read) {
+            /* loads the ftab entry of the k-mer ending at i, returns false if there is none */
+            if constexpr (!seeding_t::use_ftab) {
+                return false;
+            } else {
+                int ftab_pos = index.check_if_ftab_can_be_used(input_read.data(), i, alphabet_t::minimizer_alp);
+                if (ftab_pos < 0) {
+                    count(&query_counters_t::ftab_misses);
+                    return false;
+                }
+                count(&query_counters_t::ftab_hits);
+
+                const std::vector<size_t>& entry = index.ftab[ftab_pos];
+                start = entry[0];
+                end = entry[1];
+                curr_prof_pos = entry[2];
+                num_LF_steps = entry[3];
+                curr_prof_ch = entry[4];
+                use_end = entry[6];
+                i -= alphabet_t::ftab_length;
+
+                pointer_set = true;
+                return true;
+            }
+        }
+};
+
+template <class seeding_t, class profile_storage_t>
+void run_query_engine(profile_storage_t& index,
+                      std::string pattern_file,
+                      std::string listings_path,
+                      ref_type database_type,
+                      size_t small_window_l,
+                      size_t large_window_l) {
+    /* dispatches to the engine for the reference type, and writes the listings to listings_path */
+    STATUS_LOG("query_main", "processing the patterns");
+    auto start_time = std::chrono::system_clock::now();
+
+    std::ofstream listings_fd (listings_path);
+    auto run_engine = [&](auto&& engine) {
+        engine.run(pattern_file, small_window_l, large_window_l);
+        listings_fd.close();
+        DONE_LOG((std::chrono::system_clock::now() - start_time));
+        engine.report();
+    };
+
+    // the stats are a policy as well, so the loop has no stats code unless they are on
+    auto dispatch = [&](auto stats_policy) {
+        using stats_t = decltype(stats_policy);
+        switch (database_type) {
+            case DNA:
+                run_engine(mem_query_engine<profile_storage_t, seeding_t, read_alphabet<DNA>, stats_t>(index, listings_fd)); break;
+            case DNA_MINIMIZER:
+                run_engine(mem_query_engine<profile_storage_t, seeding_t, read_alphabet<DNA_MINIMIZER>, stats_t>(index, listings_fd)); break;
+            case MINIMIZER:
+                run_engine(mem_query_engine<profile_storage_t, seeding_t, read_alphabet<MINIMIZER>, stats_t>(index, listings_fd)); break;
+            case DNA_SYNCMER:
+                run_engine(mem_query_engine<profile_storage_t, seeding_t, read_alphabet<DNA_SYNCMER>, stats_t>(index, listings_fd)); break;
+            default:
+                FATAL_ERROR("unknown reference type for the query engine.");
+        }
+    };
+    if (index.stats.enabled)
+        dispatch(with_stats());
+    else
+        dispatch(no_stats());
+}
+
+#endif /* end of include guard: _QUERY_ENGINE_H */
@@ -0,0 +1,195 @@
+/*
+ * File: query_stats.hpp
+ * Description: Definition of the query_stats class, which collects the
+ *              counters of the query loops (reads, bases, LF steps, rank
+ *              and run lookups, range resets, profile fetches, ftab hits,
+ *              overflow reads and MEMs) along with a latency histogram of
+ *              the reads and the throughput over time. Nothing is
+ *              collected unless the stats are enabled (-S), the query
+ *              engine is compiled without the updates in that case.
+ * Date: October 19th, 2026
+ */
+
+#ifndef _QUERY_STATS_H
+#define _QUERY_STATS_H
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+#include <pfp_doc.hpp>
+
+/* latency histogram: one group of buckets per power of 2 (in ns), each split into sub-buckets */
+#define LATENCY_SUB_BUCKET_BITS 4
+#define LATENCY_SUB_BUCKETS (1ULL << LATENCY_SUB_BUCKET_BITS)
+#define LATENCY_NUM_BUCKETS (64 * LATENCY_SUB_BUCKETS)
+
+typedef struct
+{
+    uint64_t reads = 0;
+    uint64_t bases = 0;
+    uint64_t lf_steps = 0;
+    uint64_t rank_lookups = 0;
+    uint64_t run_lookups = 0;
+    uint64_t range_resets = 0;
+    uint64_t profile_fetches = 0;
+    uint64_t ftab_hits = 0;
+    uint64_t ftab_misses = 0;
+    uint64_t overflow_reads = 0;
+    uint64_t mems = 0;
+} query_counters_t;
+
+typedef struct
+{
+    double elapsed_sec = 0.0;
+    uint64_t reads = 0;
+    uint64_t bases = 0;
+    double reads_per_sec = 0.0;
+    double bases_per_sec = 0.0;
+} throughput_sample_t;
+
+class query_stats {
+    public:
+        query_counters_t counters;
+        bool enabled = false;
+
+        void enable(size_t interval_sec) {
+            /* turns on the timing of reads, and the report every interval_sec seconds (0 for none) */
+            enabled = true;
+            report_interval = interval_sec;
+            latency_buckets.assign(LATENCY_NUM_BUCKETS, 0);
+        }
+
+        void start() {
+            /* called once the index is loaded, right before the first read */
+            counters = query_counters_t();
+            query_start = last_report = std::chrono::steady_clock::now();
+            last_sample = throughput_sample_t();
+        }
+
+        inline void start_read() {
+            if (enabled) read_start = std::chrono::steady_clock::now();
+        }
+
+        inline void end_read(uint64_t read_length) {
+            /* counts the read, and records its latency if the stats are on */
+            counters.reads++;
+            counters.bases += read_length;
+            if (!enabled) return;
+
+            auto now = std::chrono::steady_clock::now();
+            uint64_t latency = std::chrono::duration_cast<std::chrono::nanoseconds>(now - read_start).count();
+            latency_buckets[bucket_of(latency)]++;
+            max_latency = std::max(max_latency, latency);
+            total_latency += latency;
+
+            if (report_interval > 0 && now - last_report >= std::chrono::seconds(report_interval)) {
+                last_report = now;
+                take_sample(now);
+                FORCE_LOG("query_stats", "%s", sample_json(timeline.back()).data());
+            }
+        }
+
+        void write(std::string path) {
+            /* writes the counters, latency percentiles and throughput as JSON */
+            auto now = std::chrono::steady_clock::now();
+            double elapsed = std::chrono::duration<double>(now - query_start).count();
+
+            std::ostringstream json;
+            json << "{\n  \"counters\": {"
+                 << "\"reads\": " << counters.reads << ", \"bases\": " << counters.bases
+                 << ", \"lf_steps\": " << counters.lf_steps << ", \"rank_lookups\": " << counters.rank_lookups
+                 << ", \"run_lookups\": " << counters.run_lookups << ", \"range_resets\": " << counters.range_resets
+                 << ", \"profile_fetches\": " << counters.profile_fetches << ", \"ftab_hits\": " << counters.ftab_hits
+                 << ", \"ftab_misses\": " << counters.ftab_misses << ", \"overflow_reads\": " << counters.overflow_reads
+                 << ", \"mems\": " << counters.mems << "},\n";
+
+            uint64_t num_timed = std::max(counters.reads, (uint64_t) 1);
+            json << "  \"latency_us\": {"
+                 << "\"mean\": " << total_latency / 1000.0 / num_timed
+                 << ", \"p50\": " << percentile(0.50) / 1000.0 << ", \"p90\": " << percentile(0.90) / 1000.0
+                 << ", \"p99\": " << percentile(0.99) / 1000.0 << ", \"max\": " << max_latency / 1000.0 << "},\n";
+
+            json << "  \"elapsed_sec\": " << elapsed
+                 << ",\n  \"reads_per_sec\": " << counters.reads / std::max(elapsed, 1e-9)
+                 << ",\n  \"bases_per_sec\": " << counters.bases / std::max(elapsed, 1e-9) << ",\n";
+
+            json << "  \"throughput\": [";
+            for (size_t i = 0; i < timeline.size(); i++)
+                json << ((i > 0) ? ",\n    " : "\n    ") << sample_json(timeline[i]);
+            json << ((timeline.size() > 0) ? "\n  ]\n}\n" : "]\n}\n");
+
+            std::ofstream stats_fd(path.data());
+            stats_fd << json.str();
+            stats_fd.close();
+            if (stats_fd.fail())
+                FATAL_ERROR("issue occurred while writing the query stats: %s", path.data());
+        }
+
+    private:
+        size_t report_interval = 0;
+        std::chrono::steady_clock::time_point query_start;
+        std::chrono::steady_clock::time_point last_report;
+        std::chrono::steady_clock::time_point read_start;
+
+        std::vector<uint64_t> latency_buckets;
+        uint64_t max_latency = 0;
+        uint64_t total_latency = 0;
+
+        std::vector<throughput_sample_t> timeline;
+        throughput_sample_t last_sample;
+
+        static inline size_t bucket_of(uint64_t latency) {
+            /* the bucket is the position of the highest bit, plus the next bits as the sub-bucket */
+            if (latency < LATENCY_SUB_BUCKETS) return latency;
+            size_t top_bit = 63 - __builtin_clzll(latency);
+            size_t shift = top_bit - LATENCY_SUB_BUCKET_BITS;
+            return ((shift + 1) << LATENCY_SUB_BUCKET_BITS) + ((latency >> shift) & (LATENCY_SUB_BUCKETS - 1));
+        }
+
+        static inline uint64_t bucket_value(size_t bucket) {
+            /* the smallest latency that falls into the bucket */
+            if (bucket < LATENCY_SUB_BUCKETS) return bucket;
+            size_t shift = (bucket >> LATENCY_SUB_BUCKET_BITS) - 1;
+            return (LATENCY_SUB_BUCKETS + (bucket & (LATENCY_SUB_BUCKETS - 1))) << shift;
+        }
+
+        uint64_t percentile(double fraction) const {
+            if (latency_buckets.empty() || counters.reads == 0) return 0;
+            uint64_t target = std::max((uint64_t) 1, (uint64_t) std::ceil(fraction * counters.reads));
+            uint64_t seen = 0;
+            for (size_t i = 0; i < latency_buckets.size(); i++) {
+                seen += latency_buckets[i];
+                if (seen >= target) return std::min(bucket_value(i), max_latency);
+            }
+            return max_latency;
+        }
+
+        void take_sample(std::chrono::steady_clock::time_point now) {
+            /* throughput since the previous sample */
+            throughput_sample_t sample;
+            sample.elapsed_sec = std::chrono::duration<double>(now - query_start).count();
+            sample.reads = counters.reads;
+            sample.bases = counters.bases;
+
+            double span = std::max(sample.elapsed_sec - last_sample.elapsed_sec, 1e-9);
+            sample.reads_per_sec = (sample.reads - last_sample.reads) / span;
+            sample.bases_per_sec = (sample.bases - last_sample.bases) / span;
+            timeline.push_back(sample);
+            last_sample = sample;
+        }
+
+        static std::string sample_json(const throughput_sample_t& sample) {
+            std::ostringstream json;
+            json << "{\"elapsed_sec\": " << sample.elapsed_sec << ", \"reads\": " << sample.reads
+                 << ", \"bases\": " << sample.bases << ", \"reads_per_sec\": " << sample.reads_per_sec
+                 << ", \"bases_per_sec\": " << sample.bases_per_sec << "}";
+            return json.str();
+        }
+};
+
+#endif /* end of include guard: _QUERY_STATS_H */
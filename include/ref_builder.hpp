@@ -9,22 +9,37 @@
 #define REF_BUILD_H
 
 #include <string>
+#include <vector>
 #include <sdsl/bit_vectors.hpp>
 #include <pfp_doc.hpp>
 
+class pfp_scanner;
+
 class RefBuilder {
 public:
     std::string input_file = "";
     std::string output_ref = "";
     bool use_revcomp = false;
+    ref_type seq_type = DNA;
 
     sdsl::bit_vector doc_ends;
     sdsl::rank_support_v<1> doc_ends_rank;
     size_t num_docs = 0;
     size_t total_length = 0;
     
+    std::vector<size_t> doc_lengths;
+    
     RefBuilder(std::string input_data, std::string output_prefix, bool use_rcomp,
-               ref_type seq_type=DNA, size_t small_w=4, size_t large_w=11);
+               ref_type seq_type=DNA, size_t small_w=4, size_t large_w=11,
+               pfp_scanner* scanner=nullptr, size_t num_threads=1);
+
+    // restores the document lengths saved by a previous build
+    RefBuilder(std::string doc_lengths_file, ref_type seq_type=DNA);
+
+    void save_doc_lengths(std::string doc_lengths_file);
+
+private:
+    void build_doc_ends();
 
 }; // end of RefBuilder class
 
@@ -0,0 +1,271 @@
+/*
+ * File: seq_normalize.hpp
+ * Description: Vectorized kernels used to normalize sequences before
+ *              they are indexed or queried: upper-casing, in-place reverse
+ *              complement, and a 2-bit packed encoding of the sequence
+ *              with a mask of the non-ACGT positions. There are AVX2 and
+ *              SSSE3 versions of each kernel, and a scalar fallback that
+ *              uses the up_tab/comp_tab tables, all of them give the
+ *              same output.
+ * Date: October 19th, 2026
+ */
+
+#ifndef _SEQ_NORMALIZE_H
+#define _SEQ_NORMALIZE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <pfp_doc.hpp>
+
+#if defined(__AVX2__) || defined(__SSSE3__)
+#include <immintrin.h>
+#endif
+
+#define PACKED_CHARS_PER_WORD 32
+#define MASK_CHARS_PER_WORD 64
+#define PACKED_GET_CODE(packed, i) (((packed)[(i) >> 5] >> (((i) & 31) * 2)) & 0x3)
+#define MASK_GET_BIT(mask, i) (((mask)[(i) >> 6] >> ((i) & 63)) & 0x1)
+
+/* 2-bit encoding of a sequence: A=0, C=1, G=2, T=3 (either case), other characters are
+   set in the invalid mask and have a code of 0 */
+typedef struct {
+    size_t length = 0;
+    std::vector<uint64_t> packed;  // 32 characters per word, char i at bits [2i, 2i+1]
+    std::vector<uint64_t> invalid; // 64 characters per word, bit i set if char i is not ACGT
+} packed_seq_t;
+
+/*********************************************************/
+/*  Scalar kernels: used for tails, and when SIMD is off */
+/*********************************************************/
+
+inline char scalar_upper(char ch) {
+    uint8_t c = static_cast<uint8_t>(ch);
+    return (c < 128) ? up_tab[c] : ch;
+}
+
+inline char scalar_complement(char ch) {
+    uint8_t c = static_cast<uint8_t>(ch);
+    return (c < 128) ? comp_tab[c] : ch;
+}
+
+inline uint8_t scalar_code(char ch) {
+    /* returns the 2-bit code of the character, or UINT8_MAX if it is not ACGT */
+    switch (ch) {
+        case 'A': case 'a': return 0;
+        case 'C': case 'c': return 1;
+        case 'G': case 'g': return 2;
+        case 'T': case 't': return 3;
+        default: return UINT8_MAX;
+    }
+}
+
+/*********************************************************/
+/*  Vector helpers                                       */
+/*********************************************************/
+
+#if defined(__AVX2__)
+#define NORM_VEC_BYTES 32
+typedef __m256i norm_vec_t;
+#define norm_load(p) _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p))
+#define norm_store(p, v) _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v)
+#define norm_set1(x) _mm256_set1_epi8(static_cast<char>(x))
+#define norm_and _mm256_and_si256
+#define norm_or _mm256_or_si256
+#define norm_xor _mm256_xor_si256
+#define norm_andnot _mm256_andnot_si256
+#define norm_cmpeq _mm256_cmpeq_epi8
+#define norm_cmpgt _mm256_cmpgt_epi8
+#define norm_sub _mm256_sub_epi8
+#define norm_shuffle _mm256_shuffle_epi8
+#define norm_blend _mm256_blendv_epi8
+#define norm_movemask(v) static_cast<uint32_t>(_mm256_movemask_epi8(v))
+#define norm_srli16 _mm256_srli_epi16
+#define norm_table(...) _mm256_setr_epi8(__VA_ARGS__, __VA_ARGS__)
+#elif defined(__SSSE3__)
+#define NORM_VEC_BYTES 16
+typedef __m128i norm_vec_t;
+#define norm_load(p) _mm_loadu_si128(reinterpret_cast<const __m128i*>(p))
+#define norm_store(p, v) _mm_storeu_si128(reinterpret_cast<__m128i*>(p), v)
+#define norm_set1(x) _mm_set1_epi8(static_cast<char>(x))
+#define norm_and _mm_and_si128
+#define norm_or _mm_or_si128
+#define norm_xor _mm_xor_si128
+#define norm_andnot _mm_andnot_si128
+#define norm_cmpeq _mm_cmpeq_epi8
+#define norm_cmpgt _mm_cmpgt_epi8
+#define norm_sub _mm_sub_epi8
+#define norm_shuffle _mm_shuffle_epi8
+#define norm_blend(a, b, m) _mm_or_si128(_mm_andnot_si128(m, a), _mm_and_si128(m, b))
+#define norm_movemask(v) static_cast<uint32_t>(_mm_movemask_epi8(v))
+#define norm_srli16 _mm_srli_epi16
+#define norm_table(...) _mm_setr_epi8(__VA_ARGS__)
+#endif
+
+#ifdef NORM_VEC_BYTES
+inline norm_vec_t norm_in_range(norm_vec_t v, char lo, char hi) {
+    /* returns 0xFF for bytes in [lo, hi], signed compares are fine since lo/hi are ASCII */
+    return norm_andnot(norm_cmpgt(norm_set1(lo), v), norm_cmpgt(norm_set1(hi + 1), v));
+}
+
+inline norm_vec_t norm_upper(norm_vec_t v) {
+    /* subtracts 32 from the bytes in [a, z] */
+    norm_vec_t is_lower = norm_in_range(v, 'a', 'z');
+    return norm_sub(v, norm_and(is_lower, norm_set1(0x20)));
+}
+
+inline bool norm_complement(norm_vec_t v, norm_vec_t& out) {
+    /* complements a block of letters following comp_tab, returns false if the block contains
+       a non-letter so the caller can use the scalar path */
+    norm_vec_t case_bit = norm_and(v, norm_set1(0x20));
+    norm_vec_t upper = norm_xor(v, case_bit);
+    if (norm_movemask(norm_in_range(upper, 'A', 'Z')) != (NORM_VEC_BYTES == 32 ? 0xFFFFFFFFu : 0xFFFFu))
+        return false;
+
+    // complements of 0x40-0x4F and 0x50-0x5F, indexed by the low nibble (same as comp_tab)
+    const norm_vec_t tab_4x = norm_table('@', 'T', 'V', 'G', 'H', 'E', 'F', 'C',
+                                         'D', 'I', 'J', 'M', 'L', 'K', 'N', 'O');
+    const norm_vec_t tab_5x = norm_table('P', 'Q', 'Y', 'S', 'A', 'A', 'B', 'W',
+                                         'X', 'R', 'Z', '[', '\\', ']', '^', '_');
+    norm_vec_t nibble = norm_and(upper, norm_set1(0x0F));
+    norm_vec_t is_5x = norm_cmpeq(norm_and(upper, norm_set1(0x10)), norm_set1(0x10));
+    out = norm_or(norm_blend(norm_shuffle(tab_4x, nibble), norm_shuffle(tab_5x, nibble), is_5x), case_bit);
+    return true;
+}
+
+inline norm_vec_t norm_reverse(norm_vec_t v) {
+    /* reverses the order of the bytes in the vector */
+    const norm_vec_t rev = norm_table(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+    #if defined(__AVX2__)
+    return _mm256_permute2x128_si256(norm_shuffle(v, rev), norm_shuffle(v, rev), 0x01);
+    #else
+    return norm_shuffle(v, rev);
+    #endif
+}
+
+inline uint64_t norm_encode(norm_vec_t v, uint64_t& valid_bits) {
+    /* computes the 2-bit codes of the block, packed into an integer, and
+       the bitmask of ACGT positions */
+    norm_vec_t upper = norm_andnot(norm_set1(0x20), v);
+    norm_vec_t valid = norm_or(norm_or(norm_cmpeq(upper, norm_set1('A')), norm_cmpeq(upper, norm_set1('C'))),
+                               norm_or(norm_cmpeq(upper, norm_set1('G')), norm_cmpeq(upper, norm_set1('T'))));
+    valid_bits = norm_movemask(valid);
+
+    // code = ((c >> 1) ^ (c >> 2)) & 3 maps A,C,G,T to 0,1,2,3
+    norm_vec_t codes = norm_and(norm_xor(norm_srli16(v, 1), norm_srli16(v, 2)), norm_set1(0x03));
+    codes = norm_and(codes, valid);
+
+    // combine 4 codes into a byte: bytes -> 16-bit (c0 + 4c1) -> 32-bit (... + 16c2 + 64c3)
+    #if defined(__AVX2__)
+    __m256i pairs = _mm256_maddubs_epi16(codes, _mm256_set1_epi16(0x0401));
+    __m256i quads = _mm256_madd_epi16(pairs, _mm256_set1_epi32(0x00100001));
+    __m256i bytes = _mm256_shuffle_epi8(quads, _mm256_setr_epi8(0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                                                0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1));
+    __m256i packed = _mm256_permutevar8x32_epi32(bytes, _mm256_setr_epi32(0, 4, 1, 1, 1, 1, 1, 1));
+    return static_cast<uint64_t>(_mm_cvtsi128_si64(_mm256_castsi256_si128(packed)));
+    #else
+    __m128i pairs = _mm_maddubs_epi16(codes, _mm_set1_epi16(0x0401));
+    __m128i quads = _mm_madd_epi16(pairs, _mm_set1_epi32(0x00100001));
+    __m128i bytes = _mm_shuffle_epi8(quads, _mm_setr_epi8(0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1));
+    return static_cast<uint64_t>(static_cast<uint32_t>(_mm_cvtsi128_si32(bytes)));
+    #endif
+}
+#endif
+
+/*********************************************************/
+/*  Normalization kernels                                */
+/*********************************************************/
+
+inline void upper_case_seq(char* seq, size_t length) {
+    /* upper-cases the sequence in place, same as applying up_tab to each character */
+    size_t i = 0;
+    #ifdef NORM_VEC_BYTES
+    for (; i + NORM_VEC_BYTES <= length; i += NORM_VEC_BYTES)
+        norm_store(seq + i, norm_upper(norm_load(seq + i)));
+    #endif
+    for (; i < length; i++)
+        seq[i] = scalar_upper(seq[i]);
+}
+
+inline void reverse_complement_seq(char* seq, size_t length) {
+    /* reverse complements the sequence in place, same as the seqtk loop over comp_tab */
+    size_t front = 0, back = length;
+    #ifdef NORM_VEC_BYTES
+    // swap a block from each end, both blocks are read before either is written
+    while (back - front >= 2 * NORM_VEC_BYTES) {
+        norm_vec_t head_comp, tail_comp;
+        norm_vec_t head = norm_load(seq + front);
+        norm_vec_t tail = norm_load(seq + back - NORM_VEC_BYTES);
+        if (!norm_complement(head, head_comp) || !norm_complement(tail, tail_comp))
+            break;
+        norm_store(seq + front, norm_reverse(tail_comp));
+        norm_store(seq + back - NORM_VEC_BYTES, norm_reverse(head_comp));
+        front += NORM_VEC_BYTES; back -= NORM_VEC_BYTES;
+    }
+    #endif
+    for (; front + 1 < back; front++, back--) {
+        char c0 = scalar_complement(seq[front]);
+        seq[front] = scalar_complement(seq[back - 1]);
+        seq[back - 1] = c0;
+    }
+    if (front + 1 == back) // complement the remaining base
+        seq[front] = scalar_complement(seq[front]);
+}
+
+inline void encode_seq(const char* seq, size_t length, packed_seq_t& out) {
+    /* computes the 2-bit encoding and invalid mask of the sequence */
+    out.length = length;
+    out.packed.assign((length + PACKED_CHARS_PER_WORD - 1) / PACKED_CHARS_PER_WORD, 0);
+    out.invalid.assign((length + MASK_CHARS_PER_WORD - 1) / MASK_CHARS_PER_WORD, 0);
+
+    size_t i = 0;
+    #ifdef NORM_VEC_BYTES
+    for (; i + NORM_VEC_BYTES <= length; i += NORM_VEC_BYTES) {
+        uint64_t valid_bits = 0;
+        uint64_t codes = norm_encode(norm_load(seq + i), valid_bits);
+        uint64_t invalid_bits = ~valid_bits & ((NORM_VEC_BYTES == 32) ? 0xFFFFFFFFULL : 0xFFFFULL);
+
+        out.packed[i / PACKED_CHARS_PER_WORD] |= codes << ((i % PACKED_CHARS_PER_WORD) * 2);
+        out.invalid[i / MASK_CHARS_PER_WORD] |= invalid_bits << (i % MASK_CHARS_PER_WORD);
+    }
+    #endif
+    for (; i < length; i++) {
+        uint8_t code = scalar_code(seq[i]);
+        if (code == UINT8_MAX)
+            out.invalid[i / MASK_CHARS_PER_WORD] |= (1ULL << (i % MASK_CHARS_PER_WORD));
+        else
+            out.packed[i / PACKED_CHARS_PER_WORD] |= (static_cast<uint64_t>(code) << ((i % PACKED_CHARS_PER_WORD) * 2));
+    }
+}
+
+inline void normalize_and_encode_seq(char* seq, size_t length, packed_seq_t& out) {
+    /* upper-cases the sequence in place, and encodes it in the same pass */
+    out.length = length;
+    out.packed.assign((length + PACKED_CHARS_PER_WORD - 1) / PACKED_CHARS_PER_WORD, 0);
+    out.invalid.assign((length + MASK_CHARS_PER_WORD - 1) / MASK_CHARS_PER_WORD, 0);
+
+    size_t i = 0;
+    #ifdef NORM_VEC_BYTES
+    for (; i + NORM_VEC_BYTES <= length; i += NORM_VEC_BYTES) {
+        norm_vec_t block = norm_upper(norm_load(seq + i));
+        norm_store(seq + i, block);
+
+        uint64_t valid_bits = 0;
+        uint64_t codes = norm_encode(block, valid_bits);
+        uint64_t invalid_bits = ~valid_bits & ((NORM_VEC_BYTES == 32) ? 0xFFFFFFFFULL : 0xFFFFULL);
+
+        out.packed[i / PACKED_CHARS_PER_WORD] |= codes << ((i % PACKED_CHARS_PER_WORD) * 2);
+        out.invalid[i / MASK_CHARS_PER_WORD] |= invalid_bits << (i % MASK_CHARS_PER_WORD);
+    }
+    #endif
+    for (; i < length; i++) {
+        seq[i] = scalar_upper(seq[i]);
+        uint8_t code = scalar_code(seq[i]);
+        if (code == UINT8_MAX)
+            out.invalid[i / MASK_CHARS_PER_WORD] |= (1ULL << (i % MASK_CHARS_PER_WORD));
+        else
+            out.packed[i / PACKED_CHARS_PER_WORD] |= (static_cast<uint64_t>(code) << ((i % PACKED_CHARS_PER_WORD) * 2));
+    }
+}
+
+#endif /* end of include guard: _SEQ_NORMALIZE_H */
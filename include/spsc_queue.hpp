@@ -0,0 +1,94 @@
+/*
+ * File: spsc_queue.hpp
+ * Description: Definition of a bounded, lock-free single-producer
+ *              single-consumer ring buffer. It is used to pass records
+ *              between the stages of the construction pipeline, where
+ *              each queue has exactly one thread pushing and one popping.
+ * Date: October 19th, 2026
+ */
+
+#ifndef _SPSC_QUEUE_H
+#define _SPSC_QUEUE_H
+
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <cstddef>
+#include <pfp_doc.hpp>
+
+#define SPSC_CACHE_LINE 64
+
+template <typename T>
+class spsc_queue {
+    public:
+        spsc_queue(size_t capacity_pow2 = (1 << 16)) {
+            /* capacity is rounded up to a power of two so indices can be masked */
+            size_t cap = 2;
+            while (cap < capacity_pow2) cap <<= 1;
+            buffer.resize(cap);
+            mask = cap - 1;
+        }
+
+        inline bool try_push(const T& item) {
+            /* producer-only: returns false if the queue is full */
+            size_t tail = tail_pos.load(std::memory_order_relaxed);
+            if (tail - cached_head >= buffer.size()) {
+                cached_head = head_pos.load(std::memory_order_acquire);
+                if (tail - cached_head >= buffer.size())
+                    return false;
+            }
+            buffer[tail & mask] = item;
+            tail_pos.store(tail + 1, std::memory_order_release);
+            return true;
+        }
+
+        inline void push(const T& item) {
+            /* producer-only: waits until there is room in the queue */
+            while (!try_push(item))
+                std::this_thread::yield();
+        }
+
+        inline bool try_pop(T& item) {
+            /* consumer-only: returns false if the queue is currently empty */
+            size_t head = head_pos.load(std::memory_order_relaxed);
+            if (head == cached_tail) {
+                cached_tail = tail_pos.load(std::memory_order_acquire);
+                if (head == cached_tail)
+                    return false;
+            }
+            item = buffer[head & mask];
+            head_pos.store(head + 1, std::memory_order_release);
+            return true;
+        }
+
+        inline bool pop(T& item) {
+            /* consumer-only: waits for an item, returns false once closed and drained */
+            while (!try_pop(item)) {
+                if (closed.load(std::memory_order_acquire)) {
+                    // re-check since an item could have been pushed right before closing
+                    return try_pop(item);
+                }
+                std::this_thread::yield();
+            }
+            return true;
+        }
+
+        void close() {
+            /* producer-only: signals that no more items will be pushed */
+            closed.store(true, std::memory_order_release);
+        }
+
+    private:
+        std::vector<T> buffer;
+        size_t mask = 0;
+        std::atomic<bool> closed {false};
+
+        // the producer and consumer indices are kept on separate cache lines, and
+        // each side keeps a cached copy of the other's index to avoid sharing
+        alignas(SPSC_CACHE_LINE) std::atomic<size_t> head_pos {0};
+        size_t cached_tail = 0;
+        alignas(SPSC_CACHE_LINE) std::atomic<size_t> tail_pos {0};
+        size_t cached_head = 0;
+};
+
+#endif /* end of include guard: _SPSC_QUEUE_H */
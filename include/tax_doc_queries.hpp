@@ -5,6 +5,10 @@
  */
 
 #include <minimizer_digest.hpp>
+#include <seq_normalize.hpp>
+#include <alphabet.hpp>
+#include <query_stats.hpp>
+#include <query_engine.hpp>
 
 #ifndef _TAX_DOC_QUERIES_H
 #define _TAX_DOC_QUERIES_H
@@ -24,6 +28,7 @@ class tax_doc_queries : ri::r_index<sparse_bv_type, rle_string_t>
         bool print_profiles = false;
         std::string output_csv_path = "";
         size_t profiles_to_print = 0;
+        query_stats stats;
 
         std::ofstream csv_sdap_output;
         std::ofstream csv_edap_output;
@@ -36,13 +41,17 @@ class tax_doc_queries : ri::r_index<sparse_bv_type, rle_string_t>
         char* mmap_sdap_of;
         char* mmap_edap_of;
 
-        // This vectors has the following dimensions: [256][num of ith char][num_docs]
-        // This structure stores the DA profiles for each character separately.
+        // This vectors has the following dimensions: [sigma][num of ith char][num_docs]
+        // This structure stores the DA profiles for each character separately, and
+        // is indexed by the rank of the character in alphabet.
         // std::vector<std::vector<std::vector<uint64_t>>> start_doc_profiles;
         // std::vector<std::vector<std::vector<uint64_t>>> end_doc_profiles;
         std::vector<std::vector<std::vector<uint64_t>>> start_doc_profiles2;
         std::vector<std::vector<std::vector<uint64_t>>> end_doc_profiles2;
 
+        // Maps BWT characters to dense ranks for the profile matrices
+        alphabet_map alphabet;
+
         tax_doc_queries(std::string filename): ri::r_index<sparse_bv_type, rle_string_t>() 
         {
             /* special constructor: used for only loading BWT from raw files */
@@ -71,6 +80,31 @@ class tax_doc_queries : ri::r_index<sparse_bv_type, rle_string_t>
             DONE_LOG((std::chrono::system_clock::now() - start));
         }
 
+        tax_doc_queries(std::string filename, std::string run_heads, const std::vector<uint64_t>& run_lengths): 
+                    ri::r_index<sparse_bv_type, rle_string_t>()
+        {
+            /* special constructor: used by lean builds to serialize the BWT runs kept in memory */
+            STATUS_LOG("query_main", "serializing BWT and F to disk");
+            auto start = std::chrono::system_clock::now();
+
+            build_F_from_runs(run_heads, run_lengths);
+            this->bwt = rle_string_t(std::move(run_heads), run_lengths);
+
+            std::string outfile = filename + ".bwt.cliffy";
+            std::ofstream out_bwt(outfile);
+
+            serialize_bwt(out_bwt);
+            out_bwt.close();
+
+            outfile = filename + ".F.cliffy";
+            std::ofstream out_F(outfile, std::ios::binary);
+
+            serialize_F(out_F);
+            out_F.close();
+
+            DONE_LOG((std::chrono::system_clock::now() - start));
+        }
+
         tax_doc_queries(std::string filename,
                         size_t num_cols,
                         size_t num_profiles = 0,
@@ -84,8 +118,8 @@ class tax_doc_queries : ri::r_index<sparse_bv_type, rle_string_t>
                         ri::r_index<sparse_bv_type, rle_string_t>(),
                         // start_doc_profiles(256, std::vector<std::vector<uint64_t>>(0, std::vector<uint64_t>(0))),
                         // end_doc_profiles(256, std::vector<std::vector<uint64_t>>(0, std::vector<uint64_t>(0))),
-                        start_doc_profiles2(256, std::vector<std::vector<uint64_t>>(0, std::vector<uint64_t>(0))),
-                        end_doc_profiles2(256, std::vector<std::vector<uint64_t>>(0, std::vector<uint64_t>(0)))
+                        start_doc_profiles2(0, std::vector<std::vector<uint64_t>>(0, std::vector<uint64_t>(0))),
+                        end_doc_profiles2(0, std::vector<std::vector<uint64_t>>(0, std::vector<uint64_t>(0)))
         {
             /* main constructor: used during the query phase and ftab generation */
             
@@ -150,6 +184,9 @@ class tax_doc_queries : ri::r_index<sparse_bv_type, rle_string_t>
             if (verbose) {STATUS_LOG("build_profiles", "loading document array profiles");}
             start = std::chrono::system_clock::now();
 
+            // the profile matrices are indexed by the dense rank of each BWT character
+            alphabet = alphabet_map::from_runcnt_file(filename + ".runcnt");
+
             read_doc_profiles_main_table_new_way(start_doc_profiles2, filename + ".taxcomp.sdap", filename + ".taxcomp.ofptr.sdap", filename + ".runcnt");
             read_doc_profiles_main_table_new_way(end_doc_profiles2, filename + ".taxcomp.edap", filename + ".taxcomp.ofptr.edap", filename + ".runcnt");
 
@@ -190,484 +227,8 @@ class tax_doc_queries : ri::r_index<sparse_bv_type, rle_string_t>
                             size_t small_window_l,
                             size_t large_window_l){
             /* Go through and query the reads and print the leftmost, rightmost occurrence of string */
-
-            STATUS_LOG("query_main", "processing the patterns");
-            auto start_time = std::chrono::system_clock::now();
-
-            // open output/input files
-            std::ofstream listings_fd (output_prefix + ".listings");
-            gzFile fp; kseq_t* seq;
-
-            fp = gzopen(pattern_file.data(), "r"); 
-            if(fp == 0) {std::exit(1);}
-            seq = kseq_init(fp);
-
-            // variable used keep track of position in lamdbas
-            size_t idx = 0;
-
-            // alternate lambda to print out the document listing, that
-            // will be tested to see if it improves classification
-            auto process_profile_with_subtree = [&](std::vector<uint64_t> profile, uint16_t length, bool use_end) {
-                    bool left_done = false, right_done = false;
-                    std::vector<uint64_t> left_docs;
-                    std::vector<uint64_t> right_docs;
-                    size_t tuple_num = 0;
-
-                    // std::cout << "length: " << length << std::endl;
-                    // std::cout << "profile: ";
-                    // for (auto x: profile)
-                    //     std::cout << x << " ";
-                    // std::cout << "\n";
-
-                    // Iterates through the main table ...
-                    while ((!left_done || !right_done) && (tuple_num < (this->num_cols * 4))) {   
-
-                        // Checks if the LCP value has reached the max, and
-                        // the monotonic increases have ended
-                        if (profile[tuple_num] == MAXLCPVALUE)
-                            left_done = true;
-                        if (profile[tuple_num+2] == MAXLCPVALUE)
-                            right_done = true;
-
-                        // Check if increases in either direction are still going, and 
-                        // lcp is greater than query length
-                        if (!left_done && profile[tuple_num+1] >= length) {
-                            left_docs.push_back(profile[tuple_num]);
-                        }
-                        if (!right_done && profile[tuple_num+3] >= length) {
-                            right_docs.push_back(profile[tuple_num+2]);
-                        }
-                        tuple_num += 4;
-                    }
-
-                    // Double-check that if we haven't found the leftmost or rightmost
-                    // document that there are still some documents to look at in overflow file
-                    if ((left_docs.size() == 0 && left_done) || (right_docs.size() == 0 && right_done))
-                        FATAL_ERROR("Issue occurred when querying the taxonomic document array.");
-
-                    // Grab the overflow pointer based on which type of profiles was used
-                    char* of_ptr = nullptr;
-                    if (use_end)
-                        of_ptr = mmap_edap_of;
-                    else
-                        of_ptr = mmap_sdap_of;
-                    size_t of_pos = profile[this->num_cols * 4];
-
-                    // Make sure that both directions are done based on overflow ptr
-                    if (of_pos == 0) {
-                        left_done = true;
-                        right_done = true;
-                        assert((left_done && right_done));
-                    }
-                    // std::cout << leftmost_found << " " << rightmost_found << std::endl;
-                    // std::cout << of_pos << std::endl;
-                    
-                    // Use overflow file for left to right direction ...
-                    if (!left_done) {
-                        // std::cout << "left is not done!" << std::endl;
-                        assert(of_pos != 0);
-
-                        size_t num_left_pairs = READ_NUM_PAIRS(of_ptr, of_pos);
-                        assert(num_left_pairs < 256);
-                        of_pos += 1;
-                        // std::cout << "num_pairs_left = " << num_left_pairs << "\n";
-
-                        // Go through all the L2R pairs
-                        for (size_t i = 0; i < num_left_pairs; i++){
-                            size_t doc_id = READ_DOC_ID_OR_LCP_VAL(of_ptr, of_pos); of_pos += 2;
-                            size_t lcp_val = READ_DOC_ID_OR_LCP_VAL(of_ptr, of_pos); of_pos += 2;
-                            // std::cout << "doc = " << doc_id << ", lcp = " << lcp_val << std::endl;
-
-                            if (lcp_val >= length) {
-                                left_docs.push_back(doc_id);
-                                //leftmost_doc = doc_id;
-                                //leftmost_found = true;
-                                //break;
-                            }
-                        }
-                    }
-                    // Use overflow file for right to left direction ...
-                    if (!right_done) {
-                        // std::cout << "right is not done!" << std::endl;
-                        of_pos = profile[this->num_cols * 4];
-                        assert(of_pos != 0);
-
-                        // Move past the left pairs to right pairs
-                        size_t num_left_pairs = READ_NUM_PAIRS(of_ptr, of_pos);
-                        assert(num_left_pairs < 256);
-                        of_pos += 1 + (DOCWIDTH * 2 * num_left_pairs);
-
-                        size_t num_right_pairs = READ_NUM_PAIRS(of_ptr, of_pos);
-                        assert(num_right_pairs < 256);
-                        of_pos += 1;
-                        // std::cout << "num_pairs_right = " << num_right_pairs << "\n";
-
-                        // Go through all the R2L pairs
-                        for (size_t i = 0; i < num_right_pairs; i++){
-                            size_t doc_id = READ_DOC_ID_OR_LCP_VAL(of_ptr, of_pos); of_pos += 2;
-                            size_t lcp_val = READ_DOC_ID_OR_LCP_VAL(of_ptr, of_pos); of_pos += 2;
-                            // std::cout << "doc = " << doc_id << ", lcp = " << lcp_val << std::endl;
-                            
-                            if (lcp_val >= length) {
-                                right_docs.push_back(doc_id);
-                                //rightmost_doc = doc_id;
-                                //rightmost_found = true;
-                                //break;
-                            }
-                        }
-                    }
-                    // Make sure we have found both documents in 
-                    // both directions, and they end with same doc
-                    assert((left_docs.size() && right_docs.size()));
-                    assert ((left_docs.back() == right_docs.back()));
-
-                    // Remove the last document from one of the vectors
-                    left_docs.pop_back();
-
-                    // std::cout << "left docs: ";
-                    // for (auto x: left_docs)
-                    //     std::cout << x << " ";
-                    // std::cout << "\n";
-                    // std::cout << "right docs: ";
-                    // for (auto x: right_docs)
-                    //     std::cout << x << " ";
-                    // std::cout << "\n";
-
-                    // Output the leftmost/rightmost nodes along with
-                    // nodes underneath with hit
-                    std::string output_str = "{";
-                    for (auto x: left_docs)
-                        output_str += std::to_string(x) + ",";
-                    for (int i = right_docs.size()-1; i >= 0; i--)
-                        output_str += std::to_string(right_docs[i]) + ",";
-
-                    // Remove comma and close bracket
-                    output_str.pop_back();
-                    output_str += "} ";
-                    listings_fd << output_str;
-            };
-
-            // lambda to print out the document listing
-            auto process_profile = [&](std::vector<uint64_t> profile, uint16_t length, bool use_end) {
-                    bool leftmost_found = false, rightmost_found = false;
-                    bool left_done = false, right_done = false;
-
-                    size_t leftmost_doc = 0, rightmost_doc = 0;
-                    size_t tuple_num = 0;
-
-                    // std::cout << "\nlength = " << length << std::endl;
-                    // std::cout << "\nprofile: ";
-                    // for (auto x: profile)
-                    //     std::cout << x << " ";
-                    // std::cout << "\n";
-
-                    // Iterates through the main table ...
-                    while ((!leftmost_found || !rightmost_found) && (tuple_num < (this->num_cols * 4))) {
-                        // Check if the increases in each direction is done or not
-                        if (profile[tuple_num] == MAXLCPVALUE)
-                            left_done = true;
-                        if (profile[tuple_num+2] == MAXLCPVALUE)
-                            right_done = true;
-                        
-                        // Check if increases in each direction is not done, and we haven't
-                        // found an matching document, and then compare lengths
-                        if (!left_done && !leftmost_found && profile[tuple_num+1] >= length) {
-                            leftmost_doc = profile[tuple_num];
-                            leftmost_found = true;
-                        }
-                        if (!right_done && !rightmost_found && profile[tuple_num+3] >= length) {
-                            rightmost_doc = profile[tuple_num+2];
-                            rightmost_found = true;
-                        }
-                        tuple_num += 4;
-                    }
-
-                    // Double-check that if we haven't found the leftmost or rightmost
-                    // document that there are still some documents to look at in overflow file
-                    if ((!leftmost_found && left_done) || (!rightmost_found && right_done))
-                        FATAL_ERROR("Issue occurred when querying the taxonomic document array.");
-                    
-                    // Grab the overflow pointer based on which type of profiles was used
-                    char* of_ptr = nullptr;
-                    if (use_end)
-                        of_ptr = mmap_edap_of;
-                    else
-                        of_ptr = mmap_sdap_of;
-                    size_t of_pos = profile[this->num_cols * 4];
-
-                    // std::cout << leftmost_found << " " << rightmost_found << std::endl;
-                    // std::cout << of_pos << std::endl;
-                    
-                    // Use overflow file for left to right direction ...
-                    if (!leftmost_found && !left_done) {
-                        assert(of_pos != 0);
-
-                        size_t num_left_pairs = READ_NUM_PAIRS(of_ptr, of_pos);
-                        assert(num_left_pairs < 256);
-                        of_pos += 1;
-                        // std::cout << "num_pairs_left = " << num_left_pairs << "\n";
-
-                        // Go through all the L2R pairs
-                        for (size_t i = 0; i < num_left_pairs; i++){
-                            size_t doc_id = READ_DOC_ID_OR_LCP_VAL(of_ptr, of_pos); of_pos += 2;
-                            size_t lcp_val = READ_DOC_ID_OR_LCP_VAL(of_ptr, of_pos); of_pos += 2;
-                            // std::cout << "doc = " << doc_id << ", lcp = " << lcp_val << std::endl;
-
-                            if (lcp_val >= length) {
-                                leftmost_doc = doc_id;
-                                leftmost_found = true;
-                                break;
-                            }
-                        }
-                    }
-                    // Use overflow file for right to left direction ...
-                    if (!rightmost_found && !right_done) {
-                        of_pos = profile[this->num_cols * 4];
-                        assert(of_pos != 0);
-
-                        // Move past the left pairs to right pairs
-                        size_t num_left_pairs = READ_NUM_PAIRS(of_ptr, of_pos);
-                        assert(num_left_pairs < 256);
-                        of_pos += 1 + (DOCWIDTH * 2 * num_left_pairs);
-
-                        size_t num_right_pairs = READ_NUM_PAIRS(of_ptr, of_pos);
-                        assert(num_right_pairs < 256);
-                        of_pos += 1;
-                        // std::cout << "num_pairs_right = " << num_right_pairs << "\n";
-
-                        // Go through all the R2L pairs
-                        for (size_t i = 0; i < num_right_pairs; i++){
-                            size_t doc_id = READ_DOC_ID_OR_LCP_VAL(of_ptr, of_pos); of_pos += 2;
-                            size_t lcp_val = READ_DOC_ID_OR_LCP_VAL(of_ptr, of_pos); of_pos += 2;
-                            // std::cout << "doc = " << doc_id << ", lcp = " << lcp_val << std::endl;
-                            
-                            if (lcp_val >= length) {
-                                rightmost_doc = doc_id;
-                                rightmost_found = true;
-                                break;
-                            }
-                        }
-                    }
-                    // Make sure we have found both directions
-                    assert((rightmost_found && leftmost_found));
-
-                    // Output the leftmost/rightmost nodes
-                    std::string output_str = "";
-                    output_str += "{" + std::to_string(leftmost_doc) + 
-                                  "," + std::to_string(rightmost_doc) + "} ";
-                    listings_fd << output_str;
-
-                    // std::cout << output_str << "\n";
-                    // std::exit(1);
-            };
-
-            // build minimizer digest object (only used if needed)
-            MinimizerDigest digester; 
-            digester.set_lexorder(false);
-            digester.set_windows(small_window_l, large_window_l);
-            if (database_type == MINIMIZER) digester.set_minimizer_alp(true);
-
-            // process each read, and print out the document lists
-            while (kseq_read(seq)>=0) {
-
-                // uppercase every letter in read
-                for (int j = 0; j < seq->seq.l; j++) {seq->seq.s[j] = up_tab[(int) seq->seq.s[j]];}
-
-                // digest read if needed
-                std::string input_read = seq->seq.s;
-                size_t read_length = 0;
-
-                if (database_type == DNA_MINIMIZER) {input_read = digester.compute_digest(input_read);}
-                else if (database_type == MINIMIZER) {input_read = digester.compute_digest(input_read);}
-                read_length = input_read.size();
-
-                listings_fd << ">" << seq->name.s << "\n";
-
-                // initialize variables to use for backward search
-                size_t start = 0, end = this->bwt.size(), end_pos_of_match = read_length-1;
-                size_t start_run = 0, end_run = this->r - 1;
-                size_t num_ch_before_start = 0, num_ch_before_end = 0;
-                std::vector<uint64_t> curr_profile (this->num_cols * 4, 0);
-                uint16_t length = 0;
-
-                // pointer variables to current profile being "used"
-                uint8_t curr_prof_ch = 0;
-                size_t curr_prof_pos = 0, num_LF_steps = 0;
-
-                // tell us what type of profile to grab based on pointer variables
-                bool use_start = false, use_end = false;
-                bool pointer_set = false;
-
-                // perform backward search and report document listings when
-                // range goes empty or we reach the end
-                for (int i = (read_length-1); i >= 0; i--) {
-                    
-                    // extract the next char
-                    uint8_t next_ch = input_read[i];
-
-                    // special case: character is not present in text
-                    if (this->bwt.number_of_letter(next_ch) == 0) {
-                        // step 1: print listing for [i+1,end]
-                        if (pointer_set) {
-                            if (use_end)
-                                curr_profile = end_doc_profiles2[curr_prof_ch][curr_prof_pos];
-                            else
-                                curr_profile = start_doc_profiles2[curr_prof_ch][curr_prof_pos];
-
-                            idx = 0;
-                            std::for_each(curr_profile.begin(), 
-                                            curr_profile.end(), 
-                                            [&](uint64_t &x){
-                                            if (idx % 2 == 1) 
-                                            {x = std::min((size_t) MAXLCPVALUE, x+num_LF_steps);} 
-                                            idx++;});
-
-                            listings_fd << "[" << (i+1) << "," << end_pos_of_match << "] ";
-
-                            length = std::min((size_t) MAXLCPVALUE, (end_pos_of_match-i));
-                            process_profile_with_subtree(curr_profile, length, use_end);
-                            end_pos_of_match = i;
-                        }
-                        // step 2: print an empty listing for current character
-                        listings_fd << "[" << i << "," << i << "] {} ";
-                        end_pos_of_match = i - 1;
-
-                        // step 3: reset variables to full bwt range
-                        start = 0; end = this->bwt.size();
-                        start_run = 0; end_run = this->r - 1;
-                        num_ch_before_start = 0;
-                        num_ch_before_end = 0;
-
-                        // step 4: reset pointer and go back to top of loop
-                        pointer_set = false;
-                        continue;
-                    }
-
-                    // identify the run # that start and end are in
-                    num_ch_before_start = this->bwt.rank(start, next_ch); 
-                    num_ch_before_end = this->bwt.rank(end, next_ch);
-                    start_run = this->bwt.run_of_position(start);
-                    end_run = this->bwt.run_of_position(end-1);
-                    
-                    // range spans runs, so there are different BWT characters
-                    if (start_run != end_run) 
-                    {       
-                        // bwt range is empty, so will reset start and end
-                        if (num_ch_before_end == num_ch_before_start) {
-
-                            // grab the correct current profile, and update with steps
-                            if (use_end)
-                                curr_profile = end_doc_profiles2[curr_prof_ch][curr_prof_pos];
-                            else
-                                curr_profile = start_doc_profiles2[curr_prof_ch][curr_prof_pos];
-
-                            idx = 0;
-                            std::for_each(curr_profile.begin(), 
-                                          curr_profile.end(), 
-                                          [&](uint64_t &x){
-                                          if (idx % 2 == 1) 
-                                          {x = std::min((size_t) MAXLCPVALUE, x+num_LF_steps);} 
-                                          idx++;});
-                            listings_fd << "[" << (i+1) << "," << end_pos_of_match << "] ";
-
-                            length = std::min((size_t) MAXLCPVALUE, (end_pos_of_match-i));
-                            process_profile_with_subtree(curr_profile, length, use_end);
-                            end_pos_of_match = i;
-
-                            start = 0; end = this->bwt.size();
-                            start_run = 0; end_run = this->r - 1;
-                            num_ch_before_start = 0;
-                            num_ch_before_end = this->bwt.number_of_letter(next_ch);
-                        }
-
-                        // grab any profile at run boundary of next_ch (choose first one)
-                        curr_prof_ch = next_ch;
-                        curr_prof_pos = this->bwt.run_head_rank(start_run, next_ch);
-                        num_LF_steps = 0;
-                        use_start = false; use_end = false;
-                        pointer_set = true;
-
-                        // if the start position run is the same as query
-                        // ch, then we can guarantee that end of run is in the range
-                        // otherwise, we can guarantee the start of run is in range.
-                        if (this->bwt[start] == next_ch)
-                            use_end = true;
-                        else
-                            use_start = true;
-                    } 
-                    // range is within BWT run, but wrong character 
-                    else if (this->bwt[start] != next_ch) 
-                    {
-                        // grab the correct current profile, and update with steps
-                        if (use_end)
-                            curr_profile = end_doc_profiles2[curr_prof_ch][curr_prof_pos];
-                        else
-                            curr_profile = start_doc_profiles2[curr_prof_ch][curr_prof_pos];
-
-                        idx = 0;
-                        std::for_each(curr_profile.begin(), 
-                                        curr_profile.end(), 
-                                        [&](uint64_t &x){
-                                        if (idx % 2 == 1) 
-                                        {x = std::min((size_t) MAXLCPVALUE, x+num_LF_steps);} 
-                                        idx++;});
-                        listings_fd << "[" << (i+1) << "," << end_pos_of_match << "] ";
-
-                        length = std::min((size_t) MAXLCPVALUE, (end_pos_of_match-i));
-                        process_profile_with_subtree(curr_profile, length, use_end);
-                        end_pos_of_match = i;
-
-                        start = 0; end = this->bwt.size();
-                        start_run = 0; end_run = this->r - 1;
-                        num_ch_before_start = 0;
-                        num_ch_before_end = this->bwt.number_of_letter(next_ch);
-                        pointer_set = true;
-
-                        // grab any profile at run boundary of next_ch (choose first one)
-                        curr_prof_ch = next_ch;
-                        curr_prof_pos = this->bwt.run_head_rank(start_run, next_ch);
-                        num_LF_steps = 0;
-                        use_start = false; use_end = false;
-
-                        // if the start position run is the same as query
-                        // ch, then we can guarantee that end of run is in the range
-                        // otherwise, we can guarantee the start of run is in range.
-                        if (this->bwt[start] == next_ch)
-                            use_end = true;
-                        else
-                            use_start = true;
-                    }
-                    // range is within BWT run, and is the correct character
-                    else 
-                    {
-                        num_LF_steps++;
-                    }
-
-                    // Perform an LF step
-                    start = num_ch_before_start + this->F[next_ch]; 
-                    end = num_ch_before_end + this->F[next_ch];
-                }
-                // grab the current profile, and update with steps
-                if (use_end)
-                    curr_profile = end_doc_profiles2[curr_prof_ch][curr_prof_pos];
-                else
-                    curr_profile = start_doc_profiles2[curr_prof_ch][curr_prof_pos];
-
-                // Update profile based on LF steps
-                idx = 0;
-                std::for_each(curr_profile.begin(), 
-                              curr_profile.end(), 
-                              [&](uint64_t &x){
-                              if (idx % 2 == 1) 
-                              {x = std::min((size_t) MAXLCPVALUE, x+num_LF_steps);} 
-                              idx++;});
-
-                listings_fd << "[" << 0 << "," << end_pos_of_match << "] ";
-                length = std::min((size_t) MAXLCPVALUE, end_pos_of_match+1);
-                process_profile_with_subtree(curr_profile, length, use_end);
-                listings_fd << "\n";
-            }
-            DONE_LOG((std::chrono::system_clock::now() - start_time));
+            run_query_engine<no_seeding>(*this, pattern_file, output_prefix + ".listings", 
+                                         database_type, small_window_l, large_window_l);
         }
 
         void query_profiles_optimized(std::string pattern_file, 
@@ -675,364 +236,9 @@ class tax_doc_queries : ri::r_index<sparse_bv_type, rle_string_t>
                                       ref_type database_type,
                                       size_t small_window_l,
                                       size_t large_window_l) {
-            /* query reads using the optimized algorithm to accelerate queries */
-
-            STATUS_LOG("query_main", "processing the patterns");
-            auto start_time = std::chrono::system_clock::now();
-
-            // open output/input files
-            std::ofstream listings_fd (output_prefix + ".listings");
-            gzFile fp; kseq_t* seq;
-            fp = gzopen(pattern_file.data(), "r"); 
-
-            if(fp == 0) {std::exit(1);}
-            seq = kseq_init(fp);
-
-            // initialize variables for backward search
-            size_t start = 0, end = this->bwt.size(), end_pos_of_match = 0;
-            size_t start_run = 0, end_run = 0;
-            size_t num_ch_before_start = 0, num_ch_before_end = 0;
-
-            std::vector<uint64_t> curr_profile (this->num_cols * 4, 0);
-            uint16_t length = 0; uint8_t next_ch = 0;
-            int i = 0; size_t read_length = 0;
-            bool pointer_set = false;
-
-            // variable used keep track of position in lamdbas
-            size_t idx = 0;
-
-            // initialize variables for identifying correct document array profile
-            uint8_t curr_prof_ch = 0;
-            size_t curr_prof_pos = 0, num_LF_steps = 0;
-
-            // initialize variables for which profile to use
-            bool use_start = false, use_end = false;
-        
-            // alternate lambda to print out the document listing, that
-            // will be tested to see if it improves classification
-            auto process_profile_with_subtree = [&](std::vector<uint64_t> profile, uint16_t length, bool use_end, size_t num_LF_steps) {
-                    bool left_done = false, right_done = false;
-                    std::vector<uint64_t> left_docs;
-                    std::vector<uint64_t> right_docs;
-                    size_t tuple_num = 0;
-
-                    // debug code:
-                    // std::cout << "length: " << length << std::endl;
-                    // std::cout << "profile: ";
-                    // for (auto x: profile)
-                    //     std::cout << x << " ";
-                    // std::cout << "\n";
-
-                    // iterates through the main table pairs ...
-                    while ((!left_done || !right_done) && (tuple_num < (this->num_cols * 4))) {   
-
-                        // base case: checks if the LCP value has reached the max, and
-                        // the monotonic increases have ended
-                        if (profile[tuple_num] == MAXLCPVALUE)
-                            left_done = true;
-                        if (profile[tuple_num+2] == MAXLCPVALUE)
-                            right_done = true;
-
-                        // query step: check if increases in either direction are still going, and 
-                        // lcp is greater than query length
-                        if (!left_done && profile[tuple_num+1] >= length) {
-                            left_docs.push_back(profile[tuple_num]);
-                        }
-                        if (!right_done && profile[tuple_num+3] >= length) {
-                            right_docs.push_back(profile[tuple_num+2]);
-                        }
-                        tuple_num += 4;
-                    }
-
-                    // error case: when we have not found any documents in either direction
-                    // and we have run out of pairs to look at.
-                    if ((left_docs.size() == 0 && left_done) || (right_docs.size() == 0 && right_done))
-                        FATAL_ERROR("Issue occurred when querying the taxonomic document array.");
-
-                    // grab the overflow pointer based on which type of profiles was used
-                    char* of_ptr = nullptr;
-                    if (use_end)
-                        of_ptr = mmap_edap_of;
-                    else
-                        of_ptr = mmap_sdap_of;
-                    size_t of_pos = profile[this->num_cols * 4];
-
-                    // make sure that both directions are done based on overflow ptr
-                    if (of_pos == 0) {
-                        left_done = true;
-                        right_done = true;
-                        ASSERT((left_done && right_done), "error occurred when querying profile (1)");
-                    }
-                    
-                    // overflow file: left to right direction ...
-                    if (!left_done) {
-                        //std::cout << "left overflow" << std::endl;
-                        ASSERT((of_pos != 0), "error occurred when querying profile (2)");
-
-                        size_t num_left_pairs = READ_NUM_PAIRS(of_ptr, of_pos);
-                        ASSERT((num_left_pairs < 256), "error occurred when querying profile (3)");
-                        of_pos += 1;
-
-                        //std::cout << "num_left_pairs = " << num_left_pairs << "\n";
-
-                        // iterate through L2R pairs in overflow
-                        for (size_t i = 0; i < num_left_pairs; i++){
-                            size_t doc_id = READ_DOC_ID_OR_LCP_VAL(of_ptr, of_pos); of_pos += 2;
-                            size_t lcp_val = READ_DOC_ID_OR_LCP_VAL(of_ptr, of_pos); of_pos += 2;
-
-                            lcp_val = std::min((size_t) MAXLCPVALUE, lcp_val+num_LF_steps);
-                            //std::cout << "doc = " << doc_id << ", lcp = " << lcp_val << std::endl;
-                            if (lcp_val >= length) {
-                                left_docs.push_back(doc_id);
-                            }
-                        }
-                    }
-                    // overflow file: right to left direction ...
-                    if (!right_done) {
-                        //std::cout << "right overflow!" << std::endl;
-                        of_pos = profile[this->num_cols * 4];
-                        ASSERT((of_pos != 0), "error occurred when querying profile (4)");
-
-                        // move past the L2R pairs
-                        size_t num_left_pairs = READ_NUM_PAIRS(of_ptr, of_pos);
-                        ASSERT((num_left_pairs < 256), "error occurred when querying profile (5)");
-                        of_pos += 1 + (DOCWIDTH * 2 * num_left_pairs);
-
-                        size_t num_right_pairs = READ_NUM_PAIRS(of_ptr, of_pos);
-                        ASSERT((num_right_pairs < 256), "error occurred when querying profile (6)");
-                        of_pos += 1;
-
-                        //std::cout << "num_left_pairs = " << num_left_pairs << "\n";
-                        //std::cout << "num_right_pairs = " << num_right_pairs << "\n";
-
-                        // iterate through all the R2L pairs
-                        for (size_t i = 0; i < num_right_pairs; i++){
-                            size_t doc_id = READ_DOC_ID_OR_LCP_VAL(of_ptr, of_pos); of_pos += 2;
-                            size_t lcp_val = READ_DOC_ID_OR_LCP_VAL(of_ptr, of_pos); of_pos += 2;
-                            //std::cout << "doc = " << doc_id << ", lcp = " << lcp_val << std::endl;
-                            
-                            lcp_val = std::min((size_t) MAXLCPVALUE, lcp_val+num_LF_steps);
-                            if (lcp_val >= length) {
-                                right_docs.push_back(doc_id);
-                            }
-                        }
-                    }
-
-                    // for (auto x: left_docs)
-                    //     std::cout << x << " ";
-                    // std::cout << "\n";
-                    // for (auto x: right_docs)
-                    //     std::cout << x << " ";
-                    // std::cout << "\n";
-
-                    // sanity check: the left and right docs vectors should share the
-                    // documents at the end. edge case is if we have multiple documents
-                    // with MAXLCPVALUE so multiple peaks in the profile.
-                    size_t amount_to_remove = 0;
-                    size_t min_size = std::min(left_docs.size(), right_docs.size());
-                    if (left_docs.back() != right_docs.back()) {
-                        bool found = false;
-                        for (size_t k = 2; k <= min_size; k++) {
-                            std::vector<uint64_t> sub_vec1 (left_docs.end()-k, left_docs.end());
-                            std::vector<uint64_t> sub_vec2 (right_docs.rbegin(), right_docs.rbegin()+k);
-
-                            if (sub_vec1 == sub_vec2) {
-                                found = true;
-                                amount_to_remove = k;
-                                break;
-                            }
-                        }
-                        if (!found)
-                            FATAL_ERROR("error occurred when querying profile (7)");
-                    } else {
-                        amount_to_remove = 1;
-                    }
-
-                    // sanity check: the last document found in both direction
-                    // should be the same, and make sure we found something for both
-                    ASSERT((left_docs.size() && right_docs.size()), "error occurred when querying profile (8)");
-
-                    // remove the overlapping documents from left one
-                    for (size_t k = 0; k < amount_to_remove; k++)
-                        left_docs.pop_back();
-
-                    // output: leftmost/rightmost nodes along with
-                    // nodes between them that have a hit
-                    std::string output_str = "{";
-                    for (auto x: left_docs)
-                        output_str += std::to_string(x) + ",";
-                    for (int i = right_docs.size()-1; i >= 0; i--)
-                        output_str += std::to_string(right_docs[i]) + ",";
-
-                    // Remove comma and close bracket
-                    output_str.pop_back();
-                    output_str += "} ";
-                    listings_fd << output_str;
-            };
-        
-            // lambda to output the document listing for current exact match 
-            auto generate_listing = [this, &process_profile_with_subtree, &listings_fd,
-                                         &curr_prof_ch, &curr_prof_pos, &num_LF_steps,
-                                         &i, &end_pos_of_match, &use_end, &length, &pointer_set, &idx] 
-                                        () {
-                // only grab pointer if it has been set already
-                if (pointer_set) {
-
-                    // grab the correct current profile
-                    std::vector<uint64_t> curr_profile (this->num_cols * 4, 0);
-                    if (use_end)
-                        curr_profile = end_doc_profiles2[curr_prof_ch][curr_prof_pos];
-                    else
-                        curr_profile = start_doc_profiles2[curr_prof_ch][curr_prof_pos];
-
-                    // update profile based on LF steps
-                    idx = 0;
-                    std::for_each(curr_profile.begin(), 
-                                curr_profile.end(), 
-                                [&](uint64_t &x){
-                                if (idx % 2 == 1) 
-                                {x = std::min((size_t) MAXLCPVALUE, x+num_LF_steps);} 
-                                idx++;});
-
-                    listings_fd << "[" << (i+1) << "," << end_pos_of_match << "] ";
-
-                    length = std::min((size_t) MAXLCPVALUE, (end_pos_of_match-i));
-                    process_profile_with_subtree(curr_profile, length, use_end, num_LF_steps);
-                    end_pos_of_match = i;
-                }
-            };
-
-            // lambda to output empty listing for current position
-            auto generate_empty_listing = [this, &i, &end_pos_of_match, &listings_fd] {
-                listings_fd << "[" << i << "," << end_pos_of_match << "] {} ";
-                end_pos_of_match = i - 1;
-            };
-
-            // lambda to reset bwt variables to full range
-            auto initialize_to_full_range = [this, &start, &end, &start_run, &end_run,
-                                             &num_ch_before_start, &num_ch_before_end, &next_ch] () {
-                start = 0; end = this->bwt.size();
-                start_run = 0; end_run = this->r - 1;
-                num_ch_before_start = 0;
-                num_ch_before_end = this->bwt.number_of_letter(next_ch);
-            };
-
-            // lambda to reset bwt variables to full range after empty listing
-            auto initialize_to_full_range_after_empty = [this, &start, &end, &start_run, &end_run,
-                                             &num_ch_before_start, &num_ch_before_end, &next_ch] () {
-                start = 0; end = this->bwt.size();
-                start_run = 0; end_run = this->r - 1;
-                num_ch_before_start = 0;
-                num_ch_before_end = 0;
-            };
-
-            // lambda to choose a new document array profile to use
-            auto update_profile_pointer = [this, &curr_prof_ch, &next_ch, &curr_prof_pos,
-                                           &start_run, &num_LF_steps, &use_start, &use_end, 
-                                           &start, &pointer_set] () {
-                
-                // turn on variable to show we have found set it
-                pointer_set = true;
-
-                // grab any profile at run boundary of next_ch (choose first one)
-                curr_prof_ch = next_ch;
-                curr_prof_pos = this->bwt.run_head_rank(start_run, next_ch);
-                num_LF_steps = 0;
-                use_start = false; use_end = false;
-
-                // if the start position run is the same as query
-                // ch, then we can guarantee that end of run is in the range
-                // otherwise, we can guarantee the start of run is in range.
-                if (this->bwt[start] == next_ch)
-                    use_end = true;
-                else
-                    use_start = true;
-            };
-
-            // build minimizer digest object (only used if needed)
-            MinimizerDigest digester; 
-            digester.set_lexorder(false);
-            digester.set_windows(small_window_l, large_window_l);
-            if (database_type == MINIMIZER) digester.set_minimizer_alp(true);
-
-            // process each read, and print out the document lists
-            while (kseq_read(seq)>=0) {
-                // uppercase every letter in read
-                for (int j = 0; j < seq->seq.l; j++) {seq->seq.s[j] = up_tab[(int) seq->seq.s[j]];}
-
-                // digest read if needed
-                std::string input_read = seq->seq.s;
-                read_length = 0;
-
-                if (database_type == DNA_MINIMIZER) {input_read = digester.compute_digest(input_read);}
-                else if (database_type == MINIMIZER) {input_read = digester.compute_digest(input_read);}
-                read_length = input_read.size();
-
-                // include read name in output file
-                listings_fd << ">" << seq->name.s << "\n";
-
-                // re-initialize variables to use for backward search
-                start = 0; end = this->bwt.size(); 
-                end_pos_of_match = read_length-1; length = 0;
-
-                curr_prof_ch = 0; curr_prof_pos = 0, num_LF_steps = 0;
-                use_start = false, use_end = false; pointer_set = false;
-
-                // initialize position variable 
-                i = (read_length-1);
-                // perform backward search and report document listings
-                while (i >= 0) {
-                    // already upper-cased
-                    next_ch = input_read[i];
-
-                    // special case: next_ch does not occur in text
-                    if (this->bwt.number_of_letter(next_ch) == 0) {
-                        generate_listing(); // listing for [i+1,end] ...
-                        generate_empty_listing(); // empty listing for [i,i] ...
-
-                        i--; 
-                        initialize_to_full_range_after_empty();
-                        pointer_set = false;
-                        continue;
-                    }
-
-                    // identify the run # that start and end are in
-                    num_ch_before_start = this->bwt.rank(start, next_ch); 
-                    num_ch_before_end = this->bwt.rank(end, next_ch);
-                    start_run = 0; end_run = 0;
-
-                    // calculate key variables
-                    size_t range_length = end - start;
-                    size_t num_next_ch_in_range = num_ch_before_end - num_ch_before_start;
-
-                    // range is within BWT run, and it is the next character
-                    if (range_length == num_next_ch_in_range) {
-                        num_LF_steps++;
-                    } 
-                    // range does not contain the next character 
-                    else if (num_next_ch_in_range == 0) {
-                        generate_listing();
-                        initialize_to_full_range(); 
-                        update_profile_pointer();
-                    }
-                    // range spans a run boundary, and contains the next character
-                    else {
-                        // update start_run variable here since it is used by following lambda
-                        start_run = this->bwt.run_of_position(start);
-                        update_profile_pointer();
-                    }
-
-                    // Perform an LF step
-                    start = num_ch_before_start + this->F[next_ch]; 
-                    end = num_ch_before_end + this->F[next_ch];
-
-                    // move to next character
-                    i--;
-                }
-                generate_listing(); listings_fd << "\n";
-            }
-            listings_fd.close();
-            DONE_LOG((std::chrono::system_clock::now() - start_time));
+            /* query reads with a single rank query per character when the range stays in one run */
+            run_query_engine<no_seeding>(*this, pattern_file, output_prefix + ".listings", 
+                                         database_type, small_window_l, large_window_l);
         }
 
         void query_profiles_with_ftab(std::string pattern_file, 
@@ -1041,421 +247,8 @@ class tax_doc_queries : ri::r_index<sparse_bv_type, rle_string_t>
                                       size_t small_window_l,
                                       size_t large_window_l) {
             /* query reads using the ftab to accelerate queries */
-
-            STATUS_LOG("query_main", "querying the patterns");
-            auto start_time = std::chrono::system_clock::now();
-
-            // open output/input files
-            std::ofstream listings_fd (output_prefix + ".listings");
-            gzFile fp; kseq_t* seq;
-            fp = gzopen(pattern_file.data(), "r"); 
-
-            if(fp == 0) {std::exit(1);}
-            seq = kseq_init(fp);
-
-            // initialize variables for tracking length
-            size_t length_sum = 0, num_matches = 0, num_reads = 0;
-
-            // initialize ftab-related variables
-            size_t curr_ftab_length = FTAB_ENTRY_LENGTH;
-            if (database_type == MINIMIZER) curr_ftab_length = FTAB_ENTRY_LENGTH_MIN;
-
-            char curr_ftab_char[curr_ftab_length+1] = "";
-            std::string curr_ftab_str = "";
-            size_t curr_ftab_num = 0;
-            int ftab_pos = 0;
-
-            // initialize variables for backward search
-            size_t start = 0, end = this->bwt.size(), end_pos_of_match = 0;
-            size_t start_run = 0, end_run = 0;
-            size_t num_ch_before_start = 0, num_ch_before_end = 0;
-
-            std::vector<uint64_t> curr_profile (this->num_cols * 4, 0);
-            uint16_t length = 0; uint8_t next_ch = 0;
-            int i = 0; size_t read_length = 0;
-            bool pointer_set = false;
-
-            // variable used keep track of position in lamdbas
-            size_t idx = 0;
-
-            // initialize variables for identifying correct document array profile
-            uint8_t curr_prof_ch = 0;
-            size_t curr_prof_pos = 0, num_LF_steps = 0;
-
-            // initialize variables for which profile to use
-            bool use_start = false, use_end = false;
-        
-            // alternate lambda to print out the document listing, that
-            // will be tested to see if it improves classification
-            auto process_profile_with_subtree = [&](std::vector<uint64_t> profile, uint16_t length, bool use_end, size_t num_LF_steps) {
-                    bool left_done = false, right_done = false;
-                    std::vector<uint64_t> left_docs;
-                    std::vector<uint64_t> right_docs;
-                    size_t tuple_num = 0;
-
-                    // debug code:
-                    // std::cout << "length: " << length << std::endl;
-                    // std::cout << "profile: ";
-                    // for (auto x: profile)
-                    //     std::cout << x << " ";
-                    // std::cout << "\n";
-
-                    // iterates through the main table pairs ...
-                    while ((!left_done || !right_done) && (tuple_num < (this->num_cols * 4))) {   
-
-                        // base case: checks if the LCP value has reached the max, and
-                        // the monotonic increases have ended
-                        if (profile[tuple_num] == MAXLCPVALUE)
-                            left_done = true;
-                        if (profile[tuple_num+2] == MAXLCPVALUE)
-                            right_done = true;
-
-                        // query step: check if increases in either direction are still going, and 
-                        // lcp is greater than query length
-                        if (!left_done && profile[tuple_num+1] >= length) {
-                            left_docs.push_back(profile[tuple_num]);
-                        }
-                        if (!right_done && profile[tuple_num+3] >= length) {
-                            right_docs.push_back(profile[tuple_num+2]);
-                        }
-                        tuple_num += 4;
-                    }
-
-                    // error case: when we have not found any documents in either direction
-                    // and we have run out of pairs to look at.
-                    if ((left_docs.size() == 0 && left_done) || (right_docs.size() == 0 && right_done))
-                        FATAL_ERROR("Issue occurred when querying the taxonomic document array.");
-
-                    // grab the overflow pointer based on which type of profiles was used
-                    char* of_ptr = nullptr;
-                    if (use_end)
-                        of_ptr = mmap_edap_of;
-                    else
-                        of_ptr = mmap_sdap_of;
-                    size_t of_pos = profile[this->num_cols * 4];
-
-                    // make sure that both directions are done based on overflow ptr
-                    if (of_pos == 0) {
-                        left_done = true;
-                        right_done = true;
-                        ASSERT((left_done && right_done), "error occurred when querying profile (1)");
-                    }
-                    
-                    // overflow file: left to right direction ...
-                    if (!left_done) {
-                        //std::cout << "left overflow" << std::endl;
-                        ASSERT((of_pos != 0), "error occurred when querying profile (2)");
-
-                        size_t num_left_pairs = READ_NUM_PAIRS(of_ptr, of_pos);
-                        ASSERT((num_left_pairs < 256), "error occurred when querying profile (3)");
-                        of_pos += 1;
-
-                        //std::cout << "num_left_pairs = " << num_left_pairs << "\n";
-
-                        // iterate through L2R pairs in overflow
-                        for (size_t i = 0; i < num_left_pairs; i++){
-                            size_t doc_id = READ_DOC_ID_OR_LCP_VAL(of_ptr, of_pos); of_pos += 2;
-                            size_t lcp_val = READ_DOC_ID_OR_LCP_VAL(of_ptr, of_pos); of_pos += 2;
-
-                            lcp_val = std::min((size_t) MAXLCPVALUE, lcp_val+num_LF_steps);
-                            //std::cout << "doc = " << doc_id << ", lcp = " << lcp_val << std::endl;
-                            if (lcp_val >= length) {
-                                left_docs.push_back(doc_id);
-                            }
-                        }
-                    }
-                    // overflow file: right to left direction ...
-                    if (!right_done) {
-                        //std::cout << "right overflow!" << std::endl;
-                        of_pos = profile[this->num_cols * 4];
-                        ASSERT((of_pos != 0), "error occurred when querying profile (4)");
-
-                        // move past the L2R pairs
-                        size_t num_left_pairs = READ_NUM_PAIRS(of_ptr, of_pos);
-                        ASSERT((num_left_pairs < 256), "error occurred when querying profile (5)");
-                        of_pos += 1 + (DOCWIDTH * 2 * num_left_pairs);
-
-                        size_t num_right_pairs = READ_NUM_PAIRS(of_ptr, of_pos);
-                        ASSERT((num_right_pairs < 256), "error occurred when querying profile (6)");
-                        of_pos += 1;
-
-                        //std::cout << "num_left_pairs = " << num_left_pairs << "\n";
-                        //std::cout << "num_right_pairs = " << num_right_pairs << "\n";
-
-                        // iterate through all the R2L pairs
-                        for (size_t i = 0; i < num_right_pairs; i++){
-                            size_t doc_id = READ_DOC_ID_OR_LCP_VAL(of_ptr, of_pos); of_pos += 2;
-                            size_t lcp_val = READ_DOC_ID_OR_LCP_VAL(of_ptr, of_pos); of_pos += 2;
-                            //std::cout << "doc = " << doc_id << ", lcp = " << lcp_val << std::endl;
-                            
-                            lcp_val = std::min((size_t) MAXLCPVALUE, lcp_val+num_LF_steps);
-                            if (lcp_val >= length) {
-                                right_docs.push_back(doc_id);
-                            }
-                        }
-                    }
-
-                    // for (auto x: left_docs)
-                    //     std::cout << x << " ";
-                    // std::cout << "\n";
-                    // for (auto x: right_docs)
-                    //     std::cout << x << " ";
-                    // std::cout << "\n";
-
-                    // sanity check: the left and right docs vectors should share the
-                    // documents at the end. edge case is if we have multiple documents
-                    // with MAXLCPVALUE so multiple peaks in the profile.
-                    size_t amount_to_remove = 0;
-                    size_t min_size = std::min(left_docs.size(), right_docs.size());
-                    if (left_docs.back() != right_docs.back()) {
-                        bool found = false;
-                        for (size_t k = 2; k <= min_size; k++) {
-                            std::vector<uint64_t> sub_vec1 (left_docs.end()-k, left_docs.end());
-                            std::vector<uint64_t> sub_vec2 (right_docs.rbegin(), right_docs.rbegin()+k);
-
-                            if (sub_vec1 == sub_vec2) {
-                                found = true;
-                                amount_to_remove = k;
-                                break;
-                            }
-                        }
-                        if (!found)
-                            FATAL_ERROR("error occurred when querying profile (7)");
-                    } else {
-                        amount_to_remove = 1;
-                    }
-
-                    // sanity check: the last document found in both direction
-                    // should be the same, and make sure we found something for both
-                    ASSERT((left_docs.size() && right_docs.size()), "error occurred when querying profile (8)");
-
-                    // remove the overlapping documents from left one
-                    for (size_t k = 0; k < amount_to_remove; k++)
-                        left_docs.pop_back();
-
-                    // output: leftmost/rightmost nodes along with
-                    // nodes between them that have a hit
-                    std::string output_str = "{";
-                    for (auto x: left_docs)
-                        output_str += std::to_string(x) + ",";
-                    for (int i = right_docs.size()-1; i >= 0; i--)
-                        output_str += std::to_string(right_docs[i]) + ",";
-
-                    // Remove comma and close bracket
-                    output_str.pop_back();
-                    output_str += "} ";
-                    listings_fd << output_str;
-            };
-        
-            // lambda to output the document listing for current exact match 
-            auto generate_listing = [this, &process_profile_with_subtree, &listings_fd,
-                                         &curr_prof_ch, &curr_prof_pos, &num_LF_steps,
-                                         &i, &end_pos_of_match, &use_end, &length, &pointer_set, &idx,
-                                         &length_sum, &num_matches] 
-                                        () {
-                // only grab pointer if it has been set already
-                if (pointer_set) {
-
-                    // grab the correct current profile
-                    std::vector<uint64_t> curr_profile (this->num_cols * 4 + 1, 0);
-                    //std::cout << "ch = " << unsigned(curr_prof_ch) << ", pos = " << curr_prof_pos << ", use_end" << use_end << std::endl;
-
-                    if (use_end)
-                        curr_profile = end_doc_profiles2[curr_prof_ch][curr_prof_pos];
-                    else
-                        curr_profile = start_doc_profiles2[curr_prof_ch][curr_prof_pos];
-
-                    // update profile based on LF steps
-                    idx = 0;
-                    std::for_each(curr_profile.begin(), 
-                                curr_profile.end(), 
-                                [&](uint64_t &x){
-                                if (idx % 2 == 1) 
-                                {x = std::min((size_t) MAXLCPVALUE, x+num_LF_steps);} 
-                                idx++;});
-
-                    listings_fd << "[" << (i+1) << "," << end_pos_of_match << "] ";
-
-                    length = std::min((size_t) MAXLCPVALUE, (end_pos_of_match-i));
-                    process_profile_with_subtree(curr_profile, length, use_end, num_LF_steps);
-                    end_pos_of_match = i;
-
-                    length_sum += length;
-                    num_matches++;
-                }
-            };
-
-            // lambda to output empty listing for current position
-            auto generate_empty_listing = [this, &i, &end_pos_of_match, &listings_fd] {
-                listings_fd << "[" << i << "," << end_pos_of_match << "] {} ";
-                end_pos_of_match = i - 1;
-            };
-
-            // lambda to reset bwt variables to full range
-            auto initialize_to_full_range = [this, &start, &end, &start_run, &end_run,
-                                             &num_ch_before_start, &num_ch_before_end, &next_ch] () {
-                start = 0; end = this->bwt.size();
-                start_run = 0; end_run = this->r - 1;
-                num_ch_before_start = 0;
-                num_ch_before_end = this->bwt.number_of_letter(next_ch);
-            };
-
-            // lambda to reset bwt variables to full range after empty listing
-            auto initialize_to_full_range_after_empty = [this, &start, &end, &start_run, &end_run,
-                                             &num_ch_before_start, &num_ch_before_end, &next_ch] () {
-                start = 0; end = this->bwt.size();
-                start_run = 0; end_run = this->r - 1;
-                num_ch_before_start = 0;
-                num_ch_before_end = 0;
-            };
-
-            // lambda to choose a new document array profile to use
-            auto update_profile_pointer = [this, &curr_prof_ch, &next_ch, &curr_prof_pos,
-                                           &start_run, &num_LF_steps, &use_start, &use_end, 
-                                           &start, &pointer_set] () {
-                
-                // turn on variable to show we have found set it
-                pointer_set = true;
-
-                // grab any profile at run boundary of next_ch (choose first one)
-                curr_prof_ch = next_ch;
-                curr_prof_pos = this->bwt.run_head_rank(start_run, next_ch);
-                num_LF_steps = 0;
-                use_start = false; use_end = false;
-
-                // if the start position run is the same as query
-                // ch, then we can guarantee that end of run is in the range
-                // otherwise, we can guarantee the start of run is in range.
-                if (this->bwt[start] == next_ch)
-                    use_end = true;
-                else
-                    use_start = true;
-            };
-
-            // lambda to extract ftab entry and load variables
-            auto load_ftab_entry = [this, &ftab_pos, &start, &end, &curr_prof_pos, &num_LF_steps,
-                                    &curr_prof_ch, &use_start, &use_end, &i, &curr_ftab_length, &pointer_set] () {
-                start = ftab[ftab_pos][0]; 
-                end = ftab[ftab_pos][1];
-                curr_prof_pos = ftab[ftab_pos][2]; 
-                num_LF_steps = ftab[ftab_pos][3]; 
-                curr_prof_ch = ftab[ftab_pos][4]; 
-                use_start = ftab[ftab_pos][5];
-                use_end = ftab[ftab_pos][6];
-                i -= curr_ftab_length;
-
-                // turn on variable to show we have found set it
-                pointer_set = true;
-            };
-
-            // build minimizer digest object (only used if needed)
-            MinimizerDigest digester; 
-            digester.set_lexorder(false);
-            digester.set_windows(small_window_l, large_window_l);
-            if (database_type == MINIMIZER) digester.set_minimizer_alp(true);
-
-            // process each read, and print out the document lists
-            while (kseq_read(seq)>=0) {
-                // uppercase every letter in read
-                for (int j = 0; j < seq->seq.l; j++) {seq->seq.s[j] = up_tab[(int) seq->seq.s[j]];}
-                num_reads++;
-
-                // digest read if needed
-                std::string input_read = seq->seq.s;
-                read_length = 0;
-
-                if (database_type == DNA_MINIMIZER) {input_read = digester.compute_digest(input_read);}
-                else if (database_type == MINIMIZER) {input_read = digester.compute_digest(input_read);}
-                read_length = input_read.size();
-
-                // include read name in output file
-                listings_fd << ">" << seq->name.s << "\n";
-
-                // re-initialize variables to use for backward search
-                start = 0; end = this->bwt.size(); 
-                end_pos_of_match = read_length-1; length = 0;
-
-                curr_prof_ch = 0; curr_prof_pos = 0, num_LF_steps = 0;
-                use_start = false, use_end = false; pointer_set = false;
-
-                // re-initialize ftab-related variables
-                curr_ftab_str = ""; curr_ftab_num = 0;
-
-                // initialize position variable 
-                i = (read_length-1);
-
-                // determine if we can use ftab to start out
-                ftab_pos = check_if_ftab_can_be_used(input_read.data(), i, (database_type == MINIMIZER)); 
-                if (ftab_pos >= 0) {load_ftab_entry();}
-
-                // perform backward search and report document listings
-                while (i >= 0) {
-                    bool ftab_used = false; 
-                    // already upper-cased
-                    next_ch = input_read[i];
-
-                    // special case: next_ch does not occur in text
-                    if (this->bwt.number_of_letter(next_ch) == 0) {
-                        generate_listing(); // listing for [i+1,end] ...
-                        generate_empty_listing(); // empty listing for [i,i] ...
-
-                        i--; 
-                        initialize_to_full_range_after_empty();
-                        pointer_set = false;
-                        continue;
-                    }
-
-                    // identify the run # that start and end are in
-                    num_ch_before_start = this->bwt.rank(start, next_ch); 
-                    num_ch_before_end = this->bwt.rank(end, next_ch);
-                    start_run = 0; end_run = 0;
-
-                    // calculate key variables
-                    size_t range_length = end - start;
-                    size_t num_next_ch_in_range = num_ch_before_end - num_ch_before_start;
-
-                    // range is within BWT run, and it is the next character
-                    if (range_length == num_next_ch_in_range) {
-                        num_LF_steps++;
-                    } 
-                    // range does not contain the next character 
-                    else if (num_next_ch_in_range == 0) {
-                        generate_listing();
-                        initialize_to_full_range(); 
-
-                        ftab_pos = check_if_ftab_can_be_used(input_read.data(), i, (database_type == MINIMIZER));
-                        if (ftab_pos >= 0) {
-                            load_ftab_entry();
-                            ftab_used = true;
-                        } else {
-                            update_profile_pointer();
-                        }
-                    }
-                    // range spans a run boundary, and contains the next character
-                    else {
-                        // update start_run variable here since it is used by following lambda
-                        start_run = this->bwt.run_of_position(start);
-                        update_profile_pointer();
-                    }
-
-                    if (!ftab_used) {
-                        // perform an LF step
-                        start = num_ch_before_start + this->F[next_ch]; 
-                        end = num_ch_before_end + this->F[next_ch];
-
-                        // move to next character
-                        i--;
-                    }
-                }
-                generate_listing(); listings_fd << "\n";
-            }
-            listings_fd.close();
-            DONE_LOG((std::chrono::system_clock::now() - start_time));
-        
-                  // report overall metrics on querying
-            FORCE_LOG("query_main", 
-                      "processed %ld reads (%ld total chars / %ld exact matches = %.2f avg length)",
-                      num_reads, length_sum, num_matches, (length_sum/(num_matches+0.0)));  
+            run_query_engine<ftab_seeding>(*this, pattern_file, output_prefix + ".listings", 
+                                           database_type, small_window_l, large_window_l);
         }
 
         std::pair<size_t, size_t> build_ftab(bool minimizer_alphabet) {
@@ -1691,6 +484,141 @@ class tax_doc_queries : ri::r_index<sparse_bv_type, rle_string_t>
         /*********************************/ 
         /* Private instance methods
         /*********************************/
+        template <class, class, class, class> friend class mem_query_engine;
+
+        const std::vector<uint64_t>& get_profile(uint8_t ch, size_t pos, bool use_end) {
+            /* returns the start or end profile of the pos-th run of ch */
+            if (use_end)
+                return end_doc_profiles2[alphabet[ch]][pos];
+            return start_doc_profiles2[alphabet[ch]][pos];
+        }
+
+        void write_listing(std::ostream& out, const std::vector<uint64_t>& profile, 
+                           uint16_t length, bool use_end, size_t num_LF_steps) {
+            /* prints the leftmost/rightmost documents along with the ones between them that have a hit */
+            bool left_done = false, right_done = false;
+            std::vector<uint64_t> left_docs;
+            std::vector<uint64_t> right_docs;
+            size_t tuple_num = 0;
+
+            // the lcp values (odd entries) are updated with the LF steps
+            auto lcp_at = [&](size_t pos) {
+                return std::min((size_t) MAXLCPVALUE, profile[pos]+num_LF_steps);
+            };
+
+            // iterates through the main table pairs ...
+            while ((!left_done || !right_done) && (tuple_num < (this->num_cols * 4))) {   
+
+                // base case: checks if the LCP value has reached the max, and
+                // the monotonic increases have ended
+                if (profile[tuple_num] == MAXLCPVALUE)
+                    left_done = true;
+                if (profile[tuple_num+2] == MAXLCPVALUE)
+                    right_done = true;
+
+                // query step: check if increases in either direction are still going, and 
+                // lcp is greater than query length
+                if (!left_done && lcp_at(tuple_num+1) >= length)
+                    left_docs.push_back(profile[tuple_num]);
+                if (!right_done && lcp_at(tuple_num+3) >= length)
+                    right_docs.push_back(profile[tuple_num+2]);
+                tuple_num += 4;
+            }
+
+            // error case: when we have not found any documents in either direction
+            // and we have run out of pairs to look at.
+            if ((left_docs.size() == 0 && left_done) || (right_docs.size() == 0 && right_done))
+                FATAL_ERROR("Issue occurred when querying the taxonomic document array.");
+
+            // grab the overflow pointer based on which type of profiles was used
+            char* of_ptr = (use_end) ? mmap_edap_of : mmap_sdap_of;
+            size_t of_pos = profile[this->num_cols * 4];
+
+            // make sure that both directions are done based on overflow ptr
+            if (of_pos == 0) {
+                left_done = true;
+                right_done = true;
+            }
+            
+            // overflow file: left to right direction ...
+            if (!left_done) {
+                if (stats.enabled) stats.counters.overflow_reads++;
+                size_t num_left_pairs = READ_NUM_PAIRS(of_ptr, of_pos);
+                ASSERT((num_left_pairs < 256), "error occurred when querying profile (3)");
+                of_pos += 1;
+
+                // iterate through L2R pairs in overflow
+                for (size_t i = 0; i < num_left_pairs; i++){
+                    size_t doc_id = READ_DOC_ID_OR_LCP_VAL(of_ptr, of_pos); of_pos += 2;
+                    size_t lcp_val = READ_DOC_ID_OR_LCP_VAL(of_ptr, of_pos); of_pos += 2;
+
+                    lcp_val = std::min((size_t) MAXLCPVALUE, lcp_val+num_LF_steps);
+                    if (lcp_val >= length)
+                        left_docs.push_back(doc_id);
+                }
+            }
+            // overflow file: right to left direction ...
+            if (!right_done) {
+                of_pos = profile[this->num_cols * 4];
+                ASSERT((of_pos != 0), "error occurred when querying profile (4)");
+
+                // move past the L2R pairs
+                if (stats.enabled) stats.counters.overflow_reads++;
+                size_t num_left_pairs = READ_NUM_PAIRS(of_ptr, of_pos);
+                ASSERT((num_left_pairs < 256), "error occurred when querying profile (5)");
+                of_pos += 1 + (DOCWIDTH * 2 * num_left_pairs);
+
+                size_t num_right_pairs = READ_NUM_PAIRS(of_ptr, of_pos);
+                ASSERT((num_right_pairs < 256), "error occurred when querying profile (6)");
+                of_pos += 1;
+
+                // iterate through all the R2L pairs
+                for (size_t i = 0; i < num_right_pairs; i++){
+                    size_t doc_id = READ_DOC_ID_OR_LCP_VAL(of_ptr, of_pos); of_pos += 2;
+                    size_t lcp_val = READ_DOC_ID_OR_LCP_VAL(of_ptr, of_pos); of_pos += 2;
+                    
+                    lcp_val = std::min((size_t) MAXLCPVALUE, lcp_val+num_LF_steps);
+                    if (lcp_val >= length)
+                        right_docs.push_back(doc_id);
+                }
+            }
+
+            // sanity check: the left and right docs vectors should share the
+            // documents at the end. edge case is if we have multiple documents
+            // with MAXLCPVALUE so multiple peaks in the profile.
+            ASSERT((left_docs.size() && right_docs.size()), "error occurred when querying profile (8)");
+            size_t amount_to_remove = 0;
+            size_t min_size = std::min(left_docs.size(), right_docs.size());
+            if (left_docs.back() != right_docs.back()) {
+                bool found = false;
+                for (size_t k = 2; k <= min_size; k++) {
+                    if (std::equal(left_docs.end()-k, left_docs.end(), right_docs.rbegin())) {
+                        found = true;
+                        amount_to_remove = k;
+                        break;
+                    }
+                }
+                if (!found)
+                    FATAL_ERROR("error occurred when querying profile (7)");
+            } else {
+                amount_to_remove = 1;
+            }
+
+            // remove the overlapping documents from left one
+            left_docs.resize(left_docs.size() - amount_to_remove);
+
+            // output: leftmost/rightmost nodes along with
+            // nodes between them that have a hit
+            std::string output_str = "{";
+            for (auto x: left_docs)
+                output_str += std::to_string(x) + ",";
+            for (int i = right_docs.size()-1; i >= 0; i--)
+                output_str += std::to_string(right_docs[i]) + ",";
+
+            // Remove comma and close bracket
+            output_str.pop_back();
+            out << output_str << "} ";
+        }
 
         void load_bwt_structure(std::string bwt_fname) {
             /* loads the BWT data-structure from the build sub-command */
@@ -1793,6 +721,7 @@ class tax_doc_queries : ri::r_index<sparse_bv_type, rle_string_t>
             // Go through each record, it starts with the BWT ch and then
             // the left and right monotonic increase pairs and lastly
             // followed by index to the overflow file.
+            prof_matrix.resize(alphabet.size());
             size_t curr_val = 0;
             uint8_t curr_bwt_ch = 0;
             for (size_t i = 0; i < this->r; i++){
@@ -1822,7 +751,7 @@ class tax_doc_queries : ri::r_index<sparse_bv_type, rle_string_t>
                 //         *out_fd << x << ",";
                 //     *out_fd << of_ptr << "\n";
                 // }
-                prof_matrix[curr_bwt_ch].push_back(curr_record);
+                prof_matrix[alphabet[curr_bwt_ch]].push_back(curr_record);
             }
         }
 
@@ -1850,10 +779,13 @@ class tax_doc_queries : ri::r_index<sparse_bv_type, rle_string_t>
             fin_ptrs.read(reinterpret_cast<char*>(overflow_ptrs.data()), this->r * sizeof(size_t));
             fin_runcnt.read(reinterpret_cast<char*>(true_ch_run_cnt.data()), 256 * sizeof(uint64_t));
                         
-            // reserve space for document array table to avoid reallocations
-            for(size_t i = 0; i < 256; i++) {
-                prof_matrix[i].resize(true_ch_run_cnt[i]); // second dimension
-                for(size_t j = 0; j < true_ch_run_cnt[i]; j++) {
+            // reserve space for document array table to avoid reallocations,
+            // only the characters present in the alphabet get a row
+            prof_matrix.resize(alphabet.size());
+            for(size_t i = 0; i < alphabet.size(); i++) {
+                size_t ch = alphabet.chars[i];
+                prof_matrix[i].resize(true_ch_run_cnt[ch]); // second dimension
+                for(size_t j = 0; j < true_ch_run_cnt[ch]; j++) {
                     prof_matrix[i][j].resize(this->num_cols * 4 + 1);
                     ASSERT((prof_matrix[i][j].capacity() == (this->num_cols * 4 + 1)), "issue with capacity of prof_matrix[i][j].");
                 }
@@ -1870,13 +802,14 @@ class tax_doc_queries : ri::r_index<sparse_bv_type, rle_string_t>
                 
                 // get the run id for this bwt char to locate the right vector
                 size_t run_bwt_ch_i = curr_num_ch_runs[curr_bwt_ch];
+                size_t ch_rank = alphabet[curr_bwt_ch];
 
                 // go through each value and place it directly in array
-                ASSERT((prof_matrix[curr_bwt_ch][run_bwt_ch_i].size() == (this->num_cols * 4 + 1)), "issue with size of prof_matrix[i][j].");
+                ASSERT((prof_matrix[ch_rank][run_bwt_ch_i].size() == (this->num_cols * 4 + 1)), "issue with size of prof_matrix[i][j].");
                 for (size_t j = 0; j < (this->num_cols * 4); j++) {
-                    prof_matrix[curr_bwt_ch][run_bwt_ch_i][j] = main_table[pos+j+1];
+                    prof_matrix[ch_rank][run_bwt_ch_i][j] = main_table[pos+j+1];
                 }
-                prof_matrix[curr_bwt_ch][run_bwt_ch_i][this->num_cols * 4] = overflow_ptrs[run_i];
+                prof_matrix[ch_rank][run_bwt_ch_i][this->num_cols * 4] = overflow_ptrs[run_i];
 
                 // optional code: check and make sure they are equal to old version
                 // if (!std::equal(old_matrix[curr_bwt_ch][run_bwt_ch_i].begin(), old_matrix[curr_bwt_ch][run_bwt_ch_i].end(), prof_matrix[curr_bwt_ch][run_bwt_ch_i].begin())) {
@@ -2050,6 +983,27 @@ class tax_doc_queries : ri::r_index<sparse_bv_type, rle_string_t>
                 this->F[i] += this->F[i - 1];
             return this->F;
         }
+
+        void build_F_from_runs(const std::string& run_heads, const std::vector<uint64_t>& run_lengths) {
+            /* same as build_F_, but over the runs kept in memory */
+            this->F = vector<ulint>(256, 0);
+            for (ulint i = 0; i < run_heads.size(); i++)
+            {
+                uint8_t c = run_heads[i];
+                if (c > TERMINATOR)
+                    this->F[c] += run_lengths[i];
+                else
+                {
+                    this->F[TERMINATOR] += run_lengths[i];
+                    this->terminator_position = i;
+                }
+            }
+            for (ulint i = 255; i > 0; --i)
+                this->F[i] = this->F[i - 1];
+            this->F[0] = 0;
+            for (ulint i = 1; i < 256; ++i)
+                this->F[i] += this->F[i - 1];
+        }
 };
 
 #endif /* end of include guard: _TAX_DOC_QUERIES_H */
\ No newline at end of file
@@ -0,0 +1,287 @@
+/*
+ * File: temp_records.hpp
+ * Description: Definition of the temp_record_stream class, which stores
+ *              the per-suffix records of the two-pass construction in
+ *              compressed blocks on top of a temp_store. Each block holds
+ *              a fixed number of records and is encoded independently,
+ *              one column after the other: the flags, the bwt chars and
+ *              documents (only stored when they change), the lcps (delta
+ *              + varint encoded) and the suffix lengths. The offset of
+ *              every block is kept, so blocks can be decoded in any
+ *              order (forward for the 1st pass, backward for the 2nd)
+ *              into aligned arrays, one for each column.
+ * Date: October 19th, 2026
+ */
+
+#ifndef _TEMP_RECORDS_H
+#define _TEMP_RECORDS_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <iostream>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <pfp_doc.hpp>
+#include <temp_store.hpp>
+
+/* size of each record before compression (flags, char, doc, lcp, suffix length) */
+#define TEMPDATA_RECORD 8
+
+/* number of records in each compressed block, and the max bytes for one record */
+#define TEMP_BLOCK_BITS 12
+#define TEMP_BLOCK_RECORDS (1ULL << TEMP_BLOCK_BITS)
+#define TEMP_BLOCK_MASK (TEMP_BLOCK_RECORDS - 1)
+#define TEMP_MAX_ENCODED_RECORD 11
+
+/* bits of the flag byte stored for each record */
+#define TEMP_FLAG_IS_END 0x1
+#define TEMP_FLAG_IS_START 0x2
+#define TEMP_FLAG_NEW_CH 0x4
+#define TEMP_FLAG_NEW_DOC 0x8
+#define TEMP_FLAG_MAX_SUFFIX 0x10
+
+/* MACROS for reading a record through a temp_record_reader */
+#define GET_IS_START(rd, num) ((rd.block_of(num).flags[(num) & TEMP_BLOCK_MASK] & TEMP_FLAG_IS_START) >> 1)
+#define GET_IS_END(rd, num) (rd.block_of(num).flags[(num) & TEMP_BLOCK_MASK] & TEMP_FLAG_IS_END)
+#define GET_BWT_CH(rd, num) (rd.block_of(num).bwt_ch[(num) & TEMP_BLOCK_MASK])
+#define GET_DOC_OF_LF(rd, num) (rd.block_of(num).doc_num[(num) & TEMP_BLOCK_MASK])
+#define GET_LCP(rd, num) (rd.block_of(num).lcp[(num) & TEMP_BLOCK_MASK])
+#define GET_SUFFIX_LEN(rd, num) (rd.block_of(num).suffix_length[(num) & TEMP_BLOCK_MASK])
+
+/* record of the temporary lcp data, as it is appended to the stream */
+typedef struct
+{
+    bool is_start = false;
+    bool is_end = false;
+    uint8_t bwt_ch = 0;
+    uint16_t doc_num = 0;
+    uint16_t lcp = 0;
+    uint16_t suffix_length = 0;
+} temp_record_t;
+
+/* decoded block of records, with one aligned array per column */
+typedef struct
+{
+    size_t start = 0;
+    size_t num_records = 0;
+    alignas(64) uint8_t flags[TEMP_BLOCK_RECORDS];
+    alignas(64) uint8_t bwt_ch[TEMP_BLOCK_RECORDS];
+    alignas(64) uint16_t doc_num[TEMP_BLOCK_RECORDS];
+    alignas(64) uint16_t lcp[TEMP_BLOCK_RECORDS];
+    alignas(64) uint16_t suffix_length[TEMP_BLOCK_RECORDS];
+} temp_record_block_t;
+
+inline uint8_t* put_varint(uint8_t* out, uint32_t value) {
+    while (value >= 0x80) {
+        *out++ = (value & 0x7F) | 0x80;
+        value >>= 7;
+    }
+    *out++ = value;
+    return out;
+}
+
+inline const uint8_t* get_varint(const uint8_t* in, uint32_t& value) {
+    value = 0;
+    for (size_t shift = 0; ; shift += 7) {
+        uint8_t byte = *in++;
+        value |= (uint32_t) (byte & 0x7F) << shift;
+        if (!(byte & 0x80)) return in;
+    }
+}
+
+inline uint32_t zigzag_encode(int32_t value) {return ((uint32_t) value << 1) ^ (uint32_t) (value >> 31);}
+inline int32_t zigzag_decode(uint32_t value) {return (int32_t) (value >> 1) ^ -((int32_t) (value & 1));}
+
+class temp_record_stream {
+    public:
+        temp_record_stream() {}
+        temp_record_stream(const temp_record_stream&) = delete;
+        temp_record_stream& operator=(const temp_record_stream&) = delete;
+
+        void init(std::string file_path, temp_memory_budget_t* mem_budget, size_t max_size = 0) {
+            store.init(file_path, mem_budget, max_size);
+            pending.reserve(TEMP_BLOCK_RECORDS);
+        }
+
+        void append(const temp_record_t& record) {
+            /* adds a record to the current block, and encodes the block once it is full */
+            ASSERT((!finished), "cannot append to a temp record stream after it is finished.");
+            pending.push_back(record);
+            if (pending.size() == TEMP_BLOCK_RECORDS)
+                encode_block();
+        }
+
+        void finish() {
+            /* encodes the last partial block, the stream is read-only afterwards */
+            if (finished) return;
+            if (!pending.empty()) encode_block();
+            finished = true;
+            std::vector<temp_record_t>().swap(pending);
+        }
+
+        void decode_block(size_t block_num, temp_record_block_t& block, std::vector<uint8_t>& buffer) const {
+            /* decodes all the columns of a block, buffer is scratch space for the encoded bytes */
+            ASSERT((finished), "the temp record stream must be finished before decoding it.");
+            size_t num_bytes = block_offsets[block_num+1] - block_offsets[block_num];
+            buffer.resize(num_bytes);
+            store.read(block_offsets[block_num], (char*) buffer.data(), num_bytes);
+
+            block.start = block_num * TEMP_BLOCK_RECORDS;
+            block.num_records = std::min((size_t) TEMP_BLOCK_RECORDS, num_records_total - block.start);
+            size_t n = block.num_records;
+
+            const uint8_t* in = buffer.data();
+            std::memcpy(block.flags, in, n);
+            in += n;
+
+            uint8_t curr_ch = 0;
+            for (size_t i = 0; i < n; i++) {
+                if (block.flags[i] & TEMP_FLAG_NEW_CH) curr_ch = *in++;
+                block.bwt_ch[i] = curr_ch;
+            }
+
+            uint32_t value = 0, curr_doc = 0;
+            for (size_t i = 0; i < n; i++) {
+                if (block.flags[i] & TEMP_FLAG_NEW_DOC) in = get_varint(in, curr_doc);
+                block.doc_num[i] = curr_doc;
+            }
+
+            uint16_t curr_lcp = 0;
+            for (size_t i = 0; i < n; i++) {
+                in = get_varint(in, value);
+                curr_lcp += zigzag_decode(value);
+                block.lcp[i] = curr_lcp;
+            }
+
+            for (size_t i = 0; i < n; i++) {
+                if (block.flags[i] & TEMP_FLAG_MAX_SUFFIX) {
+                    block.suffix_length[i] = MAXLCPVALUE;
+                } else {
+                    in = get_varint(in, value);
+                    block.suffix_length[i] = value;
+                }
+            }
+        }
+
+        std::vector<bool> checkpoint(std::ostream& index_out, std::string ckpt_path) {
+            /* writes the block index to index_out, and checkpoints the encoded blocks in place (see temp_store) */
+            ASSERT((finished), "the temp record stream must be finished before saving it.");
+            uint64_t header[2] = {num_records_total, block_offsets.size()};
+            index_out.write((char*) header, sizeof(header));
+            index_out.write((char*) block_offsets.data(), block_offsets.size() * sizeof(size_t));
+            index_out.write((char*) block_boundaries.data(), block_boundaries.size() * sizeof(uint32_t));
+            return store.checkpoint(ckpt_path, bytes_used());
+        }
+
+        void restore(std::istream& index_in, std::string ckpt_path) {
+            /* reads a stream saved by checkpoint(), it is read-only afterwards */
+            uint64_t header[2] = {0, 0};
+            index_in.read((char*) header, sizeof(header));
+            if (!index_in || header[1] == 0)
+                FATAL_ERROR("the index of the temp records in the checkpoint is incomplete.");
+            num_records_total = header[0];
+            block_offsets.resize(header[1]);
+            block_boundaries.resize(header[1] - 1);
+            index_in.read((char*) block_offsets.data(), block_offsets.size() * sizeof(size_t));
+            index_in.read((char*) block_boundaries.data(), block_boundaries.size() * sizeof(uint32_t));
+            store.restore(ckpt_path, bytes_used());
+            finished = true;
+            std::vector<temp_record_t>().swap(pending);
+        }
+
+        void release_before(size_t record_num) {
+            /* frees the storage of the blocks that lie entirely before this record */
+            store.release_before(block_offsets[record_num / TEMP_BLOCK_RECORDS]);
+        }
+
+        void remove_file() {store.remove_file();}
+
+        size_t num_boundaries(size_t block_num) const {return block_boundaries[block_num];}
+        size_t size() const {return num_records_total;}
+        size_t num_blocks() const {return block_offsets.size() - 1;}
+        size_t bytes_used() const {return block_offsets.back();}
+        size_t bytes_in_memory() const {return store.bytes_in_memory();}
+        size_t bytes_on_disk() const {return store.bytes_on_disk();}
+
+    private:
+        temp_store store;
+        std::vector<size_t> block_offsets = {0};
+        std::vector<uint32_t> block_boundaries; // # of run boundaries in each block
+        std::vector<temp_record_t> pending;
+        std::vector<uint8_t> encode_buffer;
+        size_t num_records_total = 0;
+        bool finished = false;
+
+        void encode_block() {
+            /* encodes the pending records column by column, each relative to the previous record */
+            encode_buffer.resize(pending.size() * TEMP_MAX_ENCODED_RECORD);
+            uint8_t* out = encode_buffer.data();
+            size_t n = pending.size();
+
+            uint32_t boundaries = 0;
+            for (size_t i = 0; i < n; i++) {
+                const temp_record_t& record = pending[i];
+                boundaries += (record.is_start || record.is_end);
+                bool new_ch = (i == 0 || record.bwt_ch != pending[i-1].bwt_ch);
+                bool new_doc = (i == 0 || record.doc_num != pending[i-1].doc_num);
+                *out++ = (record.is_end ? TEMP_FLAG_IS_END : 0) |
+                         (record.is_start ? TEMP_FLAG_IS_START : 0) |
+                         (new_ch ? TEMP_FLAG_NEW_CH : 0) |
+                         (new_doc ? TEMP_FLAG_NEW_DOC : 0) |
+                         (record.suffix_length == MAXLCPVALUE ? TEMP_FLAG_MAX_SUFFIX : 0);
+            }
+            for (size_t i = 0; i < n; i++) {
+                if (i == 0 || pending[i].bwt_ch != pending[i-1].bwt_ch)
+                    *out++ = pending[i].bwt_ch;
+            }
+            for (size_t i = 0; i < n; i++) {
+                if (i == 0 || pending[i].doc_num != pending[i-1].doc_num)
+                    out = put_varint(out, pending[i].doc_num);
+            }
+            uint16_t prev_lcp = 0;
+            for (size_t i = 0; i < n; i++) {
+                out = put_varint(out, zigzag_encode((int32_t) pending[i].lcp - (int32_t) prev_lcp));
+                prev_lcp = pending[i].lcp;
+            }
+            for (size_t i = 0; i < n; i++) {
+                if (pending[i].suffix_length != MAXLCPVALUE)
+                    out = put_varint(out, pending[i].suffix_length);
+            }
+
+            size_t num_bytes = out - encode_buffer.data();
+            size_t start_pos = block_offsets.back();
+            store.reserve(start_pos + num_bytes);
+            store.write(start_pos, (const char*) encode_buffer.data(), num_bytes);
+
+            block_offsets.push_back(start_pos + num_bytes);
+            block_boundaries.push_back(boundaries);
+            num_records_total += pending.size();
+            pending.clear();
+        }
+};
+
+class temp_record_reader {
+    public:
+        temp_record_reader(const temp_record_stream& stream): stream(stream), block(new temp_record_block_t) {}
+
+        inline const temp_record_block_t& block_of(size_t num) {
+            /* returns the block holding the record, decoding it if it is not the current one */
+            if (num - block->start >= block->num_records)
+                load_block(num >> TEMP_BLOCK_BITS);
+            return *block;
+        }
+
+        const temp_record_block_t& load_block(size_t block_num) {
+            stream.decode_block(block_num, *block, buffer);
+            return *block;
+        }
+
+    private:
+        const temp_record_stream& stream;
+        std::unique_ptr<temp_record_block_t> block;
+        std::vector<uint8_t> buffer;
+};
+
+#endif /* end of include guard: _TEMP_RECORDS_H */
@@ -0,0 +1,246 @@
+/*
+ * File: temp_store.hpp
+ * Description: Definition of the temp_store class, a growable byte
+ *              array used for the temporary data of the two-pass
+ *              construction. It is made up of fixed-size segments that
+ *              are allocated on demand: a segment is kept in memory if
+ *              it fits in the memory budget shared by the stores, and
+ *              otherwise it is mmap'd from a temporary file. Segments
+ *              are released once they have been consumed. A store can
+ *              be checkpointed in place: its file is completed with the
+ *              in-memory segments and renamed, instead of being copied.
+ * Date: October 19th, 2026
+ */
+
+#ifndef _TEMP_STORE_H
+#define _TEMP_STORE_H
+
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <iostream>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <pfp_doc.hpp>
+
+/* segments are 64 MB, which is a multiple of every record size */
+#define TEMP_SEGMENT_BITS 26
+#define TEMP_SEGMENT_SIZE (1ULL << TEMP_SEGMENT_BITS)
+#define TEMP_SEGMENT_MASK (TEMP_SEGMENT_SIZE - 1)
+
+/* memory budget shared by all the stores of a build */
+typedef struct
+{
+    size_t remaining = 0;
+} temp_memory_budget_t;
+
+class temp_store {
+    public:
+        temp_store() {}
+        temp_store(const temp_store&) = delete;
+        temp_store& operator=(const temp_store&) = delete;
+
+        ~temp_store() {
+            release_before(capacity);
+            if (fd != -1) close(fd);
+        }
+
+        void init(std::string file_path, temp_memory_budget_t* mem_budget, size_t max_size = 0) {
+            /* the file is only created if a segment does not fit in memory */
+            path = file_path;
+            budget = mem_budget;
+            max_bytes = max_size;
+        }
+
+        inline char& operator[](size_t pos) {
+            return segments[pos >> TEMP_SEGMENT_BITS][pos & TEMP_SEGMENT_MASK];
+        }
+
+        inline void reserve(size_t num_bytes) {
+            /* makes sure the bytes [0, num_bytes) are backed by segments */
+            if (num_bytes > capacity) add_segments(num_bytes);
+        }
+
+        inline char* span(size_t pos, size_t num_bytes) {
+            /* pointer to the bytes [pos, pos + num_bytes), or nullptr if they cross a segment */
+            if ((pos & TEMP_SEGMENT_MASK) + num_bytes > TEMP_SEGMENT_SIZE) return nullptr;
+            return &segments[pos >> TEMP_SEGMENT_BITS][pos & TEMP_SEGMENT_MASK];
+        }
+
+        void write(size_t pos, const char* src, size_t num_bytes) {
+            /* copies num_bytes into the store at pos, the bytes must be reserved */
+            while (num_bytes > 0) {
+                size_t len = std::min(num_bytes, (size_t) (TEMP_SEGMENT_SIZE - (pos & TEMP_SEGMENT_MASK)));
+                std::memcpy(&(*this)[pos], src, len);
+                pos += len; src += len; num_bytes -= len;
+            }
+        }
+
+        void read(size_t pos, char* dest, size_t num_bytes) const {
+            /* copies num_bytes starting at pos out of the store */
+            while (num_bytes > 0) {
+                size_t len = std::min(num_bytes, (size_t) (TEMP_SEGMENT_SIZE - (pos & TEMP_SEGMENT_MASK)));
+                std::memcpy(dest, &segments[pos >> TEMP_SEGMENT_BITS][pos & TEMP_SEGMENT_MASK], len);
+                pos += len; dest += len; num_bytes -= len;
+            }
+        }
+
+        std::vector<bool> checkpoint(std::string ckpt_path, size_t num_bytes) {
+            /*
+             * Makes the bytes [0, num_bytes) durable under ckpt_path, and returns which of
+             * the segments were in memory. The segments that spilled are already in the
+             * file at their offsets, so only the in-memory ones are written into it before
+             * the file is renamed. From then on the file is kept: released segments are not
+             * punched out, and remove_file() leaves it for remove_checkpoint_files().
+             */
+            if (fd == -1) open_file();
+            size_t num_segments = (num_bytes + TEMP_SEGMENT_MASK) >> TEMP_SEGMENT_BITS;
+            ASSERT((first_live == 0 && num_segments <= segments.size()), "the temp store was released before the checkpoint.");
+
+            struct stat file_stat;
+            if (fstat(fd, &file_stat) == -1 || ((size_t) file_stat.st_size < num_bytes && ftruncate(fd, num_bytes) == -1))
+                FATAL_ERROR("issue occurred when extending the temporary file for the checkpoint.");
+
+            std::vector<bool> from_memory(in_memory.begin(), in_memory.begin() + num_segments);
+            for (size_t i = 0; i < num_segments; i++) {
+                size_t pos = i * TEMP_SEGMENT_SIZE;
+                size_t len = std::min((size_t) TEMP_SEGMENT_SIZE, num_bytes - pos);
+                bool ok = (in_memory[i]) ? write_all(segments[i], len, pos)
+                                         : (msync(segments[i], TEMP_SEGMENT_SIZE, MS_SYNC) == 0);
+                if (!ok) FATAL_ERROR("issue occurred when writing the checkpoint of the temporary data.");
+            }
+            if (fsync(fd) == -1 || std::rename(path.data(), ckpt_path.data()) != 0)
+                FATAL_ERROR("issue occurred when saving the checkpoint of the temporary data: %s", ckpt_path.data());
+            path = ckpt_path;
+            keep_file = true;
+            return from_memory;
+        }
+
+        void restore(std::string ckpt_path, size_t num_bytes) {
+            /* maps the bytes [0, num_bytes) of a checkpoint() file into an empty store, without reading them */
+            ASSERT((segments.empty()), "a checkpoint can only be restored into an empty temp store.");
+            path = ckpt_path;
+            fd = open(path.data(), O_RDWR);
+            struct stat file_stat;
+            if (fd == -1 || fstat(fd, &file_stat) == -1 || (size_t) file_stat.st_size < num_bytes)
+                FATAL_ERROR("the checkpoint of the temporary data is missing or incomplete: %s", path.data());
+
+            // the file is extended to whole segments, so each one can be mapped
+            size_t num_segments = (num_bytes + TEMP_SEGMENT_MASK) >> TEMP_SEGMENT_BITS;
+            if ((size_t) file_stat.st_size < num_segments * TEMP_SEGMENT_SIZE && ftruncate(fd, num_segments * TEMP_SEGMENT_SIZE) == -1)
+                FATAL_ERROR("issue occurred when extending the temporary file.");
+            for (size_t i = 0; i < num_segments; i++) {
+                char* data = (char*) mmap(NULL, TEMP_SEGMENT_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, i * TEMP_SEGMENT_SIZE);
+                if (data == MAP_FAILED) FATAL_ERROR("issue occurred mapping the temporary file.");
+                segments.push_back(data);
+                in_memory.push_back(false);
+                capacity += TEMP_SEGMENT_SIZE;
+            }
+            curr_on_disk = peak_on_disk = capacity;
+            keep_file = true;
+        }
+
+        void release_before(size_t pos) {
+            /* frees every segment that lies entirely before pos */
+            size_t end_segment = std::min(pos >> TEMP_SEGMENT_BITS, segments.size());
+            for (; first_live < end_segment; first_live++)
+                free_segment(first_live);
+        }
+
+        void remove_file() {
+            /* deletes the backing file, if one was created and it is not a checkpoint */
+            if (fd != -1 && !keep_file && std::remove(path.data()))
+                FATAL_ERROR("issue occurred while deleting temporary file.");
+        }
+
+        size_t bytes_in_memory() const {return peak_in_memory;}
+        size_t bytes_on_disk() const {return peak_on_disk;}
+
+    private:
+        std::string path = "";
+        temp_memory_budget_t* budget = nullptr;
+        size_t max_bytes = 0; // 0 means there is no limit
+
+        int fd = -1;
+        bool keep_file = false; // the file is a checkpoint
+        std::vector<char*> segments;
+        std::vector<bool> in_memory;
+        size_t capacity = 0;
+        size_t first_live = 0;
+        size_t curr_in_memory = 0, peak_in_memory = 0;
+        size_t curr_on_disk = 0, peak_on_disk = 0;
+
+        void add_segments(size_t num_bytes) {
+            /* allocates segments until num_bytes are covered */
+            if (max_bytes > 0 && num_bytes > max_bytes)
+                FATAL_ERROR("the temporary data is larger than the limit given by --tmp-size.");
+
+            while (capacity < num_bytes) {
+                char* data = nullptr;
+                bool fits = (budget != nullptr && budget->remaining >= TEMP_SEGMENT_SIZE);
+                if (fits) {
+                    data = (char*) mmap(NULL, TEMP_SEGMENT_SIZE, PROT_READ | PROT_WRITE,
+                                        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+                    if (data == MAP_FAILED) FATAL_ERROR("issue occurred allocating memory for temporary data.");
+                    budget->remaining -= TEMP_SEGMENT_SIZE;
+                    curr_in_memory += TEMP_SEGMENT_SIZE;
+                    peak_in_memory = std::max(peak_in_memory, curr_in_memory);
+                } else {
+                    // extend the file by one segment, and map the new part
+                    if (fd == -1) open_file();
+                    if (ftruncate(fd, capacity + TEMP_SEGMENT_SIZE) == -1)
+                        FATAL_ERROR("issue occurred when extending the temporary file.");
+                    data = (char*) mmap(NULL, TEMP_SEGMENT_SIZE, PROT_READ | PROT_WRITE,
+                                        MAP_SHARED, fd, capacity);
+                    if (data == MAP_FAILED) FATAL_ERROR("issue occurred mapping the temporary file.");
+                    curr_on_disk += TEMP_SEGMENT_SIZE;
+                    peak_on_disk = std::max(peak_on_disk, curr_on_disk);
+                }
+                segments.push_back(data);
+                in_memory.push_back(fits);
+                capacity += TEMP_SEGMENT_SIZE;
+            }
+        }
+
+        void free_segment(size_t num) {
+            /* unmaps the segment, and gives back its memory or disk space */
+            if (segments[num] == nullptr) return;
+            munmap(segments[num], TEMP_SEGMENT_SIZE);
+            segments[num] = nullptr;
+
+            if (in_memory[num]) {
+                budget->remaining += TEMP_SEGMENT_SIZE;
+                curr_in_memory -= TEMP_SEGMENT_SIZE;
+            } else {
+                #ifdef FALLOC_FL_PUNCH_HOLE
+                if (!keep_file)
+                    fallocate(fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, num * TEMP_SEGMENT_SIZE, TEMP_SEGMENT_SIZE);
+                #endif
+                curr_on_disk -= TEMP_SEGMENT_SIZE;
+            }
+        }
+
+        bool write_all(const char* src, size_t num_bytes, size_t offset) {
+            /* writes the buffer into the file at offset, pwrite() can write less than asked */
+            while (num_bytes > 0) {
+                ssize_t written = pwrite(fd, src, num_bytes, offset);
+                if (written <= 0) return false;
+                src += written; num_bytes -= written; offset += written;
+            }
+            return true;
+        }
+
+        void open_file() {
+            mode_t mode = S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH;
+            fd = open(path.data(), O_RDWR | O_CREAT | O_TRUNC, mode);
+            if (fd == -1)
+                FATAL_ERROR("Issue occurred when opening file for intermediate file.");
+        }
+};
+
+#endif /* end of include guard: _TEMP_STORE_H */
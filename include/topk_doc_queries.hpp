@@ -7,6 +7,9 @@
 #ifndef _TOPK_DOC_QUERIES_H
 #define _TOPK_DOC_QUERIES_H
 
+#include <query_stats.hpp>
+#include <query_engine.hpp>
+
 template <class sparse_bv_type = ri::sparse_sd_vector,
           class rle_string_t = ms_rle_string_sd>
 class topk_doc_queries : ri::r_index<sparse_bv_type, rle_string_t>
@@ -17,6 +20,7 @@ class topk_doc_queries : ri::r_index<sparse_bv_type, rle_string_t>
         bool print_profiles = false;
         std::string output_csv_path = "";
         size_t profiles_to_print = 0;
+        query_stats stats;
 
         // Used for printing out data-structure
         std::ofstream csv_sdap_output;
@@ -89,192 +93,37 @@ class topk_doc_queries : ri::r_index<sparse_bv_type, rle_string_t>
 
         void query_profiles(std::string pattern_file){
             /* Go through and query the reads and print all occurrences among top-k */
+            run_query_engine<no_seeding>(*this, pattern_file, pattern_file + ".listings", DNA, 0, 0);
+        }
 
-            // Open output/input files
-            std::ofstream listings_fd (pattern_file + ".listings");
-            gzFile fp; kseq_t* seq;
-
-            fp = gzopen(pattern_file.data(), "r"); 
-            if(fp == 0) {std::exit(1);}
-            seq = kseq_init(fp);
-
-            // Variable used keep track of position in lamdbas
-            size_t idx = 0;
-
-            // lambda to print out the document listing
-            auto process_profile = [&](std::vector<uint16_t> profile, uint16_t length) {
-                std::vector<size_t> found_docs = {};
-
-                // Go from largest lcp to smallest lcp and check for membership
-                assert(profile.size() == this->num_cols);
-                for (int i = profile.size()-1; i>=0; i-=2) {
-                    if (profile[i] >= length) {
-                        found_docs.push_back(profile[i-1]);
-                    }
-                }
-
-                // Print the listings
-                assert(found_docs.size() > 0);
-                listings_fd << "{";
-                for (size_t i = 0; i < found_docs.size(); i++) {
-                    if (i != found_docs.size()-1) 
-                        listings_fd << std::to_string(found_docs[i]) << ",";
-                    else 
-                        listings_fd << std::to_string(found_docs[i]) << "} ";
-                }
-            };
-
-            // Process each read, and print out the document lists
-            while (kseq_read(seq)>=0) {
+    private:
+        template <class, class, class, class> friend class mem_query_engine;
 
-                // Uppercase every character in read
-                for (size_t i = 0; i < seq->seq.l; ++i) 
-                {
-                    seq->seq.s[i] = static_cast<char>(std::toupper(seq->seq.s[i]));
-                }
+        const std::vector<uint16_t>& get_profile(uint8_t ch, size_t pos, bool use_end) {
+            /* returns the start or end profile of the pos-th run of ch */
+            if (use_end)
+                return end_doc_profiles[ch][pos];
+            return start_doc_profiles[ch][pos];
+        }
 
-                size_t start = 0, end = this->bwt.size(), end_pos_of_match = seq->seq.l-1;
-                std::vector<uint16_t> curr_profile (this->num_cols * 2, 0);
-                uint16_t length = 0;
-                listings_fd << ">" << seq->name.s << "\n";
-
-                // Pointer variables to current profile being "used"
-                uint8_t curr_prof_ch = 0;
-                size_t curr_prof_pos = 0, num_LF_steps = 0;
-
-                // Tell us what type of profile to grab based on pointer variables
-                bool use_start = false, use_end = false;
-
-                // Perform backward search and report document listings when
-                // range goes empty or we reach the end
-                for (int i = (seq->seq.l-1); i >= 0; i--) {
-                    uint8_t next_ch = seq->seq.s[i];
-
-                    size_t num_ch_before_start = this->bwt.rank(start, next_ch); 
-                    size_t num_ch_before_end = this->bwt.rank(end, next_ch);
-                    size_t start_run = this->bwt.run_of_position(start);
-                    size_t end_run = this->bwt.run_of_position(end-1);
-                    
-                    // range spans runs, so there are different BWT characters
-                    if (start_run != end_run) 
-                    {       
-                        // bwt range is empty, so will reset start and end
-                        if (num_ch_before_end == num_ch_before_start) {
-
-                            // grab the correct current profile, and update with steps
-                            if (use_end)
-                                curr_profile = end_doc_profiles[curr_prof_ch][curr_prof_pos];
-                            else
-                                curr_profile = start_doc_profiles[curr_prof_ch][curr_prof_pos];
-
-                            idx = 0;
-                            std::for_each(curr_profile.begin(), 
-                                          curr_profile.end(), 
-                                          [&](uint16_t &x){
-                                          if (idx % 2 == 1) 
-                                          {x = std::min((size_t) MAXLCPVALUE, x+num_LF_steps);} 
-                                          idx++;});
-                            listings_fd << "[" << (i+1) << "," << end_pos_of_match << "] ";
-
-                            length = std::min((size_t) MAXLCPVALUE, (end_pos_of_match-i));
-                            process_profile(curr_profile, length);
-                            end_pos_of_match = i;
-
-                            start = 0; end = this->bwt.size();
-                            start_run = 0; end_run = this->r - 1;
-                            num_ch_before_start = 0;
-                            num_ch_before_end = this->bwt.number_of_letter(next_ch);
-                        }
-
-                        // grab any profile at run boundary of next_ch (choose first one)
-                        curr_prof_ch = next_ch;
-                        curr_prof_pos = this->bwt.run_head_rank(start_run, next_ch);
-                        num_LF_steps = 0;
-                        use_start = false; use_end = false;
-
-                        // If the start position run is the same as query
-                        // ch, then we can guarantee that end of run is in the range
-                        // otherwise, we can guarantee the start of run is in range.
-                        if (this->bwt[start] == next_ch)
-                            use_end = true;
-                        else
-                            use_start = true;
-                    } 
-                    // range is within BWT run, but wrong character 
-                    else if (this->bwt[start] != next_ch) 
-                    {
-                        // grab the correct current profile, and update with steps
-                        if (use_end)
-                            curr_profile = end_doc_profiles[curr_prof_ch][curr_prof_pos];
-                        else
-                            curr_profile = start_doc_profiles[curr_prof_ch][curr_prof_pos];
-
-                        idx = 0;
-                        std::for_each(curr_profile.begin(), 
-                                        curr_profile.end(), 
-                                        [&](uint16_t &x){
-                                        if (idx % 2 == 1) 
-                                        {x = std::min((size_t) MAXLCPVALUE, x+num_LF_steps);} 
-                                        idx++;});
-                        listings_fd << "[" << (i+1) << "," << end_pos_of_match << "] ";
-
-                        length = std::min((size_t) MAXLCPVALUE, (end_pos_of_match-i));
-                        process_profile(curr_profile, length);
-                        end_pos_of_match = i;
-
-                        start = 0; end = this->bwt.size();
-                        start_run = 0; end_run = this->r - 1;
-                        num_ch_before_start = 0;
-                        num_ch_before_end = this->bwt.number_of_letter(next_ch);
-
-                        // grab any profile at run boundary of next_ch (choose first one)
-                        curr_prof_ch = next_ch;
-                        curr_prof_pos = this->bwt.run_head_rank(start_run, next_ch);
-                        num_LF_steps = 0;
-                        use_start = false; use_end = false;
-
-                        // If the start position run is the same as query
-                        // ch, then we can guarantee that end of run is in the range
-                        // otherwise, we can guarantee the start of run is in range.
-                        if (this->bwt[start] == next_ch)
-                            use_end = true;
-                        else
-                            use_start = true;
-                    }
-                    // range is within BWT run, and is the correct character
-                    else 
-                    {
-                        num_LF_steps++;
-                    }
-
-                    // Perform an LF step
-                    start = num_ch_before_start + this->F[next_ch]; 
-                    end = num_ch_before_end + this->F[next_ch];
+        void write_listing(std::ostream& out, const std::vector<uint16_t>& profile, 
+                           uint16_t length, bool use_end, size_t num_LF_steps) {
+            /* prints the documents among the top-k whose lcp (after the LF steps) covers the length */
+            bool found_one = false;
+            out << "{";
+
+            // Go from largest lcp to smallest lcp and check for membership
+            assert(profile.size() == (this->num_cols * 2));
+            for (int i = profile.size()-1; i > 0; i-=2) {
+                if (std::min((size_t) MAXLCPVALUE, profile[i]+num_LF_steps) >= length) {
+                    out << (found_one ? "," : "") << profile[i-1];
+                    found_one = true;
                 }
-                // grab the current profile, and update with steps
-                if (use_end)
-                    curr_profile = end_doc_profiles[curr_prof_ch][curr_prof_pos];
-                else
-                    curr_profile = start_doc_profiles[curr_prof_ch][curr_prof_pos];
-
-                // Update profile based on LF steps
-                idx = 0;
-                std::for_each(curr_profile.begin(), 
-                              curr_profile.end(), 
-                              [&](uint16_t &x){
-                              if (idx % 2 == 1) 
-                              {x = std::min((size_t) MAXLCPVALUE, x+num_LF_steps);} 
-                              idx++;});
-
-                listings_fd << "[" << 0 << "," << end_pos_of_match << "] ";
-                length = std::min((size_t) MAXLCPVALUE, end_pos_of_match+1);
-                process_profile(curr_profile, length);
-                listings_fd << "\n";
             }
-            listings_fd.close();
+            assert(found_one);
+            out << "} ";
         }
 
-    private:
         void load_bwt_structure(std::string bwt_fname) {
             /* loads the BWT data-structure from the build sub-command */
             if(rle)
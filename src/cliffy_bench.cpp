@@ -0,0 +1,324 @@
+/*
+ * File: cliffy_bench.cpp
+ * Description: Microbenchmarks for the hot kernels of the build and query
+ *              paths: rank, run_of_position and run_head_rank on the
+ *              run-length encoded BWT, the query engine (backward search,
+ *              profile fetch and listing, with and without the ftab),
+ *              minimizer digestion, MurmurHash3 and the predecessor table
+ *              update. Everything runs on a synthetic collection that is
+ *              built in-process from a fixed seed, so the throughput
+ *              numbers can be compared across commits. The query engine
+ *              runs on a doc_queries index that is written to a temporary
+ *              prefix and loaded back, so it times the code that ships.
+ * Date: October 19th, 2026
+ */
+
+#include <benchmark/benchmark.h>
+#include <string>
+#include <vector>
+#include <random>
+#include <fstream>
+#include <memory>
+#include <cstring>
+#include <cstdlib>
+#include <filesystem>
+#include <algorithm>
+#include <unistd.h>
+#include <pfp_doc.hpp>
+#include <ms_rle_string.hpp>
+#include <doc_queries.hpp>
+#include <hash_func.hpp>
+#include <minimizer_digest.hpp>
+#include <predecessor_table.hpp>
+
+extern "C" {
+    #include <gsacak.h>
+}
+
+/* shape of the synthetic collection, kept fixed so runs are comparable */
+#define BENCH_SEED 42
+#define BENCH_NUM_DOCS 16
+#define BENCH_DOC_LENGTH (1ULL << 18)
+#define BENCH_MUTATION_RATE 0.01
+#define BENCH_READ_LENGTH 150
+#define BENCH_NUM_READS 1024
+#define BENCH_NUM_QUERIES (1ULL << 16)
+#define BENCH_MAX_PROFILE_LCP 200
+
+/* synthetic index: BWT of a collection of similar genomes, and the doc_queries index built from it */
+struct bench_index_t {
+    std::vector<std::string> docs;
+    ms_rle_string_sd bwt;
+    size_t n = 0;
+    size_t r = 0;
+
+    // index files are written under a temporary directory, which is removed at exit
+    std::string temp_dir = "";
+    std::unique_ptr<doc_queries<>> queries;
+
+    // reads sampled from the documents with errors, and random positions in the BWT
+    std::string reads_path = "";
+    std::vector<size_t> positions;
+    std::vector<uint8_t> chars;
+    std::vector<size_t> runs;
+};
+
+std::string mutate_sequence(const std::string& seq, double rate, std::mt19937_64& gen) {
+    /* applies substitutions at the given rate to a copy of the sequence */
+    static const char nucs[4] = {'A', 'C', 'G', 'T'};
+    std::bernoulli_distribution mutate(rate);
+    std::uniform_int_distribution<int> nuc(0, 3);
+
+    std::string out = seq;
+    for (auto& ch: out) {
+        if (mutate(gen)) ch = nucs[nuc(gen)];
+    }
+    return out;
+}
+
+void write_profiles(std::string path, const std::string& run_heads, std::mt19937_64& gen) {
+    /* writes a *.sdap/*.edap file: the number of docs, then the BWT char and random lcps of each run */
+    std::uniform_int_distribution<uint16_t> lcp_dist(0, BENCH_MAX_PROFILE_LCP);
+    std::ofstream out_fd(path, std::ios::binary);
+    size_t num_docs = BENCH_NUM_DOCS;
+    out_fd.write((char*) &num_docs, sizeof(size_t));
+
+    std::vector<uint16_t> row(BENCH_NUM_DOCS + 1);
+    for (uint8_t ch: run_heads) {
+        row[0] = ch;
+        for (size_t j = 1; j <= BENCH_NUM_DOCS; j++) row[j] = lcp_dist(gen);
+        out_fd.write((char*) row.data(), row.size() * sizeof(uint16_t));
+    }
+    out_fd.close();
+    if (out_fd.fail()) FATAL_ERROR("unable to write the benchmark profiles: %s", path.data());
+}
+
+void build_bench_index(bench_index_t& index) {
+    /* builds the collection, its BWT through the suffix array, and the query structures */
+    std::mt19937_64 gen(BENCH_SEED);
+    std::string base = mutate_sequence(std::string(BENCH_DOC_LENGTH, 'A'), 1.0, gen);
+    for (size_t i = 0; i < BENCH_NUM_DOCS; i++)
+        index.docs.push_back(mutate_sequence(base, BENCH_MUTATION_RATE, gen));
+
+    std::vector<uint8_t> text;
+    for (auto& doc: index.docs) text.insert(text.end(), doc.begin(), doc.end());
+    text.push_back(0);
+    index.n = text.size();
+
+    std::vector<uint_t> sa(text.size());
+    gsacak(text.data(), sa.data(), nullptr, nullptr, text.size());
+
+    // run-length encode the BWT
+    std::string run_heads = "";
+    std::vector<uint64_t> run_lengths;
+    for (size_t i = 0; i < sa.size(); i++) {
+        uint8_t ch = text[(sa[i] > 0) ? sa[i] - 1 : text.size() - 1];
+        ch = std::max(ch, (uint8_t) ms_rle_string_sd::TERMINATOR);
+        if (run_heads.empty() || (uint8_t) run_heads.back() != ch) {
+            run_heads.push_back(ch);
+            run_lengths.push_back(0);
+        }
+        run_lengths.back()++;
+    }
+    index.r = run_heads.size();
+    index.bwt = ms_rle_string_sd(run_heads, run_lengths);
+
+    // write the index files the way the build does (the profiles are random lcps), and
+    // load them back with doc_queries, which also builds and loads the ftab
+    index.temp_dir = std::filesystem::temp_directory_path().string() + "/cliffy_bench_XXXXXX";
+    if (mkdtemp(index.temp_dir.data()) == nullptr)
+        FATAL_ERROR("unable to create a temporary directory for the benchmark index.");
+    std::string prefix = index.temp_dir + "/index";
+
+    std::vector<uint64_t> run_counts(256, 0);
+    for (uint8_t ch: run_heads) run_counts[ch]++;
+    std::ofstream runcnt_fd(prefix + ".runcnt", std::ios::binary);
+    runcnt_fd.write((char*) run_counts.data(), 256 * sizeof(uint64_t));
+    runcnt_fd.close();
+
+    write_profiles(prefix + ".sdap", run_heads, gen);
+    write_profiles(prefix + ".edap", run_heads, gen);
+    {doc_queries<> serializer(prefix, run_heads, run_lengths);} // writes *.bwt.cliffy and *.F.cliffy
+    index.queries.reset(new doc_queries<>(prefix));
+    index.queries->build_ftab(false);
+    index.queries->load_ftab_from_file(false);
+
+    // sample the reads and the random positions used by the kernels
+    std::uniform_int_distribution<size_t> doc_dist(0, BENCH_NUM_DOCS - 1);
+    std::uniform_int_distribution<size_t> pos_dist(0, BENCH_DOC_LENGTH - BENCH_READ_LENGTH);
+    index.reads_path = index.temp_dir + "/reads.fa";
+    std::ofstream reads_fd(index.reads_path);
+    for (size_t i = 0; i < BENCH_NUM_READS; i++) {
+        std::string read = index.docs[doc_dist(gen)].substr(pos_dist(gen), BENCH_READ_LENGTH);
+        reads_fd << ">read_" << i << "\n" << mutate_sequence(read, BENCH_MUTATION_RATE, gen) << "\n";
+    }
+    reads_fd.close();
+
+    static const uint8_t nucs[4] = {'A', 'C', 'G', 'T'};
+    std::uniform_int_distribution<size_t> bwt_dist(0, index.n - 1);
+    std::uniform_int_distribution<size_t> run_dist(0, index.r - 1);
+    std::uniform_int_distribution<int> nuc_dist(0, 3);
+    for (size_t i = 0; i < BENCH_NUM_QUERIES; i++) {
+        index.positions.push_back(bwt_dist(gen));
+        index.runs.push_back(run_dist(gen));
+        index.chars.push_back(nucs[nuc_dist(gen)]);
+    }
+}
+
+bench_index_t& bench_index() {
+    /* builds the synthetic index on first use, outside of any timed region */
+    static bench_index_t index;
+    static bool built = false;
+    if (!built) {build_bench_index(index); built = true;}
+    return index;
+}
+
+/*****************************************/
+/* Kernels on the run-length encoded BWT */
+/*****************************************/
+
+static void BM_RleRank(benchmark::State& state) {
+    bench_index_t& index = bench_index();
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(index.bwt.rank(index.positions[i], index.chars[i]));
+        i = (i + 1) & (BENCH_NUM_QUERIES - 1);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_RleRank);
+
+static void BM_RleRunOfPosition(benchmark::State& state) {
+    bench_index_t& index = bench_index();
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(index.bwt.run_of_position(index.positions[i]));
+        i = (i + 1) & (BENCH_NUM_QUERIES - 1);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_RleRunOfPosition);
+
+static void BM_RleRunHeadRank(benchmark::State& state) {
+    bench_index_t& index = bench_index();
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(index.bwt.run_head_rank(index.runs[i], index.chars[i]));
+        i = (i + 1) & (BENCH_NUM_QUERIES - 1);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_RleRunHeadRank);
+
+/*****************************************/
+/* Query engine on the doc_queries index  */
+/*****************************************/
+
+template <class seeding_t>
+static void BM_QueryEngine(benchmark::State& state) {
+    /* backward search, profile fetch and listing of every read, as done by cliffy run */
+    bench_index_t& index = bench_index();
+    std::ofstream listings_fd("/dev/null");
+    mem_query_engine<doc_queries<>, seeding_t, read_alphabet<DNA>, no_stats> engine(*index.queries, listings_fd);
+    for (auto _ : state)
+        engine.run(index.reads_path, 4, 11);
+    state.SetItemsProcessed(state.iterations() * BENCH_NUM_READS);
+    state.SetBytesProcessed(state.iterations() * BENCH_NUM_READS * BENCH_READ_LENGTH);
+}
+BENCHMARK_TEMPLATE(BM_QueryEngine, no_seeding);
+BENCHMARK_TEMPLATE(BM_QueryEngine, ftab_seeding);
+
+/*****************************************/
+/* Kernels of the construction           */
+/*****************************************/
+
+static void BM_MinimizerDigest(benchmark::State& state) {
+    /* digests one document, args are the small and large window */
+    bench_index_t& index = bench_index();
+    MinimizerDigest digester(state.range(0), state.range(1), false);
+    std::string digest = "";
+    for (auto _ : state) {
+        digester.compute_digest(index.docs[0].data(), index.docs[0].size(), digest);
+        benchmark::DoNotOptimize(digest.data());
+    }
+    state.SetBytesProcessed(state.iterations() * index.docs[0].size());
+}
+BENCHMARK(BM_MinimizerDigest)->Args({4, 11})->Args({15, 25})->Args({31, 35});
+
+static void BM_SyncmerDigest(benchmark::State& state) {
+    bench_index_t& index = bench_index();
+    MinimizerDigest digester(state.range(0), state.range(1), false);
+    digester.set_syncmer_mode(true);
+    std::string digest = "";
+    for (auto _ : state) {
+        digester.compute_digest(index.docs[0].data(), index.docs[0].size(), digest);
+        benchmark::DoNotOptimize(digest.data());
+    }
+    state.SetBytesProcessed(state.iterations() * index.docs[0].size());
+}
+BENCHMARK(BM_SyncmerDigest)->Args({4, 11})->Args({15, 25});
+
+static void BM_MurmurHash3(benchmark::State& state) {
+    std::vector<uint64_t> keys(state.range(0)), hashes(state.range(0));
+    std::mt19937_64 gen(BENCH_SEED);
+    for (auto& key: keys) key = gen();
+    for (auto _ : state) {
+        for (size_t i = 0; i < keys.size(); i++)
+            hashes[i] = MurmurHash3(keys[i]);
+        benchmark::DoNotOptimize(hashes.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * keys.size());
+}
+BENCHMARK(BM_MurmurHash3)->Arg(HASH_BLOCK_SIZE)->Arg(1 << 16);
+
+static void BM_MurmurHash3Batch(benchmark::State& state) {
+    std::vector<uint64_t> keys(state.range(0)), hashes(state.range(0));
+    std::mt19937_64 gen(BENCH_SEED);
+    for (auto& key: keys) key = gen();
+    for (auto _ : state) {
+        MurmurHash3_batch(keys.data(), hashes.data(), keys.size());
+        benchmark::DoNotOptimize(hashes.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * keys.size());
+}
+BENCHMARK(BM_MurmurHash3Batch)->Arg(HASH_BLOCK_SIZE)->Arg(1 << 16);
+
+static void BM_PredecessorRowUpdate(benchmark::State& state) {
+    /* lowers a row of the predecessor max lcp table, the arg is the number of documents */
+    size_t num_docs = state.range(0);
+    size_t row_length = (num_docs/32 + 1) * 32;
+    std::vector<uint16_t> row(row_length, MAXLCPVALUE);
+
+    std::mt19937_64 gen(BENCH_SEED);
+    std::vector<uint16_t> lcps(BENCH_NUM_QUERIES);
+    for (auto& lcp: lcps) lcp = gen() % BENCH_MAX_PROFILE_LCP;
+
+    size_t i = 0;
+    for (auto _ : state) {
+        lcp_row_min(row.data(), num_docs, lcps[i]);
+        row[i % num_docs] = MAXLCPVALUE;
+        benchmark::DoNotOptimize(row.data());
+        i = (i + 1) & (BENCH_NUM_QUERIES - 1);
+    }
+    state.SetItemsProcessed(state.iterations() * num_docs);
+}
+BENCHMARK(BM_PredecessorRowUpdate)->Arg(16)->Arg(64)->Arg(256)->Arg(1024)->Arg(4096);
+
+int main(int argc, char** argv) {
+    /* reports the shape of the synthetic index next to the results */
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+
+    bench_index_t& index = bench_index();
+    benchmark::AddCustomContext("num_docs", std::to_string(BENCH_NUM_DOCS));
+    benchmark::AddCustomContext("n", std::to_string(index.n));
+    benchmark::AddCustomContext("r", std::to_string(index.r));
+    benchmark::AddCustomContext("seed", std::to_string(BENCH_SEED));
+
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    std::filesystem::remove_all(index.temp_dir);
+    return 0;
+}
@@ -0,0 +1,340 @@
+/*
+ * File: doc_listing_test.cpp
+ * Description: Differential test for the build and run sub-commands. It
+ *              generates small random collections and reads, builds the
+ *              index with each build mode, queries it with each run mode,
+ *              and compares every listing against doc_listing_oracle,
+ *              which computes them directly from the text and its suffix
+ *              array. It also checks the predecessor table update against
+ *              a scalar loop, and that the multi-threaded scanner writes
+ *              the same parse as newscanNT.x.
+ * Usage: cliffy_difftest <path to cliffy> [num trials] [seed] [work dir]
+ * Date: October 19th, 2026
+ */
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <random>
+#include <cstdlib>
+#include <filesystem>
+#include <algorithm>
+#include <iterator>
+#include <unistd.h>
+#include <pfp_doc.hpp>
+#include <minimizer_digest.hpp>
+#include <predecessor_table.hpp>
+#include <doc_listing_oracle.hpp>
+
+/* how the listings of a mode relate to the exact document lists */
+enum listing_type {EXACT, LEFT_RIGHT};
+
+typedef struct
+{
+    std::string name = "";
+    std::string build_flags = "";
+    std::vector<std::string> run_flags;
+    listing_type type = EXACT;
+    bool digest = false;
+} test_mode_t;
+
+typedef struct
+{
+    std::string name = "";
+    std::vector<mem_listing_t> listings;
+} read_listings_t;
+
+std::vector<test_mode_t> test_modes(std::string work_dir) {
+    /* 
+     * Every build mode, with the run modes that it supports. The build only accepts
+     * the two-pass algorithm, so the one-pass and top-k modes are not tested.
+     */
+    std::vector<std::string> all_runs = {"", "-z", "-f"};
+    std::string two_pass = "-a " + work_dir + "/tmp";
+    return {
+        {"two-pass", two_pass, all_runs, EXACT},
+        {"two-pass, 4 threads", two_pass + " -T 4", all_runs, EXACT},
+        {"in-process parse, lean", two_pass + " -P -L", all_runs, EXACT},
+        {"DNA minimizers", two_pass + " -j", {"-j", "-j -z", "-j -f"}, EXACT, true},
+        {"taxcomp", two_pass + " -t -k 7", {"-t -c 7", "-t -c 7 -z", "-t -c 7 -f"}, LEFT_RIGHT},
+        {"taxcomp, overflow", two_pass + " -t -k 2", {"-t -c 2", "-t -c 2 -z", "-t -c 2 -f"}, LEFT_RIGHT}
+    };
+}
+
+std::string mutate_sequence(const std::string& seq, double rate, std::mt19937_64& gen) {
+    static const char nucs[4] = {'A', 'C', 'G', 'T'};
+    std::bernoulli_distribution mutate(rate);
+    std::uniform_int_distribution<int> nuc(0, 3);
+
+    std::string out = seq;
+    for (auto& ch: out) {
+        if (mutate(gen)) ch = nucs[nuc(gen)];
+    }
+    return out;
+}
+
+void write_fasta(std::string path, const std::vector<std::string>& names, const std::vector<std::string>& seqs) {
+    std::ofstream out_fd(path);
+    for (size_t i = 0; i < seqs.size(); i++)
+        out_fd << ">" << names[i] << "\n" << seqs[i] << "\n";
+    out_fd.close();
+    if (out_fd.fail()) FATAL_ERROR("unable to write the test file: %s", path.data());
+}
+
+std::vector<read_listings_t> parse_listings(std::string path) {
+    /* reads a *.listings file, each read is a >name line followed by "[start,end] {docs} " groups */
+    std::vector<read_listings_t> reads;
+    std::ifstream in_fd(path);
+    std::string line = "";
+    while (std::getline(in_fd, line)) {
+        if (line.size() > 0 && line[0] == '>') {
+            reads.push_back({line.substr(1), {}});
+            continue;
+        }
+        ASSERT((reads.size() > 0), "listings file does not start with a read name.");
+        size_t pos = 0;
+        while ((pos = line.find('[', pos)) != std::string::npos) {
+            mem_listing_t listing;
+            size_t comma = line.find(',', pos), close = line.find(']', pos);
+            listing.start = std::stoull(line.substr(pos + 1, comma - pos - 1));
+            listing.end = std::stoull(line.substr(comma + 1, close - comma - 1));
+
+            size_t open_brace = line.find('{', close), close_brace = line.find('}', open_brace);
+            std::stringstream docs(line.substr(open_brace + 1, close_brace - open_brace - 1));
+            std::string doc = "";
+            while (std::getline(docs, doc, ','))
+                if (doc.size() > 0) listing.docs.push_back(std::stoull(doc));
+            reads.back().listings.push_back(listing);
+            pos = close_brace;
+        }
+    }
+    return reads;
+}
+
+bool listing_matches(const mem_listing_t& found, const mem_listing_t& expected, listing_type type) {
+    if (found.start != expected.start || found.end != expected.end) return false;
+    if (type == EXACT) return found.docs == expected.docs;
+    // taxcomp only reports some of the documents, which must be a non-empty subset
+    if (found.docs.empty() != expected.docs.empty()) return false;
+    // taxcomp always includes the leftmost and rightmost documents, in order
+    if (type == LEFT_RIGHT && !expected.docs.empty()) {
+        if (found.docs.front() != expected.docs.front() || found.docs.back() != expected.docs.back())
+            return false;
+    }
+    for (auto doc: found.docs)
+        if (!std::binary_search(expected.docs.begin(), expected.docs.end(), doc)) return false;
+    return true;
+}
+
+std::string listing_to_string(const mem_listing_t& listing) {
+    std::string out = "[" + std::to_string(listing.start) + "," + std::to_string(listing.end) + "] {";
+    for (size_t i = 0; i < listing.docs.size(); i++)
+        out += ((i > 0) ? "," : "") + std::to_string(listing.docs[i]);
+    return out + "}";
+}
+
+size_t compare_listings(const std::vector<read_listings_t>& found, const std::vector<std::vector<mem_listing_t>>& expected,
+                        listing_type type, std::string label) {
+    /* returns the number of reads whose listings differ, and prints the first few */
+    size_t num_errors = 0;
+    if (found.size() != expected.size()) {
+        std::cerr << label << ": found " << found.size() << " reads in the listings, expected " << expected.size() << "\n";
+        return std::max(found.size(), expected.size());
+    }
+    for (size_t i = 0; i < found.size(); i++) {
+        bool same = (found[i].listings.size() == expected[i].size());
+        for (size_t j = 0; same && j < expected[i].size(); j++)
+            same = listing_matches(found[i].listings[j], expected[i][j], type);
+        if (same) continue;
+
+        if (num_errors++ < 3) {
+            std::cerr << label << ": read " << found[i].name << "\n  found:    ";
+            for (auto& listing: found[i].listings) std::cerr << listing_to_string(listing) << " ";
+            std::cerr << "\n  expected: ";
+            for (auto& listing: expected[i]) std::cerr << listing_to_string(listing) << " ";
+            std::cerr << "\n";
+        }
+    }
+    return num_errors;
+}
+
+bool run_command(std::string cmd, std::string log_path) {
+    return std::system((cmd + " > " + log_path + " 2>&1").data()) == 0;
+}
+
+bool same_file_contents(std::string path1, std::string path2) {
+    std::ifstream fd1(path1, std::ios::binary), fd2(path2, std::ios::binary);
+    if (!fd1 || !fd2) return false;
+    return std::string(std::istreambuf_iterator<char>(fd1), {}) == std::string(std::istreambuf_iterator<char>(fd2), {});
+}
+
+size_t test_scanner_threads(std::string ref_path, std::string work_dir) {
+    /* newscan.x with several threads must write the same dictionary, parse and occurrences as newscanNT.x */
+    if (!std::getenv("PFPDOC_BUILD_DIR")) {
+        std::cout << "test scanner threads: skipped (PFPDOC_BUILD_DIR is not set)" << std::endl;
+        return 0;
+    }
+    HelperPrograms helper_bins;
+    helper_bins.build_paths((std::string(std::getenv("PFPDOC_BUILD_DIR")) + "/bin/").data());
+    helper_bins.validate();
+
+    // each scanner writes its files next to its input, with the same options as the build
+    std::string nt_ref = work_dir + "/scan_nt.fna", mt_ref = work_dir + "/scan_mt.fna";
+    std::filesystem::copy_file(ref_path, nt_ref, std::filesystem::copy_options::overwrite_existing);
+    std::filesystem::copy_file(ref_path, mt_ref, std::filesystem::copy_options::overwrite_existing);
+
+    size_t num_failures = 0;
+    if (!run_command(helper_bins.parseNT_bin + " " + nt_ref + " -w 10 -p 100 -f", work_dir + "/scan.log") ||
+        !run_command(helper_bins.parse_fasta_bin + " " + mt_ref + " -w 10 -p 100 -f -t 4", work_dir + "/scan.log")) {
+        std::cerr << "scanner failed, see " << work_dir << "/scan.log\n";
+        num_failures++;
+    } else {
+        for (std::string ext: {".dict", ".parse", ".occ"}) {
+            if (!same_file_contents(nt_ref + ext, mt_ref + ext)) {
+                std::cerr << "  " << ext << " differs between newscanNT.x and newscan.x -t 4\n";
+                num_failures++;
+            }
+        }
+    }
+    std::cout << "test scanner threads: " << ((num_failures == 0) ? "passed" : "FAILED") << std::endl;
+    return (num_failures > 0);
+}
+
+size_t run_trial(std::string cliffy_path, std::string work_dir, size_t seed) {
+    /* generates one collection and its reads, and checks every mode, returns the number of failures */
+    std::mt19937_64 gen(seed);
+    std::uniform_int_distribution<size_t> num_docs_dist(2, 5), length_dist(3000, 6000);
+    std::uniform_real_distribution<double> rate_dist(0.005, 0.05);
+
+    // documents are mutated copies of a common genome, so matches are shared by some of them
+    size_t num_docs = num_docs_dist(gen);
+    std::string base = mutate_sequence(std::string(length_dist(gen), 'A'), 1.0, gen);
+    std::vector<std::string> docs, doc_names;
+    std::ofstream filelist_fd(work_dir + "/filelist.txt");
+    for (size_t i = 0; i < num_docs; i++) {
+        docs.push_back(mutate_sequence(base, rate_dist(gen), gen));
+        doc_names.push_back("doc_" + std::to_string(i+1));
+        std::string doc_path = work_dir + "/doc_" + std::to_string(i+1) + ".fa";
+        write_fasta(doc_path, {doc_names.back()}, {docs.back()});
+        filelist_fd << doc_path << " " << (i+1) << "\n";
+    }
+    filelist_fd.close();
+
+    // reads from the documents with errors, random reads, and reads with a char missing from the
+    // text, either inside the read or at its start (the last position reached by the search)
+    std::vector<std::string> reads, read_names;
+    std::uniform_int_distribution<size_t> doc_dist(0, num_docs - 1);
+    for (size_t i = 0; i < 50; i++) {
+        std::string read = "";
+        if (i < 40) {
+            const std::string& doc = docs[doc_dist(gen)];
+            read = mutate_sequence(doc.substr(gen() % (doc.size() - 100), 100), 0.02, gen);
+        } else {
+            read = mutate_sequence(std::string(60, 'A'), 1.0, gen);
+        }
+        if (i % 10 == 9) read[1 + gen() % (read.size() - 2)] = 'N';
+        if (i % 10 == 4) read[0] = 'N';
+        reads.push_back(read);
+        read_names.push_back("read_" + std::to_string(i));
+    }
+    std::string reads_path = work_dir + "/reads.fa";
+    write_fasta(reads_path, read_names, reads);
+
+    // the DNA minimizer modes index and query the digests, with the default windows
+    MinimizerDigest digester(4, 11, false, false);
+    std::vector<std::string> digested_docs(num_docs), digested_reads(reads.size());
+    for (size_t i = 0; i < num_docs; i++) digester.compute_digest(docs[i].data(), docs[i].size(), digested_docs[i]);
+    for (size_t i = 0; i < reads.size(); i++) digester.compute_digest(reads[i].data(), reads[i].size(), digested_reads[i]);
+
+    doc_listing_oracle oracle(docs), digest_oracle(digested_docs);
+    std::vector<std::vector<mem_listing_t>> expected, digest_expected;
+    for (auto& read: reads) expected.push_back(oracle.query(read));
+    for (auto& read: digested_reads) digest_expected.push_back(digest_oracle.query(read));
+
+    size_t num_failures = 0;
+    for (auto& mode: test_modes(work_dir)) {
+        std::string prefix = work_dir + "/index";
+        std::string build_cmd = cliffy_path + " build -f " + work_dir + "/filelist.txt -o " + prefix + " " + mode.build_flags;
+        if (!run_command(build_cmd, work_dir + "/build.log")) {
+            std::cerr << "build (" << mode.name << ") failed, see " << work_dir << "/build.log\n";
+            num_failures++;
+            continue;
+        }
+
+        for (auto& run_flags: mode.run_flags) {
+            std::string out_prefix = work_dir + "/query";
+            std::string run_cmd = cliffy_path + " run -r " + prefix + " -p " + reads_path + " -o " + out_prefix + " " + run_flags;
+            std::string label = mode.name + " / run " + (run_flags.empty() ? "(plain)" : run_flags);
+            if (!run_command(run_cmd, work_dir + "/run.log")) {
+                std::cerr << label << ": run failed, see " << work_dir << "/run.log\n";
+                num_failures++;
+                continue;
+            }
+
+            size_t num_errors = compare_listings(parse_listings(out_prefix + ".listings"),
+                                                 (mode.digest ? digest_expected : expected),
+                                                 mode.type, label);
+            std::cout << "test " << label << ": " << ((num_errors == 0) ? "passed" : "FAILED") << std::endl;
+            num_failures += (num_errors > 0);
+        }
+    }
+
+    // the reference built from the file-list is a multi-document input for the scanners
+    num_failures += test_scanner_threads(work_dir + "/index.fna", work_dir);
+    return num_failures;
+}
+
+size_t test_lcp_row_min(size_t seed) {
+    /* the SIMD row update must match a scalar min on every entry */
+    std::mt19937_64 gen(seed);
+    size_t num_failures = 0;
+    for (size_t num_docs: {1, 31, 32, 33, 100, 1000}) {
+        std::vector<uint16_t> row((num_docs/32 + 1) * 32), expected;
+        for (auto& value: row) value = gen() % MAXLCPVALUE;
+        expected = row;
+
+        for (size_t iter = 0; iter < 100; iter++) {
+            uint16_t lcp = gen() % 1000;
+            lcp_row_min(row.data(), num_docs, lcp);
+            for (size_t i = 0; i < num_docs; i++) expected[i] = std::min(expected[i], lcp);
+            size_t reset_pos = gen() % num_docs;
+            row[reset_pos] = expected[reset_pos] = MAXLCPVALUE;
+        }
+        num_failures += !std::equal(row.begin(), row.begin() + num_docs, expected.begin());
+    }
+    std::cout << "test predecessor row update: " << ((num_failures == 0) ? "passed" : "FAILED") << std::endl;
+    return num_failures;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::fprintf(stderr, "Usage: %s <path to cliffy> [num trials (default: 3)] [seed (default: 1)] [work dir (default: /tmp)]\n", argv[0]);
+        return 1;
+    }
+    std::string cliffy_path = argv[1];
+    size_t num_trials = (argc > 2) ? std::atoi(argv[2]) : 3;
+    size_t seed = (argc > 3) ? std::atoi(argv[3]) : 1;
+    std::string temp_dir = (argc > 4) ? argv[4] : "/tmp";
+
+    if (!std::filesystem::is_regular_file(cliffy_path))
+        FATAL_ERROR("the cliffy executable was not found: %s", cliffy_path.data());
+
+    size_t num_failures = test_lcp_row_min(seed);
+    for (size_t trial = 0; trial < num_trials; trial++) {
+        std::string work_dir = temp_dir + "/cliffy_difftest_XXXXXX";
+        if (mkdtemp(work_dir.data()) == nullptr)
+            FATAL_ERROR("unable to create a working directory in %s", temp_dir.data());
+
+        std::cout << "\ntrial " << trial << " (seed = " << (seed + trial) << ", dir = " << work_dir << ")" << std::endl;
+        size_t trial_failures = run_trial(cliffy_path, work_dir, seed + trial);
+        num_failures += trial_failures;
+
+        // keep the files of a failed trial to debug it
+        if (trial_failures == 0) std::filesystem::remove_all(work_dir);
+    }
+
+    std::cout << "\n" << ((num_failures == 0) ? "all tests passed" : std::to_string(num_failures) + " test(s) failed") << std::endl;
+    return (num_failures == 0) ? 0 : 1;
+}
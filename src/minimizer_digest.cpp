@@ -12,6 +12,7 @@
 
 #include <minimizer_digest.hpp>
 #include <hash_func.hpp>
+#include <seq_normalize.hpp>
 #include <string.h>
 
 MinimizerDigest::MinimizerDigest(uint64_t k, uint64_t w, bool lex_order, bool minimizer_alp): 
@@ -30,30 +31,9 @@ MinimizerDigest::MinimizerDigest(uint64_t k, uint64_t w, bool lex_order, bool mi
 
     // make sure the large window size is larger
     ASSERT((w >= k), "the large-window size cannot be smaller than small-window size.");
-
-    // initialize the lookup table 
-    this->inititalize_lookup_table();
-}
-
-MinimizerDigest::MinimizerDigest() {
-    this->inititalize_lookup_table();
-}
-
-void MinimizerDigest::inititalize_lookup_table() {
-    // initialize the lookup table 
-    for (size_t i = 0; i < UINT8_MAX; i++){
-        lookup_table[i] = UINT8_MAX;
-    }
-    update_lookup_table('A', 0x00);
-    update_lookup_table('C', 0x01);
-    update_lookup_table('G', 0x02);
-    update_lookup_table('T', 0x03);
 }
 
-void MinimizerDigest::update_lookup_table(char ch, uint8_t val) {
-    lookup_table[ch] = val;
-    lookup_table[std::tolower(ch)] = val;
-}
+MinimizerDigest::MinimizerDigest() {}
 
 void MinimizerDigest::set_windows(uint64_t k, uint64_t w) {
     this->k = k;
@@ -67,16 +47,160 @@ void MinimizerDigest::set_windows(uint64_t k, uint64_t w) {
     ASSERT((w >= k), "the large-window size cannot be smaller than small-window size.");
 }
 
-std::string MinimizerDigest::compute_digest(std::string input_seq) {
+void MinimizerDigest::set_syncmer_mode(bool status) {
+    // syncmers are written as DNA, and need the s-mer to be shorter than the syncmer
+    if (status && minimizer_alp) {FATAL_ERROR("syncmers cannot be used with the minimizer alphabet.");}
+    if (status && k >= w) {FATAL_ERROR("for syncmers, the small window must be smaller than the large window.");}
+    this->syncmer_mode = status;
+}
+
+std::string MinimizerDigest::compute_digest(const std::string& input_seq) {
+    /* convenience wrapper that returns the digest as a new string */
+    std::string digest = "";
+    compute_digest(input_seq.data(), input_seq.size(), digest);
+    return digest;
+}
+
+void MinimizerDigest::compute_digests(const char* const* seqs, const size_t* lengths, size_t num_seqs,
+                                      std::string& digests, std::vector<size_t>& offsets) {
+    /* digests a batch of sequences, the digests are concatenated into one buffer 
+       and digest i is found at [offsets[i], offsets[i+1]) */
+    digests.clear();
+    offsets.resize(num_seqs + 1);
+    offsets[0] = 0;
+
+    for (size_t i = 0; i < num_seqs; i++) {
+        compute_digest(seqs[i], lengths[i], curr_digest);
+        digests.append(curr_digest);
+        offsets[i+1] = digests.size();
+    }
+}
+
+void MinimizerDigest::compute_kmer_hashes(uint64_t start_pos, uint64_t end_pos, uint64_t* vals, uint64_t* hashes) {
+    /* computes the values of the k-mers starting at [start_pos, end_pos) from the 2-bit 
+       encoding, and then hashes them together. k-mers that contain a non-ACGT char 
+       get a value, but it is never used */
+    uint64_t last_n_bits = ((uint64_t) 1 << (2*k))-1;
+    uint64_t curr_kmer_val = 0;
+
+    for (uint64_t pos = start_pos; pos < start_pos + k - 1; pos++)
+        curr_kmer_val = (curr_kmer_val << BITS_PER_CHAR) | PACKED_GET_CODE(encoded_seq.packed, pos);
+    for (uint64_t pos = start_pos; pos < end_pos; pos++) {
+        curr_kmer_val = ((curr_kmer_val << BITS_PER_CHAR) | PACKED_GET_CODE(encoded_seq.packed, pos + k - 1)) & last_n_bits;
+        vals[pos - start_pos] = curr_kmer_val;
+    }
+
+    if (lex_order)
+        std::copy(vals, vals + (end_pos - start_pos), hashes);
+    else
+        MurmurHash3_batch(vals, hashes, end_pos - start_pos);
+}
+
+void MinimizerDigest::fill_hash_block(uint64_t start_pos, size_t length) {
+    /* computes the hashes of the k-mers starting at [start_pos, start_pos + HASH_BLOCK_SIZE) */
+    uint64_t end_pos = std::min(start_pos + HASH_BLOCK_SIZE, (uint64_t) (length - k + 1));
+    compute_kmer_hashes(start_pos, end_pos, kmer_block, hash_block);
+    hash_block_start = start_pos;
+    hash_block_end = end_pos;
+}
+
+void MinimizerDigest::compute_syncmer_digest(const char* input_seq, size_t length, std::string& digest) {
+    /* computes a digest of open syncmers, here the small window (k) is the length of the
+       s-mers and the large window (w) is the length of the syncmers. A w-mer is kept if
+       its smallest k-mer (first one if tied) starts at offset (w-k)/2, so each w-mer is
+       checked on its own without a sliding window */
+    uint64_t num_smers = w - k + 1;
+    uint64_t offset = (w - k) / 2;
+    uint64_t num_wmers = length - w + 1;
+
+    // lambda to find the first non-ACGT char at or after pos (or length if there is none)
+    auto find_next_invalid = [&] (uint64_t pos) {
+        uint64_t word = pos / MASK_CHARS_PER_WORD;
+        uint64_t bits = encoded_seq.invalid[word] & (~0ULL << (pos % MASK_CHARS_PER_WORD));
+        while (bits == 0) {
+            if (++word >= encoded_seq.invalid.size()) return (uint64_t) length;
+            bits = encoded_seq.invalid[word];
+        }
+        return word * MASK_CHARS_PER_WORD + __builtin_ctzll(bits);
+    };
+
+    // lambda to check the selection rule, given the hashes of the k-mers in a w-mer
+    auto is_open_syncmer = [&] (const uint64_t* hashes) {
+        uint64_t target = hashes[offset];
+        bool selected = true;
+        for (uint64_t i = 0; i < offset; i++) {selected &= (hashes[i] > target);}
+        for (uint64_t i = offset + 1; i < num_smers; i++) {selected &= (hashes[i] >= target);}
+        return selected;
+    };
+
+    // process the w-mers in blocks, the k-mer hashes of each block are computed together
+    syncmer_vals.resize(HASH_BLOCK_SIZE + num_smers - 1);
+    syncmer_hashes.resize(HASH_BLOCK_SIZE + num_smers - 1);
+    uint64_t next_invalid = find_next_invalid(0);
+
+    for (uint64_t block_start = 0; block_start < num_wmers; block_start += HASH_BLOCK_SIZE) {
+        uint64_t block_end = std::min(block_start + HASH_BLOCK_SIZE, num_wmers);
+        compute_kmer_hashes(block_start, block_end + num_smers - 1, syncmer_vals.data(), syncmer_hashes.data());
+
+        for (uint64_t pos = block_start; pos < block_end; pos++) {
+            // skip the w-mers that contain a non-ACGT char
+            if (next_invalid < pos) next_invalid = find_next_invalid(pos);
+            if (next_invalid < pos + w) continue;
+
+            if (is_open_syncmer(syncmer_hashes.data() + (pos - block_start))) {
+                DEBUG_MSG("SYNCMER FOUND: pos = " << pos << ", string = " << std::string(input_seq + pos, w));
+                digest.append(input_seq + pos, w);
+            }
+        }
+    }
+}
+
+void MinimizerDigest::compute_digest(const char* input_seq, size_t length, std::string& digest) {
+    /* computes the digest of the sequence, and writes it into the digest buffer */
+    digest.clear();
+
+    // return full sequnece if it less than large window
+    if (length < w) {
+        digest.assign(input_seq, length);
+        return;
+    }
+
+    // encode the sequence once, the k-mer values and the non-ACGT
+    // positions are read from the 2-bit encoding and invalid mask
+    encode_seq(input_seq, length, encoded_seq);
+    digest_encoded_seq(input_seq, length, digest);
+}
+
+void MinimizerDigest::normalize_and_digest(char* input_seq, size_t length, std::string& digest) {
+    /* upper-cases the sequence in place while encoding it, and then computes its digest, this
+       gives the same digest as upper_case_seq() followed by compute_digest() */
+    digest.clear();
+    normalize_and_encode_seq(input_seq, length, encoded_seq);
+
     // return full sequnece if it less than large window
-    if (input_seq.size() < w)
-        return input_seq;
+    if (length < w) {
+        digest.assign(input_seq, length);
+        return;
+    }
+    digest_encoded_seq(input_seq, length, digest);
+}
+
+void MinimizerDigest::digest_encoded_seq(const char* input_seq, size_t length, std::string& digest) {
+    /* computes the digest from encoded_seq, the characters of the digest are copied from input_seq */
+    if (syncmer_mode) {
+        compute_syncmer_digest(input_seq, length, digest);
+        return;
+    }
     
     // define key variables
     uint64_t curr_kmer_val = 0x00, str_pos = 0, loaded_chs = 0;
     uint64_t last_n_bits = ((uint64_t) 1 << (2*k))-1;
     uint64_t last_minimizer = UINT64_MAX;
-    std::string digest = "";
+    queue.reserve(w-k+2);
+
+    auto is_invalid = [&] (uint64_t pos) {return MASK_GET_BIT(encoded_seq.invalid, pos);};
+    auto code_at = [&] (uint64_t pos) {return PACKED_GET_CODE(encoded_seq.packed, pos);};
+    hash_block_start = hash_block_end = 0;
 
     // lambda to load up the first kmer of string, or first kmer after non-ACGT char
     auto load_first_kmer_to_queue = [&] () {
@@ -87,8 +211,8 @@ std::string MinimizerDigest::compute_digest(std::string input_seq) {
         loaded_kmers = 0;
 
         // keep going until we get our first k-mer
-        while (loaded_chs < k && str_pos < input_seq.size()) {
-            if (lookup_table[input_seq[str_pos]] == UINT8_MAX) {
+        while (loaded_chs < k && str_pos < length) {
+            if (is_invalid(str_pos)) {
                 queue.clear();
                 loaded_chs = 0; loaded_kmers = 0;
                 curr_kmer_val = 0x00;
@@ -97,107 +221,89 @@ std::string MinimizerDigest::compute_digest(std::string input_seq) {
             }
         
             curr_kmer_val <<= BITS_PER_CHAR;
-            curr_kmer_val |= lookup_table[input_seq[str_pos++]];
+            curr_kmer_val |= code_at(str_pos++);
             loaded_chs++;
         }
         
         // add first k-mer to the queue
         uint64_t hash_val = (lex_order) ? (curr_kmer_val) : MurmurHash3(curr_kmer_val); 
-        MinimizerData curr_kmer_data {(str_pos-k), curr_kmer_val, hash_val};
-        queue.push_back(curr_kmer_data);
+        queue.push_back({(str_pos-k), curr_kmer_val, hash_val});
         loaded_kmers++;
     };
 
     // lambda to add current k-mer to queue
     auto append_kmer_to_queue = [&] (uint64_t new_pos, uint64_t new_val) {
-        // compute hash value based on whether using lex order or not
-        uint64_t hash_val = (lex_order) ? new_val : MurmurHash3(new_val);
-
-        // go from the back until we see a value less then the new one
-        int it = queue.size()-1;
-        for (; it >= 0; it--) {
-            if (queue[it].hash_val < hash_val) {break;}
-        }
-        if (queue.size() > 0){
-            queue.erase(queue.begin()+it+1, queue.end());
+        // compute hash value based on whether using lex order or not, the
+        // hashes are computed ahead of time for a block of positions
+        uint64_t hash_val = new_val;
+        if (!lex_order) {
+            if (new_pos < hash_block_start || new_pos >= hash_block_end)
+                fill_hash_block(new_pos, length);
+            hash_val = hash_block[new_pos - hash_block_start];
         }
 
+        // remove k-mers from the back that are not smaller than the new one,
+        // so the queue stays increasing and the minimizer is at the front
+        while (!queue.empty() && queue.back().hash_val >= hash_val)
+            queue.pop_back();
+
         // append new kmer data
-        MinimizerData new_kmer {new_pos, new_val, hash_val};
-        queue.push_back(new_kmer);
+        queue.push_back({new_pos, new_val, hash_val});
         loaded_kmers++;
     };
 
-    // load the first kmer, and then continue char by char
-    load_first_kmer_to_queue();
+    // lambda to report the minimizer at the front, if we have a full range
+    auto report_minimizer = [&] () {
+        if (loaded_kmers < (w-k+1) || queue.front().val == last_minimizer)
+            return;
 
-    // first, we check if have enough k-mers to report a minimizer,
-    // this would happen if k = w
-    if (loaded_kmers >= (w-k+1) && queue[0].val != last_minimizer) { 
-        DEBUG_MSG("MINIMIZER FOUND: pos = " << queue[0].pos << 
-                                 ", val = " << queue[0].val << 
-                                 ", hash_val = " << queue[0].hash_val << 
-                                 ", string = " << input_seq.substr(queue[0].pos,k));   
+        DEBUG_MSG("MINIMIZER FOUND: pos = " << queue.front().pos << 
+                                 ", val = " << queue.front().val << 
+                                 ", hash_val = " << queue.front().hash_val << 
+                                 ", string = " << std::string(input_seq + queue.front().pos, k));
 
         if (minimizer_alp) {
-            ASSERT((queue[0].val <= 255), 
+            ASSERT((queue.front().val <= 255), 
                     "unexpected value seen for k-mer");
-            uint8_t min_char = KMER_TO_UINT8_CHAR(queue[0].val);
+            uint8_t min_char = KMER_TO_UINT8_CHAR(queue.front().val);
 
             ASSERT((min_char >= 3 && min_char <= 255), 
                     "unexpected value seen for minimizer alphabet");
-            digest += min_char;
+            digest.push_back(min_char);
         } else {
-            digest += input_seq.substr(queue[0].pos, k);
+            digest.append(input_seq + queue.front().pos, k);
         }
-        last_minimizer = queue[0].val;
-    }
-    // remove first element if out of range
-    if (str_pos >= w && queue[0].pos < (str_pos-w+1)){
-        queue.erase(queue.begin());
-        loaded_kmers--;
-    }
+        last_minimizer = queue.front().val;
+    };
+
+    // lambda to remove first element if out of range
+    auto remove_expired_kmer = [&] () {
+        if (str_pos >= w && queue.front().pos < (str_pos-w+1)) {
+            queue.pop_front();
+            loaded_kmers--;
+        }
+    };
+
+    // load the first kmer, and then continue char by char. first, we check 
+    // if have enough k-mers to report a minimizer, this would happen if k = w
+    load_first_kmer_to_queue();
+    report_minimizer();
+    remove_expired_kmer();
 
-    while (str_pos <= (input_seq.size()-1)) {
+    while (str_pos <= (length-1)) {
         // for non-ACGT chars, reset large window
-        if (lookup_table[input_seq[str_pos]] == UINT8_MAX) {
-            if ((input_seq.size() - (++str_pos)) >= w)
+        if (is_invalid(str_pos)) {
+            if ((length - (++str_pos)) >= w)
                 load_first_kmer_to_queue();
             else
-                return digest;
+                return;
         // for ACGT chars, add kmer to window
         } else {
             curr_kmer_val <<= BITS_PER_CHAR;
-            curr_kmer_val = (curr_kmer_val | lookup_table[input_seq[str_pos++]]) & last_n_bits;
+            curr_kmer_val = (curr_kmer_val | code_at(str_pos++)) & last_n_bits;
             append_kmer_to_queue((str_pos-k), curr_kmer_val);
         }
-
-        // report minimizer if we have a full range
-        if (loaded_kmers >= (w-k+1) && queue[0].val != last_minimizer) { 
-            DEBUG_MSG("MINIMIZER FOUND: pos = " << queue[0].pos << 
-                                     ", val = " << queue[0].val << 
-                                     ", hash_val = " << queue[0].hash_val << 
-                                     ", string = " << input_seq.substr(queue[0].pos,k));
-            
-            if (minimizer_alp) {
-                ASSERT((queue[0].val <= 255), 
-                        "unexpected value seen for k-mer");
-                uint8_t min_char = KMER_TO_UINT8_CHAR(queue[0].val);
-                
-                ASSERT((min_char >= 3 && min_char <= 255), 
-                        "unexpected value seen for minimizer alphabet");
-                digest += min_char;
-            } else {
-                digest += input_seq.substr(queue[0].pos, k);
-            }
-            last_minimizer = queue[0].val;
-        }
-
-        // remove first element if out of range
-        if (str_pos >= w && queue[0].pos < (str_pos-w+1)) {
-            queue.erase(queue.begin());
-            loaded_kmers--;
-        }
+        report_minimizer();
+        remove_expired_kmer();
     }
-    return digest;
-}
\ No newline at end of file
+}
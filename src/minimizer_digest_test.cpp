@@ -3,6 +3,7 @@
 #include <algorithm>
 #include <chrono>
 #include <minimizer_digest.hpp>
+#include <hash_func.hpp>
 
 std::string generate_random_dna_string(size_t length) {
     // declare needed variables
@@ -119,6 +120,228 @@ void test10() {
     std::cout << "test 10: passed" << std::endl;
 }
 
+void test11() {
+    // test 11: the normalization kernels should match the up_tab/comp_tab tables
+    std::string seq = "acgtNNACGTryKMbdhvACGTacgtu-@`ACGTTTGCAaccgtNacgtgggtcaTTTacgatcagtcagcatcagacAAA";
+    for (size_t length = 0; length <= seq.size(); length++) {
+        std::string upper = seq.substr(0, length), expected_upper = upper;
+        for (auto& ch: expected_upper) {ch = up_tab[(int) ch];}
+        upper_case_seq(upper.data(), upper.size());
+        ASSERT((upper == expected_upper), "upper-casing in test #11 is not correct.");
+
+        std::string rev_comp = seq.substr(0, length), expected_rev_comp = "";
+        for (auto it = rev_comp.rbegin(); it != rev_comp.rend(); it++) {expected_rev_comp += comp_tab[(int) *it];}
+        reverse_complement_seq(rev_comp.data(), rev_comp.size());
+        ASSERT((rev_comp == expected_rev_comp), "reverse complement in test #11 is not correct.");
+
+        packed_seq_t encoded;
+        std::string normalized = seq.substr(0, length);
+        normalize_and_encode_seq(normalized.data(), normalized.size(), encoded);
+        ASSERT((normalized == expected_upper), "normalization in test #11 is not correct.");
+        for (size_t i = 0; i < length; i++) {
+            uint8_t code = scalar_code(seq[i]);
+            ASSERT((MASK_GET_BIT(encoded.invalid, i) == (code == UINT8_MAX)), "invalid mask in test #11 is not correct.");
+            ASSERT((code == UINT8_MAX || PACKED_GET_CODE(encoded.packed, i) == code), "encoding in test #11 is not correct.");
+        }
+
+        // digesting while normalizing should match upper-casing the sequence first
+        MinimizerDigest digester(3, 6, false);
+        std::string raw = seq.substr(0, length), expected_digest = "", digest = "";
+        digester.compute_digest(expected_upper.data(), length, expected_digest);
+        digester.normalize_and_digest(raw.data(), length, digest);
+        ASSERT((digest == expected_digest && raw == expected_upper), "normalized digest in test #11 is not correct.");
+    }
+    std::cout << "test 11: passed" << std::endl;
+}
+
+void test12() {
+    // test 12: open syncmers with 2-mers inside 4-mers (offset 1), the second
+    // sequence has an N so the 4-mers overlapping it are skipped
+    MinimizerDigest obj(2, 4);
+    obj.set_syncmer_mode(true);
+
+    std::string digest = obj.compute_digest("ATACGTACCGATTACA");
+    ASSERT((digest == "TACGTACCGATTTACA"), "digestion #12 is not correct.");
+
+    digest = obj.compute_digest("ATACGTANCGATTACA");
+    ASSERT((digest == "TACGGATTTACA"), "digestion #12 is not correct.");
+    std::cout << "test 12: passed" << std::endl;
+}
+
+std::string baseline_minimizer_digest(const std::string& input_seq, uint64_t k, uint64_t w, bool lex_order, bool minimizer_alp) {
+    // scalar minimizer digest from before the ring buffer and the hash blocks, with a
+    // lookup table for the 2-bit codes and a vector as the queue
+    if (input_seq.size() < w)
+        return input_seq;
+
+    uint8_t lookup_table[128];
+    std::fill(lookup_table, lookup_table + 128, UINT8_MAX);
+    for (auto ch: {'A', 'C', 'G', 'T'}) {
+        lookup_table[(int) ch] = lookup_table[std::tolower(ch)] = (ch == 'A') ? 0 : (ch == 'C') ? 1 : (ch == 'G') ? 2 : 3;
+    }
+
+    std::vector<MinimizerData> queue;
+    uint64_t curr_kmer_val = 0x00, str_pos = 0, loaded_chs = 0, loaded_kmers = 0;
+    uint64_t last_n_bits = ((uint64_t) 1 << (2*k))-1;
+    uint64_t last_minimizer = UINT64_MAX;
+    std::string digest = "";
+
+    auto load_first_kmer_to_queue = [&] () {
+        queue.clear();
+        loaded_chs = 0; curr_kmer_val = 0x00; loaded_kmers = 0;
+        while (loaded_chs < k && str_pos < input_seq.size()) {
+            if (lookup_table[(int) input_seq[str_pos]] == UINT8_MAX) {
+                queue.clear();
+                loaded_chs = 0; loaded_kmers = 0; curr_kmer_val = 0x00;
+                str_pos++;
+                continue;
+            }
+            curr_kmer_val = (curr_kmer_val << BITS_PER_CHAR) | lookup_table[(int) input_seq[str_pos++]];
+            loaded_chs++;
+        }
+        uint64_t hash_val = (lex_order) ? (curr_kmer_val) : MurmurHash3(curr_kmer_val);
+        queue.push_back({(str_pos-k), curr_kmer_val, hash_val});
+        loaded_kmers++;
+    };
+
+    auto append_kmer_to_queue = [&] (uint64_t new_pos, uint64_t new_val) {
+        uint64_t hash_val = (lex_order) ? new_val : MurmurHash3(new_val);
+        int it = queue.size()-1;
+        for (; it >= 0; it--) {
+            if (queue[it].hash_val < hash_val) {break;}
+        }
+        queue.erase(queue.begin()+it+1, queue.end());
+        queue.push_back({new_pos, new_val, hash_val});
+        loaded_kmers++;
+    };
+
+    auto report_and_expire = [&] () {
+        if (loaded_kmers >= (w-k+1) && queue[0].val != last_minimizer) {
+            if (minimizer_alp)
+                digest += KMER_TO_UINT8_CHAR(queue[0].val);
+            else
+                digest += input_seq.substr(queue[0].pos, k);
+            last_minimizer = queue[0].val;
+        }
+        if (str_pos >= w && queue[0].pos < (str_pos-w+1)) {
+            queue.erase(queue.begin());
+            loaded_kmers--;
+        }
+    };
+
+    load_first_kmer_to_queue();
+    report_and_expire();
+    while (str_pos <= (input_seq.size()-1)) {
+        if (lookup_table[(int) input_seq[str_pos]] == UINT8_MAX) {
+            if ((input_seq.size() - (++str_pos)) >= w)
+                load_first_kmer_to_queue();
+            else
+                return digest;
+        } else {
+            curr_kmer_val = ((curr_kmer_val << BITS_PER_CHAR) | lookup_table[(int) input_seq[str_pos++]]) & last_n_bits;
+            append_kmer_to_queue((str_pos-k), curr_kmer_val);
+        }
+        report_and_expire();
+    }
+    return digest;
+}
+
+std::string baseline_syncmer_digest(const std::string& input_seq, uint64_t k, uint64_t w, bool lex_order) {
+    // scalar open syncmer digest: a w-mer without non-ACGT chars is kept if its
+    // smallest k-mer (first one if tied) starts at offset (w-k)/2
+    if (input_seq.size() < w)
+        return input_seq;
+
+    std::string digest = "";
+    for (size_t pos = 0; pos + w <= input_seq.size(); pos++) {
+        std::vector<uint64_t> hashes;
+        bool valid = true;
+        for (size_t j = 0; j + k <= w && valid; j++) {
+            uint64_t kmer_val = 0;
+            for (size_t l = pos + j; l < pos + j + k; l++) {
+                uint8_t code = scalar_code(input_seq[l]);
+                valid &= (code != UINT8_MAX);
+                kmer_val = (kmer_val << BITS_PER_CHAR) | (code & 0x3);
+            }
+            hashes.push_back((lex_order) ? kmer_val : MurmurHash3(kmer_val));
+        }
+        if (valid && (size_t) (std::min_element(hashes.begin(), hashes.end()) - hashes.begin()) == (w - k) / 2)
+            digest.append(input_seq, pos, w);
+    }
+    return digest;
+}
+
+void test13() {
+    // test 13: the digests should match the scalar versions above on random sequences with
+    // lower-case letters and N runs, for every mode and a range of window sizes. mtest is built
+    // for the native instruction set (AVX-512 when available) and mtest_avx2 for AVX2 only
+    #if defined(__AVX512F__) && defined(__AVX512DQ__)
+    std::string hash_path = "AVX-512";
+    #elif defined(__AVX2__)
+    std::string hash_path = "AVX2";
+    #else
+    std::string hash_path = "scalar";
+    #endif
+
+    std::mt19937_64 gen(13);
+    const char* letters = "ACGTacgtN";
+    std::discrete_distribution<> letter_dist({30, 30, 30, 30, 5, 5, 5, 5, 1});
+
+    // the batch hash should match the scalar hash for every tail length
+    for (size_t num_keys = 0; num_keys <= 40; num_keys++) {
+        std::vector<uint64_t> keys(num_keys), hashes(num_keys);
+        for (auto& key: keys) {key = gen();}
+        MurmurHash3_batch(keys.data(), hashes.data(), num_keys);
+        for (size_t i = 0; i < num_keys; i++)
+            ASSERT((hashes[i] == MurmurHash3(keys[i])), ("batch hash in test #13 is not correct (" + hash_path + ").").data());
+    }
+
+    auto random_seq = [&] (size_t length) {
+        std::string seq = "";
+        for (size_t i = 0; i < length; i++) {
+            // runs of N, so that some windows are reset more than once in a row
+            if (gen() % 500 == 0) {seq.append(1 + gen() % 40, 'N'); continue;}
+            seq += letters[letter_dist(gen)];
+        }
+        return seq;
+    };
+
+    size_t num_checks = 0;
+    for (uint64_t k: {2, 3, 4, 5, 7, 11, 15, 19, 23, 27, 31}) {
+        for (uint64_t w = k; w <= k + 64; w++) {
+            // sequences shorter than w, around a block, and spanning several blocks
+            std::vector<std::string> seqs;
+            for (size_t length: {(size_t) 0, (size_t) (w - 1), (size_t) w, (size_t) HASH_BLOCK_SIZE + w, (size_t) (gen() % (4 * HASH_BLOCK_SIZE))})
+                seqs.push_back(random_seq(length));
+
+            std::vector<const char*> seq_ptrs;
+            std::vector<size_t> seq_lengths;
+            for (auto& seq: seqs) {seq_ptrs.push_back(seq.data()); seq_lengths.push_back(seq.size());}
+
+            for (size_t mode = 0; mode < 5; mode++) {
+                // modes: lex order, hashed, minimizer alphabet, and syncmers (hashed and lex order)
+                bool lex_order = (mode == 0 || mode == 4), minimizer_alp = (mode == 2), syncmers = (mode >= 3);
+                if ((minimizer_alp && k != 4) || (syncmers && k >= w)) continue;
+
+                MinimizerDigest obj(k, w, lex_order, minimizer_alp);
+                if (syncmers) obj.set_syncmer_mode(true);
+
+                std::string digests = "";
+                std::vector<size_t> offsets;
+                obj.compute_digests(seq_ptrs.data(), seq_lengths.data(), seqs.size(), digests, offsets);
+                for (size_t i = 0; i < seqs.size(); i++) {
+                    std::string expected = (syncmers) ? baseline_syncmer_digest(seqs[i], k, w, lex_order)
+                                                      : baseline_minimizer_digest(seqs[i], k, w, lex_order, minimizer_alp);
+                    ASSERT((obj.compute_digest(seqs[i]) == expected), "digestion #13 is not correct.");
+                    ASSERT((digests.substr(offsets[i], offsets[i+1] - offsets[i]) == expected), "batch digestion #13 is not correct.");
+                    num_checks++;
+                }
+            }
+        }
+    }
+    std::cout << "test 13: passed (" << num_checks << " digests, " << hash_path << " hashing)" << std::endl;
+}
+
 void run_exp1(size_t k, bool use_minimizer_alp) {
     // experiment 1: try using k with various large windows
     size_t input_length = 1000000000;
@@ -129,7 +352,7 @@ void run_exp1(size_t k, bool use_minimizer_alp) {
     std::generate(list_of_w.begin(), list_of_w.begin()+49, [curr_w=(k-4)] () mutable { return curr_w+=4;});
 
     // iterate through different window sizes
-    std::cout << "k,w,inputlength,digestlength,time" << std::endl;
+    std::cout << "k,w,inputlength,digestlength,time,mb_per_sec" << std::endl;
     for (auto curr_w: list_of_w) {
         // create object with specified parameters
         MinimizerDigest new_obj (k, curr_w, false, use_minimizer_alp);
@@ -142,8 +365,39 @@ void run_exp1(size_t k, bool use_minimizer_alp) {
         double elapsed_time_ms = std::chrono::duration<double, std::milli>(end_time-start_time).count();
 
         // output results in csv format
-        std::cout << k << "," << curr_w << ","  << input_length << "," << curr_digest.size() << "," << elapsed_time_ms << std::endl;
+        double mb_per_sec = (input_length / (1024.0 * 1024.0)) / (elapsed_time_ms / 1000.0);
+        std::cout << k << "," << curr_w << ","  << input_length << "," << curr_digest.size() << "," 
+                  << elapsed_time_ms << "," << mb_per_sec << std::endl;
+    }
+}
+
+void run_exp2(size_t k, size_t w, size_t read_length, size_t num_reads, size_t batch_size) {
+    // experiment 2: digest short reads in batches, like the query path does
+    std::string full_dna_seq = generate_random_dna_string(read_length * num_reads);
+    std::vector<const char*> reads (num_reads, nullptr);
+    std::vector<size_t> read_lengths (num_reads, read_length);
+    for (size_t i = 0; i < num_reads; i++) {reads[i] = full_dna_seq.data() + (i * read_length);}
+
+    MinimizerDigest new_obj (k, w, false, (k == 4));
+    std::string digests = "";
+    std::vector<size_t> offsets;
+    size_t total_digest_length = 0;
+
+    // digest the reads batch by batch, re-using the same output buffers
+    auto start_time = std::chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < num_reads; i += batch_size) {
+        size_t curr_batch = std::min(batch_size, num_reads - i);
+        new_obj.compute_digests(reads.data() + i, read_lengths.data() + i, curr_batch, digests, offsets);
+        total_digest_length += digests.size();
     }
+    auto end_time = std::chrono::high_resolution_clock::now();
+    double elapsed_time_ms = std::chrono::duration<double, std::milli>(end_time-start_time).count();
+    double mb_per_sec = (full_dna_seq.size() / (1024.0 * 1024.0)) / (elapsed_time_ms / 1000.0);
+
+    // output results in csv format
+    std::cout << "k,w,readlength,numreads,batchsize,digestlength,time,mb_per_sec" << std::endl;
+    std::cout << k << "," << w << "," << read_length << "," << num_reads << "," << batch_size << "," 
+              << total_digest_length << "," << elapsed_time_ms << "," << mb_per_sec << std::endl;
 }
 
 int main() {
@@ -160,12 +414,16 @@ int main() {
     test8();
     test9();
     test10();
+    test11();
+    test12();
+    test13();
     std::cout << "\n";
 
     // experiments
     //run_exp1(7, false); std::cout << "\n";
     //run_exp1(31, false); std::cout << "\n";
     run_exp1(4, true); std::cout << "\n";
+    run_exp2(31, 35, 150, 1000000, 1024); std::cout << "\n";
 
     return 0;
 }
\ No newline at end of file
@@ -18,12 +18,17 @@
 #include <filesystem>
 #include <ref_builder.hpp>
 #include <vector>
+#include <memory>
 #include <pfp.hpp>
+#include <pfp_scanner.hpp>
 #include <pfp_lcp_doc.hpp>
 #include <pfp_lcp_doc_two_pass.hpp>
 #include <doc_queries.hpp>
 #include <tax_doc_queries.hpp>
 #include <topk_doc_queries.hpp>
+#include <build_checkpoint.hpp>
+#include <build_planner.hpp>
+#include <build_report.hpp>
 #include <immintrin.h>
 #include <getopt.h>
 #include <queue>
@@ -42,50 +47,133 @@ int build_main(int argc, char** argv) {
     build_opts.output_ref.assign(build_opts.output_prefix + ".fna");
     print_build_status_info(&build_opts);
 
-    // build the input reference file, and bitvector labeling the end for each doc
-    STATUS_LOG("cliffy::log", "building the reference file based on file-list");
+    // every stage is measured, the report is only written if requested
+    build_report report;
+    report.set_param(build_opts.checkpoint_params());
+
+    // resumable builds keep a manifest of the completed stages, which
+    // must match the current parameters and input files
+    std::unique_ptr<build_checkpoint> checkpoint;
     auto start = std::chrono::system_clock::now();
+    if (build_opts.use_resume) {
+        if (build_opts.verify_inputs)
+            STATUS_LOG("cliffy::log", "hashing the input files for the build manifest");
+        else
+            STATUS_LOG("cliffy::log", "checking the input files for the build manifest");
+        report.start_stage("manifest");
+        checkpoint.reset(new build_checkpoint(build_opts.output_prefix + ".ckpt", build_opts.checkpoint_params(), 
+                                              build_opts.input_list, build_opts.verify_inputs));
+        if (!checkpoint->resume())
+            checkpoint->start();
+        report.end_stage();
+        DONE_LOG((std::chrono::system_clock::now() - start));
+    }
+    auto stage_done = [&](std::string stage) {
+        bool done = (checkpoint != nullptr && checkpoint->is_complete(stage));
+        if (done) FORCE_LOG("cliffy::log", "skipping the %s stage, it was completed by a previous build", stage.data());
+        return done;
+    };
+
+    // determine which of the stages need to run, the in-process parse
+    // is never written to disk so it is redone along with the reference
+    bool profiles_done = stage_done(CKPT_PROFILES);
+    bool first_pass_done = !profiles_done && build_opts.use_two_pass && 
+                           is_file(build_opts.temp_prefix + ".ckpt_state") && checkpoint != nullptr &&
+                           checkpoint->stores_intact() && stage_done(CKPT_FIRST_PASS);
+    bool need_pf = !profiles_done && !first_pass_done;
+    bool need_parse = need_pf && (build_opts.in_process || !stage_done(CKPT_PARSE));
+    bool need_reference = need_parse && (build_opts.in_process || !stage_done(CKPT_REFERENCE));
+    std::string doc_lengths_file = build_opts.output_prefix + ".ckpt_doclens";
 
     ref_type database_type = DNA;
     if (build_opts.use_minimizers) database_type = MINIMIZER;
     else if (build_opts.use_dna_minimizers) database_type = DNA_MINIMIZER;
+    else if (build_opts.use_dna_syncmers) database_type = DNA_SYNCMER;
+
+    // when parsing in-process, the sequences are streamed into the scanner instead of the *.fna file
+    pfp_scanner scanner(build_opts.pfp_w, build_opts.hash_mod);
+    std::unique_ptr<RefBuilder> ref_ptr;
+    if (need_reference) {
+        // build the input reference file, and bitvector labeling the end for each doc
+        STATUS_LOG("cliffy::log", "building the reference file based on file-list");
+        start = std::chrono::system_clock::now();
+        report.start_stage(CKPT_REFERENCE);
+
+        ref_ptr.reset(new RefBuilder(build_opts.input_list, build_opts.output_prefix, build_opts.use_rcomp,
+                                     database_type, build_opts.small_window_l, build_opts.large_window_l,
+                                     (build_opts.in_process) ? &scanner : nullptr, build_opts.threads));
+        report.end_stage();
+        DONE_LOG((std::chrono::system_clock::now() - start));
 
-    RefBuilder ref_build(build_opts.input_list, build_opts.output_prefix, build_opts.use_rcomp,
-                         database_type, build_opts.small_window_l, build_opts.large_window_l);
-    DONE_LOG((std::chrono::system_clock::now() - start));
+        if (checkpoint) {
+            ref_ptr->save_doc_lengths(doc_lengths_file);
+            checkpoint->complete(CKPT_REFERENCE);
+        }
+    } else if (!profiles_done) {
+        // the profiles only need the document boundaries of the reference
+        ref_ptr.reset(new RefBuilder(doc_lengths_file, database_type));
+    }
 
-    // make sure that document numbers can be stored in 2 bytes, and 
-    // it makes sense with respect to k
-    if (ref_build.num_docs >= MAXDOCS)
-        FATAL_ERROR("An index cannot be build over %ld documents, "
-                    "please reduce to a max of %d docs.", ref_build.num_docs, MAXDOCS);
-    if ((build_opts.use_taxcomp || build_opts.use_topk) 
-        && ref_build.num_docs < build_opts.numcolsintable)
-        FATAL_ERROR("the k provided is larger than the number of documents.");
-
-    // check and make sure the document to extract is a valid id
-    if (build_opts.doc_to_extract > ref_build.num_docs) {
-        FATAL_ERROR("Document #%d was requested to be extracted,"
-                    " but there are only %d documents", build_opts.doc_to_extract, ref_build.num_docs);
+    if (ref_ptr) {
+        report.set_size("n", ref_ptr->total_length);
+        report.set_size("d", ref_ptr->num_docs);
+
+        // make sure that document numbers can be stored in 2 bytes, and 
+        // it makes sense with respect to k
+        if (ref_ptr->num_docs >= MAXDOCS)
+            FATAL_ERROR("An index cannot be build over %ld documents, "
+                        "please reduce to a max of %d docs.", ref_ptr->num_docs, MAXDOCS);
+        if ((build_opts.use_taxcomp || build_opts.use_topk) 
+            && ref_ptr->num_docs < build_opts.numcolsintable)
+            FATAL_ERROR("the k provided is larger than the number of documents.");
+
+        // check and make sure the document to extract is a valid id
+        if (build_opts.doc_to_extract > ref_ptr->num_docs) {
+            FATAL_ERROR("Document #%d was requested to be extracted,"
+                        " but there are only %d documents", build_opts.doc_to_extract, ref_ptr->num_docs);
+        }
     }
 
-    // determine the paths to the BigBWT executables
-    HelperPrograms helper_bins;
-    if (!std::getenv("PFPDOC_BUILD_DIR")) {FATAL_ERROR("Need to set PFPDOC_BUILD_DIR environment variable.");}
-    helper_bins.build_paths((std::string(std::getenv("PFPDOC_BUILD_DIR")) + "/bin/").data());
-    helper_bins.validate();
+    // parse the input text with BigBWT, or finish the in-process parse
+    if (need_parse) {
+        STATUS_LOG("cliffy::log", "generating the prefix-free parse for given reference");
+        start = std::chrono::system_clock::now();
+        report.start_stage(CKPT_PARSE);
+        if (build_opts.in_process) {
+            scanner.finish();
+        } else {
+            // determine the paths to the BigBWT executables
+            HelperPrograms helper_bins;
+            if (!std::getenv("PFPDOC_BUILD_DIR")) {FATAL_ERROR("Need to set PFPDOC_BUILD_DIR environment variable.");}
+            helper_bins.build_paths((std::string(std::getenv("PFPDOC_BUILD_DIR")) + "/bin/").data());
+            helper_bins.validate();
+            run_build_parse_cmd(&build_opts, &helper_bins);
+            if (checkpoint) checkpoint->complete(CKPT_PARSE);
+        }
+        report.end_stage();
+        DONE_LOG((std::chrono::system_clock::now() - start));
+    }
 
-    // parse the input text with BigBWT
-    STATUS_LOG("cliffy::log", "generating the prefix-free parse for given reference");
-    start = std::chrono::system_clock::now();
-    run_build_parse_cmd(&build_opts, &helper_bins);
-    DONE_LOG((std::chrono::system_clock::now() - start));
+    // load the parse and dictionary into pf object, a resumed 2nd-pass does not use it
+    std::unique_ptr<pf_parsing> pf_ptr;
+    if (need_pf) {
+        STATUS_LOG("cliffy::log", "building the parse and dictionary objects");
+        start = std::chrono::system_clock::now();
+        report.start_stage("dictionary");
+        if (build_opts.in_process)
+            pf_ptr.reset(new pf_parsing(std::move(scanner.dict), std::move(scanner.parse), build_opts.pfp_w));
+        else
+            pf_ptr.reset(new pf_parsing(build_opts.output_ref, build_opts.pfp_w));
+        report.end_stage();
+        DONE_LOG((std::chrono::system_clock::now() - start));
 
-    // load the parse and dictionary into pf object
-    STATUS_LOG("cliffy::log", "building the parse and dictionary objects");
-    start = std::chrono::system_clock::now();
-    pf_parsing pf(build_opts.output_ref, build_opts.pfp_w);
-    DONE_LOG((std::chrono::system_clock::now() - start));
+        report.set_size("phrases", pf_ptr->dict.n_phrases());
+        report.set_size("dictionary_length", pf_ptr->dict.d.size());
+        report.set_size("parse_length", pf_ptr->pars.p.size());
+    } else {
+        pf_ptr.reset(new pf_parsing());
+    }
+    pf_parsing& pf = *pf_ptr;
 
     // print info regarding the compression scheme being used
     std::cerr << "\n";
@@ -96,34 +184,76 @@ int build_main(int argc, char** argv) {
     else   
         FORCE_LOG("cliffy::log", "\033[1m\033[32mno compression scheme will be used for the doc profiles\033[0m");
 
+    // the profiles stage is recorded once its files are complete, lean builds
+    // keep the BWT runs in memory so they also need the BWT stage to finish
+    auto complete_profiles = [&]() {
+        if (!checkpoint) return;
+        checkpoint->complete(CKPT_PROFILES);
+        if (build_opts.use_two_pass)
+            pfp_lcp_doc_two_pass::remove_checkpoint_files(build_opts.temp_prefix);
+    };
+
     // builds the BWT, SA, LCP, and document array profiles and writes to a file
+    async_writer::direct_io = build_opts.use_direct_io;
     size_t num_runs = 0;
-    if (!build_opts.use_two_pass) {
+    std::string run_heads = "";
+    std::vector<uint64_t> run_lengths;
+    if (!profiles_done) report.start_stage(CKPT_PROFILES);
+    if (!profiles_done && !build_opts.use_two_pass) {
         pfp_lcp lcp(build_opts.use_heuristics, build_opts.doc_to_extract, build_opts.use_taxcomp, build_opts.use_topk, 
-                build_opts.numcolsintable, pf, build_opts.output_ref, &ref_build);
+                build_opts.numcolsintable, pf, build_opts.output_ref, ref_ptr.get(), build_opts.use_lean);
         num_runs = lcp.total_num_runs;
-    } else {
-        pfp_lcp_doc_two_pass lcp(pf, build_opts.output_ref, &ref_build, 
-                                 build_opts.temp_prefix, build_opts.tmp_size,
+        run_heads.swap(lcp.run_heads); run_lengths.swap(lcp.run_lengths);
+    } else if (!profiles_done) {
+        pfp_lcp_doc_two_pass lcp(pf, build_opts.output_ref, ref_ptr.get(), 
+                                 build_opts.temp_prefix, build_opts.tmp_size, build_opts.tmp_mem,
                                  build_opts.use_taxcomp, build_opts.use_topk,
-                                 build_opts.numcolsintable);
+                                 build_opts.numcolsintable, build_opts.threads, build_opts.use_lean,
+                                 checkpoint.get());
         num_runs = lcp.total_num_runs;
+        run_heads.swap(lcp.run_heads); run_lengths.swap(lcp.run_lengths);
+        report.set_size("temp_used", lcp.total_tmp_used);
+        report.set_size("temp_in_memory", lcp.total_tmp_in_memory);
     }
+    if (!profiles_done) {
+        report.end_stage();
+        report.set_size("r", num_runs);
+    }
+    if (!profiles_done && !build_opts.use_lean)
+        complete_profiles();
     std::cerr << "\n";
 
-    // serialize BWT & F to disk for quick loading at query time
-    if (!build_opts.use_taxcomp && !build_opts.use_topk) {
-        doc_queries doc_queries_obj(build_opts.output_ref, 7);
-    } else if (build_opts.use_taxcomp) {
-        tax_doc_queries tax_queries_obj(build_opts.output_ref);
-    } else if (build_opts.use_topk) {
-        FATAL_ERROR("Not implemented yet ...");
+    // serialize BWT & F to disk for quick loading at query time, lean
+    // builds use the runs in memory instead of re-reading the raw BWT
+    if (!stage_done(CKPT_BWT)) {
+        report.start_stage(CKPT_BWT);
+        if (!build_opts.use_taxcomp && !build_opts.use_topk) {
+            if (build_opts.use_lean) {
+                doc_queries doc_queries_obj(build_opts.output_ref, std::move(run_heads), run_lengths);
+            } else {
+                doc_queries doc_queries_obj(build_opts.output_ref, 7);
+            }
+        } else if (build_opts.use_taxcomp) {
+            if (build_opts.use_lean) {
+                tax_doc_queries tax_queries_obj(build_opts.output_ref, std::move(run_heads), run_lengths);
+            } else {
+                tax_doc_queries tax_queries_obj(build_opts.output_ref);
+            }
+        } else if (build_opts.use_topk) {
+            FATAL_ERROR("Not implemented yet ...");
+        }
+        std::vector<uint64_t>().swap(run_lengths);
+        if (build_opts.use_lean)
+            complete_profiles();
+        if (checkpoint) checkpoint->complete(CKPT_BWT);
+        report.end_stage();
+        std::cerr << "\n";
     }
-    std::cerr << "\n";
 
      // build the f_tab if requested
-    if (build_opts.make_ftab) {
+    if (build_opts.make_ftab && !stage_done(CKPT_FTAB)) {
         FORCE_LOG("cliffy::log", "\033[1m\033[32mbuilding ftab to speed-up querying\033[0m");
+        report.start_stage(CKPT_FTAB);
 
         if (!build_opts.use_taxcomp && !build_opts.use_topk){
             // build query object, and then build ftab index
@@ -161,12 +291,18 @@ int build_main(int argc, char** argv) {
         } else if (build_opts.use_topk) {
             FATAL_ERROR("Not implemented yet ...");
         }
+        if (checkpoint) checkpoint->complete(CKPT_FTAB);
+        report.end_stage();
         std::cerr << "\n";
     }
 
     // print out full time
     auto build_time = std::chrono::duration<double>((std::chrono::system_clock::now() - build_start));
     STATS_LOG("cliffy::stats", "finished: build time (s) = %.2f", build_time.count());
+    if (build_opts.report_file.length()) {
+        report.write(build_opts.report_file);
+        FORCE_LOG("cliffy::log", "wrote the build report to %s", build_opts.report_file.data());
+    }
     std::cerr << "\n";
     
     return 0;
@@ -186,10 +322,12 @@ int run_main(int argc, char** argv) {
     ref_type database_type = DNA;
     if (run_opts.use_minimizers) database_type = MINIMIZER;
     else if (run_opts.use_dna_minimizers) database_type = DNA_MINIMIZER;
+    else if (run_opts.use_dna_syncmers) database_type = DNA_SYNCMER;
 
     if (!run_opts.use_taxcomp && !run_opts.use_topk) {
         // build the doc_queries object (load data-structures)
         doc_queries doc_queries_obj (run_opts.ref_file);
+        if (run_opts.use_stats) doc_queries_obj.stats.enable(run_opts.stats_interval);
 
         // query reads, load ftab structure if we want to use it
         if (run_opts.use_ftab) {
@@ -212,6 +350,7 @@ int run_main(int argc, char** argv) {
                                           run_opts.small_window_l,
                                           run_opts.large_window_l);
         }
+        if (run_opts.use_stats) doc_queries_obj.stats.write(run_opts.output_prefix + ".stats.json");
         
         // write index to disk
         if (run_opts.write_to_file) {
@@ -226,6 +365,7 @@ int run_main(int argc, char** argv) {
         // build the tax_doc_queries object (load data-structures)
         tax_doc_queries tax_doc_queries_obj(run_opts.ref_file,
                                             run_opts.num_cols);
+        if (run_opts.use_stats) tax_doc_queries_obj.stats.enable(run_opts.stats_interval);
         
         // query reads, load ftab structure if we want to use it
         if (run_opts.use_ftab) {
@@ -248,17 +388,21 @@ int run_main(int argc, char** argv) {
                                             run_opts.small_window_l,
                                             run_opts.large_window_l);
         }
+        if (run_opts.use_stats) tax_doc_queries_obj.stats.write(run_opts.output_prefix + ".stats.json");
             
     } else if (run_opts.use_topk) {
         // build the topk_doc_queries object (load data-structures)
         topk_doc_queries topk_doc_queries_obj(run_opts.ref_file,
                                               run_opts.num_cols);
+        if (run_opts.use_stats) topk_doc_queries_obj.stats.enable(run_opts.stats_interval);
+
         // query the doc_profiles with the given reads
         STATUS_LOG("run_main", "processing the patterns");
 
         auto start = std::chrono::system_clock::now();
         topk_doc_queries_obj.query_profiles(run_opts.pattern_file);
         DONE_LOG((std::chrono::system_clock::now() - start));
+        if (run_opts.use_stats) topk_doc_queries_obj.stats.write(run_opts.output_prefix + ".stats.json");
     }
     std::cerr << "\n";
     return 0;
@@ -314,6 +458,7 @@ int repstats_main(int argc, char** argv) {
     ref_type database_type = DNA;
     if (build_opts.use_minimizers) database_type = MINIMIZER;
     else if (build_opts.use_dna_minimizers) database_type = DNA_MINIMIZER;
+    else if (build_opts.use_dna_syncmers) database_type = DNA_SYNCMER;
 
     RefBuilder ref_build(build_opts.input_list, build_opts.output_prefix, build_opts.use_rcomp,
                          database_type, build_opts.small_window_l, build_opts.large_window_l);
@@ -338,6 +483,7 @@ int repstats_main(int argc, char** argv) {
     DONE_LOG((std::chrono::system_clock::now() - start));
 
     // builds the BWT, SA, LCP, and document array profiles and writes to a file
+    async_writer::direct_io = build_opts.use_direct_io;
     size_t num_runs = 0;
     pfp_lcp_doc_two_pass lcp(pf, build_opts.output_ref, &ref_build);
     num_runs = lcp.total_num_runs;
@@ -346,14 +492,47 @@ int repstats_main(int argc, char** argv) {
     return 0;
 }
 
+int plan_main(int argc, char** argv) {
+    /* main method for the plan sub-command */
+    if (argc == 1) return pfpdoc_plan_usage();
+    std::cerr << "\n";
+
+    // grab the command-line options, and validate them
+    PFPDocPlanOptions plan_opts;
+    parse_plan_options(argc, argv, &plan_opts);
+    plan_opts.validate();
+
+    FORCE_LOG("cliffy::log", "planning a build with a memory budget of %.2f GB and %ld thread(s)",
+              plan_opts.mem_budget / 1073741824.0, plan_opts.threads);
+
+    // scan the inputs, and run the quick parse if requested
+    if (plan_opts.sample_mb > 0)
+        STATUS_LOG("cliffy::log", "scanning the file-list and parsing a %ld MB sample", plan_opts.sample_mb);
+    else
+        STATUS_LOG("cliffy::log", "scanning the file-list");
+    auto start = std::chrono::system_clock::now();
+    build_planner planner(&plan_opts);
+    DONE_LOG((std::chrono::system_clock::now() - start));
+    std::cerr << "\n";
+
+    // the report goes to stderr, and the recommended command to stdout so it can be captured
+    planner.print_report();
+    std::cerr << "\n";
+    FORCE_LOG("cliffy::log", "recommended build command:");
+    std::cout << planner.build_command() << std::endl;
+    std::cerr << "\n";
+
+    return 0;
+}
+
 void run_build_parse_cmd(PFPDocBuildOptions* build_opts, HelperPrograms* helper_bins) {
     /* generates and runs the command-line for executing the PFP of the reference */
     std::ostringstream command_stream;
 
     // important note, we are only using newscanNT.x to avoid an issue
-    // present in newscanNT.x
-    std::string curr_exe = "";
-    command_stream << helper_bins->parseNT_bin << " "; // << " -i ";
+    // present in newscan.x, the number of threads is only used for the
+    // profiles until the difftest shows both scanners give the same parse
+    command_stream << helper_bins->parseNT_bin << " ";
     command_stream << build_opts->output_ref << " ";
     command_stream << "-w " << build_opts->pfp_w;
     command_stream << " -p " << build_opts->hash_mod;
@@ -444,9 +623,25 @@ void print_build_status_info(PFPDocBuildOptions* opts) {
         std::fprintf(stderr, "\tPerformed minimizer digestion?: yes, used minimizer-alphabet (k=%d, w=%d)\n", opts->small_window_l, opts->large_window_l);
     else if (opts->use_dna_minimizers)
         std::fprintf(stderr, "\tPerformed minimizer digestion?: yes, used DNA-alphabet (k=%d, w=%d)\n", opts->small_window_l, opts->large_window_l);
+    else if (opts->use_dna_syncmers)
+        std::fprintf(stderr, "\tPerformed minimizer digestion?: yes, used DNA-alphabet open syncmers (s=%d, k=%d)\n", opts->small_window_l, opts->large_window_l);
     else
         std::fprintf(stderr, "\tPerformed minimizer digestion?: no\n");
 
+    std::fprintf(stderr, "\tNumber of threads: %ld\n", opts->threads);
+    if (opts->use_direct_io)
+        std::fprintf(stderr, "\tWriting index files with O_DIRECT?: yes\n");
+    if (opts->use_lean)
+        std::fprintf(stderr, "\tLean build (query files only)?: yes\n");
+    if (opts->use_resume)
+        std::fprintf(stderr, "\tResume from build manifest: %s.ckpt\n", opts->output_prefix.data());
+    if (opts->use_resume && opts->verify_inputs)
+        std::fprintf(stderr, "\tHash the input files?: yes\n");
+    if (opts->report_file.length())
+        std::fprintf(stderr, "\tBuild report: %s\n", opts->report_file.data());
+    if (opts->use_two_pass)
+        std::fprintf(stderr, "\tTemp memory budget: %ld bytes\n", opts->tmp_mem);
+
     if (opts->use_two_pass)
         std::fprintf(stderr, "\tBuild Algorithm: Two-Pass\n\n");
     else {
@@ -471,6 +666,8 @@ void print_repstats_status_info(PFPDocBuildOptions* opts) {
         std::fprintf(stderr, "\tPerformed minimizer digestion?: yes, used minimizer-alphabet (k=%d, w=%d)\n", opts->small_window_l, opts->large_window_l);
     else if (opts->use_dna_minimizers)
         std::fprintf(stderr, "\tPerformed minimizer digestion?: yes, used DNA-alphabet (k=%d, w=%d)\n", opts->small_window_l, opts->large_window_l);
+    else if (opts->use_dna_syncmers)
+        std::fprintf(stderr, "\tPerformed minimizer digestion?: yes, used DNA-alphabet open syncmers (s=%d, k=%d)\n", opts->small_window_l, opts->large_window_l);
     else
         std::fprintf(stderr, "\tPerformed minimizer digestion?: no\n");
     std::fprintf(stderr, "\n");
@@ -492,17 +689,26 @@ void parse_build_options(int argc, char** argv, PFPDocBuildOptions* opts) {
         {"modulus", required_argument, NULL, 'm'},
         {"two-pass", required_argument, NULL, 'a'},
         {"tmp-size", required_argument, NULL, 's'},
+        {"tmp-mem", required_argument, NULL, 'M'},
         {"small-window", required_argument, NULL, 'b'},
         {"large-window", required_argument, NULL, 'c'},
         {"minimizers", no_argument, NULL, 'i'},
         {"dna-minimizers", no_argument, NULL, 'j'},
+        {"dna-syncmers", no_argument, NULL, 'y'},
         {"no-ftab", no_argument, NULL, 'd'},
+        {"threads", required_argument, NULL, 'T'},
+        {"in-process", no_argument, NULL, 'P'},
+        {"direct-io", no_argument, NULL, 'D'},
+        {"lean", no_argument, NULL, 'L'},
+        {"resume", no_argument, NULL, 'R'},
+        {"verify-inputs", no_argument, NULL, 'V'},
+        {"report", required_argument, NULL, 'J'},
         {0, 0, 0,  0}
     };
 
     int c = 0;
     int long_index = 0;
-    while ((c = getopt_long(argc, argv, "hf:o:w:rtk:pe:nm:a:s:b:c:ijd", long_options, &long_index)) >= 0) {
+    while ((c = getopt_long(argc, argv, "hf:o:w:rtk:pe:nm:a:s:M:b:c:ijydT:PDLRVJ:", long_options, &long_index)) >= 0) {
         switch(c) {
             case 'h': pfpdoc_build_usage(); std::exit(1);
             case 'f': opts->input_list.assign(optarg); break;
@@ -517,11 +723,20 @@ void parse_build_options(int argc, char** argv, PFPDocBuildOptions* opts) {
             case 'm': opts->hash_mod = std::atoi(optarg); break;
             case 'a': opts->use_two_pass = true; opts->temp_prefix.assign(optarg); break;
             case 's': opts->tmp_size_str.assign(optarg); break;
+            case 'M': opts->tmp_mem_str.assign(optarg); break;
             case 'b': opts->small_window_l = std::atoi(optarg); break;
             case 'c': opts->large_window_l = std::atoi(optarg); break;
             case 'i': opts->use_minimizers = true; opts->is_fasta=false; break;
             case 'j': opts->use_dna_minimizers = true; break;
+            case 'y': opts->use_dna_syncmers = true; break;
             case 'd': opts->make_ftab = false; break;
+            case 'T': opts->threads = std::max(std::atoi(optarg), 0); break;
+            case 'P': opts->in_process = true; break;
+            case 'D': opts->use_direct_io = true; break;
+            case 'L': opts->use_lean = true; break;
+            case 'R': opts->use_resume = true; break;
+            case 'V': opts->verify_inputs = true; break;
+            case 'J': opts->report_file.assign(optarg); break;
             default: pfpdoc_build_usage(); std::exit(1);
         }
     }
@@ -545,12 +760,15 @@ void parse_run_options(int argc, char** argv, PFPDocRunOptions* opts) {
         {"large-window", required_argument, NULL, 'W'},
         {"minimizers", no_argument, NULL, 'i'},
         {"dna-minimizers", no_argument, NULL, 'j'},
+        {"dna-syncmers", no_argument, NULL, 'y'},
+        {"stats", no_argument, NULL, 'S'},
+        {"stats-interval", required_argument, NULL, 'I'},
         {0, 0, 0,  0}
     };
 
     int c = 0;
     int long_index = 0;
-    while ((c = getopt_long(argc, argv, "hr:p:o:sl:tkc:fzK:W:ij", long_options, &long_index)) >= 0) {
+    while ((c = getopt_long(argc, argv, "hr:p:o:sl:tkc:fzK:W:ijySI:", long_options, &long_index)) >= 0) {
         switch(c) {
             case 'h': pfpdoc_run_usage(); std::exit(1);
             case 'r': opts->ref_file.assign(optarg); break;
@@ -565,8 +783,11 @@ void parse_run_options(int argc, char** argv, PFPDocRunOptions* opts) {
             case 'z': opts->use_optimized = true; break;
             case 'i': opts->use_minimizers = true; break;
             case 'j': opts->use_dna_minimizers = true; break;
+            case 'y': opts->use_dna_syncmers = true; break;
             case 'K': opts->small_window_l = std::atoi(optarg); break;
             case 'W': opts->large_window_l = std::atoi(optarg); break;
+            case 'S': opts->use_stats = true; break;
+            case 'I': opts->use_stats = true; opts->stats_interval = std::max(0, std::atoi(optarg)); break;
             default: pfpdoc_run_usage(); std::exit(1);
         }
     }
@@ -601,6 +822,58 @@ void parse_info_options(int argc, char** argv, PFPDocInfoOptions* opts) {
     }
 }
 
+void parse_plan_options(int argc, char** argv, PFPDocPlanOptions* opts) {
+    /* parses the arguments for the plan sub-command, and returns a struct with arguments */
+
+    static struct option long_options[] = {
+        {"help",      no_argument, NULL,  'h'},
+        {"filelist",   required_argument, NULL,  'f'},
+        {"output",       required_argument, NULL,  'o'},
+        {"two-pass", required_argument, NULL, 'a'},
+        {"budget", required_argument, NULL, 'B'},
+        {"threads", required_argument, NULL, 'T'},
+        {"quick-parse", required_argument, NULL, 'q'},
+        {"revcomp",   no_argument, NULL,  'r'},
+        {"taxcomp",   no_argument, NULL,  't'},
+        {"num-col",   required_argument, NULL,  'k'},
+        {"lean", no_argument, NULL, 'L'},
+        {"modulus", required_argument, NULL, 'm'},
+        {"window", required_argument, NULL, 'w'},
+        {"small-window", required_argument, NULL, 'b'},
+        {"large-window", required_argument, NULL, 'c'},
+        {"minimizers", no_argument, NULL, 'i'},
+        {"dna-minimizers", no_argument, NULL, 'j'},
+        {"dna-syncmers", no_argument, NULL, 'y'},
+        {0, 0, 0,  0}
+    };
+
+    int c = 0;
+    int long_index = 0;
+    while ((c = getopt_long(argc, argv, "hf:o:a:B:T:q:rtk:Lm:w:b:c:ijy", long_options, &long_index)) >= 0) {
+        switch(c) {
+            case 'h': pfpdoc_plan_usage(); std::exit(1);
+            case 'f': opts->input_list.assign(optarg); break;
+            case 'o': opts->output_prefix.assign(optarg); break;
+            case 'a': opts->temp_prefix.assign(optarg); break;
+            case 'B': opts->mem_budget_str.assign(optarg); break;
+            case 'T': opts->threads = std::max(std::atoi(optarg), 0); break;
+            case 'q': opts->sample_mb = std::max(std::atoi(optarg), 0); break;
+            case 'r': opts->use_rcomp = true; break;
+            case 't': opts->use_taxcomp = true; break;
+            case 'k': opts->numcolsintable = std::max(std::atoi(optarg), 2); break;
+            case 'L': opts->use_lean = true; break;
+            case 'm': opts->hash_mod = std::atoi(optarg); break;
+            case 'w': opts->pfp_w = std::atoi(optarg); break;
+            case 'b': opts->small_window_l = std::atoi(optarg); break;
+            case 'c': opts->large_window_l = std::atoi(optarg); break;
+            case 'i': opts->use_minimizers = true; break;
+            case 'j': opts->use_dna_minimizers = true; break;
+            case 'y': opts->use_dna_syncmers = true; break;
+            default: pfpdoc_plan_usage(); std::exit(1);
+        }
+    }
+}
+
 int pfpdoc_build_usage() {
     /* prints out the usage information for the build method */
     std::fprintf(stderr, "\n%s build - builds the document array profiles using PFP.\n", TOOL_NAME);
@@ -614,11 +887,13 @@ int pfpdoc_build_usage() {
 
     std::fprintf(stderr, "\t%-21s%-10sdigest the reference using minimizer-alphabet minimizers\n", "-i, --minimizers", "");
     std::fprintf(stderr, "\t%-21s%-10sdigest the reference using DNA-alphabet minimizers\n", "-j, --dna-minimizers", "");
+    std::fprintf(stderr, "\t%-21s%-10sdigest the reference using open syncmers (s = small, k = large window)\n", "-y, --dna-syncmers", "");
     std::fprintf(stderr, "\t%-21s%-10ssize of small window used for finding minimizers (default: 4)\n", "-b, --small-window", "[INT]");
     std::fprintf(stderr, "\t%-21s%-10ssize of large window used for finding minimizers (default: 11)\n\n", "-c, --large-window", "[INT]");
 
     std::fprintf(stderr, "\t%-21s%-10suse the 2-pass construction algorithm (default: false)\n", "-a, --two-pass", "[PREFIX]");
-    std::fprintf(stderr, "\t%-21s%-10ssize of temporary storage files in GB (e.g. 4GB)\n\n", "-s, --tmp-size", "[ARG]");
+    std::fprintf(stderr, "\t%-21s%-10slimit on the size of temporary storage in GB (default: none)\n", "-s, --tmp-size", "[ARG]");
+    std::fprintf(stderr, "\t%-21s%-10smemory used to keep temporary storage off disk in GB (default: 0GB)\n\n", "-M, --tmp-mem", "[ARG]");
 
     std::fprintf(stderr, "\t%-31sturn off ftab generation, used for faster querying (default: true)\n\n", "-d, --no-ftab");
     
@@ -630,7 +905,14 @@ int pfpdoc_build_usage() {
     std::fprintf(stderr, "\t%-31sturn off any heuristics used to build profiles\n\n", "-n, --no-heuristic");
 
     std::fprintf(stderr, "\t%-21s%-10swindow size used for pfp (default: 10)\n", "-w, --window", "[INT]");
-    std::fprintf(stderr, "\t%-21s%-10shash-modulus used for pfp (default: 100)\n\n", "-m, --modulus", "[INT]");
+    std::fprintf(stderr, "\t%-21s%-10shash-modulus used for pfp (default: 100)\n", "-m, --modulus", "[INT]");
+    std::fprintf(stderr, "\t%-21s%-10snumber of threads used for parsing and profiles (default: 1)\n", "-T, --threads", "[INT]");
+    std::fprintf(stderr, "\t%-31sparse in-process without writing the *.fna file (default: false)\n", "-P, --in-process");
+    std::fprintf(stderr, "\t%-31swrite the index files with O_DIRECT, bypassing the page cache (default: false)\n", "-D, --direct-io");
+    std::fprintf(stderr, "\t%-31sonly write the files needed for querying, skips *.lcp, *.ssa, *.esa (default: false)\n", "-L, --lean");
+    std::fprintf(stderr, "\t%-31skeep a manifest of completed stages, and skip them when rerun (default: false)\n", "-R, --resume");
+    std::fprintf(stderr, "\t%-31shash the input files when resuming, instead of checking their size and mtime (default: false)\n", "-V, --verify-inputs");
+    std::fprintf(stderr, "\t%-21s%-10swrite the time, memory and I/O of each stage as JSON (default: none)\n\n", "-J, --report", "[FILE]");
 
     return 0;
 }
@@ -652,12 +934,16 @@ int pfpdoc_run_usage() {
 
     std::fprintf(stderr, "\t%-21s%-10sdigest the reference using minimizer-alphabet minimizers\n", "-i, --minimizers", "");
     std::fprintf(stderr, "\t%-21s%-10sdigest the reference using DNA-alphabet minimizers\n", "-j, --dna-minimizers", "");
+    std::fprintf(stderr, "\t%-21s%-10sdigest the reference using open syncmers (s = small, k = large window)\n", "-y, --dna-syncmers", "");
     std::fprintf(stderr, "\t%-21s%-10ssize of small window used for finding minimizers (default: 4)\n", "-K, --small-window", "[INT]");
     std::fprintf(stderr, "\t%-21s%-10ssize of large window used for finding minimizers (default: 11)\n\n", "-W, --large-window", "[INT]");
 
     std::fprintf(stderr, "\t%-31suse ftab to speed up querying (default: false)\n", "-f, --ftab");
     std::fprintf(stderr, "\t%-31suse optimized version of querying (default: false)\n\n", "-z, --optimized");
 
+    std::fprintf(stderr, "\t%-31stime each read, and write the query stats to <output>.stats.json\n", "-S, --stats");
+    std::fprintf(stderr, "\t%-21s%-10slog the throughput every INT seconds while querying (implies -S)\n\n", "-I, --stats-interval", "[INT]");
+
     std::fprintf(stderr, "\t%-31swrite data-structures to disk\n", "-s, --write");
     std::fprintf(stderr, "\t%-21s%-10supper-bound on read length (used to shrink size of index using -s)\n\n", "-l, --length", "[arg]");
     
@@ -695,6 +981,38 @@ int pfpdoc_repstats_usage() {
 
     std::fprintf(stderr, "\t%-21s%-10sdigest the reference using minimizer-alphabet minimizers\n", "-i, --minimizers", "");
     std::fprintf(stderr, "\t%-21s%-10sdigest the reference using DNA-alphabet minimizers\n", "-j, --dna-minimizers", "");
+    std::fprintf(stderr, "\t%-21s%-10sdigest the reference using open syncmers (s = small, k = large window)\n", "-y, --dna-syncmers", "");
+    std::fprintf(stderr, "\t%-21s%-10ssize of small window used for finding minimizers (default: 4)\n", "-b, --small-window", "[INT]");
+    std::fprintf(stderr, "\t%-21s%-10ssize of large window used for finding minimizers (default: 11)\n\n", "-c, --large-window", "[INT]");
+
+    std::fprintf(stderr, "\t%-21s%-10swindow size used for pfp (default: 10)\n", "-w, --window", "[INT]");
+    std::fprintf(stderr, "\t%-21s%-10shash-modulus used for pfp (default: 100)\n\n", "-m, --modulus", "[INT]");
+
+    return 0;
+}
+
+int pfpdoc_plan_usage() {
+    /* prints out the usage information for the plan method */
+    std::fprintf(stderr, "\n%s plan - estimates the memory and time of a build, and recommends its options.\n", TOOL_NAME);
+    std::fprintf(stderr, "Usage: %s plan [options]\n\n", TOOL_NAME);
+
+    std::fprintf(stderr, "Options:\n");
+    std::fprintf(stderr, "\t%-31sprints this usage message\n", "-h, --help");
+    std::fprintf(stderr, "\t%-21s%-10spath to a file-list of genomes to use\n", "-f, --filelist", "[FILE]");
+    std::fprintf(stderr, "\t%-21s%-10soutput prefix used in the suggested command\n", "-o, --output", "[PREFIX]");
+    std::fprintf(stderr, "\t%-21s%-10stemp prefix used in the suggested command (default: <output>_tmp)\n", "-a, --two-pass", "[PREFIX]");
+    std::fprintf(stderr, "\t%-21s%-10smemory budget for the build in GB (default: physical memory)\n", "-B, --budget", "[ARG]");
+    std::fprintf(stderr, "\t%-21s%-10smax number of threads to use (default: number of cores)\n", "-T, --threads", "[INT]");
+    std::fprintf(stderr, "\t%-21s%-10sparse a sample of this many MB to estimate r and the parse (default: off)\n\n", "-q, --quick-parse", "[INT]");
+
+    std::fprintf(stderr, "\t%-31sinclude the reverse-complement of sequence (default: false)\n", "-r, --revcomp");
+    std::fprintf(stderr, "\t%-31suse taxonomic compression of the document array (default: false)\n", "-t, --taxcomp");
+    std::fprintf(stderr, "\t%-21s%-10snumber of columns to include in the main table (default: 7)\n", "-k, --num-col", "[INT]");
+    std::fprintf(stderr, "\t%-31sonly write the files needed for querying (default: false)\n\n", "-L, --lean");
+
+    std::fprintf(stderr, "\t%-21s%-10sdigest the reference using minimizer-alphabet minimizers\n", "-i, --minimizers", "");
+    std::fprintf(stderr, "\t%-21s%-10sdigest the reference using DNA-alphabet minimizers\n", "-j, --dna-minimizers", "");
+    std::fprintf(stderr, "\t%-21s%-10sdigest the reference using open syncmers (s = small, k = large window)\n", "-y, --dna-syncmers", "");
     std::fprintf(stderr, "\t%-21s%-10ssize of small window used for finding minimizers (default: 4)\n", "-b, --small-window", "[INT]");
     std::fprintf(stderr, "\t%-21s%-10ssize of large window used for finding minimizers (default: 11)\n\n", "-c, --large-window", "[INT]");
 
@@ -730,6 +1048,8 @@ int main(int argc, char** argv) {
             return info_main(argc-1, argv+1);
         else if (std::strcmp(argv[1], "repstats") == 0)
             return repstats_main(argc-1, argv+1);
+        else if (std::strcmp(argv[1], "plan") == 0)
+            return plan_main(argc-1, argv+1);
     }
     return pfpdoc_usage();
 }
\ No newline at end of file
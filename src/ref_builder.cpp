@@ -19,13 +19,63 @@
 #include <numeric>
 #include <sdsl/bit_vectors.hpp>
 #include <minimizer_digest.hpp>
+#include <pfp_scanner.hpp>
+#include <seq_normalize.hpp>
+#include <omp.h>
 
 KSEQ_INIT(int, read);
 
+/* sequences of one input file after they are normalized, reverse-complemented and digested */
+typedef struct {
+    std::vector<std::string> names;
+    std::vector<std::string> seqs;
+} file_records_t;
+
+static void read_input_file(std::string file_path, bool use_revcomp, ref_type seq_type, 
+                            MinimizerDigest& digester, file_records_t& records) {
+    /* reads every sequence in the file, this runs on the worker threads */
+    FILE* fp = fopen(file_path.data(), "r"); 
+    if(fp == 0) {std::exit(1);}
+    kseq_t* seq = kseq_init(fileno(fp));
+
+    // adds the sequence to the records, after digesting it if needed. when normalize
+    // is set, the sequence is upper-cased first (in the same pass as its encoding
+    // for the digests)
+    bool digest_seqs = (seq_type == MINIMIZER || seq_type == DNA_MINIMIZER || seq_type == DNA_SYNCMER);
+    auto add_record = [&](std::string name, bool normalize) {
+        records.names.push_back(name);
+        if (digest_seqs) {
+            records.seqs.emplace_back();
+            if (normalize)
+                digester.normalize_and_digest(seq->seq.s, seq->seq.l, records.seqs.back());
+            else
+                digester.compute_digest(seq->seq.s, seq->seq.l, records.seqs.back());
+        } else {
+            if (normalize) upper_case_seq(seq->seq.s, seq->seq.l);
+            records.seqs.emplace_back(seq->seq.s, seq->seq.l);
+        }
+    };
+
+    while (kseq_read(seq)>=0) {
+        // uppercase the forward sequence
+        add_record(seq->name.s, true);
+        
+        // compute reverse complement in place (it stays upper-case), and print it
+        if (use_revcomp) {
+            reverse_complement_seq(seq->seq.s, seq->seq.l);
+            add_record(std::string(seq->name.s) + "_rev_comp", false);
+        }
+    }
+    kseq_destroy(seq);
+    fclose(fp);
+}
+
 RefBuilder::RefBuilder(std::string input_data, std::string output_prefix, 
-                        bool use_rcomp, ref_type seq_type, size_t small_w, size_t large_w): 
+                        bool use_rcomp, ref_type seq_type, size_t small_w, size_t large_w,
+                        pfp_scanner* scanner, size_t num_threads): 
                        input_file(input_data), 
-                       use_revcomp(use_rcomp)
+                       use_revcomp(use_rcomp),
+                       seq_type(seq_type)
 {
     /* Constructor of RefBuilder - builds input reference and determines size of each class */
 
@@ -68,89 +118,64 @@ RefBuilder::RefBuilder(std::string input_data, std::string output_prefix,
     if (document_ids.back() == 1) {
         FATAL_ERROR("If you only have one class ID, you should not build a document array.");}
 
-    // declare needed parameters for reading/writing
+    // declare needed parameters for reading/writing, the reference file
+    // is not written when the sequences are parsed in-process
     output_ref = output_prefix + ".fna";
-    std::ofstream output_fd (output_ref.data(), std::ofstream::out);
-    FILE* fp; kseq_t* seq;
+    std::ofstream output_fd;
+    if (scanner == nullptr)
+        output_fd.open(output_ref.data(), std::ofstream::out);
     std::vector<size_t> seq_lengths;
 
-    // create minimizer digest object (will only be used when seq_type == MINIMIZER or DNA_MINIMIZER)
-    MinimizerDigest digester(small_w, large_w, false, (seq_type == MINIMIZER));
-    std::string mseq = "";
-
     // second, start working on building the reference file by reading each file ...
     curr_id = 1;
     size_t curr_id_seq_length = 0;
-    for (auto iter = input_files.begin(); iter != input_files.end(); ++iter) {
-
-        fp = fopen((*iter).data(), "r"); 
-        if(fp == 0) {std::exit(1);}
-
-        seq = kseq_init(fileno(fp));
-        size_t iter_index = static_cast<size_t>(iter-input_files.begin());
-
-        while (kseq_read(seq)>=0) {
-            // uppercase the forward sequence
-			for (size_t i = 0; i < seq->seq.l; ++i) {seq->seq.s[i] = up_tab[(int) seq->seq.s[i]];}
-
-            // write it out to file
-            if (seq_type == MINIMIZER) {
-                mseq = digester.compute_digest(seq->seq.s);
-                output_fd << mseq;
-                curr_id_seq_length += mseq.size();
-            } else if (seq_type == DNA_MINIMIZER) {
-                mseq = digester.compute_digest(seq->seq.s);
-                output_fd << '>' << seq->name.s << '\n' << mseq << '\n';
-                curr_id_seq_length += mseq.size();
-            } else {
-                output_fd << '>' << seq->name.s << '\n' << seq->seq.s << '\n';
-                curr_id_seq_length += seq->seq.l;
-            }
-            
-            // compute reverse complement, and print it. based on seqtk reverse complement 
-            // code, that does it in place. (https://github.com/lh3/seqtk/blob/master/seqtk.c)
-            if (use_revcomp) {
-                int c0, c1;
-                for (size_t i = 0; i < seq->seq.l>>1; ++i) { // reverse complement sequence
-                    c0 = comp_tab[(int)seq->seq.s[i]];
-                    c1 = comp_tab[(int)seq->seq.s[seq->seq.l - 1 - i]];
-                    seq->seq.s[i] = c1;
-                    seq->seq.s[seq->seq.l - 1 - i] = c0;
-                }
-                if (seq->seq.l & 1) // complement the remaining base
-                    seq->seq.s[seq->seq.l>>1] = comp_tab[static_cast<int>(seq->seq.s[seq->seq.l>>1])];
-
-
-                // write out the reverse complement
-                if (seq_type == MINIMIZER) {
-                    mseq = digester.compute_digest(seq->seq.s);
-                    output_fd << mseq;
-                    curr_id_seq_length += mseq.size();
-                } else if (seq_type == DNA_MINIMIZER) {
-                    mseq = digester.compute_digest(seq->seq.s);
-                    output_fd << '>' << seq->name.s << "_rev_comp" << '\n' << mseq << '\n';
-                    curr_id_seq_length += mseq.size();
-                } else {
-                    output_fd << '>' << seq->name.s << "_rev_comp" << '\n' << seq->seq.s << '\n';
-                    curr_id_seq_length += seq->seq.l;
-                }
 
-            }
+    // each sequence is either written to the reference file or streamed into the scanner
+    auto output_sequence = [&](const std::string& name, const char* curr_seq, size_t length) {
+        if (scanner != nullptr)
+            scanner->add(curr_seq, length);
+        else if (seq_type == MINIMIZER)
+            output_fd.write(curr_seq, length);
+        else {
+            output_fd << '>' << name << '\n';
+            output_fd.write(curr_seq, length);
+            output_fd << '\n';
         }
-        kseq_destroy(seq);
-        fclose(fp);
-
-        // check if we are transitioning to a new group
-        if (iter_index < document_ids.size()-1 && document_ids[iter_index] != document_ids[iter_index+1]){
-            seq_lengths.push_back(curr_id_seq_length);
-            curr_id += 1; curr_id_seq_length = 0;
-        // if it is the last file, output current sequence length
-        } else if (iter_index == document_ids.size()-1) {
-            seq_lengths.push_back(curr_id_seq_length);
-            curr_id_seq_length = 0;
+        curr_id_seq_length += length;
+    };
+    // the files are read and processed by a pool of worker threads, while the
+    // ordered section writes them out in file-list order, so the document
+    // boundaries are exactly the same as a serial read
+    #pragma omp parallel num_threads(std::max((size_t) 1, num_threads))
+    {
+        // each thread has its own minimizer digest object (only used when the sequences are digested)
+        MinimizerDigest digester(small_w, large_w, false, (seq_type == MINIMIZER));
+        if (seq_type == DNA_SYNCMER) digester.set_syncmer_mode(true);
+
+        #pragma omp for ordered schedule(dynamic, 1)
+        for (size_t iter_index = 0; iter_index < input_files.size(); iter_index++) {
+            file_records_t records;
+            read_input_file(input_files[iter_index], use_revcomp, seq_type, digester, records);
+
+            #pragma omp ordered
+            {
+                for (size_t i = 0; i < records.seqs.size(); i++)
+                    output_sequence(records.names[i], records.seqs[i].data(), records.seqs[i].size());
+
+                // check if we are transitioning to a new group
+                if (iter_index < document_ids.size()-1 && document_ids[iter_index] != document_ids[iter_index+1]){
+                    seq_lengths.push_back(curr_id_seq_length);
+                    curr_id += 1; curr_id_seq_length = 0;
+                // if it is the last file, output current sequence length
+                } else if (iter_index == document_ids.size()-1) {
+                    seq_lengths.push_back(curr_id_seq_length);
+                    curr_id_seq_length = 0;
+                }
+            }
         }
     }
-    output_fd.close();
+    if (output_fd.is_open())
+        output_fd.close();
 
     // add 1 to last document for $ and find total length
     size_t total_input_length = 0;
@@ -161,13 +186,46 @@ RefBuilder::RefBuilder(std::string input_data, std::string output_prefix,
     
     this->total_length = total_input_length;
     this->num_docs = seq_lengths.size();
+    this->doc_lengths = seq_lengths;
+    build_doc_ends();
+}
+
+RefBuilder::RefBuilder(std::string doc_lengths_file, ref_type seq_type): seq_type(seq_type) {
+    /* Constructor of RefBuilder - restores the document lengths written by save_doc_lengths() */
+    std::ifstream input_fd (doc_lengths_file.data(), std::ios::binary);
+    if (!input_fd.is_open())
+        FATAL_ERROR("unable to open the document lengths file: %s", doc_lengths_file.data());
+
+    uint64_t num_lengths = 0;
+    input_fd.read((char*) &num_lengths, sizeof(uint64_t));
+    doc_lengths.resize(num_lengths);
+    input_fd.read((char*) doc_lengths.data(), num_lengths * sizeof(size_t));
+    if (!input_fd)
+        FATAL_ERROR("the document lengths file is truncated: %s", doc_lengths_file.data());
+
+    this->total_length = std::accumulate(doc_lengths.begin(), doc_lengths.end(), (size_t) 0);
+    this->num_docs = doc_lengths.size();
+    build_doc_ends();
+}
+
+void RefBuilder::save_doc_lengths(std::string doc_lengths_file) {
+    /* writes the length of each document, so a resumed build can skip re-reading the input */
+    std::ofstream output_fd (doc_lengths_file.data(), std::ios::binary);
+    uint64_t num_lengths = doc_lengths.size();
+    output_fd.write((char*) &num_lengths, sizeof(uint64_t));
+    output_fd.write((char*) doc_lengths.data(), num_lengths * sizeof(size_t));
+    output_fd.close();
+    if (output_fd.fail())
+        FATAL_ERROR("issue occurred while writing the document lengths file: %s", doc_lengths_file.data());
+}
 
-    // build bitvector/rank support marking the end of each document
-    doc_ends = sdsl::bit_vector(total_input_length, 0);
+void RefBuilder::build_doc_ends() {
+    /* builds the bitvector/rank support marking the end of each document */
+    doc_ends = sdsl::bit_vector(total_length, 0);
     size_t curr_sum = 0;
 
-    for (size_t i = 0; i < seq_lengths.size(); i++) {
-        curr_sum += seq_lengths[i];
+    for (size_t i = 0; i < doc_lengths.size(); i++) {
+        curr_sum += doc_lengths[i];
         doc_ends[curr_sum-1] = 1;
     }
     doc_ends_rank = sdsl::rank_support_v<1> (&doc_ends); 